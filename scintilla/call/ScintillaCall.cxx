@@ -811,6 +811,14 @@ int ScintillaCall::UndoSequence() {
 	return static_cast<int>(Call(Message::GetUndoSequence));
 }
 
+void ScintillaCall::SetUndoMemoryLimit(Position bytes) {
+	Call(Message::SetUndoMemoryLimit, bytes);
+}
+
+Position ScintillaCall::UndoMemoryLimit() {
+	return Call(Message::GetUndoMemoryLimit);
+}
+
 int ScintillaCall::UndoActions() {
 	return static_cast<int>(Call(Message::GetUndoActions));
 }
@@ -1243,6 +1251,10 @@ Position ScintillaCall::FindTextFull(Scintilla::FindOption searchFlags, TextToFi
 	return CallPointer(Message::FindTextFull, static_cast<uintptr_t>(searchFlags), ft);
 }
 
+Position ScintillaCall::FindTextAll(Scintilla::FindOption searchFlags, TextToFindAll *ft) {
+	return CallPointer(Message::FindTextAll, static_cast<uintptr_t>(searchFlags), ft);
+}
+
 Position ScintillaCall::FormatRange(bool draw, void *fr) {
 	return CallPointer(Message::FormatRange, draw, fr);
 }
@@ -1511,6 +1523,10 @@ Position ScintillaCall::SearchInTarget(Position length, const char *text) {
 	return CallString(Message::SearchInTarget, length, text);
 }
 
+Position ScintillaCall::ReplaceAllInTarget(const char *search, const char *replacement) {
+	return CallString(Message::ReplaceAllInTarget, reinterpret_cast<uintptr_t>(search), replacement);
+}
+
 void ScintillaCall::SetSearchFlags(Scintilla::FindOption searchFlags) {
 	Call(Message::SetSearchFlags, static_cast<uintptr_t>(searchFlags));
 }
@@ -1519,6 +1535,22 @@ FindOption ScintillaCall::SearchFlags() {
 	return static_cast<Scintilla::FindOption>(Call(Message::GetSearchFlags));
 }
 
+Position ScintillaCall::FindIndicatorStart(Position length, const char *text) {
+	return CallString(Message::FindIndicatorStart, length, text);
+}
+
+void ScintillaCall::FindIndicatorCancel() {
+	Call(Message::FindIndicatorCancel);
+}
+
+bool ScintillaCall::FindIndicatorBusy() {
+	return Call(Message::GetFindIndicatorBusy);
+}
+
+Position ScintillaCall::FindIndicatorCount() {
+	return Call(Message::GetFindIndicatorCount);
+}
+
 void ScintillaCall::CallTipShow(Position pos, const char *definition) {
 	CallString(Message::CallTipShow, pos, definition);
 }
@@ -1771,6 +1803,14 @@ LineCache ScintillaCall::LayoutCache() {
 	return static_cast<Scintilla::LineCache>(Call(Message::GetLayoutCache));
 }
 
+void ScintillaCall::SetLayoutCacheBudget(Position bytes) {
+	Call(Message::SetLayoutCacheBudget, bytes);
+}
+
+Position ScintillaCall::LayoutCacheBudget() {
+	return Call(Message::GetLayoutCacheBudget);
+}
+
 void ScintillaCall::SetScrollWidth(int pixelWidth) {
 	Call(Message::SetScrollWidth, pixelWidth);
 }
@@ -2255,6 +2295,18 @@ DocumentOption ScintillaCall::DocumentOptions() {
 	return static_cast<Scintilla::DocumentOption>(Call(Message::GetDocumentOptions));
 }
 
+Position ScintillaCall::GetTrigramIndex(char *data) {
+	return CallPointer(Message::GetTrigramIndex, 0, data);
+}
+
+std::string ScintillaCall::GetTrigramIndex() {
+	return CallReturnString(Message::GetTrigramIndex, 0);
+}
+
+bool ScintillaCall::SetTrigramIndex(Position length, const char *data) {
+	return CallString(Message::SetTrigramIndex, length, data);
+}
+
 ModificationFlags ScintillaCall::ModEventMask() {
 	return static_cast<Scintilla::ModificationFlags>(Call(Message::GetModEventMask));
 }
@@ -121,7 +121,7 @@ private:
 		guint timer;
 		TimeThunk() noexcept : reason(TickReason::caret), scintilla(nullptr), timer(0) {}
 	};
-	TimeThunk timers[static_cast<size_t>(TickReason::dwell)+1];
+	TimeThunk timers[static_cast<size_t>(TickReason::find)+1];
 	bool FineTickerRunning(TickReason reason) override;
 	void FineTickerStart(TickReason reason, int millis, int tolerance) override;
 	void FineTickerCancel(TickReason reason) override;
@@ -884,13 +884,13 @@ void ScintillaGTKAccessible::Notify(GtkWidget *, gint, NotificationData *nt) {
 		return;
 	switch (nt->nmhdr.code) {
 		case Notification::Modified: {
-			if (FlagSet(nt->modificationType, ModificationFlags::InsertText)) {
+			if (FlagSet(nt->modificationType, ModificationFlags::InsertText | ModificationFlags::ReplaceAll)) {
 				int startChar = CharacterOffsetFromByteOffset(nt->position);
 				int lengthChar = sci->pdoc->CountCharacters(nt->position, nt->position + nt->length);
 				g_signal_emit_by_name(accessible, "text-changed::insert", startChar, lengthChar);
 				UpdateCursor();
 			}
-			if (FlagSet(nt->modificationType, ModificationFlags::BeforeDelete)) {
+			if (FlagSet(nt->modificationType, ModificationFlags::BeforeDelete | ModificationFlags::BeforeReplaceAll)) {
 				int startChar = CharacterOffsetFromByteOffset(nt->position);
 				int lengthChar = sci->pdoc->CountCharacters(nt->position, nt->position + nt->length);
 				g_signal_emit_by_name(accessible, "text-changed::delete", startChar, lengthChar);
@@ -114,6 +114,30 @@ AutoComplete.o: \
 	../src/CharacterType.h \
 	../src/Position.h \
 	../src/AutoComplete.h
+BackgroundFind.o: \
+	../src/BackgroundFind.cxx \
+	../include/ScintillaTypes.h \
+	../include/ILoader.h \
+	../include/Sci_Position.h \
+	../include/ILexer.h \
+	../src/Debugging.h \
+	../src/CharacterCategoryMap.h \
+	../src/Position.h \
+	../src/SplitVector.h \
+	../src/Partitioning.h \
+	../src/RunStyles.h \
+	../src/PieceTree.h \
+	../src/CellBuffer.h \
+	../src/CharClassify.h \
+	../src/Decoration.h \
+	../src/CaseFolder.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
+	../src/Document.h \
+	../src/DocumentSnapshot.h \
+	../src/BackgroundFind.h \
+	../src/RESearch.h \
+	../src/UniConversion.h
 CallTip.o: \
 	../src/CallTip.cxx \
 	../include/ScintillaTypes.h \
@@ -142,8 +166,10 @@ CellBuffer.o: \
 	../src/RunStyles.h \
 	../src/SparseVector.h \
 	../src/ChangeHistory.h \
+	../src/PieceTree.h \
 	../src/CellBuffer.h \
 	../src/UndoHistory.h \
+	../src/StringSearch.h \
 	../src/UniConversion.h
 ChangeHistory.o: \
 	../src/ChangeHistory.cxx \
@@ -200,15 +226,26 @@ Document.o: \
 	../src/SplitVector.h \
 	../src/Partitioning.h \
 	../src/RunStyles.h \
+	../src/PieceTree.h \
 	../src/CellBuffer.h \
 	../src/PerLine.h \
 	../src/CharClassify.h \
 	../src/Decoration.h \
 	../src/CaseFolder.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
 	../src/Document.h \
+	../src/DocumentSnapshot.h \
+	../src/BackgroundFind.h \
+	../src/TrigramIndex.h \
 	../src/RESearch.h \
 	../src/UniConversion.h \
 	../src/ElapsedPeriod.h
+DocumentSnapshot.o: \
+	../src/DocumentSnapshot.cxx \
+	../src/Position.h \
+	../src/PieceTree.h \
+	../src/DocumentSnapshot.h
 EditModel.o: \
 	../src/EditModel.cxx \
 	../include/ScintillaTypes.h \
@@ -268,8 +305,10 @@ Editor.o: \
 	../src/Decoration.h \
 	../src/CaseFolder.h \
 	../src/Document.h \
+	../src/BackgroundFind.h \
 	../src/UniConversion.h \
 	../src/DBCS.h \
+	../src/ThreadPool.h \
 	../src/Selection.h \
 	../src/PositionCache.h \
 	../src/EditModel.h \
@@ -308,6 +347,7 @@ EditView.o: \
 	../src/CaseFolder.h \
 	../src/Document.h \
 	../src/UniConversion.h \
+	../src/ThreadPool.h \
 	../src/Selection.h \
 	../src/PositionCache.h \
 	../src/EditModel.h \
@@ -333,6 +373,13 @@ KeyMap.o: \
 	../src/Geometry.h \
 	../src/Platform.h \
 	../src/KeyMap.h
+LinearRegex.o: \
+	../src/LinearRegex.cxx \
+	../src/CharacterCategoryMap.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
+	../src/CaseConvert.h \
+	../src/UniConversion.h
 LineMarker.o: \
 	../src/LineMarker.cxx \
 	../include/ScintillaTypes.h \
@@ -387,6 +434,10 @@ PerLine.o: \
 	../src/Partitioning.h \
 	../src/CellBuffer.h \
 	../src/PerLine.h
+PieceTree.o: \
+	../src/PieceTree.cxx \
+	../src/Position.h \
+	../src/PieceTree.h
 PositionCache.o: \
 	../src/PositionCache.cxx \
 	../include/ScintillaTypes.h \
@@ -473,6 +524,9 @@ Selection.o: \
 	../src/Debugging.h \
 	../src/Position.h \
 	../src/Selection.h
+StringSearch.o: \
+	../src/StringSearch.cxx \
+	../src/StringSearch.h
 Style.o: \
 	../src/Style.cxx \
 	../include/ScintillaTypes.h \
@@ -480,6 +534,30 @@ Style.o: \
 	../src/Geometry.h \
 	../src/Platform.h \
 	../src/Style.h
+ThreadPool.o: \
+	../src/ThreadPool.cxx \
+	../src/ThreadPool.h
+TrigramIndex.o: \
+	../src/TrigramIndex.cxx \
+	../include/ScintillaTypes.h \
+	../include/ILoader.h \
+	../include/ILexer.h \
+	../src/Debugging.h \
+	../src/CharacterCategoryMap.h \
+	../src/Position.h \
+	../src/SplitVector.h \
+	../src/Partitioning.h \
+	../src/RunStyles.h \
+	../src/PieceTree.h \
+	../src/CellBuffer.h \
+	../src/CharClassify.h \
+	../src/Decoration.h \
+	../src/CaseFolder.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
+	../src/Document.h \
+	../src/DocumentSnapshot.h \
+	../src/TrigramIndex.h
 UndoHistory.o: \
 	../src/UndoHistory.cxx \
 	../include/ScintillaTypes.h \
@@ -354,6 +354,8 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_BEGINUNDOACTION 2078
 #define SCI_ENDUNDOACTION 2079
 #define SCI_GETUNDOSEQUENCE 2799
+#define SCI_SETUNDOMEMORYLIMIT 2824
+#define SCI_GETUNDOMEMORYLIMIT 2825
 #define SCI_GETUNDOACTIONS 2790
 #define SCI_SETUNDOSAVEPOINT 2791
 #define SCI_GETUNDOSAVEPOINT 2792
@@ -524,6 +526,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCFIND_CXX11REGEX 0x00800000
 #define SCI_FINDTEXT 2150
 #define SCI_FINDTEXTFULL 2196
+#define SCI_FINDTEXTALL 2815
 #define SCI_FORMATRANGE 2151
 #define SCI_FORMATRANGEFULL 2777
 #define SC_CHANGE_HISTORY_DISABLED 0
@@ -591,8 +594,13 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_REPLACETARGETRE 2195
 #define SCI_REPLACETARGETMINIMAL 2779
 #define SCI_SEARCHINTARGET 2197
+#define SCI_REPLACEALLINTARGET 2826
 #define SCI_SETSEARCHFLAGS 2198
 #define SCI_GETSEARCHFLAGS 2199
+#define SCI_FINDINDICATORSTART 2816
+#define SCI_FINDINDICATORCANCEL 2817
+#define SCI_GETFINDINDICATORBUSY 2818
+#define SCI_GETFINDINDICATORCOUNT 2819
 #define SCI_CALLTIPSHOW 2200
 #define SCI_CALLTIPCANCEL 2201
 #define SCI_CALLTIPACTIVE 2202
@@ -702,6 +710,8 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_CACHE_DOCUMENT 3
 #define SCI_SETLAYOUTCACHE 2272
 #define SCI_GETLAYOUTCACHE 2273
+#define SCI_SETLAYOUTCACHEBUDGET 2822
+#define SCI_GETLAYOUTCACHEBUDGET 2823
 #define SCI_SETSCROLLWIDTH 2274
 #define SCI_GETSCROLLWIDTH 2275
 #define SCI_SETSCROLLWIDTHTRACKING 2516
@@ -840,10 +850,15 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_DOCUMENTOPTION_DEFAULT 0
 #define SC_DOCUMENTOPTION_STYLES_NONE 0x1
 #define SC_DOCUMENTOPTION_TEXT_LARGE 0x100
+#define SC_DOCUMENTOPTION_TEXT_PIECES 0x200
+#define SC_DOCUMENTOPTION_TRIGRAM_INDEX 0x400
+#define SC_DOCUMENTOPTION_DISPLAY_TREE 0x800
 #define SCI_CREATEDOCUMENT 2375
 #define SCI_ADDREFDOCUMENT 2376
 #define SCI_RELEASEDOCUMENT 2377
 #define SCI_GETDOCUMENTOPTIONS 2379
+#define SCI_GETTRIGRAMINDEX 2820
+#define SCI_SETTRIGRAMINDEX 2821
 #define SCI_GETMODEVENTMASK 2378
 #define SCI_SETCOMMANDEVENTS 2717
 #define SCI_GETCOMMANDEVENTS 2718
@@ -1241,7 +1256,9 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SC_MOD_INSERTCHECK 0x100000
 #define SC_MOD_CHANGETABSTOPS 0x200000
 #define SC_MOD_CHANGEEOLANNOTATION 0x400000
-#define SC_MODEVENTMASKALL 0x7FFFFF
+#define SC_MOD_BEFOREREPLACEALL 0x800000
+#define SC_MOD_REPLACEALL 0x1000000
+#define SC_MODEVENTMASKALL 0x1FFFFFF
 #define SC_UPDATE_NONE 0x0
 #define SC_UPDATE_CONTENT 0x1
 #define SC_UPDATE_SELECTION 0x2
@@ -1317,6 +1334,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCN_AUTOCCOMPLETED 2030
 #define SCN_MARGINRIGHTCLICK 2031
 #define SCN_AUTOCSELECTIONCHANGE 2032
+#define SCN_FINDINDICATORCOMPLETED 2033
 #ifndef SCI_DISABLE_PROVISIONAL
 #define SC_BIDIRECTIONAL_DISABLED 0
 #define SC_BIDIRECTIONAL_L2R 1
@@ -1364,6 +1382,13 @@ struct Sci_TextToFindFull {
 	struct Sci_CharacterRangeFull chrgText;
 };
 
+struct Sci_TextToFindAll {
+	struct Sci_CharacterRangeFull chrg;
+	const char *lpstrText;
+	struct Sci_CharacterRangeFull *ranges;
+	Sci_Position maxRanges;
+};
+
 typedef void *Sci_SurfaceID;
 
 struct Sci_Rectangle {
@@ -1428,7 +1453,7 @@ struct SCNotification {
 	const char *text;
 	/* SCN_MODIFIED, SCN_USERLISTSELECTION, SCN_AUTOCSELECTION, SCN_URIDROPPED */
 
-	Sci_Position length;		/* SCN_MODIFIED */
+	Sci_Position length;		/* SCN_MODIFIED, SCN_FINDINDICATORCOMPLETED */
 	Sci_Position linesAdded;	/* SCN_MODIFIED */
 	int message;	/* SCN_MACRORECORD */
 	uptr_t wParam;	/* SCN_MACRORECORD */
@@ -18,6 +18,7 @@ enum class Message;	// Declare in case ScintillaMessages.h not included
 // Declare in case ScintillaStructures.h not included
 struct TextRangeFull;
 struct TextToFindFull;
+struct TextToFindAll;
 struct RangeToFormatFull;
 
 class IDocumentEditable;
@@ -248,6 +249,8 @@ public:
 	void BeginUndoAction();
 	void EndUndoAction();
 	int UndoSequence();
+	void SetUndoMemoryLimit(Position bytes);
+	Position UndoMemoryLimit();
 	int UndoActions();
 	void SetUndoSavePoint(int action);
 	int UndoSavePoint();
@@ -356,6 +359,7 @@ public:
 	Scintilla::PrintOption PrintColourMode();
 	Position FindText(Scintilla::FindOption searchFlags, void *ft);
 	Position FindTextFull(Scintilla::FindOption searchFlags, TextToFindFull *ft);
+	Position FindTextAll(Scintilla::FindOption searchFlags, TextToFindAll *ft);
 	Position FormatRange(bool draw, void *fr);
 	Position FormatRangeFull(bool draw, RangeToFormatFull *fr);
 	void SetChangeHistory(Scintilla::ChangeHistoryOption changeHistory);
@@ -423,8 +427,13 @@ public:
 	Position ReplaceTargetRE(Position length, const char *text);
 	Position ReplaceTargetMinimal(Position length, const char *text);
 	Position SearchInTarget(Position length, const char *text);
+	Position ReplaceAllInTarget(const char *search, const char *replacement);
 	void SetSearchFlags(Scintilla::FindOption searchFlags);
 	Scintilla::FindOption SearchFlags();
+	Position FindIndicatorStart(Position length, const char *text);
+	void FindIndicatorCancel();
+	bool FindIndicatorBusy();
+	Position FindIndicatorCount();
 	void CallTipShow(Position pos, const char *definition);
 	void CallTipCancel();
 	bool CallTipActive();
@@ -488,6 +497,8 @@ public:
 	Scintilla::WrapIndentMode WrapIndentMode();
 	void SetLayoutCache(Scintilla::LineCache cacheMode);
 	Scintilla::LineCache LayoutCache();
+	void SetLayoutCacheBudget(Position bytes);
+	Position LayoutCacheBudget();
 	void SetScrollWidth(int pixelWidth);
 	int ScrollWidth();
 	void SetScrollWidthTracking(bool tracking);
@@ -609,6 +620,9 @@ public:
 	void AddRefDocument(IDocumentEditable *doc);
 	void ReleaseDocument(IDocumentEditable *doc);
 	Scintilla::DocumentOption DocumentOptions();
+	Position GetTrigramIndex(char *data);
+	std::string GetTrigramIndex();
+	bool SetTrigramIndex(Position length, const char *data);
 	Scintilla::ModificationFlags ModEventMask();
 	void SetCommandEvents(bool commandEvents);
 	bool CommandEvents();
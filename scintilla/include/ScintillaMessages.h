@@ -174,6 +174,8 @@ enum class Message {
 	BeginUndoAction = 2078,
 	EndUndoAction = 2079,
 	GetUndoSequence = 2799,
+	SetUndoMemoryLimit = 2824,
+	GetUndoMemoryLimit = 2825,
 	GetUndoActions = 2790,
 	SetUndoSavePoint = 2791,
 	GetUndoSavePoint = 2792,
@@ -281,6 +283,7 @@ enum class Message {
 	GetPrintColourMode = 2149,
 	FindText = 2150,
 	FindTextFull = 2196,
+	FindTextAll = 2815,
 	FormatRange = 2151,
 	FormatRangeFull = 2777,
 	SetChangeHistory = 2780,
@@ -344,8 +347,13 @@ enum class Message {
 	ReplaceTargetRE = 2195,
 	ReplaceTargetMinimal = 2779,
 	SearchInTarget = 2197,
+	ReplaceAllInTarget = 2826,
 	SetSearchFlags = 2198,
 	GetSearchFlags = 2199,
+	FindIndicatorStart = 2816,
+	FindIndicatorCancel = 2817,
+	GetFindIndicatorBusy = 2818,
+	GetFindIndicatorCount = 2819,
 	CallTipShow = 2200,
 	CallTipCancel = 2201,
 	CallTipActive = 2202,
@@ -408,6 +416,8 @@ enum class Message {
 	GetWrapIndentMode = 2473,
 	SetLayoutCache = 2272,
 	GetLayoutCache = 2273,
+	SetLayoutCacheBudget = 2822,
+	GetLayoutCacheBudget = 2823,
 	SetScrollWidth = 2274,
 	GetScrollWidth = 2275,
 	SetScrollWidthTracking = 2516,
@@ -528,6 +538,8 @@ enum class Message {
 	AddRefDocument = 2376,
 	ReleaseDocument = 2377,
 	GetDocumentOptions = 2379,
+	GetTrigramIndex = 2820,
+	SetTrigramIndex = 2821,
 	GetModEventMask = 2378,
 	SetCommandEvents = 2717,
 	GetCommandEvents = 2718,
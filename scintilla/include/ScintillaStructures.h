@@ -46,6 +46,13 @@ struct TextToFindFull {
 	CharacterRangeFull chrgText;
 };
 
+struct TextToFindAll {
+	CharacterRangeFull chrg;
+	const char *lpstrText;
+	CharacterRangeFull *ranges;
+	Position maxRanges;
+};
+
 using SurfaceID = void *;
 
 struct Rectangle {
@@ -104,7 +111,7 @@ struct NotificationData {
 	const char *text;
 	/* SCN_MODIFIED, SCN_USERLISTSELECTION, SCN_AUTOCSELECTION, SCN_URIDROPPED */
 
-	Position length;		/* SCN_MODIFIED */
+	Position length;		/* SCN_MODIFIED, SCN_FINDINDICATORCOMPLETED */
 	Position linesAdded;	/* SCN_MODIFIED */
 	Message message;	/* SCN_MACRORECORD */
 	uptr_t wParam;	/* SCN_MACRORECORD */
@@ -419,6 +419,9 @@ enum class DocumentOption {
 	Default = 0,
 	StylesNone = 0x1,
 	TextLarge = 0x100,
+	TextPieces = 0x200,
+	TrigramIndex = 0x400,
+	DisplayTree = 0x800,
 };
 
 enum class Status {
@@ -584,7 +587,9 @@ enum class ModificationFlags {
 	InsertCheck = 0x100000,
 	ChangeTabStops = 0x200000,
 	ChangeEOLAnnotation = 0x400000,
-	EventMaskAll = 0x7FFFFF,
+	BeforeReplaceAll = 0x800000,
+	ReplaceAll = 0x1000000,
+	EventMaskAll = 0x1FFFFFF,
 };
 
 enum class Update {
@@ -687,6 +692,7 @@ enum class Notification {
 	AutoCCompleted = 2030,
 	MarginRightClick = 2031,
 	AutoCSelectionChange = 2032,
+	FindIndicatorCompleted = 2033,
 };
 //--Autogenerated -- end of section automatically generated from Scintilla.iface
 
@@ -26,21 +26,27 @@ SOURCES += \
     ../../src/UndoHistory.cxx \
     ../../src/UniqueString.cxx \
     ../../src/UniConversion.cxx \
+    ../../src/TrigramIndex.cxx \
+    ../../src/ThreadPool.cxx \
     ../../src/Style.cxx \
+    ../../src/StringSearch.cxx \
     ../../src/Selection.cxx \
     ../../src/ScintillaBase.cxx \
     ../../src/RunStyles.cxx \
     ../../src/RESearch.cxx \
     ../../src/PositionCache.cxx \
+    ../../src/PieceTree.cxx \
     ../../src/PerLine.cxx \
     ../../src/MarginView.cxx \
     ../../src/LineMarker.cxx \
+    ../../src/LinearRegex.cxx \
     ../../src/KeyMap.cxx \
     ../../src/Indicator.cxx \
     ../../src/Geometry.cxx \
     ../../src/EditView.cxx \
     ../../src/Editor.cxx \
     ../../src/EditModel.cxx \
+    ../../src/DocumentSnapshot.cxx \
     ../../src/Document.cxx \
     ../../src/Decoration.cxx \
     ../../src/DBCS.cxx \
@@ -53,6 +59,7 @@ SOURCES += \
     ../../src/CaseFolder.cxx \
     ../../src/CaseConvert.cxx \
     ../../src/CallTip.cxx \
+    ../../src/BackgroundFind.cxx \
     ../../src/AutoComplete.cxx
 
 HEADERS  += \
@@ -24,21 +24,27 @@ SOURCES += \
     ../../src/UniqueString.cxx \
     ../../src/UniConversion.cxx \
     ../../src/UndoHistory.cxx \
+    ../../src/TrigramIndex.cxx \
+    ../../src/ThreadPool.cxx \
     ../../src/Style.cxx \
+    ../../src/StringSearch.cxx \
     ../../src/Selection.cxx \
     ../../src/ScintillaBase.cxx \
     ../../src/RunStyles.cxx \
     ../../src/RESearch.cxx \
     ../../src/PositionCache.cxx \
+    ../../src/PieceTree.cxx \
     ../../src/PerLine.cxx \
     ../../src/MarginView.cxx \
     ../../src/LineMarker.cxx \
+    ../../src/LinearRegex.cxx \
     ../../src/KeyMap.cxx \
     ../../src/Indicator.cxx \
     ../../src/Geometry.cxx \
     ../../src/EditView.cxx \
     ../../src/Editor.cxx \
     ../../src/EditModel.cxx \
+    ../../src/DocumentSnapshot.cxx \
     ../../src/Document.cxx \
     ../../src/Decoration.cxx \
     ../../src/DBCS.cxx \
@@ -51,6 +57,7 @@ SOURCES += \
     ../../src/CaseFolder.cxx \
     ../../src/CaseConvert.cxx \
     ../../src/CallTip.cxx \
+    ../../src/BackgroundFind.cxx \
     ../../src/AutoComplete.cxx
 
 HEADERS  += \
@@ -61,7 +68,10 @@ HEADERS  += \
     ../../src/ViewStyle.h \
     ../../src/UndoHistory.h \
     ../../src/UniConversion.h \
+    ../../src/TrigramIndex.h \
+    ../../src/ThreadPool.h \
     ../../src/Style.h \
+    ../../src/StringSearch.h \
     ../../src/SplitVector.h \
     ../../src/Selection.h \
     ../../src/ScintillaBase.h \
@@ -69,13 +79,16 @@ HEADERS  += \
     ../../src/RESearch.h \
     ../../src/PositionCache.h \
     ../../src/Platform.h \
+    ../../src/PieceTree.h \
     ../../src/PerLine.h \
     ../../src/Partitioning.h \
     ../../src/LineMarker.h \
+    ../../src/LinearRegex.h \
     ../../src/KeyMap.h \
     ../../src/Indicator.h \
     ../../src/Geometry.h \
     ../../src/Editor.h \
+    ../../src/DocumentSnapshot.h \
     ../../src/Document.h \
     ../../src/Decoration.h \
     ../../src/ContractionState.h \
@@ -87,6 +100,7 @@ HEADERS  += \
     ../../src/CaseFolder.h \
     ../../src/CaseConvert.h \
     ../../src/CallTip.h \
+    ../../src/BackgroundFind.h \
     ../../src/AutoComplete.h \
     ../../include/Scintilla.h \
     ../../include/ILexer.h
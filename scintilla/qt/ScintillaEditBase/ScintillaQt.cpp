@@ -464,7 +464,7 @@ void ScintillaQt::FineTickerStart(TickReason reason, int millis, int /* toleranc
 // called during destruction.
 void ScintillaQt::CancelTimers()
 {
-	for (size_t tr = static_cast<size_t>(TickReason::caret); tr <= static_cast<size_t>(TickReason::dwell); tr++) {
+	for (size_t tr = static_cast<size_t>(TickReason::caret); tr <= static_cast<size_t>(TickReason::find); tr++) {
 		if (timers[tr]) {
 			killTimer(timers[tr]);
 			timers[tr] = 0;
@@ -864,7 +864,7 @@ void ScintillaQt::DropUrls(const QMimeData *data)
 
 void ScintillaQt::timerEvent(QTimerEvent *event)
 {
-	for (size_t tr=static_cast<size_t>(TickReason::caret); tr<=static_cast<size_t>(TickReason::dwell); tr++) {
+	for (size_t tr=static_cast<size_t>(TickReason::caret); tr<=static_cast<size_t>(TickReason::find); tr++) {
 		if (timers[tr] == event->timerId()) {
 			TickFor(static_cast<TickReason>(tr));
 		}
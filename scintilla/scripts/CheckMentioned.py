@@ -65,6 +65,8 @@ def convertIFaceTypeToC(t):
 		return "Sci_TextRangeFull *"
 	elif t == "findtextfull":
 		return "Sci_TextToFindFull *"
+	elif t == "findtextall":
+		return "Sci_TextToFindAll *"
 	elif t == "formatrangefull":
 		return "Sci_RangeToFormatFull *"
 	elif Face.IsEnumeration(t):
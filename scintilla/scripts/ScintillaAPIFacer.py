@@ -20,6 +20,7 @@ typeAliases = {
 	"colouralpha": "ColourAlpha",
 	"findtext": "void *",
 	"findtextfull": "TextToFindFull *",
+	"findtextall": "TextToFindAll *",
 	"formatrange": "void *",
 	"formatrangefull": "RangeToFormatFull *",
 	"int": "int",
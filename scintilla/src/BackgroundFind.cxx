@@ -0,0 +1,388 @@
+// Scintilla source code edit control
+/** @file BackgroundFind.cxx
+ ** Find all matches in a document snapshot on worker threads.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <future>
+
+#include "ScintillaTypes.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+
+#include "CharacterCategoryMap.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "PieceTree.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "StringSearch.h"
+#include "LinearRegex.h"
+#include "Document.h"
+#include "DocumentSnapshot.h"
+#include "BackgroundFind.h"
+#include "RESearch.h"
+#include "UniConversion.h"
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+namespace {
+
+enum class FindMethod { plain, linear, builtin };
+
+// Text of a range of lines for RESearch which addresses characters by document position.
+class ChunkIndexer : public CharacterIndexer {
+	std::string_view text;
+	Sci::Position start;
+	bool unicode;
+public:
+	ChunkIndexer(std::string_view text_, Sci::Position start_, bool unicode_) noexcept :
+		text(text_), start(start_), unicode(unicode_) {
+	}
+	char CharAt(Sci::Position index) const noexcept override {
+		index -= start;
+		if (index < 0 || index >= static_cast<Sci::Position>(text.length())) {
+			return 0;
+		}
+		return text[index];
+	}
+	Sci::Position MovePositionOutsideChar(Sci::Position pos, Sci::Position moveDir) const noexcept override {
+		if (!unicode) {
+			return pos;
+		}
+		while (UTF8IsTrailByte(static_cast<unsigned char>(CharAt(pos)))) {
+			pos += (moveDir > 0) ? 1 : -1;
+		}
+		return pos;
+	}
+};
+
+// Width of the character at position for stepping over empty matches.
+size_t CharacterWidth(std::string_view text, size_t position, bool unicode) noexcept {
+	if (!unicode || position >= text.length()) {
+		return 1;
+	}
+	return UTF8DrawBytes(text.data() + position, text.length() - position);
+}
+
+constexpr bool IsEOLCharacter(char ch) noexcept {
+	return ch == '\r' || ch == '\n';
+}
+
+// Treat a literal as an expression for case-insensitive searches.
+std::string EscapeLiteral(std::string_view text) {
+	std::string escaped;
+	for (const char ch : text) {
+		if (ch && strchr("\\^$.|?*+()[]{}", ch)) {
+			escaped.push_back('\\');
+		}
+		escaped.push_back(ch);
+	}
+	return escaped;
+}
+
+}
+
+namespace Scintilla::Internal {
+
+struct FindWork {
+	std::shared_ptr<const DocumentSnapshot> snapshot;
+	Sci::Position minPos = 0;
+	Sci::Position maxPos = 0;
+	FindMethod method = FindMethod::plain;
+	std::string pattern;
+	bool caseSensitive = true;
+	bool unicode = false;
+	CharClassify charClass;
+	std::optional<RESearch> builtin;
+	// Boundaries of chunks with one more element than there are chunks
+	std::vector<Sci::Position> boundaries;
+
+	std::atomic<size_t> nextChunk = 0;
+	std::atomic<bool> cancelled = false;
+	std::mutex mutex;
+	// Protected by mutex
+	std::vector<std::vector<Range>> chunkMatches;
+	std::vector<bool> chunkDone;
+	size_t nextTake = 0;
+
+	std::vector<std::future<void>> futures;
+
+	FindWork() = default;
+	// Deleted so FindWork objects can not be copied.
+	FindWork(const FindWork &) = delete;
+	FindWork(FindWork &&) = delete;
+	FindWork &operator=(const FindWork &) = delete;
+	FindWork &operator=(FindWork &&) = delete;
+	~FindWork() = default;
+
+	[[nodiscard]] size_t Chunks() const noexcept {
+		return boundaries.size() - 1;
+	}
+	void Divide(Sci::Position chunkSize);
+	void Worker();
+	void SearchPlain(Sci::Position chunkStart, Sci::Position chunkEnd, std::string &text, std::vector<Range> &found) const;
+	void SearchLines(Sci::Position chunkStart, Sci::Position chunkEnd, std::string &text,
+		LinearRegex *linear, RESearch *search, std::vector<Range> &found) const;
+};
+
+}
+
+void FindWork::Divide(Sci::Position chunkSize) {
+	// Expressions match within a line so their chunks hold whole lines. Literals may
+	// span chunks so each chunk finds the matches starting inside it, reading past its end.
+	const bool wholeLines = method != FindMethod::plain;
+	Sci::Position start = minPos;
+	Sci::Position end = maxPos;
+	if (wholeLines) {
+		start = snapshot->LineStart(snapshot->LineFromPosition(minPos));
+		end = snapshot->LineStart(snapshot->LineFromPosition(maxPos) + 1);
+	}
+	boundaries.push_back(start);
+	for (Sci::Position position = start + chunkSize; position < end; position += chunkSize) {
+		const Sci::Position boundary = wholeLines ?
+			snapshot->LineStart(snapshot->LineFromPosition(position)) : position;
+		if (boundary > boundaries.back()) {
+			boundaries.push_back(boundary);
+		}
+	}
+	if (end > boundaries.back() || boundaries.size() == 1) {
+		boundaries.push_back(end);
+	}
+	chunkMatches.resize(Chunks());
+	chunkDone.resize(Chunks());
+}
+
+void FindWork::Worker() {
+	std::string text;
+	std::unique_ptr<LinearRegex> linear;
+	if (method == FindMethod::linear) {
+		// Each thread compiles its own as matching updates a lazily built automaton
+		linear = LinearRegex::Compile(pattern, caseSensitive, unicode);
+	}
+	std::optional<RESearch> search = builtin;
+	while (!cancelled.load(std::memory_order_acquire)) {
+		const size_t chunk = nextChunk.fetch_add(1, std::memory_order_acq_rel);
+		if (chunk >= Chunks()) {
+			break;
+		}
+		std::vector<Range> found;
+		if (method == FindMethod::plain) {
+			SearchPlain(boundaries[chunk], boundaries[chunk + 1], text, found);
+		} else {
+			SearchLines(boundaries[chunk], boundaries[chunk + 1], text, linear.get(),
+				search ? &*search : nullptr, found);
+		}
+		std::lock_guard<std::mutex> guard(mutex);
+		chunkMatches[chunk] = std::move(found);
+		chunkDone[chunk] = true;
+	}
+}
+
+// Finds every occurrence, including overlapping ones, as choosing between overlapping
+// occurrences depends on earlier chunks and is done when the matches are taken.
+void FindWork::SearchPlain(Sci::Position chunkStart, Sci::Position chunkEnd, std::string &text, std::vector<Range> &found) const {
+	const Sci::Position length = pattern.length();
+	const Sci::Position readEnd = std::min(chunkEnd + length - 1, maxPos);
+	if (readEnd - chunkStart < length) {
+		return;
+	}
+	text.resize(readEnd - chunkStart);
+	snapshot->GetCharRange(text.data(), chunkStart, text.length());
+	const std::string_view sv(text);
+	size_t position = 0;
+	while (!cancelled.load(std::memory_order_relaxed)) {
+		const size_t offset = SearchForward(sv.substr(position), pattern);
+		if (offset == std::string_view::npos) {
+			break;
+		}
+		position += offset;
+		const Sci::Position matchStart = chunkStart + position;
+		if (matchStart >= chunkEnd) {
+			break;
+		}
+		found.emplace_back(matchStart, matchStart + length);
+		position++;
+	}
+}
+
+void FindWork::SearchLines(Sci::Position chunkStart, Sci::Position chunkEnd, std::string &text,
+	LinearRegex *linear, RESearch *search, std::vector<Range> &found) const {
+	text.resize(chunkEnd - chunkStart);
+	snapshot->GetCharRange(text.data(), chunkStart, text.length());
+	const std::string_view sv(text);
+	const ChunkIndexer indexer(sv, chunkStart, unicode);
+	const bool searchforLineStart = pattern[0] == '^';
+	LinearRegex::Groups groups {};
+	const Sci::Line lines = snapshot->Lines();
+	for (Sci::Line line = snapshot->LineFromPosition(chunkStart); line < lines; line++) {
+		const Sci::Position lineStart = snapshot->LineStart(line);
+		// An empty last line starts at the end of the final chunk
+		if (lineStart >= chunkEnd && !(lineStart == chunkEnd && chunkEnd == snapshot->Length())) {
+			break;
+		}
+		if (cancelled.load(std::memory_order_relaxed)) {
+			return;
+		}
+		Sci::Position lineEnd = std::min(snapshot->LineStart(line + 1), chunkEnd);
+		while (lineEnd > lineStart && IsEOLCharacter(sv[lineEnd - 1 - chunkStart])) {
+			lineEnd--;
+		}
+		const Sci::Position rangeStart = std::max(lineStart, minPos);
+		const Sci::Position rangeEnd = std::min(lineEnd, maxPos);
+		if (rangeStart > rangeEnd) {
+			continue;
+		}
+		if (linear) {
+			const std::string_view lineText = sv.substr(lineStart - chunkStart, lineEnd - lineStart);
+			const size_t end = rangeEnd - lineStart;
+			size_t start = rangeStart - lineStart;
+			while (linear->Find(lineText, start, end, false, groups)) {
+				found.emplace_back(lineStart + groups[0], lineStart + groups[1]);
+				start = groups[1];
+				if (groups[1] == groups[0]) {
+					if (start >= end)
+						break;
+					start += CharacterWidth(lineText, start, unicode);
+				}
+			}
+		} else if (search) {
+			if (searchforLineStart && rangeStart != lineStart) {
+				continue;
+			}
+			search->SetLineRange(lineStart, lineEnd);
+			int success = search->Execute(indexer, rangeStart, rangeEnd);
+			while (success) {
+				const Sci::Position matchStart = search->bopat[0];
+				const Sci::Position matchEnd = search->eopat[0];
+				found.emplace_back(matchStart, matchEnd);
+				if (searchforLineStart)
+					break;
+				const Sci::Position next = (matchEnd > matchStart) ? matchEnd :
+					matchEnd + static_cast<Sci::Position>(CharacterWidth(sv, matchEnd - chunkStart, unicode));
+				if (next >= rangeEnd)
+					break;
+				success = search->Execute(indexer, next, rangeEnd);
+			}
+		}
+	}
+}
+
+BackgroundFind::BackgroundFind(std::unique_ptr<FindWork> &&work_) noexcept :
+	work(std::move(work_)), lastEnd(work->minPos) {
+}
+
+BackgroundFind::~BackgroundFind() {
+	Cancel();
+	for (const std::future<void> &f : work->futures) {
+		f.wait();
+	}
+}
+
+std::unique_ptr<BackgroundFind> BackgroundFind::Start(std::shared_ptr<const DocumentSnapshot> snapshot,
+	Sci::Position minPos, Sci::Position maxPos, std::string_view text, FindOption flags,
+	int codePage, const CharClassify &charClass, unsigned int threads, Sci::Position chunkSize) {
+	const bool unicode = codePage == CpUtf8;
+	if (text.empty() || (codePage != 0 && !unicode)) {
+		// Positions inside DBCS characters can only be recognized by scanning from a line start.
+		return {};
+	}
+	std::unique_ptr<FindWork> work = std::make_unique<FindWork>();
+	if (minPos > maxPos)
+		std::swap(minPos, maxPos);
+	work->minPos = std::clamp<Sci::Position>(minPos, 0, snapshot->Length());
+	work->maxPos = std::clamp<Sci::Position>(maxPos, 0, snapshot->Length());
+	work->snapshot = std::move(snapshot);
+	work->pattern = text;
+	work->caseSensitive = FlagSet(flags, FindOption::MatchCase);
+	work->unicode = unicode;
+	work->charClass = charClass;
+	if (FlagSet(flags, FindOption::RegExp)) {
+		if (FlagSet(flags, FindOption::Cxx11RegEx)) {
+			if (!LinearRegex::Compile(text, work->caseSensitive, unicode)) {
+				return {};
+			}
+			work->method = FindMethod::linear;
+		} else {
+			work->builtin.emplace(&work->charClass);
+			if (work->builtin->Compile(text.data(), text.length(), work->caseSensitive, FlagSet(flags, FindOption::Posix))) {
+				return {};
+			}
+			work->method = FindMethod::builtin;
+		}
+	} else if (!work->caseSensitive) {
+		// Case folding is done by a literal expression so the text can not span lines and
+		// outside Unicode is limited to ASCII which is folded the same by every code page.
+		const bool ascii = std::none_of(text.begin(), text.end(), [](char ch) noexcept {
+			return static_cast<unsigned char>(ch) >= 0x80;
+		});
+		if (std::any_of(text.begin(), text.end(), IsEOLCharacter) || (!unicode && !ascii)) {
+			return {};
+		}
+		work->pattern = EscapeLiteral(text);
+		work->method = FindMethod::linear;
+	}
+	work->Divide(chunkSize);
+
+	FindWork *pwork = work.get();
+	const size_t workers = std::clamp<size_t>(threads, 1, work->Chunks());
+	for (size_t th = 0; th < workers; th++) {
+		work->futures.push_back(std::async(std::launch::async, [pwork]() {
+			pwork->Worker();
+		}));
+	}
+	return std::make_unique<BackgroundFind>(std::move(work));
+}
+
+size_t BackgroundFind::Version() const noexcept {
+	return work->snapshot->Version();
+}
+
+void BackgroundFind::Cancel() noexcept {
+	work->cancelled.store(true, std::memory_order_release);
+}
+
+bool BackgroundFind::TakeMatches(std::vector<Range> &matches, const Acceptor &accept) {
+	std::vector<std::vector<Range>> taken;
+	bool complete = false;
+	{
+		std::lock_guard<std::mutex> guard(work->mutex);
+		while (work->nextTake < work->Chunks() && work->chunkDone[work->nextTake]) {
+			taken.push_back(std::move(work->chunkMatches[work->nextTake]));
+			work->nextTake++;
+		}
+		complete = work->nextTake == work->Chunks();
+	}
+	for (const std::vector<Range> &chunk : taken) {
+		for (const Range &match : chunk) {
+			// Skipping overlaps chooses the same matches as searching forwards from each match end
+			if (match.start >= lastEnd && (!accept || accept(match.start, match.end))) {
+				matches.push_back(match);
+				lastEnd = match.end;
+			}
+		}
+	}
+	return complete || work->cancelled.load(std::memory_order_acquire);
+}
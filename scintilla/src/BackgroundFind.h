@@ -0,0 +1,55 @@
+// Scintilla source code edit control
+/** @file BackgroundFind.h
+ ** Find all matches in a document snapshot on worker threads.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef BACKGROUNDFIND_H
+#define BACKGROUNDFIND_H
+
+namespace Scintilla::Internal {
+
+struct FindWork;
+
+/**
+ * Searches a range of a DocumentSnapshot for every match of a pattern using several threads
+ * while the document's thread continues.
+ * The range is divided into chunks that are searched in parallel. The matches of a chunk are
+ * handed over once it and every chunk before it are done so results arrive in document order.
+ * Destroying a BackgroundFind cancels the search and waits for its threads to stop.
+ */
+class BackgroundFind {
+	std::unique_ptr<FindWork> work;
+	Sci::Position lastEnd;
+public:
+	/// Decides on the document's thread whether a match should be kept, as for whole word searches.
+	using Acceptor = std::function<bool(Sci::Position start, Sci::Position end)>;
+	static constexpr Sci::Position defaultChunkSize = 0x100000;
+
+	explicit BackgroundFind(std::unique_ptr<FindWork> &&work_) noexcept;
+	// Deleted so BackgroundFind objects can not be copied.
+	BackgroundFind(const BackgroundFind &) = delete;
+	BackgroundFind(BackgroundFind &&) = delete;
+	BackgroundFind &operator=(const BackgroundFind &) = delete;
+	BackgroundFind &operator=(BackgroundFind &&) = delete;
+	~BackgroundFind();
+
+	/// Returns nullptr when the search is not supported on other threads, such as for DBCS text
+	/// or expressions that only std::regex handles, so the caller should search synchronously.
+	/// Whole word options are not applied here: pass an Acceptor to TakeMatches instead.
+	static std::unique_ptr<BackgroundFind> Start(std::shared_ptr<const DocumentSnapshot> snapshot,
+		Sci::Position minPos, Sci::Position maxPos, std::string_view text, Scintilla::FindOption flags,
+		int codePage, const CharClassify &charClass, unsigned int threads,
+		Sci::Position chunkSize=defaultChunkSize);
+
+	/// Version of the document being searched.
+	[[nodiscard]] size_t Version() const noexcept;
+	void Cancel() noexcept;
+	/// Appends the non-overlapping matches from chunks finished since the last call.
+	/// Returns true once every match has been taken or the search was cancelled.
+	bool TakeMatches(std::vector<Range> &matches, const Acceptor &accept);
+};
+
+}
+
+#endif
@@ -6,6 +6,7 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
@@ -20,6 +21,8 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <thread>
+#include <future>
 
 #include "ScintillaTypes.h"
 
@@ -31,8 +34,10 @@
 #include "RunStyles.h"
 #include "SparseVector.h"
 #include "ChangeHistory.h"
+#include "PieceTree.h"
 #include "CellBuffer.h"
 #include "UndoHistory.h"
+#include "StringSearch.h"
 #include "UniConversion.h"
 
 namespace Scintilla::Internal {
@@ -66,6 +71,14 @@ struct CountWidths {
 	}
 };
 
+// Start of each line followed by the length of the text, in bytes and, for the line character
+// indices being maintained, in UTF-32 and UTF-16 code units.
+struct LineStarts {
+	std::vector<Sci::Position> bytes;
+	std::vector<Sci::Position> utf32;
+	std::vector<Sci::Position> utf16;
+};
+
 class ILineVector {
 public:
 	virtual void Init() = 0;
@@ -74,6 +87,7 @@ public:
 	virtual void InsertLine(Sci::Line line, Sci::Position position, bool lineStart) = 0;
 	virtual void InsertLines(Sci::Line line, const Sci::Position *positions, size_t lines, bool lineStart) = 0;
 	virtual void SetLineStart(Sci::Line line, Sci::Position position) noexcept = 0;
+	virtual void SetLineStarts(const LineStarts &lineStarts) = 0;
 	virtual void RemoveLine(Sci::Line line) = 0;
 	virtual Sci::Line Lines() const noexcept = 0;
 	virtual void AllocateLines(Sci::Line lines) = 0;
@@ -236,6 +250,21 @@ public:
 	void SetLineStart(Sci::Line line, Sci::Position position) noexcept override {
 		starts.SetPartitionStartPosition(pos_cast(line), pos_cast(position));
 	}
+	// Replace the starts of every line when the document held a single line or the number
+	// of lines is unchanged. Added lines are inserted into perLine before the first line.
+	void SetLineStarts(const LineStarts &lineStarts) override {
+		const Sci::Line linesBefore = Lines();
+		starts.Assign(lineStarts.bytes.data(), lineStarts.bytes.size());
+		if (FlagSet(activeIndices, LineCharacterIndexType::Utf32)) {
+			startsUTF32.starts.Assign(lineStarts.utf32.data(), lineStarts.utf32.size());
+		}
+		if (FlagSet(activeIndices, LineCharacterIndexType::Utf16)) {
+			startsUTF16.starts.Assign(lineStarts.utf16.data(), lineStarts.utf16.size());
+		}
+		if (perLine && (Lines() > linesBefore)) {
+			perLine->InsertLines(0, Lines() - linesBefore);
+		}
+	}
 	void RemoveLine(Sci::Line line) override {
 		starts.RemovePartition(pos_cast(line));
 		if (FlagSet(activeIndices, LineCharacterIndexType::Utf32)) {
@@ -330,8 +359,10 @@ public:
 	}
 };
 
-CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
+CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_, bool pieceTree_) :
 	hasStyles(hasStyles_), largeDocument(largeDocument_) {
+	if (pieceTree_)
+		pieces = std::make_unique<PieceTree>();
 	readOnly = false;
 	utf8Substance = false;
 	utf8LineEnds = LineEndType::Default;
@@ -346,11 +377,13 @@ CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
 CellBuffer::~CellBuffer() noexcept = default;
 
 char CellBuffer::CharAt(Sci::Position position) const noexcept {
+	if (pieces)
+		return pieces->CharAt(position);
 	return substance.ValueAt(position);
 }
 
 unsigned char CellBuffer::UCharAt(Sci::Position position) const noexcept {
-	return substance.ValueAt(position);
+	return CharAt(position);
 }
 
 void CellBuffer::GetCharRange(char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const {
@@ -358,11 +391,15 @@ void CellBuffer::GetCharRange(char *buffer, Sci::Position position, Sci::Positio
 		return;
 	if (position < 0)
 		return;
-	if ((position + lengthRetrieve) > substance.Length()) {
+	if ((position + lengthRetrieve) > Length()) {
 		Platform::DebugPrintf("Bad GetCharRange %.0f for %.0f of %.0f\n",
 				      static_cast<double>(position),
 				      static_cast<double>(lengthRetrieve),
-				      static_cast<double>(substance.Length()));
+				      static_cast<double>(Length()));
+		return;
+	}
+	if (pieces) {
+		pieces->GetRange(buffer, position, lengthRetrieve);
 		return;
 	}
 	substance.GetRange(buffer, position, lengthRetrieve);
@@ -392,18 +429,35 @@ void CellBuffer::GetStyleRange(unsigned char *buffer, Sci::Position position, Sc
 }
 
 const char *CellBuffer::BufferPointer() {
+	if (pieces)
+		return pieces->BufferPointer();
 	return substance.BufferPointer();
 }
 
 const char *CellBuffer::RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept {
+	if (pieces) {
+		try {
+			return pieces->RangePointer(position, rangeLength);
+		} catch (...) {
+			// Merging pieces failed to allocate
+			return nullptr;
+		}
+	}
 	return substance.RangePointer(position, rangeLength);
 }
 
 Sci::Position CellBuffer::GapPosition() const noexcept {
+	if (pieces)
+		return pieces->Length();
 	return substance.GapPosition();
 }
 
-SplitView CellBuffer::AllView() const noexcept {
+SplitView CellBuffer::AllView() {
+	if (pieces) {
+		const size_t length = pieces->Length();
+		const char *text = pieces->BufferPointer();
+		return SplitView { text, length, text, length };
+	}
 	const size_t length = substance.Length();
 	size_t length1 = substance.GapPosition();
 	if (length1 == 0) {
@@ -418,6 +472,20 @@ SplitView CellBuffer::AllView() const noexcept {
 	};
 }
 
+std::string_view CellBuffer::SegmentAt(Sci::Position position, Sci::Position &segmentStart) const noexcept {
+	if (pieces)
+		return pieces->SegmentAt(position, segmentStart);
+	const Sci::Position length = substance.Length();
+	const Sci::Position gap = substance.GapPosition();
+	if (position < 0 || position >= length) {
+		segmentStart = length;
+		return {};
+	}
+	segmentStart = (position < gap) ? 0 : gap;
+	const Sci::Position segmentEnd = (position < gap) ? gap : length;
+	return std::string_view(substance.ElementPointer(segmentStart), segmentEnd - segmentStart);
+}
+
 // The char* returned is to an allocation owned by the undo history
 const char *CellBuffer::InsertString(Sci::Position position, const char *s, Sci::Position insertLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
@@ -477,8 +545,14 @@ const char *CellBuffer::DeleteChars(Sci::Position position, Sci::Position delete
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
 			// The gap would be moved to position anyway for the deletion so this doesn't cost extra
-			data = substance.RangePointer(position, deleteLength);
-			data = uh->AppendAction(ActionType::remove, position, data, deleteLength, startSequence);
+			if (pieces) {
+				std::string deleted(deleteLength, '\0');
+				pieces->GetRange(deleted.data(), position, deleteLength);
+				data = uh->AppendAction(ActionType::remove, position, deleted.data(), deleteLength, startSequence);
+			} else {
+				data = substance.RangePointer(position, deleteLength);
+				data = uh->AppendAction(ActionType::remove, position, data, deleteLength, startSequence);
+			}
 		}
 
 		if (changeHistory) {
@@ -492,6 +566,8 @@ const char *CellBuffer::DeleteChars(Sci::Position position, Sci::Position delete
 }
 
 Sci::Position CellBuffer::Length() const noexcept {
+	if (pieces)
+		return pieces->Length();
 	return substance.Length();
 }
 
@@ -499,7 +575,10 @@ void CellBuffer::Allocate(Sci::Position newSize) {
 	if (!largeDocument && (newSize > INT32_MAX)) {
 		throw std::runtime_error("CellBuffer::Allocate: size of standard document limited to 2G.");
 	}
-	substance.ReAllocate(newSize);
+	if (pieces)
+		pieces->Reserve(newSize);
+	else
+		substance.ReAllocate(newSize);
 	if (hasStyles) {
 		style.ReAllocate(newSize);
 	}
@@ -548,7 +627,7 @@ void CellBuffer::AllocateLineCharacterIndex(LineCharacterIndexType lineCharacter
 	if (utf8Substance) {
 		if (plv->AllocateLineCharacterIndex(lineCharacterIndex, Lines())) {
 			// Changed so recalculate whole file
-			RecalculateIndexLineStarts(0, Lines() - 1);
+			BuildLineStarts(std::string_view(BufferPointer(), Length()));
 		}
 	}
 }
@@ -629,6 +708,28 @@ bool CellBuffer::HasStyles() const noexcept {
 	return hasStyles;
 }
 
+PieceTree CellBuffer::TextSnapshot() const {
+	if (pieces) {
+		return *pieces;
+	}
+	// Copy the text on both sides of the gap into a single chunk.
+	PieceTree text;
+	const Sci::Position length = substance.Length();
+	text.Reserve(length);
+	Sci::Position position = 0;
+	while (position < length) {
+		Sci::Position segmentStart = 0;
+		const std::string_view segment = SegmentAt(position, segmentStart);
+		text.Insert(position, segment.data(), segment.length());
+		position = segmentStart + segment.length();
+	}
+	return text;
+}
+
+bool CellBuffer::UsesPieceTree() const noexcept {
+	return pieces != nullptr;
+}
+
 void CellBuffer::SetSavePoint() {
 	uh->SetSavePoint();
 	if (changeHistory) {
@@ -668,10 +769,10 @@ void CellBuffer::RemoveLine(Sci::Line line) {
 
 bool CellBuffer::UTF8LineEndOverlaps(Sci::Position position) const noexcept {
 	const unsigned char bytes[] = {
-		static_cast<unsigned char>(substance.ValueAt(position-2)),
-		static_cast<unsigned char>(substance.ValueAt(position-1)),
-		static_cast<unsigned char>(substance.ValueAt(position)),
-		static_cast<unsigned char>(substance.ValueAt(position+1)),
+		static_cast<unsigned char>(CharAt(position-2)),
+		static_cast<unsigned char>(CharAt(position-1)),
+		static_cast<unsigned char>(CharAt(position)),
+		static_cast<unsigned char>(CharAt(position+1)),
 	};
 	return UTF8IsSeparator(bytes) || UTF8IsSeparator(bytes+1) || UTF8IsNEL(bytes+1);
 }
@@ -685,7 +786,7 @@ bool CellBuffer::UTF8IsCharacterBoundary(Sci::Position position) const {
 			if (posBack < 0) {
 				return false;
 			}
-			back.insert(0, 1, substance.ValueAt(posBack));
+			back.insert(0, 1, CharAt(posBack));
 			if (!UTF8IsTrailByte(back.front())) {
 				if (i > 0) {
 					// Have reached a non-trail
@@ -699,7 +800,7 @@ bool CellBuffer::UTF8IsCharacterBoundary(Sci::Position position) const {
 		}
 	}
 	if (position < Length()) {
-		const unsigned char fore = substance.ValueAt(position);
+		const unsigned char fore = CharAt(position);
 		if (UTF8IsTrailByte(fore)) {
 			return false;
 		}
@@ -709,56 +810,175 @@ bool CellBuffer::UTF8IsCharacterBoundary(Sci::Position position) const {
 
 void CellBuffer::ResetLineEnds() {
 	// Reinitialize line data -- too much work to preserve
-	const Sci::Line lines = plv->Lines();
 	plv->Init();
-	plv->AllocateLines(lines);
+	BuildLineStarts(std::string_view(BufferPointer(), Length()));
+}
 
-	constexpr Sci::Position position = 0;
-	const Sci::Position length = Length();
-	plv->InsertText(0, length);
-	Sci::Line lineInsert = 1;
-	constexpr bool atLineStart = true;
-	unsigned char chBeforePrev = 0;
-	unsigned char chPrev = 0;
-	for (Sci::Position i = 0; i < length; i++) {
-		const unsigned char ch = substance.ValueAt(position + i);
-		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
-		} else if (ch == '\n') {
-			if (chPrev == '\r') {
-				// Patch up what was end of line
-				plv->SetLineStart(lineInsert - 1, (position + i) + 1);
-			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
-		} else if (utf8LineEnds == LineEndType::Unicode) {
-			if (UTF8IsMultibyteLineEnd(chBeforePrev, chPrev, ch)) {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
+namespace {
+
+// Length of the run of ASCII at the start of sv, tested 8 bytes at a time.
+size_t AsciiPrefix(std::string_view sv) noexcept {
+	constexpr uint64_t highBits = 0x8080808080808080U;
+	size_t length = 0;
+	while (length + sizeof(uint64_t) <= sv.length()) {
+		uint64_t block = 0;
+		memcpy(&block, sv.data() + length, sizeof(block));
+		if (block & highBits) {
+			break;
 		}
-		chBeforePrev = chPrev;
-		chPrev = ch;
+		length += sizeof(uint64_t);
 	}
+	while ((length < sv.length()) && UTF8IsAscii(sv[length])) {
+		length++;
+	}
+	return length;
 }
 
-namespace {
-
 CountWidths CountCharacterWidthsUTF8(std::string_view sv) noexcept {
 	CountWidths cw;
-	size_t remaining = sv.length();
-	while (remaining > 0) {
+	while (!sv.empty()) {
+		const size_t ascii = AsciiPrefix(sv);
+		cw.countBasePlane += ascii;
+		sv.remove_prefix(ascii);
+		if (sv.empty()) {
+			break;
+		}
 		const int utf8Status = UTF8Classify(sv);
 		const int lenChar = utf8Status & UTF8MaskWidth;
 		cw.CountChar(lenChar);
 		sv.remove_prefix(lenChar);
-		remaining -= lenChar;
 	}
 	return cw;
 }
 
+// Insertions at least twice this long are scanned for line ends by several threads.
+constexpr ptrdiff_t parallelScanSize = 0x1000000;
+constexpr unsigned int maxScanThreads = 8;
+
+// Text being inserted along with the 2 bytes before it in the document so that the end of
+// a multi-byte line end is recognized wherever a scan starts.
+class InsertedText {
+	const char *s;
+	Sci::Position position;
+	unsigned char before[2];
+	bool unicode;
+public:
+	InsertedText(const char *s_, Sci::Position position_, unsigned char chPrev, unsigned char chBeforePrev, bool unicode_) noexcept :
+		s(s_), position(position_), before{ chPrev, chBeforePrev }, unicode(unicode_) {
+	}
+	unsigned char At(const char *ptr) const noexcept {
+		return (ptr >= s) ? *ptr : before[s - ptr - 1];
+	}
+	const char *Scan(const char *from, const char *to, std::vector<Sci::Position> &positions) const;
+	const char *FindLineEnds(const char *from, const char *to, std::vector<Sci::Position> &positions) const;
+};
+
+// Appends the position after each line end that starts in [from, to) and returns where scanning
+// stopped which is after to when a CR at its end is followed by LF.
+// to must be before the last byte of the insertion so the byte after a CR can be read.
+const char *InsertedText::Scan(const char *from, const char *to, std::vector<Sci::Position> &positions) const {
+	const char *ptr = from;
+	while (ptr < to) {
+		ptr += SkipNonLineEnds(std::string_view(ptr, to - ptr), unicode);
+		if (ptr >= to) {
+			break;
+		}
+		const unsigned char ch = *ptr++;
+		if (ch == '\r' || ch == '\n') {
+			if (ch == '\r' && *ptr == '\n') {
+				++ptr;
+			}
+			positions.push_back(position + (ptr - s));
+		} else if (UTF8IsMultibyteLineEnd(At(ptr - 3), At(ptr - 2), ch)) {
+			// LS, PS and NEL
+			positions.push_back(position + (ptr - s));
+		}
+	}
+	return ptr;
+}
+
+// Scan, dividing huge insertions into chunks that are scanned on separate threads.
+const char *InsertedText::FindLineEnds(const char *from, const char *to, std::vector<Sci::Position> &positions) const {
+	// hardware_concurrency may make system calls so avoid it for the common small insertions
+	if ((to - from) < 2 * parallelScanSize) {
+		return Scan(from, to, positions);
+	}
+	const unsigned int threads = std::min(std::thread::hardware_concurrency(), maxScanThreads);
+	const size_t chunks = std::min<size_t>(threads, (to - from) / parallelScanSize);
+	if (chunks < 2) {
+		return Scan(from, to, positions);
+	}
+	const ptrdiff_t chunkLength = (to - from) / chunks;
+	using ChunkResult = std::pair<std::vector<Sci::Position>, const char *>;
+	std::vector<std::future<ChunkResult>> results;
+	for (size_t chunk = 1; chunk < chunks; chunk++) {
+		const char *chunkStart = from + chunk * chunkLength;
+		const char *chunkEnd = (chunk == chunks - 1) ? to : chunkStart + chunkLength;
+		results.push_back(std::async(std::launch::async | std::launch::deferred, [this, chunkStart, chunkEnd]() {
+			ChunkResult result;
+			// A LF after a CR belongs to the line end found by the previous chunk
+			const bool afterCR = chunkStart[-1] == '\r' && chunkStart[0] == '\n';
+			result.second = Scan(chunkStart + (afterCR ? 1 : 0), chunkEnd, result.first);
+			return result;
+		}));
+	}
+	const char *ptr = Scan(from, from + chunkLength, positions);
+	for (std::future<ChunkResult> &result : results) {
+		ChunkResult chunkResult = result.get();
+		positions.insert(positions.end(), chunkResult.first.begin(), chunkResult.first.end());
+		ptr = chunkResult.second;
+	}
+	return ptr;
+}
+
+}
+
+// Set the line data for the whole document from its text, which is scanned once for line ends
+// and then once more for character widths only when line character indices are maintained.
+void CellBuffer::BuildLineStarts(std::string_view text) {
+	const bool unicode = utf8LineEnds == LineEndType::Unicode;
+	LineStarts lineStarts;
+	lineStarts.bytes.push_back(0);
+	if (!text.empty()) {
+		const InsertedText inserted(text.data(), 0, 0, 0, unicode);
+		const char *const end = text.data() + text.length() - 1;
+		const char *ptr = inserted.FindLineEnds(text.data(), end, lineStarts.bytes);
+		if (ptr == end) {
+			const unsigned char ch = *end;
+			if ((ch == '\r') || (ch == '\n') ||
+				(unicode && UTF8IsMultibyteLineEnd(inserted.At(end - 2), inserted.At(end - 1), ch))) {
+				lineStarts.bytes.push_back(text.length());
+			}
+		}
+	}
+	lineStarts.bytes.push_back(text.length());
+
+	const LineCharacterIndexType indexes = plv->LineCharacterIndex();
+	if (indexes != LineCharacterIndexType::None) {
+		const size_t lines = lineStarts.bytes.size() - 1;
+		const bool utf32 = FlagSet(indexes, LineCharacterIndexType::Utf32);
+		const bool utf16 = FlagSet(indexes, LineCharacterIndexType::Utf16);
+		if (utf32) {
+			lineStarts.utf32.reserve(lines + 1);
+			lineStarts.utf32.push_back(0);
+		}
+		if (utf16) {
+			lineStarts.utf16.reserve(lines + 1);
+			lineStarts.utf16.push_back(0);
+		}
+		for (size_t line = 0; line < lines; line++) {
+			const Sci::Position lineStart = lineStarts.bytes[line];
+			const CountWidths cw = CountCharacterWidthsUTF8(
+				text.substr(lineStart, lineStarts.bytes[line + 1] - lineStart));
+			if (utf32) {
+				lineStarts.utf32.push_back(lineStarts.utf32.back() + cw.WidthUTF32());
+			}
+			if (utf16) {
+				lineStarts.utf16.push_back(lineStarts.utf16.back() + cw.WidthUTF16());
+			}
+		}
+	}
+	plv->SetLineStarts(lineStarts);
 }
 
 bool CellBuffer::MaintainingLineCharacterIndex() const noexcept {
@@ -785,7 +1005,10 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 		return;
 	PLATFORM_ASSERT(insertLength > 0);
 
-	const unsigned char chAfter = substance.ValueAt(position);
+	// Loading a document so build the line data at once instead of updating it for each line
+	const bool loading = Length() == 0;
+
+	const unsigned char chAfter = CharAt(position);
 	bool breakingUTF8LineEnd = false;
 	if (utf8LineEnds == LineEndType::Unicode && UTF8IsTrailByte(chAfter)) {
 		breakingUTF8LineEnd = UTF8LineEndOverlaps(position);
@@ -800,23 +1023,30 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 	const bool maintainingIndex = MaintainingLineCharacterIndex();
 
 	// Check for breaking apart a UTF-8 sequence and inserting invalid UTF-8
-	if (utf8Substance && maintainingIndex) {
+	if (utf8Substance && maintainingIndex && !loading) {
 		// Actually, don't need to check that whole insertion is valid just that there
 		// are no potential fragments at ends.
 		simpleInsertion = UTF8IsCharacterBoundary(position) &&
 			UTF8IsValid(std::string_view(s, insertLength));
 	}
 
-	substance.InsertFromArray(position, s, 0, insertLength);
+	if (pieces)
+		pieces->Insert(position, s, insertLength);
+	else
+		substance.InsertFromArray(position, s, 0, insertLength);
 	if (hasStyles) {
 		style.InsertValue(position, insertLength, 0);
 	}
+	if (loading) {
+		BuildLineStarts(std::string_view(s, insertLength));
+		return;
+	}
 
 	const bool atLineStart = plv->LineStart(lineInsert-1) == position;
 	// Point all the lines after the insertion point further along in the buffer
 	plv->InsertText(lineInsert-1, insertLength);
-	unsigned char chBeforePrev = substance.ValueAt(position - 2);
-	unsigned char chPrev = substance.ValueAt(position - 1);
+	unsigned char chBeforePrev = CharAt(position - 2);
+	unsigned char chPrev = CharAt(position - 1);
 	if (chPrev == '\r' && chAfter == '\n') {
 		// Splitting up a crlf pair at position
 		InsertLine(lineInsert, position, false);
@@ -826,9 +1056,6 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 		RemoveLine(lineInsert);
 	}
 
-	constexpr size_t PositionBlockSize = 128;
-	Sci::Position positions[PositionBlockSize]{};
-	size_t nPositions = 0;
 	const Sci::Line lineStart = lineInsert;
 
 	// s may not NULL-terminated, ensure *ptr == '\n' or *next == '\n' is valid.
@@ -844,61 +1071,16 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 	}
 
 	if (ptr < end) {
-		uint8_t eolTable[256]{};
-		eolTable[static_cast<uint8_t>('\n')] = 1;
-		eolTable[static_cast<uint8_t>('\r')] = 2;
-		if (utf8LineEnds == LineEndType::Unicode) {
-			// see UniConversion.h for LS, PS and NEL
-			eolTable[0x85] = 4;
-			eolTable[0xa8] = 3;
-			eolTable[0xa9] = 3;
-		}
-
-		do {
-			// skip to line end
-			ch = *ptr++;
-			uint8_t type;
-			while ((type = eolTable[ch]) == 0 && ptr < end) {
-				chBeforePrev = chPrev;
-				chPrev = ch;
-				ch = *ptr++;
-			}
-			switch (type) {
-			case 2: // '\r'
-				if (*ptr == '\n') {
-					++ptr;
-				}
-				[[fallthrough]];
-			case 1: // '\n'
-				positions[nPositions++] = position + ptr - s;
-				if (nPositions == PositionBlockSize) {
-					plv->InsertLines(lineInsert, positions, nPositions, atLineStart);
-					lineInsert += nPositions;
-					nPositions = 0;
-				}
-				break;
-			case 3:
-			case 4:
-				// LS, PS and NEL
-				if ((type == 3 && chPrev == 0x80 && chBeforePrev == 0xe2) || (type == 4 && chPrev == 0xc2)) {
-					positions[nPositions++] = position + ptr - s;
-					if (nPositions == PositionBlockSize) {
-						plv->InsertLines(lineInsert, positions, nPositions, atLineStart);
-						lineInsert += nPositions;
-						nPositions = 0;
-					}
-				}
-				break;
-			}
-
-			chBeforePrev = chPrev;
-			chPrev = ch;
-		} while (ptr < end);
-	}
-
-	if (nPositions != 0) {
-		plv->InsertLines(lineInsert, positions, nPositions, atLineStart);
-		lineInsert += nPositions;
+		// Find all the line ends then insert them into the line vector together
+		const InsertedText inserted(s, position, chPrev, chBeforePrev, utf8LineEnds == LineEndType::Unicode);
+		std::vector<Sci::Position> positions;
+		ptr = inserted.FindLineEnds(ptr, end, positions);
+		if (!positions.empty()) {
+			plv->InsertLines(lineInsert, positions.data(), positions.size(), atLineStart);
+			lineInsert += positions.size();
+		}
+		chBeforePrev = inserted.At(end - 2);
+		chPrev = inserted.At(end - 1);
 	}
 
 	ch = *end;
@@ -927,7 +1109,7 @@ void CellBuffer::BasicInsertString(Sci::Position position, const char *s, Sci::P
 		chPrev = ch;
 		// May have end of UTF-8 line end in buffer and start in insertion
 		for (int j = 0; j < UTF8SeparatorLength-1; j++) {
-			const unsigned char chAt = substance.ValueAt(position + insertLength + j);
+			const unsigned char chAt = CharAt(position + insertLength + j);
 			const unsigned char back3[3] = {chBeforePrev, chPrev, chAt};
 			if (UTF8IsSeparator(back3)) {
 				InsertLine(lineInsert, (position + insertLength + j) + 1, atLineStart);
@@ -957,7 +1139,7 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 
 	Sci::Line lineRecalculateStart = Sci::invalidPosition;
 
-	if ((position == 0) && (deleteLength == substance.Length())) {
+	if ((position == 0) && (deleteLength == Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
 		plv->Init();
@@ -969,9 +1151,9 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 		Sci::Line lineRemove = linePosition + 1;
 
 		plv->InsertText(lineRemove-1, - (deleteLength));
-		const unsigned char chPrev = substance.ValueAt(position - 1);
+		const unsigned char chPrev = CharAt(position - 1);
 		const unsigned char chBefore = chPrev;
-		unsigned char chNext = substance.ValueAt(position);
+		unsigned char chNext = CharAt(position);
 
 		// Check for breaking apart a UTF-8 sequence
 		// Needs further checks that text is UTF-8 or that some other break apart is occurring
@@ -1011,7 +1193,7 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 
 		unsigned char ch = chNext;
 		for (Sci::Position i = 0; i < deleteLength; i++) {
-			chNext = substance.ValueAt(position + i + 1);
+			chNext = CharAt(position + i + 1);
 			if (ch == '\r') {
 				if (chNext != '\n') {
 					RemoveLine(lineRemove);
@@ -1025,7 +1207,7 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 			} else if (utf8LineEnds == LineEndType::Unicode) {
 				if (!UTF8IsAscii(ch)) {
 					const unsigned char next3[3] = {ch, chNext,
-						static_cast<unsigned char>(substance.ValueAt(position + i + 2))};
+						static_cast<unsigned char>(CharAt(position + i + 2))};
 					if (UTF8IsSeparator(next3) || UTF8IsNEL(next3)) {
 						RemoveLine(lineRemove);
 					}
@@ -1036,14 +1218,17 @@ void CellBuffer::BasicDeleteChars(Sci::Position position, Sci::Position deleteLe
 		}
 		// May have to fix up end if last deletion causes cr to be next to lf
 		// or removes one of a crlf pair
-		const char chAfter = substance.ValueAt(position + deleteLength);
+		const char chAfter = CharAt(position + deleteLength);
 		if (chBefore == '\r' && chAfter == '\n') {
 			// Using lineRemove-1 as cr ended line before start of deletion
 			RemoveLine(lineRemove - 1);
 			plv->SetLineStart(lineRemove - 1, position + 1);
 		}
 	}
-	substance.DeleteRange(position, deleteLength);
+	if (pieces)
+		pieces->Delete(position, deleteLength);
+	else
+		substance.DeleteRange(position, deleteLength);
 	if (lineRecalculateStart >= 0) {
 		RecalculateIndexLineStarts(lineRecalculateStart, lineRecalculateStart);
 	}
@@ -1083,6 +1268,14 @@ void CellBuffer::DeleteUndoHistory() noexcept {
 	uh->DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(size_t bytes) {
+	uh->SetMemoryLimit(bytes);
+}
+
+size_t CellBuffer::UndoMemoryLimit() const noexcept {
+	return uh->MemoryLimit();
+}
+
 bool CellBuffer::CanUndo() const noexcept {
 	return uh->CanUndo();
 }
@@ -1091,7 +1284,7 @@ int CellBuffer::StartUndo() noexcept {
 	return uh->StartUndo();
 }
 
-Action CellBuffer::GetUndoStep() const noexcept {
+Action CellBuffer::GetUndoStep() const {
 	return uh->GetUndoStep();
 }
 
@@ -1103,7 +1296,7 @@ void CellBuffer::PerformUndoStep() {
 		changeHistory->StartReversion();
 	}
 	if (previousStep.at == ActionType::insert) {
-		if (substance.Length() < previousStep.lenData) {
+		if (Length() < previousStep.lenData) {
 			throw std::runtime_error(
 				"CellBuffer::PerformUndoStep: deletion must be less than document length.");
 		}
@@ -1129,7 +1322,7 @@ int CellBuffer::StartRedo() noexcept {
 	return uh->StartRedo();
 }
 
-Action CellBuffer::GetRedoStep() const noexcept {
+Action CellBuffer::GetRedoStep() const {
 	return uh->GetRedoStep();
 }
 
@@ -1269,7 +1462,7 @@ Sci::Position CellBuffer::UndoActionPosition(int action) const noexcept {
 	return uh->Position(action);
 }
 
-std::string_view CellBuffer::UndoActionText(int action) const noexcept {
+std::string_view CellBuffer::UndoActionText(int action) const {
 	return uh->Text(action);
 }
 
@@ -22,6 +22,7 @@ public:
 
 class UndoHistory;
 class ChangeHistory;
+class PieceTree;
 
 /**
  * The line vector contains information about each of the lines in a cell buffer.
@@ -77,6 +78,8 @@ private:
 	bool hasStyles;
 	bool largeDocument;
 	SplitVector<char> substance;
+	// When set, text is stored here instead of substance. Styles always use style.
+	std::unique_ptr<PieceTree> pieces;
 	SplitVector<char> style;
 	bool readOnly;
 	bool utf8Substance;
@@ -92,6 +95,7 @@ private:
 	bool UTF8LineEndOverlaps(Sci::Position position) const noexcept;
 	bool UTF8IsCharacterBoundary(Sci::Position position) const;
 	void ResetLineEnds();
+	void BuildLineStarts(std::string_view text);
 	void RecalculateIndexLineStarts(Sci::Line lineFirst, Sci::Line lineLast);
 	bool MaintainingLineCharacterIndex() const noexcept;
 	/// Actions without undo
@@ -100,7 +104,7 @@ private:
 
 public:
 
-	CellBuffer(bool hasStyles_, bool largeDocument_);
+	CellBuffer(bool hasStyles_, bool largeDocument_, bool pieceTree_=false);
 	// Deleted so CellBuffer objects can not be copied.
 	CellBuffer(const CellBuffer &) = delete;
 	CellBuffer(CellBuffer &&) = delete;
@@ -117,7 +121,13 @@ public:
 	const char *BufferPointer();
 	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept;
 	Sci::Position GapPosition() const noexcept;
-	SplitView AllView() const noexcept;
+	/// With a piece tree this first merges the text into one piece.
+	SplitView AllView();
+	/// Segmented read access that works for either storage without moving or merging text.
+	/// Returns the contiguous run of text containing position and sets segmentStart to its start.
+	std::string_view SegmentAt(Sci::Position position, Sci::Position &segmentStart) const noexcept;
+	/// An independent copy of the text: O(1) with a piece tree, otherwise a single copy of the bytes.
+	PieceTree TextSnapshot() const;
 
 	Sci::Position Length() const noexcept;
 	void Allocate(Sci::Position newSize);
@@ -151,6 +161,7 @@ public:
 	void SetReadOnly(bool set) noexcept;
 	bool IsLarge() const noexcept;
 	bool HasStyles() const noexcept;
+	bool UsesPieceTree() const noexcept;
 
 	/// The save point is a marker in the undo stack where the container has stated that
 	/// the buffer was saved. Undo and redo can move over the save point.
@@ -169,16 +180,18 @@ public:
 	int UndoSequenceDepth() const noexcept;
 	void AddUndoAction(Sci::Position token, bool mayCoalesce);
 	void DeleteUndoHistory() noexcept;
+	void SetUndoMemoryLimit(size_t bytes);
+	[[nodiscard]] size_t UndoMemoryLimit() const noexcept;
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
 	bool CanUndo() const noexcept;
 	int StartUndo() noexcept;
-	Action GetUndoStep() const noexcept;
+	Action GetUndoStep() const;
 	void PerformUndoStep();
 	bool CanRedo() const noexcept;
 	int StartRedo() noexcept;
-	Action GetRedoStep() const noexcept;
+	Action GetRedoStep() const;
 	void PerformRedoStep();
 
 	int UndoActions() const noexcept;
@@ -192,7 +205,7 @@ public:
 	int UndoCurrent() const noexcept;
 	int UndoActionType(int action) const noexcept;
 	Sci::Position UndoActionPosition(int action) const noexcept;
-	std::string_view UndoActionText(int action) const noexcept;
+	std::string_view UndoActionText(int action) const;
 	void PushUndoActionType(int type, Sci::Position position);
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
@@ -22,8 +22,6 @@
 #include "Position.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
-#include "RunStyles.h"
-#include "SparseVector.h"
 #include "ChangeHistory.h"
 
 namespace Scintilla::Internal {
@@ -106,11 +104,355 @@ void ChangeStack::Check() const noexcept {
 #endif
 }
 
+void RunBlocks::Clear(Sci::Position length) {
+	starts.DeleteAll();
+	starts.InsertText(0, length);
+	blocks.clear();
+	blocks.push_back({ { length, 0 } });
+}
+
+Sci::Position RunBlocks::Length() const noexcept {
+	return starts.Length();
+}
+
+RunBlocks::Location RunBlocks::Find(Sci::Position position) const noexcept {
+	const size_t block = starts.PartitionFromPosition(position);
+	const std::vector<EditionRun> &runs = blocks[block];
+	Sci::Position start = starts.PositionFromPartition(block);
+	for (size_t run = 0; run < runs.size() - 1; run++) {
+		if (position < start + runs[run].length) {
+			return { block, run, start };
+		}
+		start += runs[run].length;
+	}
+	return { block, runs.size() - 1, start };
+}
+
+const EditionRun &RunBlocks::At(Location location) const noexcept {
+	return blocks[location.block][location.run];
+}
+
+bool RunBlocks::First(Location location) const noexcept {
+	return (location.block == 0) && (location.run == 0);
+}
+
+bool RunBlocks::Last(Location location) const noexcept {
+	return (location.block == blocks.size() - 1) && (location.run == blocks[location.block].size() - 1);
+}
+
+RunBlocks::Location RunBlocks::Previous(Location location) const noexcept {
+	assert(!First(location));
+	if (location.run == 0) {
+		location.block--;
+		location.run = blocks[location.block].size();
+	}
+	location.run--;
+	location.start -= blocks[location.block][location.run].length;
+	return location;
+}
+
+void RunBlocks::SetValue(Location location, int value) noexcept {
+	blocks[location.block][location.run].value = value;
+}
+
+void RunBlocks::Resize(Location location, Sci::Position delta) noexcept {
+	blocks[location.block][location.run].length += delta;
+	starts.InsertText(location.block, delta);
+}
+
+void RunBlocks::Insert(Location location, EditionRun run) {
+	std::vector<EditionRun> &runs = blocks[location.block];
+	runs.insert(runs.begin() + location.run, run);
+	starts.InsertText(location.block, run.length);
+	if (runs.size() > blockMax) {
+		// Move the second half of the runs into a new block
+		const size_t half = runs.size() / 2;
+		Sci::Position lengthFirst = 0;
+		for (size_t i = 0; i < half; i++) {
+			lengthFirst += runs[i].length;
+		}
+		std::vector<EditionRun> second(runs.begin() + half, runs.end());
+		runs.erase(runs.begin() + half, runs.end());
+		blocks.insert(blocks.begin() + location.block + 1, std::move(second));
+		starts.InsertPartition(location.block + 1, starts.PositionFromPartition(location.block) + lengthFirst);
+	}
+}
+
+void RunBlocks::Remove(Location location) {
+	std::vector<EditionRun> &runs = blocks[location.block];
+	const Sci::Position length = runs[location.run].length;
+	runs.erase(runs.begin() + location.run);
+	starts.InsertText(location.block, -length);
+	if (runs.empty()) {
+		assert(blocks.size() > 1);
+		// The empty block has no length so removing either of its bounds leaves the other
+		// blocks in place but the start of the first block has to stay at 0.
+		starts.RemovePartition((location.block == 0) ? 1 : location.block);
+		blocks.erase(blocks.begin() + location.block);
+	}
+}
+
+RunBlocks::Location RunBlocks::Split(Sci::Position position) {
+	assert(position < Length());
+	const Location location = Find(position);
+	if (location.start < position) {
+		EditionRun &run = blocks[location.block][location.run];
+		const EditionRun after { location.start + run.length - position, run.value };
+		run.length = position - location.start;
+		// Insert adds the length of the new run to the block so remove it first
+		starts.InsertText(location.block, -after.length);
+		Insert({ location.block, location.run + 1, position }, after);
+		return Find(position);
+	}
+	return location;
+}
+
+void EditionRuns::MergeAt(Sci::Position position) {
+	if ((position <= 0) || (position >= runs.Length())) {
+		return;
+	}
+	const RunBlocks::Location location = runs.Find(position);
+	if (location.start == position) {
+		const RunBlocks::Location previous = runs.Previous(location);
+		if (runs.At(previous).value == runs.At(location).value) {
+			runs.Resize(previous, runs.At(location).length);
+			runs.Remove(location);
+		}
+	}
+}
+
+void EditionRuns::Clear(Sci::Position length) {
+	runs.Clear(length);
+}
+
+Sci::Position EditionRuns::Length() const noexcept {
+	return runs.Length();
+}
+
+int EditionRuns::ValueAt(Sci::Position position) const noexcept {
+	return runs.At(runs.Find(position)).value;
+}
+
+Sci::Position EditionRuns::EndRun(Sci::Position position) const noexcept {
+	const RunBlocks::Location location = runs.Find(position);
+	return location.start + runs.At(location).length;
+}
+
+void EditionRuns::InsertSpace(Sci::Position position, Sci::Position insertLength) {
+	if (insertLength <= 0) {
+		return;
+	}
+	const RunBlocks::Location location = runs.Find(position);
+	if ((location.start < position) || (runs.Length() == 0)) {
+		runs.Resize(location, insertLength);
+	} else if (runs.At(location).value == 0) {
+		// Insert at end of previous run so do not extend its value
+		runs.Resize(location, insertLength);
+	} else if (runs.First(location)) {
+		// Inserting at start of document so ensure 0
+		runs.Insert(location, { insertLength, 0 });
+	} else {
+		// Inserting at start of run so make previous longer
+		runs.Resize(runs.Previous(location), insertLength);
+	}
+}
+
+void EditionRuns::DeleteRange(Sci::Position position, Sci::Position deleteLength) {
+	if (deleteLength <= 0) {
+		return;
+	}
+	const Sci::Position end = position + deleteLength;
+	if ((position == 0) && (end >= runs.Length())) {
+		runs.Clear(runs.Length() - deleteLength);
+		return;
+	}
+	if (end < runs.Length()) {
+		runs.Split(end);
+	}
+	RunBlocks::Location location = runs.Split(position);
+	while (runs.At(location).length < deleteLength) {
+		deleteLength -= runs.At(location).length;
+		runs.Remove(location);
+		location = runs.Find(position);
+	}
+	runs.Resize(location, -deleteLength);
+	if (runs.At(location).length == 0) {
+		runs.Remove(location);
+	}
+	MergeAt(position);
+}
+
+void EditionRuns::FillRange(Sci::Position position, int value, Sci::Position fillLength) {
+	const Sci::Position end = position + fillLength;
+	if ((fillLength <= 0) || (position < 0) || (end > runs.Length())) {
+		return;
+	}
+	if (end < runs.Length()) {
+		runs.Split(end);
+	}
+	RunBlocks::Location location = runs.Split(position);
+	runs.SetValue(location, value);
+	// Absorb the other runs covered by the range
+	while (runs.At(location).length < fillLength) {
+		const RunBlocks::Location next = runs.Find(position + runs.At(location).length);
+		runs.Resize(location, runs.At(next).length);
+		runs.Remove(next);
+		location = runs.Find(position);
+	}
+	MergeAt(end);
+	MergeAt(position);
+}
+
+int DeletionPoints::Acquire() {
+	if (unused.empty()) {
+		sets.emplace_back();
+		return static_cast<int>(sets.size());
+	}
+	const int set = unused.back();
+	unused.pop_back();
+	return set;
+}
+
+void DeletionPoints::Release(int set) noexcept {
+	if (set) {
+		// Keep the allocation for reuse
+		sets[set - 1].clear();
+		unused.push_back(set);
+	}
+}
+
+int DeletionPoints::Take(Sci::Position position) {
+	if (position == runs.Length()) {
+		const int set = atEnd;
+		atEnd = 0;
+		return set;
+	}
+	const RunBlocks::Location location = runs.Find(position);
+	if (location.start != position) {
+		return 0;
+	}
+	const int set = runs.At(location).value;
+	if (runs.First(location)) {
+		runs.SetValue(location, 0);
+	} else {
+		runs.Resize(runs.Previous(location), runs.At(location).length);
+		runs.Remove(location);
+	}
+	return set;
+}
+
+void DeletionPoints::Put(Sci::Position position, int set) {
+	if (!set) {
+		return;
+	}
+	if (position == runs.Length()) {
+		assert(!atEnd);
+		atEnd = set;
+		return;
+	}
+	assert(!ValueAt(position));
+	runs.SetValue(runs.Split(position), set);
+}
+
+void DeletionPoints::Clear(Sci::Position length) {
+	runs.Clear(length);
+	atEnd = 0;
+	sets.clear();
+	unused.clear();
+}
+
+Sci::Position DeletionPoints::Length() const noexcept {
+	return runs.Length();
+}
+
+const EditionSet *DeletionPoints::ValueAt(Sci::Position position) const noexcept {
+	int set = 0;
+	if (position == runs.Length()) {
+		set = atEnd;
+	} else if ((position >= 0) && (position < runs.Length())) {
+		const RunBlocks::Location location = runs.Find(position);
+		if (location.start == position) {
+			set = runs.At(location).value;
+		}
+	}
+	return set ? &sets[set - 1] : nullptr;
+}
+
+EditionSet *DeletionPoints::ValueAt(Sci::Position position) noexcept {
+	return const_cast<EditionSet *>(static_cast<const DeletionPoints *>(this)->ValueAt(position));
+}
+
+Sci::Position DeletionPoints::PositionNext(Sci::Position position) const noexcept {
+	if (position >= runs.Length()) {
+		return runs.Length() + 1;	// Out of bounds to terminate
+	}
+	const RunBlocks::Location location = runs.Find(position);
+	return location.start + runs.At(location).length;
+}
+
+EditionSet &DeletionPoints::Ensure(Sci::Position position) {
+	EditionSet *editions = ValueAt(position);
+	if (editions) {
+		return *editions;
+	}
+	const int set = Acquire();
+	Put(position, set);
+	return sets[set - 1];
+}
+
+void DeletionPoints::Remove(Sci::Position position) {
+	Release(Take(position));
+}
+
+void DeletionPoints::Move(Sci::Position from, Sci::Position to) {
+	const int set = Take(from);
+	Remove(to);
+	Put(to, set);
+}
+
+void DeletionPoints::InsertSpace(Sci::Position position, Sci::Position insertLength) {
+	if (insertLength <= 0) {
+		return;
+	}
+	// Deletions at or after position move forward
+	const RunBlocks::Location location = runs.Find(position);
+	if ((location.start < position) || (position == runs.Length())) {
+		runs.Resize(location, insertLength);
+	} else if (runs.First(location)) {
+		if (runs.At(location).value) {
+			runs.Insert(location, { insertLength, 0 });
+		} else {
+			runs.Resize(location, insertLength);
+		}
+	} else {
+		runs.Resize(runs.Previous(location), insertLength);
+	}
+}
+
+void DeletionPoints::DeleteRange(Sci::Position position, Sci::Position deleteLength) {
+	if ((deleteLength <= 0) || (position + deleteLength > runs.Length())) {
+		return;
+	}
+	const Sci::Position end = position + deleteLength;
+	const int kept = Take(position);
+	const int moved = Take(end);
+	for (Sci::Position next = PositionNext(position); next < end; next = PositionNext(position)) {
+		Remove(next);
+	}
+	// No deletions remain in the range so it is all inside one run
+	runs.Resize(runs.Find(position), -deleteLength);
+	if (kept) {
+		Put(position, kept);
+		Release(moved);
+	} else {
+		Put(position, moved);
+	}
+}
+
 void ChangeLog::Clear(Sci::Position length) {
 	changeStack.Clear();
-	insertEdition.DeleteAll();
-	deleteEdition.DeleteAll();
-	InsertSpace(0, length);
+	insertEdition.Clear(length);
+	deleteEdition.Clear(length);
 }
 
 void ChangeLog::InsertSpace(Sci::Position position, Sci::Position insertLength) {
@@ -121,15 +463,7 @@ void ChangeLog::InsertSpace(Sci::Position position, Sci::Position insertLength)
 
 void ChangeLog::DeleteRange(Sci::Position position, Sci::Position deleteLength) {
 	insertEdition.DeleteRange(position, deleteLength);
-	const EditionSetOwned &editions = deleteEdition.ValueAt(position);
-	if (editions) {
-		const EditionSet savedEditions = *editions;
-		deleteEdition.DeleteRange(position, deleteLength);
-		EditionSetOwned reset = std::make_unique<EditionSet>(savedEditions);
-		deleteEdition.SetValueAt(position, std::move(reset));
-	} else {
-		deleteEdition.DeleteRange(position, deleteLength);
-	}
+	deleteEdition.DeleteRange(position, deleteLength);
 	assert(insertEdition.Length() == deleteEdition.Length());
 }
 
@@ -141,13 +475,13 @@ void ChangeLog::CollapseRange(Sci::Position position, Sci::Position deleteLength
 	const Sci::Position positionMax = position + deleteLength;
 	Sci::Position positionDeletion = position + 1;
 	while (positionDeletion <= positionMax) {
-		const EditionSetOwned &editions = deleteEdition.ValueAt(positionDeletion);
-		if (editions) {
-			for (const EditionCount &ec : *editions) {
+		if (deleteEdition.ValueAt(positionDeletion)) {
+			// Ensure may move sets so fetch the source afterwards
+			deleteEdition.Ensure(position);
+			for (const EditionCount &ec : *deleteEdition.ValueAt(positionDeletion)) {
 				PushDeletionAt(position, ec);
 			}
-			EditionSetOwned empty;
-			deleteEdition.SetValueAt(positionDeletion, std::move(empty));
+			deleteEdition.Remove(positionDeletion);
 		}
 		positionDeletion = deleteEdition.PositionNext(positionDeletion);
 	}
@@ -185,18 +519,12 @@ int EditionSetCount(const EditionSet &set) noexcept {
 }
 
 void ChangeLog::PushDeletionAt(Sci::Position position, EditionCount ec) {
-	if (!deleteEdition.ValueAt(position)) {
-		deleteEdition.SetValueAt(position, std::make_unique<EditionSet>());
-	}
-	EditionSetPush(*deleteEdition.ValueAt(position), ec);
+	EditionSetPush(deleteEdition.Ensure(position), ec);
 }
 
 void ChangeLog::InsertFrontDeletionAt(Sci::Position position, EditionCount ec) {
-	if (!deleteEdition.ValueAt(position)) {
-		deleteEdition.SetValueAt(position, std::make_unique<EditionSet>());
-	}
-	const EditionSetOwned &editions = deleteEdition.ValueAt(position);
-	editions->insert(editions->begin(), ec);
+	EditionSet &editions = deleteEdition.Ensure(position);
+	editions.insert(editions.begin(), ec);
 }
 
 void ChangeLog::SaveRange(Sci::Position position, Sci::Position length) {
@@ -216,7 +544,7 @@ void ChangeLog::SaveRange(Sci::Position position, Sci::Position length) {
 	}
 	Sci::Position positionDeletion = position + 1;
 	while (positionDeletion <= positionMax) {
-		const EditionSetOwned &editions = deleteEdition.ValueAt(positionDeletion);
+		const EditionSet *editions = deleteEdition.ValueAt(positionDeletion);
 		if (editions) {
 			for (const EditionCount &ec : *editions) {
 				changeStack.PushDeletion(positionDeletion, ec);
@@ -229,11 +557,9 @@ void ChangeLog::SaveRange(Sci::Position position, Sci::Position length) {
 void ChangeLog::PopDeletion(Sci::Position position, Sci::Position deleteLength) {
 	// Just performed InsertSpace(position, deleteLength) so *this* element in
 	// deleteEdition moved forward by deleteLength
-	EditionSetOwned eso = deleteEdition.Extract(position + deleteLength);
-	deleteEdition.SetValueAt(position, std::move(eso));
-	const EditionSetOwned &editions = deleteEdition.ValueAt(position);
-	assert(editions);
-	EditionSetPop(*editions);
+	deleteEdition.Move(position + deleteLength, position);
+	assert(deleteEdition.ValueAt(position));
+	EditionSetPop(*deleteEdition.ValueAt(position));
 	const int inserts = changeStack.PopStep();
 	for (int i = 0; i < inserts;) {
 		const ChangeSpan span = changeStack.PopSpan(inserts);
@@ -242,6 +568,8 @@ void ChangeLog::PopDeletion(Sci::Position position, Sci::Position deleteLength)
 			insertEdition.FillRange(span.start, span.edition, span.length);
 			i++;
 		} else {
+			// Sets may have moved so fetch again
+			EditionSet *editions = deleteEdition.ValueAt(position);
 			assert(editions);
 			assert(editions->back().edition == span.edition);
 			for (int j = 0; j < span.count; j++) {
@@ -255,8 +583,8 @@ void ChangeLog::PopDeletion(Sci::Position position, Sci::Position deleteLength)
 		}
 	}
 
-	if (editions->empty()) {
-		deleteEdition.SetValueAt(position, EditionSetOwned{});
+	if (deleteEdition.ValueAt(position)->empty()) {
+		deleteEdition.Remove(position);
 	}
 }
 
@@ -288,7 +616,7 @@ void ChangeLog::SetSavePoint() {
 	}
 
 	for (Sci::Position positionDeletion = 0; positionDeletion <= length;) {
-		const EditionSetOwned &editions = deleteEdition.ValueAt(positionDeletion);
+		EditionSet *editions = deleteEdition.ValueAt(positionDeletion);
 		if (editions) {
 			for (EditionCount &ec : *editions) {
 				if (ec.edition == changeModified) {
@@ -308,7 +636,7 @@ size_t ChangeLog::DeletionCount(Sci::Position start, Sci::Position length) const
 	const Sci::Position end = start + length;
 	size_t count = 0;
 	while (start <= end) {
-		const EditionSetOwned &editions = deleteEdition.ValueAt(start);
+		const EditionSet *editions = deleteEdition.ValueAt(start);
 		if (editions) {
 			count += EditionSetCount(*editions);
 		}
@@ -448,14 +776,14 @@ Sci::Position ChangeHistory::EditionEndRun(Sci::Position pos) const noexcept {
 // Produce a 4-bit value from the deletions at a position
 unsigned int ChangeHistory::EditionDeletesAt(Sci::Position pos) const noexcept {
 	unsigned int editionSet = 0;
-	const EditionSetOwned &editionSetDeletions = changeLog.deleteEdition.ValueAt(pos);
+	const EditionSet *editionSetDeletions = changeLog.deleteEdition.ValueAt(pos);
 	if (editionSetDeletions) {
 		for (const EditionCount &ec : *editionSetDeletions) {
 			editionSet = editionSet | (1u << (ec.edition-1));
 		}
 	}
 	if (changeLogReversions) {
-		const EditionSetOwned &editionSetReversions = changeLogReversions->deleteEdition.ValueAt(pos);
+		const EditionSet *editionSetReversions = changeLogReversions->deleteEdition.ValueAt(pos);
 		if (editionSetReversions) {
 			// If there is no saved or modified -> revertedToOrigin
 			if (!(editionSet & (bitSaved | bitModified))) {
@@ -482,7 +810,7 @@ size_t ChangeHistory::DeletionCount(Sci::Position start, Sci::Position length) c
 }
 
 EditionSet ChangeHistory::DeletionsAt(Sci::Position pos) const {
-	const EditionSetOwned &editions = changeLog.deleteEdition.ValueAt(pos);
+	const EditionSet *editions = changeLog.deleteEdition.ValueAt(pos);
 	if (editions) {
 		return *editions;
 	}
@@ -41,7 +41,85 @@ struct EditionCount {
 
 // EditionSet is ordered from oldest to newest, its not really a set
 using EditionSet = std::vector<EditionCount>;
-using EditionSetOwned = std::unique_ptr<EditionSet>;
+
+struct EditionRun {
+	Sci::Position length;
+	int value;
+};
+
+// Runs of values over positions held in blocks of at most blockMax runs. The start of each
+// block is kept in a Partitioning so an edit only moves the runs of one block and the
+// block starts instead of every run after it.
+class RunBlocks {
+	Partitioning<Sci::Position> starts;
+	std::vector<std::vector<EditionRun>> blocks;
+public:
+	static constexpr size_t blockMax = 0x80;
+	struct Location {
+		size_t block;
+		size_t run;
+		Sci::Position start;
+	};
+	void Clear(Sci::Position length);
+	[[nodiscard]] Sci::Position Length() const noexcept;
+	// The run containing position or, at the end, the last run.
+	[[nodiscard]] Location Find(Sci::Position position) const noexcept;
+	[[nodiscard]] const EditionRun &At(Location location) const noexcept;
+	[[nodiscard]] bool First(Location location) const noexcept;
+	[[nodiscard]] bool Last(Location location) const noexcept;
+	[[nodiscard]] Location Previous(Location location) const noexcept;
+	void SetValue(Location location, int value) noexcept;
+	void Resize(Location location, Sci::Position delta) noexcept;
+	void Insert(Location location, EditionRun run);
+	void Remove(Location location);
+	// Ensure a run starts at position and return it. Position must be less than Length.
+	Location Split(Sci::Position position);
+};
+
+// The edition of the insertion that produced each position, with the same behaviour as
+// RunStyles: adjacent runs always have different values.
+class EditionRuns {
+	RunBlocks runs;
+	void MergeAt(Sci::Position position);
+public:
+	void Clear(Sci::Position length);
+	[[nodiscard]] Sci::Position Length() const noexcept;
+	[[nodiscard]] int ValueAt(Sci::Position position) const noexcept;
+	[[nodiscard]] Sci::Position EndRun(Sci::Position position) const noexcept;
+	void InsertSpace(Sci::Position position, Sci::Position insertLength);
+	void DeleteRange(Sci::Position position, Sci::Position deleteLength);
+	void FillRange(Sci::Position position, int value, Sci::Position fillLength);
+};
+
+// The editions of deletions at each position from 0 to Length inclusive. Each deletion
+// point starts a run so the next point is found at the end of the run. Sets are kept in
+// a pool and reused instead of being allocated for each point.
+class DeletionPoints {
+	RunBlocks runs;
+	int atEnd = 0;
+	std::vector<EditionSet> sets;
+	std::vector<int> unused;
+	int Acquire();
+	void Release(int set) noexcept;
+	int Take(Sci::Position position);
+	void Put(Sci::Position position, int set);
+public:
+	void Clear(Sci::Position length);
+	[[nodiscard]] Sci::Position Length() const noexcept;
+	// nullptr when there are no deletions at position.
+	[[nodiscard]] const EditionSet *ValueAt(Sci::Position position) const noexcept;
+	[[nodiscard]] EditionSet *ValueAt(Sci::Position position) noexcept;
+	// Position of the next deletion after position, Length, or Length+1 after the end.
+	[[nodiscard]] Sci::Position PositionNext(Sci::Position position) const noexcept;
+	// Returns the set at position, adding an empty set if needed. May move other sets.
+	EditionSet &Ensure(Sci::Position position);
+	void Remove(Sci::Position position);
+	void Move(Sci::Position from, Sci::Position to);
+	void InsertSpace(Sci::Position position, Sci::Position insertLength);
+	// Deletions inside the range are dropped. The deletions at position are kept or, when
+	// there are none, those at the end of the range move to position.
+	void DeleteRange(Sci::Position position, Sci::Position deleteLength);
+};
 
 class ChangeStack {
 	std::vector<int> steps;
@@ -59,8 +137,8 @@ public:
 
 struct ChangeLog {
 	ChangeStack changeStack;
-	RunStyles<Sci::Position, int> insertEdition;
-	SparseVector<EditionSetOwned> deleteEdition;
+	EditionRuns insertEdition;
+	DeletionPoints deleteEdition;
 
 	void Clear(Sci::Position length);
 	void InsertSpace(Sci::Position position, Sci::Position insertLength);
@@ -14,6 +14,7 @@
 #include <vector>
 #include <optional>
 #include <algorithm>
+#include <iterator>
 #include <memory>
 
 #include "Debugging.h"
@@ -419,11 +420,570 @@ void ContractionState<LINE>::Check() const noexcept {
 #endif
 }
 
+// Sums of a sequence of values that can each be changed or summed up to any index in O(log n).
+template <typename T>
+class FenwickTree {
+	// tree[i] is the sum of values[i - lowbit(i)] .. values[i - 1]
+	std::vector<T> tree;
+	static constexpr size_t LowBit(size_t i) noexcept {
+		return i & (~i + 1);
+	}
+public:
+	template <typename ValueAt>
+	void Build(size_t length, ValueAt valueAt) {
+		tree.assign(length + 1, 0);
+		for (size_t i = 1; i <= length; i++) {
+			tree[i] += valueAt(i - 1);
+			const size_t parent = i + LowBit(i);
+			if (parent <= length) {
+				tree[parent] += tree[i];
+			}
+		}
+	}
+	void Add(size_t index, T delta) noexcept {
+		for (size_t i = index + 1; i < tree.size(); i += LowBit(i)) {
+			tree[i] += delta;
+		}
+	}
+	// Sum of the first count values
+	[[nodiscard]] T Prefix(size_t count) const noexcept {
+		T sum = 0;
+		for (size_t i = count; i > 0; i -= LowBit(i)) {
+			sum += tree[i];
+		}
+		return sum;
+	}
+	// Largest count with Prefix(count) <= value when no value is negative.
+	// Prefix(count) is subtracted from value.
+	size_t Find(T &value) const noexcept {
+		size_t step = 1;
+		while (step * 2 < tree.size()) {
+			step *= 2;
+		}
+		size_t count = 0;
+		for (; step > 0; step /= 2) {
+			if ((count + step < tree.size()) && (tree[count + step] <= value)) {
+				count += step;
+				value -= tree[count];
+			}
+		}
+		return count;
+	}
+};
+
+// Alternative to ContractionState that keeps the state of each line in blocks with Fenwick trees
+// of the lines and display lines in each block. Changing the height or visibility of lines
+// scattered through a large document does not have to move a step through all the display
+// line positions in between, and mapping between document and display lines is O(log n).
+template <typename LINE>
+class ContractionTree final : public IContractionState {
+	// Blocks are split in half when longer than this.
+	static constexpr size_t blockMax = 0x100;
+	struct LineState {
+		int height = 1;
+		bool visible = true;
+		bool expanded = true;
+		[[nodiscard]] LINE Displayed() const noexcept {
+			return visible ? height : 0;
+		}
+	};
+	struct Block {
+		std::vector<LineState> lines;
+		LINE displayed = 0;
+		LINE hidden = 0;
+		LINE contracted = 0;
+		void Count(const LineState &state, int direction) noexcept {
+			displayed += state.Displayed() * direction;
+			hidden += state.visible ? 0 : direction;
+			contracted += state.expanded ? 0 : direction;
+		}
+	};
+	std::vector<Block> blocks;
+	FenwickTree<LINE> lineCounts;
+	FenwickTree<LINE> displayCounts;
+	std::unique_ptr<SparseVector<UniqueString>> foldDisplayTexts;
+	LINE linesInDocument;
+	LINE linesDisplayed;
+	LINE linesHidden;
+
+	void EnsureData();
+
+	bool OneToOne() const noexcept {
+		// True when each document line is exactly one display line so need for
+		// complex data structures.
+		return foldDisplayTexts == nullptr;
+	}
+
+	void Rebuild();
+	// Block holding lineDoc and the index of lineDoc in that block
+	[[nodiscard]] std::pair<size_t, size_t> Locate(Sci::Line lineDoc) const noexcept;
+	void Change(Sci::Line lineDoc, LineState state);
+
+	static constexpr LINE line_cast(Sci::Line line) noexcept {
+		return static_cast<LINE>(line);
+	}
+
+public:
+	ContractionTree() noexcept;
+
+	void Clear() noexcept override;
+
+	Sci::Line LinesInDoc() const noexcept override;
+	Sci::Line LinesDisplayed() const noexcept override;
+	Sci::Line DisplayFromDoc(Sci::Line lineDoc) const noexcept override;
+	Sci::Line DisplayLastFromDoc(Sci::Line lineDoc) const noexcept override;
+	Sci::Line DocFromDisplay(Sci::Line lineDisplay) const noexcept override;
+
+	void InsertLines(Sci::Line lineDoc, Sci::Line lineCount) override;
+	void DeleteLines(Sci::Line lineDoc, Sci::Line lineCount) override;
+
+	bool GetVisible(Sci::Line lineDoc) const noexcept override;
+	bool SetVisible(Sci::Line lineDocStart, Sci::Line lineDocEnd, bool isVisible) override;
+	bool HiddenLines() const noexcept override;
+
+	const char *GetFoldDisplayText(Sci::Line lineDoc) const noexcept override;
+	bool SetFoldDisplayText(Sci::Line lineDoc, const char *text) override;
+
+	bool GetExpanded(Sci::Line lineDoc) const noexcept override;
+	bool SetExpanded(Sci::Line lineDoc, bool isExpanded) override;
+	bool ExpandAll() override;
+	Sci::Line ContractedNext(Sci::Line lineDocStart) const noexcept override;
+
+	int GetHeight(Sci::Line lineDoc) const noexcept override;
+	bool SetHeight(Sci::Line lineDoc, int height) override;
+
+	void ShowAll() noexcept override;
+
+	void Check() const noexcept;
+};
+
+template <typename LINE>
+ContractionTree<LINE>::ContractionTree() noexcept : linesInDocument(1), linesDisplayed(1), linesHidden(0) {
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::EnsureData() {
+	if (OneToOne()) {
+		const LINE lines = linesInDocument;
+		foldDisplayTexts = std::make_unique<SparseVector<UniqueString>>();
+		blocks.emplace_back();
+		linesInDocument = 0;
+		linesDisplayed = 0;
+		linesHidden = 0;
+		InsertLines(0, lines);
+	}
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::Rebuild() {
+	lineCounts.Build(blocks.size(), [this](size_t block) noexcept {
+		return static_cast<LINE>(blocks[block].lines.size());
+	});
+	displayCounts.Build(blocks.size(), [this](size_t block) noexcept {
+		return blocks[block].displayed;
+	});
+}
+
+template <typename LINE>
+std::pair<size_t, size_t> ContractionTree<LINE>::Locate(Sci::Line lineDoc) const noexcept {
+	LINE index = line_cast(lineDoc);
+	const size_t block = lineCounts.Find(index);
+	return { block, index };
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::Change(Sci::Line lineDoc, LineState state) {
+	const auto [block, index] = Locate(lineDoc);
+	Block &b = blocks[block];
+	LineState &current = b.lines[index];
+	const LINE displayedBefore = b.displayed;
+	const LINE hiddenBefore = b.hidden;
+	b.Count(current, -1);
+	current = state;
+	b.Count(current, 1);
+	displayCounts.Add(block, b.displayed - displayedBefore);
+	linesDisplayed += b.displayed - displayedBefore;
+	linesHidden += b.hidden - hiddenBefore;
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::Clear() noexcept {
+	blocks.clear();
+	lineCounts.Build(0, [](size_t) noexcept { return 0; });
+	displayCounts.Build(0, [](size_t) noexcept { return 0; });
+	foldDisplayTexts.reset();
+	linesInDocument = 1;
+	linesDisplayed = 1;
+	linesHidden = 0;
+}
+
+template <typename LINE>
+Sci::Line ContractionTree<LINE>::LinesInDoc() const noexcept {
+	return linesInDocument;
+}
+
+template <typename LINE>
+Sci::Line ContractionTree<LINE>::LinesDisplayed() const noexcept {
+	if (OneToOne()) {
+		return linesInDocument;
+	} else {
+		return linesDisplayed;
+	}
+}
+
+template <typename LINE>
+Sci::Line ContractionTree<LINE>::DisplayFromDoc(Sci::Line lineDoc) const noexcept {
+	if (OneToOne()) {
+		return (lineDoc <= linesInDocument) ? lineDoc : linesInDocument;
+	} else {
+		if (lineDoc >= linesInDocument) {
+			return linesDisplayed;
+		}
+		if (lineDoc < 0) {
+			return 0;
+		}
+		const auto [block, index] = Locate(lineDoc);
+		Sci::Line lineDisplay = displayCounts.Prefix(block);
+		const std::vector<LineState> &lines = blocks[block].lines;
+		for (size_t i = 0; i < index; i++) {
+			lineDisplay += lines[i].Displayed();
+		}
+		return lineDisplay;
+	}
+}
+
+template <typename LINE>
+Sci::Line ContractionTree<LINE>::DisplayLastFromDoc(Sci::Line lineDoc) const noexcept {
+	return DisplayFromDoc(lineDoc) + GetHeight(lineDoc) - 1;
+}
+
+template <typename LINE>
+Sci::Line ContractionTree<LINE>::DocFromDisplay(Sci::Line lineDisplay) const noexcept {
+	if (OneToOne()) {
+		return lineDisplay;
+	} else {
+		if (lineDisplay < 0) {
+			return 0;
+		}
+		if (lineDisplay >= linesDisplayed) {
+			return linesInDocument;
+		}
+		LINE remaining = line_cast(lineDisplay);
+		const size_t block = displayCounts.Find(remaining);
+		Sci::Line lineDoc = lineCounts.Prefix(block);
+		for (const LineState &state : blocks[block].lines) {
+			if (remaining < state.Displayed()) {
+				break;
+			}
+			remaining -= state.Displayed();
+			lineDoc++;
+		}
+		PLATFORM_ASSERT(GetVisible(lineDoc));
+		return lineDoc;
+	}
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::InsertLines(Sci::Line lineDoc, Sci::Line lineCount) {
+	if (OneToOne()) {
+		linesInDocument += line_cast(lineCount);
+	} else if (lineCount > 0) {
+		for (Sci::Line l = 0; l < lineCount; l++) {
+			foldDisplayTexts->InsertSpace(lineDoc + l, 1);
+			foldDisplayTexts->SetValueAt(lineDoc + l, nullptr);
+		}
+		size_t block = blocks.size() - 1;
+		size_t index = blocks[block].lines.size();
+		if (lineDoc < linesInDocument) {
+			std::tie(block, index) = Locate(lineDoc);
+		}
+		Block &b = blocks[block];
+		b.lines.insert(b.lines.begin() + index, lineCount, LineState());
+		b.displayed += line_cast(lineCount);
+		linesInDocument += line_cast(lineCount);
+		linesDisplayed += line_cast(lineCount);
+		if (b.lines.size() <= blockMax) {
+			lineCounts.Add(block, line_cast(lineCount));
+			displayCounts.Add(block, line_cast(lineCount));
+		} else {
+			// Divide into half full blocks so following insertions have room
+			std::vector<Block> pieces;
+			for (size_t start = 0; start < b.lines.size(); start += blockMax / 2) {
+				Block &piece = pieces.emplace_back();
+				const size_t end = std::min(start + blockMax / 2, b.lines.size());
+				piece.lines.assign(b.lines.begin() + start, b.lines.begin() + end);
+				for (const LineState &state : piece.lines) {
+					piece.Count(state, 1);
+				}
+			}
+			blocks.erase(blocks.begin() + block);
+			blocks.insert(blocks.begin() + block,
+				std::make_move_iterator(pieces.begin()), std::make_move_iterator(pieces.end()));
+			Rebuild();
+		}
+	}
+	Check();
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::DeleteLines(Sci::Line lineDoc, Sci::Line lineCount) {
+	if (OneToOne()) {
+		linesInDocument -= line_cast(lineCount);
+	} else {
+		Sci::Line remaining = lineCount;
+		while (remaining > 0) {
+			const auto [block, index] = Locate(lineDoc);
+			Block &b = blocks[block];
+			const size_t count = std::min<size_t>(remaining, b.lines.size() - index);
+			const LINE displayedBefore = b.displayed;
+			const LINE hiddenBefore = b.hidden;
+			for (size_t i = index; i < index + count; i++) {
+				b.Count(b.lines[i], -1);
+			}
+			b.lines.erase(b.lines.begin() + index, b.lines.begin() + index + count);
+			linesInDocument -= line_cast(count);
+			linesDisplayed += b.displayed - displayedBefore;
+			linesHidden += b.hidden - hiddenBefore;
+			if (b.lines.empty() && (blocks.size() > 1)) {
+				blocks.erase(blocks.begin() + block);
+				Rebuild();
+			} else {
+				lineCounts.Add(block, -line_cast(count));
+				displayCounts.Add(block, b.displayed - displayedBefore);
+			}
+			remaining -= count;
+		}
+		for (Sci::Line l = 0; l < lineCount; l++) {
+			foldDisplayTexts->DeletePosition(lineDoc);
+		}
+	}
+	Check();
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::GetVisible(Sci::Line lineDoc) const noexcept {
+	if (OneToOne() || (lineDoc < 0) || (lineDoc >= linesInDocument)) {
+		return true;
+	} else {
+		const auto [block, index] = Locate(lineDoc);
+		return blocks[block].lines[index].visible;
+	}
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::SetVisible(Sci::Line lineDocStart, Sci::Line lineDocEnd, bool isVisible) {
+	if (OneToOne() && isVisible) {
+		return false;
+	} else {
+		EnsureData();
+		Check();
+		if ((lineDocStart <= lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd < LinesInDoc())) {
+			bool changed = false;
+			auto [block, index] = Locate(lineDocStart);
+			for (Sci::Line line = lineDocStart; line <= lineDocEnd;) {
+				Block &b = blocks[block];
+				const LINE displayedBefore = b.displayed;
+				const LINE hiddenBefore = b.hidden;
+				for (; (index < b.lines.size()) && (line <= lineDocEnd); index++, line++) {
+					LineState &state = b.lines[index];
+					if (state.visible != isVisible) {
+						changed = true;
+						b.Count(state, -1);
+						state.visible = isVisible;
+						b.Count(state, 1);
+					}
+				}
+				displayCounts.Add(block, b.displayed - displayedBefore);
+				linesDisplayed += b.displayed - displayedBefore;
+				linesHidden += b.hidden - hiddenBefore;
+				block++;
+				index = 0;
+			}
+			Check();
+			return changed;
+		} else {
+			return false;
+		}
+	}
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::HiddenLines() const noexcept {
+	return !OneToOne() && (linesHidden > 0);
+}
+
+template <typename LINE>
+const char *ContractionTree<LINE>::GetFoldDisplayText(Sci::Line lineDoc) const noexcept {
+	if (OneToOne()) {
+		return nullptr;
+	}
+	Check();
+	return foldDisplayTexts->ValueAt(lineDoc).get();
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::SetFoldDisplayText(Sci::Line lineDoc, const char *text) {
+	EnsureData();
+	const char *foldText = foldDisplayTexts->ValueAt(lineDoc).get();
+	if (!foldText || !text || 0 != strcmp(text, foldText)) {
+		UniqueString uns = IsNullOrEmpty(text) ? UniqueString() : UniqueStringCopy(text);
+		foldDisplayTexts->SetValueAt(lineDoc, std::move(uns));
+		Check();
+		return true;
+	} else {
+		Check();
+		return false;
+	}
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::GetExpanded(Sci::Line lineDoc) const noexcept {
+	if (OneToOne() || (lineDoc < 0) || (lineDoc >= linesInDocument)) {
+		return true;
+	} else {
+		const auto [block, index] = Locate(lineDoc);
+		return blocks[block].lines[index].expanded;
+	}
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::SetExpanded(Sci::Line lineDoc, bool isExpanded) {
+	if (OneToOne() && isExpanded) {
+		return false;
+	} else {
+		EnsureData();
+		if ((lineDoc >= 0) && (lineDoc < linesInDocument) && (isExpanded != GetExpanded(lineDoc))) {
+			const auto [block, index] = Locate(lineDoc);
+			Block &b = blocks[block];
+			b.lines[index].expanded = isExpanded;
+			b.contracted += isExpanded ? -1 : 1;
+			Check();
+			return true;
+		} else {
+			Check();
+			return false;
+		}
+	}
+}
+
+template <typename LINE>
+bool ContractionTree<LINE>::ExpandAll() {
+	if (OneToOne()) {
+		return false;
+	} else {
+		bool changed = false;
+		for (Block &b : blocks) {
+			if (b.contracted) {
+				changed = true;
+				for (LineState &state : b.lines) {
+					state.expanded = true;
+				}
+				b.contracted = 0;
+			}
+		}
+		Check();
+		return changed;
+	}
+}
+
+template <typename LINE>
+Sci::Line ContractionTree<LINE>::ContractedNext(Sci::Line lineDocStart) const noexcept {
+	if (OneToOne() || (lineDocStart < 0) || (lineDocStart >= linesInDocument)) {
+		return -1;
+	} else {
+		Check();
+		auto [block, index] = Locate(lineDocStart);
+		Sci::Line lineDoc = lineDocStart;
+		for (; block < blocks.size(); block++) {
+			const Block &b = blocks[block];
+			if (b.contracted) {
+				for (; index < b.lines.size(); index++, lineDoc++) {
+					if (!b.lines[index].expanded) {
+						return lineDoc;
+					}
+				}
+			} else {
+				lineDoc += b.lines.size() - index;
+			}
+			index = 0;
+		}
+		return -1;
+	}
+}
+
+template <typename LINE>
+int ContractionTree<LINE>::GetHeight(Sci::Line lineDoc) const noexcept {
+	if (OneToOne() || (lineDoc < 0) || (lineDoc >= linesInDocument)) {
+		return 1;
+	} else {
+		const auto [block, index] = Locate(lineDoc);
+		return blocks[block].lines[index].height;
+	}
+}
+
+// Set the number of display lines needed for this line.
+// Return true if this is a change.
+template <typename LINE>
+bool ContractionTree<LINE>::SetHeight(Sci::Line lineDoc, int height) {
+	if (OneToOne() && (height == 1)) {
+		return false;
+	} else if (lineDoc < LinesInDoc()) {
+		EnsureData();
+		if (GetHeight(lineDoc) != height) {
+			const auto [block, index] = Locate(lineDoc);
+			LineState state = blocks[block].lines[index];
+			state.height = height;
+			Change(lineDoc, state);
+			Check();
+			return true;
+		} else {
+			Check();
+			return false;
+		}
+	} else {
+		return false;
+	}
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::ShowAll() noexcept {
+	const LINE lines = line_cast(LinesInDoc());
+	Clear();
+	linesInDocument = lines;
+}
+
+template <typename LINE>
+void ContractionTree<LINE>::Check() const noexcept {
+#ifdef CHECK_CORRECTNESS
+	for (Sci::Line vline = 0; vline < LinesDisplayed(); vline++) {
+		const Sci::Line lineDoc = DocFromDisplay(vline);
+		PLATFORM_ASSERT(GetVisible(lineDoc));
+	}
+	for (Sci::Line lineDoc = 0; lineDoc < LinesInDoc(); lineDoc++) {
+		const Sci::Line displayThis = DisplayFromDoc(lineDoc);
+		const Sci::Line displayNext = DisplayFromDoc(lineDoc + 1);
+		const Sci::Line height = displayNext - displayThis;
+		PLATFORM_ASSERT(height >= 0);
+		if (GetVisible(lineDoc)) {
+			PLATFORM_ASSERT(GetHeight(lineDoc) == height);
+		} else {
+			PLATFORM_ASSERT(0 == height);
+		}
+	}
+#endif
+}
+
 }
 
 namespace Scintilla::Internal {
 
-std::unique_ptr<IContractionState> ContractionStateCreate(bool largeDocument) {
+std::unique_ptr<IContractionState> ContractionStateCreate(bool largeDocument, bool tree) {
+	if (tree) {
+		if (largeDocument)
+			return std::make_unique<ContractionTree<Sci::Line>>();
+		else
+			return std::make_unique<ContractionTree<int>>();
+	}
 	if (largeDocument)
 		return std::make_unique<ContractionState<Sci::Line>>();
 	else
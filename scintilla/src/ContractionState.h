@@ -45,7 +45,9 @@ public:
 	virtual void ShowAll() noexcept=0;
 };
 
-std::unique_ptr<IContractionState> ContractionStateCreate(bool largeDocument);
+/// With tree, heights and visibility are summed by a tree over blocks of lines, which is faster
+/// when lines scattered through very large documents are wrapped or folded.
+std::unique_ptr<IContractionState> ContractionStateCreate(bool largeDocument, bool tree=false);
 
 }
 
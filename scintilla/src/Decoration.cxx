@@ -42,7 +42,8 @@ class Decoration : public IDecoration {
 	}
 
 public:
-	RunStyles<POS, int> rs;
+	// Indicators may have many runs changed in any order so are held in a tree.
+	RunStyles<POS, int, RunTree<POS, int>> rs;
 
 	explicit Decoration(int indicator_) : indicator(indicator_) {
 	}
@@ -115,6 +116,7 @@ public:
 
 	// Returns changed=true if some values may have changed
 	FillResult<Sci::Position> FillRange(Sci::Position position, int value, Sci::Position fillLength) override;
+	FillResult<Sci::Position> FillRanges(int value, const std::vector<Sci::Position> &bounds) override;
 
 	void InsertSpace(Sci::Position position, Sci::Position insertLength) override;
 	void DeleteRange(Sci::Position position, Sci::Position deleteLength) override;
@@ -207,6 +209,24 @@ FillResult<Sci::Position> DecorationList<POS>::FillRange(Sci::Position position,
 	return fr;
 }
 
+template <typename POS>
+FillResult<Sci::Position> DecorationList<POS>::FillRanges(int value, const std::vector<Sci::Position> &bounds) {
+	if (!current) {
+		current = DecorationFromIndicator(currentIndicator);
+		if (!current) {
+			current = Create(currentIndicator, lengthDocument);
+		}
+	}
+	std::vector<POS> boundsInPOS(bounds.size());
+	std::transform(bounds.begin(), bounds.end(), boundsInPOS.begin(), pos_cast);
+	const FillResult<POS> frInPOS = current->rs.FillRanges(boundsInPOS.data(), boundsInPOS.size() / 2, value);
+	const FillResult<Sci::Position> fr { frInPOS.changed, frInPOS.position, frInPOS.fillLength };
+	if (current->Empty()) {
+		Delete(currentIndicator);
+	}
+	return fr;
+}
+
 template <typename POS>
 void DecorationList<POS>::InsertSpace(Sci::Position position, Sci::Position insertLength) {
 	const bool atEnd = position == lengthDocument;
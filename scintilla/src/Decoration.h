@@ -37,6 +37,8 @@ public:
 
 	// Returns with changed=true if some values may have changed
 	virtual FillResult<Sci::Position> FillRange(Sci::Position position, int value, Sci::Position fillLength) = 0;
+	// Fill ranges given as start and end pairs in bounds which are in order and do not overlap
+	virtual FillResult<Sci::Position> FillRanges(int value, const std::vector<Sci::Position> &bounds) = 0;
 	virtual void InsertSpace(Sci::Position position, Sci::Position insertLength) = 0;
 	virtual void DeleteRange(Sci::Position position, Sci::Position deleteLength) = 0;
 	virtual void DeleteLexerDecorations() = 0;
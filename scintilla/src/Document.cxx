@@ -6,6 +6,7 @@
 // The License.txt file describes the conditions under which this software may be distributed.
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
@@ -20,6 +21,7 @@
 #include <forward_list>
 #include <optional>
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <chrono>
 
@@ -39,12 +41,18 @@
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
+#include "PieceTree.h"
 #include "CellBuffer.h"
 #include "PerLine.h"
 #include "CharClassify.h"
 #include "Decoration.h"
 #include "CaseFolder.h"
+#include "StringSearch.h"
+#include "LinearRegex.h"
 #include "Document.h"
+#include "DocumentSnapshot.h"
+#include "BackgroundFind.h"
+#include "TrigramIndex.h"
 #include "RESearch.h"
 #include "UniConversion.h"
 #include "ElapsedPeriod.h"
@@ -144,7 +152,8 @@ CharacterExtracted::CharacterExtracted(const unsigned char *charBytes, size_t wi
 }
 
 Document::Document(DocumentOption options) :
-	cb(!FlagSet(options, DocumentOption::StylesNone), FlagSet(options, DocumentOption::TextLarge)),
+	cb(!FlagSet(options, DocumentOption::StylesNone), FlagSet(options, DocumentOption::TextLarge),
+		FlagSet(options, DocumentOption::TextPieces)),
 	durationStyleOneByte(0.000001, 0.0000001, 0.00001) {
 	refCount = 0;
 #ifdef _WIN32
@@ -169,6 +178,11 @@ Document::Document(DocumentOption options) :
 
 	matchesValid = false;
 
+	version = 0;
+
+	useTrigramIndex = FlagSet(options, DocumentOption::TrigramIndex);
+	useDisplayTree = FlagSet(options, DocumentOption::DisplayTree);
+
 	perLineData[ldMarkers] = std::make_unique<LineMarkers>();
 	perLineData[ldLevels] = std::make_unique<LineLevels>();
 	perLineData[ldState] = std::make_unique<LineState>();
@@ -267,6 +281,7 @@ bool Document::SetDBCSCodePage(int dbcsCodePage_) {
 		SetCaseFolder(nullptr);
 		cb.SetLineEndTypes(lineEndBitSet & LineEndTypesSupported());
 		cb.SetUTF8Substance(CpUtf8 == dbcsCodePage);
+		NewVersion();	// Line ends may have changed
 		ModifiedAt(0);	// Need to restyle whole document
 		return true;
 	} else {
@@ -281,6 +296,7 @@ bool Document::SetLineEndTypesAllowed(LineEndType lineEndBitSet_) {
 		if (lineEndBitSetActive != cb.GetLineEndTypes()) {
 			ModifiedAt(0);
 			cb.SetLineEndTypes(lineEndBitSetActive);
+			NewVersion();
 			return true;
 		} else {
 			return false;
@@ -400,7 +416,7 @@ Sci::Position Document::UndoActionPosition(int action) const noexcept {
 	return cb.UndoActionPosition(action);
 }
 
-std::string_view Document::UndoActionText(int action) const noexcept {
+std::string_view Document::UndoActionText(int action) const {
 	return cb.UndoActionText(action);
 }
 
@@ -1389,6 +1405,93 @@ Sci::Position Document::InsertString(Sci::Position position, std::string_view sv
 	return InsertString(position, sv.data(), sv.length());
 }
 
+/**
+ * Replace many ranges in one pass through the document as a single undo action.
+ * The ranges must be in document order and not overlap.
+ * Instead of notifications for each deletion and insertion, watchers receive BeforeReplaceAll
+ * for the span from the start of the first range to the end of the last range then ReplaceAll
+ * for that span after replacement with the list of edits made.
+ * @return The number of ranges replaced.
+ */
+Sci::Position Document::ReplaceRanges(const std::vector<Replacement> &replacements) {
+	if (replacements.empty()) {
+		return 0;
+	}
+	Sci::Position previousEnd = 0;
+	for (const Replacement &replacement : replacements) {
+		if ((replacement.range.start < previousEnd) || (replacement.range.end < replacement.range.start)) {
+			return 0;
+		}
+		previousEnd = replacement.range.end;
+	}
+	if (previousEnd > LengthNoExcept()) {
+		return 0;
+	}
+	CheckReadOnly();
+	if (cb.IsReadOnly() || (enteredModification != 0)) {
+		return 0;
+	}
+	enteredModification++;
+	const Sci::Position spanStart = replacements.front().range.start;
+	NotifyModified(
+		DocModification(
+			ModificationFlags::BeforeReplaceAll | ModificationFlags::User,
+			spanStart, previousEnd - spanStart));
+	const Sci::Line prevLinesTotal = LinesTotal();
+	const bool startSavePoint = cb.IsSavePoint();
+	bool startSequence = false;
+	std::vector<ReplacedRange> replaced;
+	replaced.reserve(replacements.size());
+	// Edits are made from the start of the document to the end so the buffer's gap and
+	// the line starts only ever move forward.
+	Sci::Position delta = 0;
+	cb.BeginUndoAction();
+	for (const Replacement &replacement : replacements) {
+		const Sci::Position position = replacement.range.start + delta;
+		const Sci::Position lengthRemoved = replacement.range.Length();
+		const Sci::Position lengthInserted = replacement.text.length();
+		const Sci::Line linesBefore = LinesTotal();
+		bool startEdit = false;
+		if (lengthRemoved > 0) {
+			cb.DeleteChars(position, lengthRemoved, startEdit);
+			decorations->DeleteRange(position, lengthRemoved);
+			if (trigramIndex) {
+				trigramIndex->DeleteText(position, lengthRemoved);
+			}
+		}
+		if (lengthInserted > 0) {
+			bool startInsertion = false;
+			cb.InsertString(position, replacement.text.data(), lengthInserted, startInsertion);
+			startEdit = startEdit || startInsertion;
+			decorations->InsertSpace(position, lengthInserted);
+			if (trigramIndex) {
+				trigramIndex->InsertText(position, lengthInserted);
+			}
+		}
+		if (replaced.empty()) {
+			startSequence = startEdit;
+		}
+		replaced.push_back({position, lengthRemoved, lengthInserted, LinesTotal() - linesBefore});
+		delta += lengthInserted - lengthRemoved;
+	}
+	cb.EndUndoAction();
+	if (startSavePoint && cb.IsCollectingUndo())
+		NotifySavePoint(false);
+	if ((spanStart < LengthNoExcept()) || (spanStart == 0))
+		ModifiedAt(spanStart);
+	else
+		ModifiedAt(spanStart - 1);
+	DocModification mh(
+		ModificationFlags::ReplaceAll | ModificationFlags::User |
+		(startSequence ? ModificationFlags::StartAction : ModificationFlags::None),
+		spanStart, previousEnd + delta - spanStart,
+		LinesTotal() - prevLinesTotal);
+	mh.replaced = &replaced;
+	NotifyModified(mh);
+	enteredModification--;
+	return replacements.size();
+}
+
 void Document::ChangeInsertion(const char *s, Sci::Position length) {
 	insertionSet = true;
 	insertion.assign(s, length);
@@ -1798,7 +1901,10 @@ std::string_view Document::EOLString() const noexcept {
 
 DocumentOption Document::Options() const noexcept {
 	return (IsLarge() ? DocumentOption::TextLarge : DocumentOption::Default) |
-		(cb.HasStyles() ? DocumentOption::Default : DocumentOption::StylesNone);
+		(cb.HasStyles() ? DocumentOption::Default : DocumentOption::StylesNone) |
+		(cb.UsesPieceTree() ? DocumentOption::TextPieces : DocumentOption::Default) |
+		(useTrigramIndex ? DocumentOption::TrigramIndex : DocumentOption::Default) |
+		(useDisplayTree ? DocumentOption::DisplayTree : DocumentOption::Default);
 }
 
 bool Document::IsWhiteLine(Sci::Line line) const {
@@ -2109,45 +2215,294 @@ CharacterExtracted Document::ExtractCharacter(Sci::Position position) const noex
 
 namespace {
 
-// Equivalent of memchr over the split view
-ptrdiff_t SplitFindChar(const SplitView &view, size_t start, size_t length, int ch) noexcept {
-	size_t range1Length = 0;
-	if (start < view.length1) {
-		range1Length = std::min(length, view.length1 - start);
-		const char *match = static_cast<const char *>(memchr(view.segment1 + start, ch, range1Length));
-		if (match) {
-			return match - view.segment1;
+// Reads the text as the contiguous segments it is stored in: the two sides of the gap
+// or the pieces of a piece tree. This avoids merging pieces to produce a SplitView.
+class SegmentReader {
+	const CellBuffer &cb;
+	Sci::Position start = 0;
+	std::string_view segment;
+	// Copy of text around a segment boundary
+	std::string span;
+	std::string_view Span(Sci::Position spanStart, Sci::Position spanEnd) {
+		span.resize(spanEnd - spanStart);
+		cb.GetCharRange(span.data(), spanStart, spanEnd - spanStart);
+		return span;
+	}
+public:
+	explicit SegmentReader(const CellBuffer &cb_) noexcept : cb(cb_) {
+	}
+	// Make the current segment the one containing position; false when past the end
+	bool Seek(Sci::Position position) noexcept {
+		if (position >= start && position < start + static_cast<Sci::Position>(segment.length())) {
+			return true;
+		}
+		segment = cb.SegmentAt(position, start);
+		return !segment.empty();
+	}
+
+	// The stored text from position to the end of its segment; empty past the end
+	std::string_view From(Sci::Position position) noexcept {
+		if (!Seek(position)) {
+			return {};
+		}
+		return segment.substr(position - start);
+	}
+
+	// First occurrence of needle starting at or after position and ending by limit.
+	// Each segment is searched directly then any matches spanning its end are found
+	// by copying the few bytes either side of the boundary.
+	Sci::Position Find(Sci::Position position, Sci::Position limit, std::string_view needle) {
+		const Sci::Position lengthNeedle = needle.length();
+		while (position + lengthNeedle <= limit && Seek(position)) {
+			const Sci::Position segmentEnd = std::min<Sci::Position>(start + segment.length(), limit);
+			const std::string_view text(segment.data() + (position - start), segmentEnd - position);
+			const size_t found = SearchForward(text, needle);
+			if (found != std::string_view::npos) {
+				return position + found;
+			}
+			if (segmentEnd >= limit) {
+				break;
+			}
+			const Sci::Position spanStart = std::max(position, segmentEnd - lengthNeedle + 1);
+			const Sci::Position spanEnd = std::min(limit, segmentEnd + lengthNeedle - 1);
+			const size_t foundSpan = SearchForward(Span(spanStart, spanEnd), needle);
+			if (foundSpan != std::string_view::npos) {
+				return spanStart + foundSpan;
+			}
+			position = segmentEnd;
 		}
-		start += range1Length;
+		return -1;
 	}
-	const char *match2 = static_cast<const char *>(memchr(view.segment2 + start, ch, length - range1Length));
-	if (match2) {
-		return match2 - view.segment2;
+
+	// Last occurrence of needle starting at or after low and ending by high.
+	Sci::Position FindBackward(Sci::Position low, Sci::Position high, std::string_view needle) {
+		const Sci::Position lengthNeedle = needle.length();
+		while (high - low >= lengthNeedle && Seek(high - 1)) {
+			const Sci::Position segmentStart = std::max(start, low);
+			const std::string_view text(segment.data() + (segmentStart - start), high - segmentStart);
+			const size_t found = SearchBackward(text, needle);
+			if (found != std::string_view::npos) {
+				return segmentStart + found;
+			}
+			if (segmentStart <= low) {
+				break;
+			}
+			const Sci::Position spanStart = std::max(low, segmentStart - lengthNeedle + 1);
+			const Sci::Position spanEnd = std::min(high, segmentStart + lengthNeedle - 1);
+			const size_t foundSpan = SearchBackward(Span(spanStart, spanEnd), needle);
+			if (foundSpan != std::string_view::npos) {
+				return spanStart + foundSpan;
+			}
+			high = segmentStart;
+		}
+		return -1;
+	}
+};
+
+// Case-insensitive UTF-8 search that folds each character of the document at most once.
+// The folded needle is compiled into a Knuth-Morris-Pratt automaton that is fed the folded
+// document as a byte stream. Characters are compared whole so a match must start and end
+// on the boundaries of folded characters.
+class FoldedSearch {
+	static constexpr size_t maxFoldingExpansion = 4;
+	static constexpr size_t maxFolded = UTF8MaxBytes * maxFoldingExpansion;
+	CaseFolder *pcf;
+	std::string needle;
+	std::vector<size_t> failure;
+	// ASCII bytes that fold to the first byte of needle: when no match is in progress,
+	// other ASCII bytes can be skipped without folding.
+	char firstLower;
+	char firstUpper;
+	// Document position of each folded byte that starts a character, or -1,
+	// for at least the most recent needle.length() folded bytes.
+	std::vector<Sci::Position> starts;
+	size_t startsMask;
+
+	// Direct-mapped cache of folded non-ASCII characters
+	struct FoldedCharacter {
+		uint64_t key = 0;
+		size_t length = 0;
+		char folded[maxFolded + 1] {};
+	};
+	static constexpr size_t cacheSize = 256;
+	std::unique_ptr<FoldedCharacter[]> cache;
+
+	const FoldedCharacter &Fold(const char *bytes, int widthChar) {
+		uint64_t key = widthChar;
+		for (int b = 0; b < widthChar; b++) {
+			key = (key << 8) | static_cast<unsigned char>(bytes[b]);
+		}
+		FoldedCharacter &entry = cache[(key * 0x9E3779B97F4A7C15ULL) >> 56];
+		if (entry.key != key) {
+			entry.key = key;
+			entry.length = pcf->Fold(entry.folded, sizeof(entry.folded), bytes, widthChar);
+		}
+		return entry;
+	}
+
+public:
+	FoldedSearch(CaseFolder *pcf_, std::string_view search) : pcf(pcf_), firstLower(0), firstUpper(0), startsMask(0) {
+		needle.resize((search.length() + 1) * maxFolded + 1);
+		needle.resize(pcf->Fold(needle.data(), needle.size(), search.data(), search.length()));
+		failure.resize(needle.length());
+		size_t k = 0;
+		for (size_t i = 1; i < needle.length(); i++) {
+			while (k > 0 && needle[i] != needle[k]) {
+				k = failure[k - 1];
+			}
+			if (needle[i] == needle[k]) {
+				k++;
+			}
+			failure[i] = k;
+		}
+		if (!needle.empty()) {
+			firstLower = needle[0];
+			firstUpper = (firstLower >= 'a' && firstLower <= 'z') ? static_cast<char>(firstLower - 'a' + 'A') : firstLower;
+		}
+		size_t ring = 1;
+		while (ring < needle.length() + maxFolded + 1) {
+			ring *= 2;
+		}
+		starts.resize(ring);
+		startsMask = ring - 1;
+		cache = std::make_unique<FoldedCharacter[]>(cacheSize);
 	}
-	return -1;
-}
 
-// Equivalent of memcmp over the split view
-// This does not call memcmp as search texts are commonly too short to overcome the
-// call overhead.
-bool SplitMatch(const SplitView &view, size_t start, std::string_view text) noexcept {
-	for (size_t i = 0; i < text.length(); i++) {
-		if (view.CharAt(i + start) != text[i]) {
+	// Longest stretch of document a match could cover
+	[[nodiscard]] Sci::Position MaximumMatchLength() const noexcept {
+		return needle.length() * UTF8MaxBytes;
+	}
+
+	// Scan the document from start up to limit which are character boundaries.
+	// For each match in order, calls accept(matchStart, matchEnd) and stops if it returns true.
+	template <typename Accept>
+	void Scan(const CellBuffer &cb, Sci::Position start, Sci::Position limit, Accept accept) {
+		if (needle.empty()) {
+			return;
+		}
+		const size_t lenNeedle = needle.length();
+		SegmentReader reader(cb);
+		size_t state = 0;
+		size_t folded = 0;
+		// Feed one folded byte to the automaton and report if it completes the needle
+		auto step = [&](char ch) noexcept {
+			while (state > 0 && needle[state] != ch) {
+				state = failure[state - 1];
+			}
+			if (needle[state] == ch) {
+				state++;
+			}
+			folded++;
+			if (state == lenNeedle) {
+				state = failure[lenNeedle - 1];
+				return true;
+			}
 			return false;
+		};
+		Sci::Position pos = start;
+		while (pos < limit) {
+			std::string_view run = reader.From(pos);
+			if (run.empty()) {
+				break;
+			}
+			if (static_cast<Sci::Position>(run.length()) > limit - pos) {
+				run = run.substr(0, limit - pos);
+			}
+			size_t i = 0;
+			while (i < run.length()) {
+				if (state == 0) {
+					const size_t skip = SkipAsciiExcept(run.substr(i), firstLower, firstUpper);
+					i += skip;
+					folded += skip;
+					if (i >= run.length()) {
+						break;
+					}
+				}
+				const Sci::Position position = pos + i;
+				const unsigned char leadByte = run[i];
+				if (UTF8IsAscii(leadByte)) {
+					starts[folded & startsMask] = position;
+					if (step(MakeLowerCase(leadByte))) {
+						const Sci::Position matchStart = starts[(folded - lenNeedle) & startsMask];
+						if (matchStart >= 0 && accept(matchStart, position + 1)) {
+							return;
+						}
+					}
+					i++;
+				} else {
+					char bytes[UTF8MaxBytes] { static_cast<char>(leadByte) };
+					const int widthCharBytes = UTF8BytesOfLead[leadByte];
+					for (int b = 1; b < widthCharBytes; b++) {
+						bytes[b] = (i + b < run.length()) ? run[i + b] : cb.CharAt(position + b);
+					}
+					const int widthChar = UTF8Classify(bytes, widthCharBytes) & UTF8MaskWidth;
+					if (position + widthChar > limit) {
+						return;
+					}
+					const FoldedCharacter &fc = Fold(bytes, widthChar);
+					if (state == 0 && fc.folded[0] != needle[0]) {
+						// Can not start a match and a match can not start inside a character
+						folded += fc.length;
+						i += widthChar;
+						continue;
+					}
+					bool matched = false;
+					for (size_t k = 0; k < fc.length; k++) {
+						starts[folded & startsMask] = (k == 0) ? position : -1;
+						matched = step(fc.folded[k]);
+					}
+					// Only a match ending with this character's last folded byte counts
+					if (matched) {
+						const Sci::Position matchStart = starts[(folded - lenNeedle) & startsMask];
+						if (matchStart >= 0 && accept(matchStart, position + widthChar)) {
+							return;
+						}
+					}
+					i += widthChar;
+				}
+			}
+			pos += i;
 		}
 	}
-	return true;
-}
+};
 
 }
 
 /**
  * Find text in document, supporting both forward and backward
  * searches (just pass minPos > maxPos to do a backward search)
- * Has not been tested with backwards DBCS searches yet.
+ * When there is a trigram index, case sensitive searches only examine
+ * the ranges where the index shows a match may start.
  */
 Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, const char *search,
                         FindOption flags, Sci::Position *length) {
+	std::vector<Range> windows;
+	if ((*length > 0) && FlagSet(flags, FindOption::MatchCase) && !FlagSet(flags, FindOption::RegExp) &&
+		FindCandidates(std::string_view(search, *length), minPos, maxPos, windows)) {
+		const bool forward = minPos <= maxPos;
+		const Sci::Position limitPos = std::max(minPos, maxPos);
+		for (size_t i = 0; i < windows.size(); i++) {
+			const Range &window = windows[forward ? i : windows.size() - 1 - i];
+			// A match starting inside the window may continue past its end
+			const Sci::Position windowEnd = std::min(window.end + *length - 1, limitPos);
+			const Sci::Position found = forward ?
+				FindTextInRange(window.start, windowEnd, search, flags, length) :
+				FindTextInRange(windowEnd, window.start, search, flags, length);
+			if (found >= 0) {
+				return found;
+			}
+		}
+		return -1;
+	}
+	return FindTextInRange(minPos, maxPos, search, flags, length);
+}
+
+/**
+ * Search every position of the range.
+ * Has not been tested with backwards DBCS searches yet.
+ */
+Sci::Position Document::FindTextInRange(Sci::Position minPos, Sci::Position maxPos, const char *search,
+                        FindOption flags, Sci::Position *length) {
 	if (*length <= 0)
 		return minPos;
 	const bool caseSensitive = FlagSet(flags, FindOption::MatchCase);
@@ -2177,26 +2532,40 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			// Back all of a character
 			pos = NextPosition(pos, increment);
 		}
-		const SplitView cbView = cb.AllView();
 		if (caseSensitive) {
 			const Sci::Position endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
 			const unsigned char charStartSearch =  search[0];
-			if (forward && ((0 == dbcsCodePage) || (CpUtf8 == dbcsCodePage && !UTF8IsTrailByte(charStartSearch)))) {
+			if ((0 == dbcsCodePage) || (CpUtf8 == dbcsCodePage && !UTF8IsTrailByte(charStartSearch))) {
 				// This is a fast case where there is no need to test byte values to iterate
-				// so becomes the equivalent of a memchr+memcmp loop.
+				// so becomes a substring search over the segments of the document.
 				// UTF-8 search will not be self-synchronizing when starts with trail byte
-				const std::string_view suffix(search + 1, lengthFind - 1);
-				while (pos < endSearch) {
-					pos = SplitFindChar(cbView, pos, limitPos - pos, charStartSearch);
-					if (pos < 0) {
-						break;
+				const std::string_view needle(search, lengthFind);
+				SegmentReader reader(cb);
+				if (forward) {
+					while (pos < endSearch) {
+						pos = reader.Find(pos, limitPos, needle);
+						if (pos < 0) {
+							break;
+						}
+						if (MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+							return pos;
+						}
+						pos++;
 					}
-					if (SplitMatch(cbView, pos + 1, suffix) && MatchesWordOptions(word, wordStart, pos, lengthFind)) {
-						return pos;
+				} else {
+					while (pos >= endSearch) {
+						pos = reader.FindBackward(endSearch, std::min(limitPos, pos + lengthFind), needle);
+						if (pos < 0) {
+							break;
+						}
+						if (MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+							return pos;
+						}
+						pos--;
 					}
-					pos++;
 				}
 			} else {
+				const SplitView cbView = cb.AllView();
 				while (forward ? (pos < endSearch) : (pos >= endSearch)) {
 					const unsigned char leadByte = cbView.CharAt(pos);
 					if (leadByte == charStartSearch) {
@@ -2223,69 +2592,49 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 				}
 			}
 		} else if (CpUtf8 == dbcsCodePage) {
-			constexpr size_t maxFoldingExpansion = 4;
-			std::vector<char> searchThing((lengthFind+1) * UTF8MaxBytes * maxFoldingExpansion + 1);
-			const size_t lenSearch =
-				pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
-			while (forward ? (pos < endPos) : (pos >= endPos)) {
-				int widthFirstCharacter = 1;
-				Sci::Position posIndexDocument = pos;
-				size_t indexSearch = 0;
-				bool characterMatches = true;
-				while (indexSearch < lenSearch) {
-					const unsigned char leadByte = cbView.CharAt(posIndexDocument);
-					int widthChar = 1;
-					size_t lenFlat = 1;
-					if (UTF8IsAscii(leadByte)) {
-						if ((posIndexDocument + 1) > limitPos) {
-							break;
-						}
-						characterMatches = searchThing[indexSearch] == MakeLowerCase(leadByte);
-					} else {
-						char bytes[UTF8MaxBytes]{ static_cast<char>(leadByte) };
-						const int widthCharBytes = UTF8BytesOfLead[leadByte];
-						for (int b = 1; b < widthCharBytes; b++) {
-							bytes[b] = cbView.CharAt(posIndexDocument + b);
-						}
-						widthChar = UTF8Classify(bytes, widthCharBytes) & UTF8MaskWidth;
-						if (!indexSearch) {	// First character
-							widthFirstCharacter = widthChar;
+			FoldedSearch foldedSearch(pcf.get(), std::string_view(search, lengthFind));
+			Sci::Position matchStart = -1;
+			Sci::Position matchEnd = -1;
+			if (forward) {
+				foldedSearch.Scan(cb, startPos, endPos, [&](Sci::Position start, Sci::Position end) {
+					if (MatchesWordOptions(word, wordStart, start, end - start)) {
+						matchStart = start;
+						matchEnd = end;
+						return true;
+					}
+					return false;
+				});
+			} else {
+				// Scan blocks working back from the end, keeping the last match in each block
+				constexpr Sci::Position blockSize = 0x10000;
+				Sci::Position blockEnd = startPos;
+				while ((matchStart < 0) && (blockEnd > endPos)) {
+					const Sci::Position blockStart = std::max(endPos,
+						MovePositionOutsideChar(blockEnd - blockSize, -1, false));
+					const Sci::Position scanEnd = std::min(limitPos, blockEnd + foldedSearch.MaximumMatchLength());
+					foldedSearch.Scan(cb, blockStart, scanEnd, [&](Sci::Position start, Sci::Position end) {
+						if (start >= blockEnd) {
+							return true;
 						}
-						if ((posIndexDocument + widthChar) > limitPos) {
-							break;
+						if (MatchesWordOptions(word, wordStart, start, end - start)) {
+							matchStart = start;
+							matchEnd = end;
 						}
-						char folded[UTF8MaxBytes * maxFoldingExpansion + 1];
-						lenFlat = pcf->Fold(folded, sizeof(folded), bytes, widthChar);
-						// memcmp may examine lenFlat bytes in both arguments so assert it doesn't read past end of searchThing
-						assert((indexSearch + lenFlat) <= searchThing.size());
-						// Does folded match the buffer
-						characterMatches = 0 == memcmp(folded, &searchThing[0] + indexSearch, lenFlat);
-					}
-					if (!characterMatches) {
-						break;
-					}
-					posIndexDocument += widthChar;
-					indexSearch += lenFlat;
-				}
-				if (characterMatches && (indexSearch == lenSearch)) {
-					if (MatchesWordOptions(word, wordStart, pos, posIndexDocument - pos)) {
-						*length = posIndexDocument - pos;
-						return pos;
-					}
-				}
-				if (forward) {
-					pos += widthFirstCharacter;
-				} else {
-					if (!NextCharacter(pos, increment)) {
-						break;
-					}
+						return false;
+					});
+					blockEnd = blockStart;
 				}
 			}
+			if (matchStart >= 0) {
+				*length = matchEnd - matchStart;
+				return matchStart;
+			}
 		} else if (dbcsCodePage) {
 			constexpr size_t maxBytesCharacter = 2;
 			constexpr size_t maxFoldingExpansion = 4;
 			std::vector<char> searchThing((lengthFind+1) * maxBytesCharacter * maxFoldingExpansion + 1);
 			const size_t lenSearch = pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
+			const SplitView cbView = cb.AllView();
 			while (forward ? (pos < endPos) : (pos >= endPos)) {
 				int widthFirstCharacter = 0;
 				Sci::Position indexDocument = 0;
@@ -2340,6 +2689,7 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			const Sci::Position endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
 			std::vector<char> searchThing(lengthFind + 1);
 			pcf->Fold(&searchThing[0], searchThing.size(), search, lengthFind);
+			const SplitView cbView = cb.AllView();
 			while (forward ? (pos < endSearch) : (pos >= endSearch)) {
 				bool found = (pos + lengthFind) <= limitPos;
 				for (int indexSearch = 0; (indexSearch < lengthFind) && found; indexSearch++) {
@@ -2364,6 +2714,104 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 	return -1;
 }
 
+/**
+ * Returns the trigram index once it is built and up to date, starting a build when there
+ * is no index or the current one has become unbalanced by large insertions.
+ */
+TrigramIndex *Document::ReadyTrigramIndex(bool wait) {
+	if (!useTrigramIndex) {
+		return nullptr;
+	}
+	if (!trigramIndex || trigramIndex->Unbalanced()) {
+		trigramIndex = TrigramIndex::Start(Snapshot());
+	}
+	if (wait) {
+		trigramIndex->Wait();
+	} else if (!trigramIndex->Ready()) {
+		return nullptr;
+	}
+	trigramIndex->Update([this](char *buffer, Sci::Position position, Sci::Position lengthRetrieve) {
+		cb.GetCharRange(buffer, position, lengthRetrieve);
+	});
+	return trigramIndex.get();
+}
+
+bool Document::FindCandidates(std::string_view literal, Sci::Position minPos, Sci::Position maxPos, std::vector<Range> &windows) {
+	if (literal.length() < TrigramIndex::gram) {
+		return false;
+	}
+	const TrigramIndex *index = ReadyTrigramIndex(false);
+	if (!index) {
+		return false;
+	}
+	windows = index->Candidates(literal, std::min(minPos, maxPos), std::max(minPos, maxPos));
+	return true;
+}
+
+/**
+ * Serialize the trigram index so it can be saved with the file and restored with SetTrigramIndexData
+ * when the file is next loaded. Waits for the index to be built.
+ */
+std::string Document::TrigramIndexData() {
+	const TrigramIndex *index = ReadyTrigramIndex(true);
+	if (!index) {
+		return {};
+	}
+	return index->Serialize();
+}
+
+/**
+ * Use a previously serialized trigram index. The document should have the same text as when the
+ * index was serialized: only the length is checked.
+ */
+bool Document::SetTrigramIndexData(std::string_view data) {
+	std::unique_ptr<TrigramIndex> index = TrigramIndex::Deserialize(data, LengthNoExcept());
+	if (!index) {
+		return false;
+	}
+	trigramIndex = std::move(index);
+	useTrigramIndex = true;
+	return true;
+}
+
+/**
+ * Find the non-overlapping matches between minPos and maxPos in document order,
+ * stopping once there are maxMatches.
+ */
+void Document::FindAll(Sci::Position minPos, Sci::Position maxPos, const char *search,
+                        FindOption flags, Sci::Position length, size_t maxMatches, std::vector<Range> &matches) {
+	if (length <= 0)
+		return;
+	if (minPos > maxPos)
+		std::swap(minPos, maxPos);
+	if (FlagSet(flags, FindOption::RegExp)) {
+		if (!regex)
+			regex = std::unique_ptr<RegexSearchBase>(CreateRegexSearch(&charClass));
+		regex->FindAll(this, minPos, maxPos, search, FlagSet(flags, FindOption::MatchCase),
+			FlagSet(flags, FindOption::WholeWord), FlagSet(flags, FindOption::WordStart), flags, length,
+			maxMatches, matches);
+		return;
+	}
+	Sci::Position pos = minPos;
+	while (matches.size() < maxMatches) {
+		Sci::Position lengthFound = length;
+		const Sci::Position found = FindText(pos, maxPos, search, flags, &lengthFound);
+		if (found < 0)
+			break;
+		matches.emplace_back(found, found + lengthFound);
+		pos = found + lengthFound;
+	}
+}
+
+/**
+ * Start finding the matches on other threads. Returns nullptr when that is not possible
+ * so the caller should use FindAll.
+ */
+std::unique_ptr<BackgroundFind> Document::FindAllInBackground(Sci::Position minPos, Sci::Position maxPos, std::string_view search,
+	FindOption flags, unsigned int threads) {
+	return BackgroundFind::Start(Snapshot(), minPos, maxPos, search, flags, dbcsCodePage, charClass, threads);
+}
+
 const char *Document::SubstituteByPosition(const char *text, Sci::Position *length) {
 	if (regex)
 		return regex->SubstituteByPosition(this, text, length);
@@ -2649,6 +3097,25 @@ void SCI_METHOD Document::DecorationFillRange(Sci_Position position, int value,
 	}
 }
 
+// Fill many ranges with one notification covering them all.
+void Document::DecorationFillRanges(int indicator, int value, const std::vector<Range> &ranges) {
+	const int indicatorCurrent = decorations->GetCurrentIndicator();
+	decorations->SetCurrentIndicator(indicator);
+	std::vector<Sci::Position> bounds;
+	bounds.reserve(ranges.size() * 2);
+	for (const Range &range : ranges) {
+		bounds.push_back(range.start);
+		bounds.push_back(range.end);
+	}
+	const FillResult<Sci::Position> fr = decorations->FillRanges(value, bounds);
+	decorations->SetCurrentIndicator(indicatorCurrent);
+	if (fr.changed) {
+		const DocModification mh(ModificationFlags::ChangeIndicator | ModificationFlags::User,
+			fr.position, fr.fillLength);
+		NotifyModified(mh);
+	}
+}
+
 bool Document::AddWatcher(DocWatcher *watcher, void *userData) {
 	const WatcherWithUserData wwud(watcher, userData);
 	std::vector<WatcherWithUserData>::iterator it =
@@ -2687,11 +3154,44 @@ void Document::NotifySavePoint(bool atSavePoint) {
 	}
 }
 
+void Document::NewVersion() noexcept {
+	version++;
+	// Readers still holding the old snapshot keep it alive until they release it.
+	snapshot.reset();
+}
+
+std::shared_ptr<const DocumentSnapshot> Document::Snapshot() {
+	if (!snapshot) {
+		const Sci::Line lines = LinesTotal();
+		std::vector<Sci::Position> lineStarts(lines + 1);
+		for (Sci::Line line = 0; line <= lines; line++) {
+			lineStarts[line] = cb.LineStart(line);
+		}
+		std::string styles;
+		if (cb.HasStyles()) {
+			styles.resize(cb.Length());
+			cb.GetStyleRange(reinterpret_cast<unsigned char *>(styles.data()), 0, cb.Length());
+		}
+		snapshot = std::make_shared<const DocumentSnapshot>(
+			cb.TextSnapshot(), std::move(lineStarts), cb.HasStyles(), std::move(styles), version);
+	}
+	return snapshot;
+}
+
 void Document::NotifyModified(DocModification mh) {
+	if (FlagSet(mh.modificationType, ModificationFlags::InsertText | ModificationFlags::DeleteText | ModificationFlags::ChangeStyle | ModificationFlags::ReplaceAll)) {
+		NewVersion();
+	}
 	if (FlagSet(mh.modificationType, ModificationFlags::InsertText)) {
 		decorations->InsertSpace(mh.position, mh.length);
+		if (trigramIndex) {
+			trigramIndex->InsertText(mh.position, mh.length);
+		}
 	} else if (FlagSet(mh.modificationType, ModificationFlags::DeleteText)) {
 		decorations->DeleteRange(mh.position, mh.length);
+		if (trigramIndex) {
+			trigramIndex->DeleteText(mh.position, mh.length);
+		}
 	}
 	for (const WatcherWithUserData &watcher : watchers) {
 		watcher.watcher->NotifyModified(this, mh, watcher.userData);
@@ -2859,6 +3359,24 @@ Sci::Position Document::BraceMatch(Sci::Position position, Sci::Position /*maxRe
 	return - 1;
 }
 
+void RegexSearchBase::FindAll(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+                        bool caseSensitive, bool word, bool wordStart, FindOption flags, Sci::Position length,
+                        size_t maxMatches, std::vector<Range> &matches) {
+	Sci::Position pos = minPos;
+	while (matches.size() < maxMatches) {
+		Sci::Position lengthFound = length;
+		const Sci::Position found = FindText(doc, pos, maxPos, s, caseSensitive, word, wordStart, flags, &lengthFound);
+		if (found < 0)
+			break;
+		matches.emplace_back(found, found + lengthFound);
+		// Step over empty matches so they are not found again
+		const Sci::Position next = (lengthFound > 0) ? found + lengthFound : doc->NextPosition(found, 1);
+		if (next <= found || next > maxPos)
+			break;
+		pos = next;
+	}
+}
+
 /**
  * Implementation of RegexSearchBase for the default built-in regular expression engine
  */
@@ -2870,10 +3388,17 @@ public:
                         bool caseSensitive, bool word, bool wordStart, FindOption flags,
                         Sci::Position *length) override;
 
+	void FindAll(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+                        bool caseSensitive, bool word, bool wordStart, FindOption flags, Sci::Position length,
+                        size_t maxMatches, std::vector<Range> &matches) override;
+
 	const char *SubstituteByPosition(Document *doc, const char *text, Sci::Position *length) override;
 
 private:
 	RESearch search;
+#ifndef NO_CXX11_REGEX
+	LinearRegexCache linearCache;
+#endif
 	std::string substituted;
 };
 
@@ -3216,8 +3741,94 @@ bool MatchOnLines(const Document *doc, const Regex &regexp, const RESearchRange
 	return matched;
 }
 
-Sci::Position Cxx11RegexFindText(const Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
-	bool caseSensitive, Sci::Position *length, RESearch &search) {
+// The nearest line from line in the direction of increment that holds positions inside windows.
+// Returns a line past the end of the document in that direction when there is none.
+Sci::Line CandidateLine(const Document *doc, const std::vector<Range> &windows, Sci::Line line, int increment) {
+	if (increment > 0) {
+		const Sci::Position lineStart = doc->LineStart(line);
+		const auto it = std::upper_bound(windows.begin(), windows.end(), lineStart,
+			[](Sci::Position position, const Range &window) noexcept { return position < window.end; });
+		if (it == windows.end()) {
+			return doc->LinesTotal();
+		}
+		return std::max(line, doc->SciLineFromPosition(it->start));
+	}
+	const Sci::Position lineEnd = doc->LineEnd(line);
+	const auto it = std::upper_bound(windows.begin(), windows.end(), lineEnd,
+		[](Sci::Position position, const Range &window) noexcept { return position < window.start; });
+	if (it == windows.begin()) {
+		return -1;
+	}
+	return std::min(line, doc->SciLineFromPosition((it - 1)->end - 1));
+}
+
+// Matches each line with the linear time engine in the same way as MatchOnLines.
+// When there are windows of positions where a match may start, lines outside them are skipped.
+bool LinearMatchOnLines(const Document *doc, LinearRegex &regex, const RESearchRange &resr, RESearch &search,
+	const std::vector<Range> *windows) {
+	static_assert(LinearRegex::maxGroups == RESearch::MAXTAG);
+	std::string lineText;
+	LinearRegex::Groups groups {};
+	for (Sci::Line line = resr.lineRangeStart; line != resr.lineRangeBreak; line += resr.increment) {
+		if (windows) {
+			line = CandidateLine(doc, *windows, line, resr.increment);
+			if ((line - resr.lineRangeEnd) * resr.increment > 0) {
+				break;
+			}
+		}
+		const Sci::Position lineStartPos = doc->LineStart(line);
+		const Sci::Position lineEndPos = doc->LineEnd(line);
+		const Range lineRange = resr.LineRange(line, lineStartPos, lineEndPos);
+		lineText.resize(lineEndPos - lineStartPos);
+		doc->GetCharRange(lineText.data(), lineStartPos, lineText.length());
+		if (regex.Find(lineText, lineRange.start - lineStartPos, lineRange.end - lineStartPos, resr.increment < 0, groups)) {
+			for (size_t co = 0; co < RESearch::MAXTAG; co++) {
+				if (groups[co * 2] >= 0) {
+					search.bopat[co] = lineStartPos + groups[co * 2];
+					search.eopat[co] = lineStartPos + groups[co * 2 + 1];
+				}
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+// Appends each match on each line, as with FindAll.
+void LinearFindAllOnLines(const Document *doc, LinearRegex &regex, const RESearchRange &resr,
+	const std::vector<Range> *windows, size_t maxMatches, std::vector<Range> &matches) {
+	std::string lineText;
+	LinearRegex::Groups groups {};
+	for (Sci::Line line = resr.lineRangeStart; line != resr.lineRangeBreak; line++) {
+		if (windows) {
+			line = CandidateLine(doc, *windows, line, 1);
+			if (line > resr.lineRangeEnd) {
+				break;
+			}
+		}
+		const Sci::Position lineStartPos = doc->LineStart(line);
+		const Sci::Position lineEndPos = doc->LineEnd(line);
+		const Range lineRange = resr.LineRange(line, lineStartPos, lineEndPos);
+		lineText.resize(lineEndPos - lineStartPos);
+		doc->GetCharRange(lineText.data(), lineStartPos, lineText.length());
+		const size_t end = lineRange.end - lineStartPos;
+		size_t start = lineRange.start - lineStartPos;
+		while (regex.Find(lineText, start, end, false, groups)) {
+			matches.emplace_back(lineStartPos + groups[0], lineStartPos + groups[1]);
+			if (matches.size() >= maxMatches)
+				return;
+			start = groups[1];
+			if (groups[1] == groups[0]) {
+				if (start >= end)
+					break;
+				start = doc->NextPosition(lineStartPos + start, 1) - lineStartPos;
+			}
+		}
+	}
+}
+
+Sci::Position Cxx11RegexFindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+	bool caseSensitive, Sci::Position *length, RESearch &search, LinearRegexCache &linearCache) {
 	const RESearchRange resr(doc, minPos, maxPos);
 	try {
 		//ElapsedPeriod ep;
@@ -3235,7 +3846,15 @@ Sci::Position Cxx11RegexFindText(const Document *doc, Sci::Position minPos, Sci:
 		search.Clear();
 
 		bool matched = false;
-		if (CpUtf8 == doc->dbcsCodePage) {
+		// Patterns with features the linear time engine lacks, like backreferences, use std::regex
+		// which also reports invalid patterns.
+		LinearRegex *linear = linearCache.Get(s, caseSensitive, CpUtf8 == doc->dbcsCodePage);
+		if (linear) {
+			// Only lines where the index finds the literal text that starts the pattern can match.
+			std::vector<Range> windows;
+			const bool narrowed = doc->FindCandidates(linear->Prefix(), resr.startPos, resr.endPos, windows);
+			matched = LinearMatchOnLines(doc, *linear, resr, search, narrowed ? &windows : nullptr);
+		} else if (CpUtf8 == doc->dbcsCodePage) {
 			const std::wstring ws = WStringFromUTF8(s);
 			std::wregex regexp;
 			regexp.assign(ws, flagsRe);
@@ -3277,7 +3896,7 @@ Sci::Position BuiltinRegex::FindText(Document *doc, Sci::Position minPos, Sci::P
 #ifndef NO_CXX11_REGEX
 	if (FlagSet(flags, FindOption::Cxx11RegEx)) {
 			return Cxx11RegexFindText(doc, minPos, maxPos, s,
-			caseSensitive, length, search);
+			caseSensitive, length, search, linearCache);
 	}
 #endif
 
@@ -3362,6 +3981,65 @@ Sci::Position BuiltinRegex::FindText(Document *doc, Sci::Position minPos, Sci::P
 	return pos;
 }
 
+void BuiltinRegex::FindAll(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+                        bool caseSensitive, [[maybe_unused]] bool word, [[maybe_unused]] bool wordStart, FindOption flags, Sci::Position length,
+                        size_t maxMatches, std::vector<Range> &matches) {
+	if (matches.size() >= maxMatches)
+		return;
+
+	const RESearchRange resr(doc, minPos, maxPos);
+
+#ifndef NO_CXX11_REGEX
+	if (FlagSet(flags, FindOption::Cxx11RegEx)) {
+		LinearRegex *linear = linearCache.Get(s, caseSensitive, CpUtf8 == doc->dbcsCodePage);
+		if (linear) {
+			std::vector<Range> windows;
+			const bool narrowed = doc->FindCandidates(linear->Prefix(), resr.startPos, resr.endPos, windows);
+			LinearFindAllOnLines(doc, *linear, resr, narrowed ? &windows : nullptr, maxMatches, matches);
+		} else {
+			RegexSearchBase::FindAll(doc, minPos, maxPos, s, caseSensitive, word, wordStart, flags, length,
+				maxMatches, matches);
+		}
+		return;
+	}
+#endif
+
+	// Compile once then run over each line in turn, unlike calling FindText for each match
+	const char *errmsg = search.Compile(s, length, caseSensitive, FlagSet(flags, FindOption::Posix));
+	if (errmsg) {
+		return;
+	}
+	const bool searchforLineStart = s[0] == '^';
+	const char searchEnd = s[length - 1];
+	const char searchEndPrev = (length > 1) ? s[length - 2] : '\0';
+	const bool searchforLineEnd = (searchEnd == '$') && (searchEndPrev != '\\');
+	for (Sci::Line line = resr.lineRangeStart; line != resr.lineRangeBreak; line++) {
+		const Sci::Position lineStartPos = doc->LineStart(line);
+		const Sci::Position lineEndPos = doc->LineEnd(line);
+		const Range lineRange = resr.LineRange(line, lineStartPos, lineEndPos);
+		if ((searchforLineStart && (lineRange.start != lineStartPos)) ||
+			(searchforLineEnd && (lineRange.end != lineEndPos)))
+			continue;	// Can't match start or end of line if range does not include it
+		const DocumentIndexer di(doc, lineRange.end);
+		search.SetLineRange(lineStartPos, lineEndPos);
+		int success = search.Execute(di, lineRange.start, lineRange.end);
+		while (success) {
+			const Sci::Position matchStart = search.bopat[0];
+			const Sci::Position matchEnd = search.eopat[0];
+			matches.emplace_back(matchStart, matchEnd);
+			if (matches.size() >= maxMatches)
+				return;
+			// There can be only one start of a line
+			if (searchforLineStart)
+				break;
+			const Sci::Position pos = (matchEnd > matchStart) ? matchEnd : doc->NextPosition(matchEnd, 1);
+			if (pos >= lineRange.end)
+				break;
+			success = search.Execute(di, pos, lineRange.end);
+		}
+	}
+}
+
 const char *BuiltinRegex::SubstituteByPosition(Document *doc, const char *text, Sci::Position *length) {
 	substituted.clear();
 	for (Sci::Position j = 0; j < *length; j++) {
@@ -13,6 +13,9 @@ namespace Scintilla::Internal {
 class DocWatcher;
 class DocModification;
 class Document;
+class DocumentSnapshot;
+class BackgroundFind;
+class TrigramIndex;
 class LineMarkers;
 class LineLevels;
 class LineState;
@@ -93,6 +96,25 @@ public:
 	}
 };
 
+/**
+ * Text to replace a range with in Document::ReplaceRanges.
+ */
+struct Replacement {
+	Range range;
+	std::string_view text;
+};
+
+/**
+ * One of the edits made by Document::ReplaceRanges. The position is in the document after the
+ * earlier edits so the edits can be applied in order to anything tracking positions or lines.
+ */
+struct ReplacedRange {
+	Sci::Position position;
+	Sci::Position lengthRemoved;
+	Sci::Position lengthInserted;
+	Sci::Line linesAdded;
+};
+
 /**
  * Interface class for regular expression searching
  */
@@ -103,6 +125,12 @@ public:
 	virtual Sci::Position FindText(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
                         bool caseSensitive, bool word, bool wordStart, Scintilla::FindOption flags, Sci::Position *length) = 0;
 
+	/// Append the non-overlapping matches from minPos to maxPos to matches until it holds maxMatches.
+	/// The default implementation calls FindText for each match.
+	virtual void FindAll(Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *s,
+                        bool caseSensitive, bool word, bool wordStart, Scintilla::FindOption flags, Sci::Position length,
+                        size_t maxMatches, std::vector<Range> &matches);
+
 	///@return String with the substitutions, must remain valid until the next call or destruction
 	virtual const char *SubstituteByPosition(Document *doc, const char *text, Sci::Position *length) = 0;
 };
@@ -305,6 +333,18 @@ private:
 	std::unique_ptr<RegexSearchBase> regex;
 	std::unique_ptr<LexInterface> pli;
 
+	// Incremented by each change to text or styles.
+	size_t version;
+	// Latest snapshot, kept while the document is unchanged so it can be handed out again.
+	std::shared_ptr<const DocumentSnapshot> snapshot;
+	void NewVersion() noexcept;
+
+	bool useTrigramIndex;
+	bool useDisplayTree;
+	std::unique_ptr<TrigramIndex> trigramIndex;
+	TrigramIndex *ReadyTrigramIndex(bool wait);
+	Sci::Position FindTextInRange(Sci::Position minPos, Sci::Position maxPos, const char *search, Scintilla::FindOption flags, Sci::Position *length);
+
 public:
 
 	Scintilla::EndOfLine eolMode;
@@ -382,6 +422,7 @@ public:
 	bool DeleteChars(Sci::Position pos, Sci::Position len);
 	Sci::Position InsertString(Sci::Position position, const char *s, Sci::Position insertLength);
 	Sci::Position InsertString(Sci::Position position, std::string_view sv);
+	Sci::Position ReplaceRanges(const std::vector<Replacement> &replacements);
 	void ChangeInsertion(const char *s, Sci::Position length);
 	int SCI_METHOD AddData(const char *data, Sci_Position length) override;
 	IDocumentEditable *AsDocumentEditable() noexcept;
@@ -391,6 +432,8 @@ public:
 	bool CanUndo() const noexcept { return cb.CanUndo(); }
 	bool CanRedo() const noexcept { return cb.CanRedo(); }
 	void DeleteUndoHistory() noexcept { cb.DeleteUndoHistory(); }
+	void SetUndoMemoryLimit(size_t bytes) { cb.SetUndoMemoryLimit(bytes); }
+	size_t UndoMemoryLimit() const noexcept { return cb.UndoMemoryLimit(); }
 	bool SetUndoCollection(bool collectUndo) noexcept {
 		return cb.SetUndoCollection(collectUndo);
 	}
@@ -418,7 +461,7 @@ public:
 	int UndoCurrent() const noexcept;
 	int UndoActionType(int action) const noexcept;
 	Sci::Position UndoActionPosition(int action) const noexcept;
-	std::string_view UndoActionText(int action) const noexcept;
+	std::string_view UndoActionText(int action) const;
 	void PushUndoActionType(int type, Sci::Position position);
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
@@ -446,6 +489,7 @@ public:
 	void SetReadOnly(bool set) noexcept { cb.SetReadOnly(set); }
 	bool IsReadOnly() const noexcept { return cb.IsReadOnly(); }
 	bool IsLarge() const noexcept { return cb.IsLarge(); }
+	bool UsesDisplayTree() const noexcept { return useDisplayTree; }
 	Scintilla::DocumentOption Options() const noexcept;
 
 	void DelChar(Sci::Position pos);
@@ -461,6 +505,9 @@ public:
 	void GetStyleRange(unsigned char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const {
 		cb.GetStyleRange(buffer, position, lengthRetrieve);
 	}
+	size_t EditVersion() const noexcept { return version; }
+	/// Call on the thread that owns the document. The result is immutable and may be read on any thread.
+	std::shared_ptr<const DocumentSnapshot> Snapshot();
 	int GetMark(Sci::Line line, bool includeChangeHistory) const;
 	Sci::Line MarkerNext(Sci::Line lineStart, int mask) const noexcept;
 	int AddMark(Sci::Line line, int markerNum);
@@ -509,6 +556,15 @@ public:
 	bool HasCaseFolder() const noexcept;
 	void SetCaseFolder(std::unique_ptr<CaseFolder> pcf_) noexcept;
 	Sci::Position FindText(Sci::Position minPos, Sci::Position maxPos, const char *search, Scintilla::FindOption flags, Sci::Position *length);
+	/// Ranges between minPos and maxPos where a case sensitive match of literal may start, in document order.
+	/// Returns false when there is no index ready so the whole range should be searched.
+	bool FindCandidates(std::string_view literal, Sci::Position minPos, Sci::Position maxPos, std::vector<Range> &windows);
+	std::string TrigramIndexData();
+	bool SetTrigramIndexData(std::string_view data);
+	void FindAll(Sci::Position minPos, Sci::Position maxPos, const char *search, Scintilla::FindOption flags, Sci::Position length,
+		size_t maxMatches, std::vector<Range> &matches);
+	std::unique_ptr<BackgroundFind> FindAllInBackground(Sci::Position minPos, Sci::Position maxPos, std::string_view search,
+		Scintilla::FindOption flags, unsigned int threads);
 	const char *SubstituteByPosition(const char *text, Sci::Position *length);
 	Scintilla::LineCharacterIndexType LineCharacterIndex() const noexcept;
 	void AllocateLineCharacterIndex(Scintilla::LineCharacterIndexType lineCharacterIndex);
@@ -531,6 +587,7 @@ public:
 	void IncrementStyleClock() noexcept;
 	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) override;
 	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
+	void DecorationFillRanges(int indicator, int value, const std::vector<Range> &ranges);
 	LexInterface *GetLexInterface() const noexcept;
 	void SetLexInterface(std::unique_ptr<LexInterface> pLexInterface) noexcept;
 
@@ -623,6 +680,7 @@ public:
 	Scintilla::FoldLevel foldLevelPrev;
 	Sci::Line annotationLinesAdded;
 	Sci::Position token;
+	const std::vector<ReplacedRange> *replaced;	/**< Only valid for ReplaceAll. */
 
 	DocModification(Scintilla::ModificationFlags modificationType_, Sci::Position position_=0, Sci::Position length_=0,
 		Sci::Line linesAdded_=0, const char *text_=nullptr, Sci::Line line_=0) noexcept :
@@ -635,7 +693,8 @@ public:
 		foldLevelNow(Scintilla::FoldLevel::None),
 		foldLevelPrev(Scintilla::FoldLevel::None),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		replaced(nullptr) {}
 
 	DocModification(Scintilla::ModificationFlags modificationType_, const Action &act, Sci::Line linesAdded_=0) noexcept :
 		modificationType(modificationType_),
@@ -647,7 +706,8 @@ public:
 		foldLevelNow(Scintilla::FoldLevel::None),
 		foldLevelPrev(Scintilla::FoldLevel::None),
 		annotationLinesAdded(0),
-		token(0) {}
+		token(0),
+		replaced(nullptr) {}
 };
 
 /**
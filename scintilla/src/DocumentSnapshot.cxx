@@ -0,0 +1,94 @@
+// Scintilla source code edit control
+/** @file DocumentSnapshot.cxx
+ ** Immutable view of a document's text, lines and styles for use on other threads.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "Position.h"
+#include "PieceTree.h"
+#include "DocumentSnapshot.h"
+
+using namespace Scintilla::Internal;
+
+DocumentSnapshot::DocumentSnapshot(PieceTree &&text_, std::vector<Sci::Position> &&lineStarts_, bool hasStyles_, std::string &&styles_, size_t version_) noexcept :
+	text(std::move(text_)), lineStarts(std::move(lineStarts_)), styles(std::move(styles_)), hasStyles(hasStyles_), version(version_) {
+}
+
+Sci::Position DocumentSnapshot::Length() const noexcept {
+	return text.Length();
+}
+
+char DocumentSnapshot::CharAt(Sci::Position position) const noexcept {
+	// Not text.CharAt as that updates a cache which would race with other readers.
+	Sci::Position segmentStart = 0;
+	const std::string_view segment = text.SegmentAt(position, segmentStart);
+	if (position < 0 || segment.empty()) {
+		return 0;
+	}
+	return segment[position - segmentStart];
+}
+
+void DocumentSnapshot::GetCharRange(char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const noexcept {
+	if (position < 0 || lengthRetrieve <= 0 || position + lengthRetrieve > text.Length()) {
+		return;
+	}
+	text.GetRange(buffer, position, lengthRetrieve);
+}
+
+std::string_view DocumentSnapshot::SegmentAt(Sci::Position position, Sci::Position &segmentStart) const noexcept {
+	return text.SegmentAt(position, segmentStart);
+}
+
+bool DocumentSnapshot::HasStyles() const noexcept {
+	return hasStyles;
+}
+
+char DocumentSnapshot::StyleAt(Sci::Position position) const noexcept {
+	if (position < 0 || position >= static_cast<Sci::Position>(styles.length())) {
+		return 0;
+	}
+	return styles[position];
+}
+
+void DocumentSnapshot::GetStyleRange(unsigned char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const noexcept {
+	if (position < 0 || lengthRetrieve <= 0 || position + lengthRetrieve > static_cast<Sci::Position>(styles.length())) {
+		return;
+	}
+	memcpy(buffer, styles.data() + position, lengthRetrieve);
+}
+
+Sci::Line DocumentSnapshot::Lines() const noexcept {
+	// lineStarts has an extra entry for the end of the text
+	return static_cast<Sci::Line>(lineStarts.size()) - 1;
+}
+
+Sci::Position DocumentSnapshot::LineStart(Sci::Line line) const noexcept {
+	if (line < 0) {
+		return 0;
+	}
+	if (line >= Lines()) {
+		return text.Length();
+	}
+	return lineStarts[line];
+}
+
+Sci::Line DocumentSnapshot::LineFromPosition(Sci::Position pos) const noexcept {
+	if (pos <= 0) {
+		return 0;
+	}
+	if (pos >= text.Length()) {
+		return Lines() - 1;
+	}
+	const auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), pos);
+	return static_cast<Sci::Line>(it - lineStarts.begin()) - 1;
+}
@@ -0,0 +1,52 @@
+// Scintilla source code edit control
+/** @file DocumentSnapshot.h
+ ** Immutable view of a document's text, lines and styles for use on other threads.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef DOCUMENTSNAPSHOT_H
+#define DOCUMENTSNAPSHOT_H
+
+namespace Scintilla::Internal {
+
+/**
+ * The text, line starts and styles of a document at one version.
+ * A snapshot never changes after construction so it may be read from any number of
+ * threads without locking while the document continues to be edited.
+ * Snapshots are shared through std::shared_ptr<const DocumentSnapshot>: the document
+ * keeps the latest one and each reader holds its own reference, so a version is freed
+ * when it is neither current nor in use by any reader.
+ * Only methods that do not update the PieceTree lookup cache are used so concurrent
+ * reads are safe. Sequential readers should use SegmentAt rather than CharAt.
+ */
+class DocumentSnapshot {
+	PieceTree text;
+	std::vector<Sci::Position> lineStarts;
+	// Empty when the document does not store styles
+	std::string styles;
+	bool hasStyles;
+	size_t version;
+public:
+	DocumentSnapshot(PieceTree &&text_, std::vector<Sci::Position> &&lineStarts_, bool hasStyles_, std::string &&styles_, size_t version_) noexcept;
+
+	/// Version of the document this was taken from, incremented by each change to text or styles.
+	[[nodiscard]] size_t Version() const noexcept { return version; }
+	[[nodiscard]] Sci::Position Length() const noexcept;
+
+	/// Retrieving positions outside the range of the text works and returns 0
+	char CharAt(Sci::Position position) const noexcept;
+	void GetCharRange(char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const noexcept;
+	std::string_view SegmentAt(Sci::Position position, Sci::Position &segmentStart) const noexcept;
+
+	[[nodiscard]] bool HasStyles() const noexcept;
+	char StyleAt(Sci::Position position) const noexcept;
+	void GetStyleRange(unsigned char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const noexcept;
+
+	[[nodiscard]] Sci::Line Lines() const noexcept;
+	Sci::Position LineStart(Sci::Line line) const noexcept;
+	Sci::Line LineFromPosition(Sci::Position pos) const noexcept;
+};
+
+}
+
+#endif
@@ -80,7 +80,7 @@ EditModel::EditModel() : braces{} {
 	reprs = std::make_unique<SpecialRepresentations>();
 	pdoc = new Document(DocumentOption::Default);
 	pdoc->AddRef();
-	pcs = ContractionStateCreate(pdoc->IsLarge());
+	pcs = ContractionStateCreate(pdoc->IsLarge(), pdoc->UsesDisplayTree());
 }
 
 EditModel::~EditModel() {
@@ -23,11 +23,11 @@
 #include <optional>
 #include <algorithm>
 #include <iterator>
+#include <functional>
 #include <memory>
 #include <chrono>
 #include <atomic>
 #include <thread>
-#include <future>
 
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
@@ -59,6 +59,7 @@
 #include "CaseFolder.h"
 #include "Document.h"
 #include "UniConversion.h"
+#include "ThreadPool.h"
 #include "Selection.h"
 #include "PositionCache.h"
 #include "EditModel.h"
@@ -220,12 +221,26 @@ bool EditView::LinesOverlap() const noexcept {
 
 void EditView::SetLayoutThreads(unsigned int threads) noexcept {
 	maxLayoutThreads = std::clamp(threads, 1U, std::thread::hardware_concurrency());
+	if (layoutPool && (layoutPool->Threads() != maxLayoutThreads)) {
+		layoutPool.reset();
+	}
 }
 
 unsigned int EditView::GetLayoutThreads() const noexcept {
 	return maxLayoutThreads;
 }
 
+// The threads are started when first needed and then kept for later layouts and wraps.
+ThreadPool &EditView::LayoutPool() {
+	if (!layoutPool) {
+		layoutPool = std::make_unique<ThreadPool>(maxLayoutThreads);
+	}
+	while (llScratch.size() < layoutPool->Threads()) {
+		llScratch.push_back(std::make_shared<LineLayout>(-1, 200));
+	}
+	return *layoutPool;
+}
+
 void EditView::ClearAllTabstops() noexcept {
 	ldTabstops.reset();
 }
@@ -456,8 +471,8 @@ void EditView::LayoutLine(const EditModel &model, Surface *surface, const ViewSt
 
 		// Fill base line layout
 		const int lineLength = static_cast<int>(posLineEnd - posLineStart);
-		model.pdoc->GetCharRange(ll->chars.get(), posLineStart, lineLength);
-		model.pdoc->GetStyleRange(ll->styles.get(), posLineStart, lineLength);
+		model.pdoc->GetCharRange(ll->chars, posLineStart, lineLength);
+		model.pdoc->GetStyleRange(ll->styles, posLineStart, lineLength);
 		const int numCharsBeforeEOL = static_cast<int>(model.pdoc->LineEnd(line) - posLineStart);
 		const int numCharsInLine = (vstyle.viewEOL) ? lineLength : numCharsBeforeEOL;
 		const unsigned char styleByteLast = (lineLength > 0) ? ll->styles[lineLength - 1] : 0;
@@ -502,20 +517,15 @@ void EditView::LayoutLine(const EditModel &model, Surface *surface, const ViewSt
 			const bool multiThreadedContext = multiThreaded || callerMultiThreaded;
 			IPositionCache *pCache = posCache.get();
 
-			// If only 1 thread needed then use the main thread, else spin up multiple
-			const std::launch policy = (multiThreaded) ? std::launch::async : std::launch::deferred;
-
-			std::vector<std::future<void>> futures;
-			for (size_t th = 0; th < threads; th++) {
-				// Find relative positions of everything except for tabs
-				std::future<void> fut = std::async(policy,
-					[pCache, surface, &vstyle, &ll, &segments, &nextIndex, textUnicode, multiThreadedContext]() {
-					LayoutSegments(pCache, surface, vstyle, ll, segments, nextIndex, textUnicode, multiThreadedContext);
-				});
-				futures.push_back(std::move(fut));
-			}
-			for (const std::future<void> &f : futures) {
-				f.wait();
+			// Find relative positions of everything except for tabs
+			const auto layoutSegments = [pCache, surface, &vstyle, &ll, &segments, &nextIndex, textUnicode, multiThreadedContext](unsigned int) {
+				LayoutSegments(pCache, surface, vstyle, ll, segments, nextIndex, textUnicode, multiThreadedContext);
+			};
+			// If only 1 thread needed then use the calling thread, else share with the layout pool
+			if (multiThreaded) {
+				LayoutPool().ForkJoin(static_cast<unsigned int>(threads), layoutSegments);
+			} else {
+				layoutSegments(0);
 			}
 		}
 
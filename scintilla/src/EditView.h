@@ -45,6 +45,7 @@ typedef void (*DrawTabArrowFn)(Surface *surface, PRectangle rcTab, int ymid,
 	const ViewStyle &vsDraw, Stroke stroke);
 
 class LineTabstops;
+class ThreadPool;
 
 /**
 * EditView draws the main text area.
@@ -83,6 +84,9 @@ public:
 
 	unsigned int maxLayoutThreads;
 	static constexpr int bytesPerLayoutThread = 1000;
+	std::unique_ptr<ThreadPool> layoutPool;
+	// Layouts for lines that are not cached, one for each thread of layoutPool
+	std::vector<std::shared_ptr<LineLayout>> llScratch;
 
 	int tabArrowHeight; // draw arrow heads this many pixels above/below line midpoint
 	/** Some platforms, notably PLAT_CURSES, do not support Scintilla's native
@@ -106,6 +110,7 @@ public:
 
 	void SetLayoutThreads(unsigned int threads) noexcept;
 	unsigned int GetLayoutThreads() const noexcept;
+	ThreadPool &LayoutPool();
 
 	void ClearAllTabstops() noexcept;
 	XYPOSITION NextTabstopPos(Sci::Line line, XYPOSITION x, XYPOSITION tabWidth) const noexcept;
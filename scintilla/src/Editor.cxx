@@ -23,12 +23,12 @@
 #include <optional>
 #include <algorithm>
 #include <iterator>
+#include <functional>
 #include <memory>
 #include <chrono>
 #include <atomic>
 #include <mutex>
 #include <thread>
-#include <future>
 
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
@@ -59,8 +59,10 @@
 #include "Decoration.h"
 #include "CaseFolder.h"
 #include "Document.h"
+#include "BackgroundFind.h"
 #include "UniConversion.h"
 #include "DBCS.h"
+#include "ThreadPool.h"
 #include "Selection.h"
 #include "PositionCache.h"
 #include "EditModel.h"
@@ -178,6 +180,10 @@ Editor::Editor() : durationWrapOneByte(0.000001, 0.00000001, 0.00001) {
 
 	targetRange = SelectionSegment();
 	searchFlags = FindOption::None;
+	findIndicatorFlags = FindOption::None;
+	findIndicator = 0;
+	findIndicatorValue = 1;
+	findIndicatorCount = 0;
 
 	topLine = 0;
 	posTopLine = 0;
@@ -212,6 +218,7 @@ Editor::~Editor() {
 }
 
 void Editor::Finalise() {
+	FindIndicatorCancel();
 	SetIdle(false);
 	CancelModes();
 }
@@ -1503,11 +1510,6 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 
 	// Wrap all the short lines in multiple threads
 
-	// If only 1 thread needed then use the main thread, else spin up multiple
-	const std::launch policy = multiThreaded ? std::launch::async : std::launch::deferred;
-
-	std::atomic<size_t> nextIndex = 0;
-
 	// Lines that are less likely to be re-examined should not be read from or written to the cache.
 	const SignificantLines significantLines {
 		pdoc->SciLineFromPosition(sel.MainCaret()),
@@ -1519,39 +1521,27 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 	// Protect the line layout cache from being accessed from multiple threads simultaneously
 	std::mutex mutexRetrieve;
 
-	std::vector<std::future<void>> futures;
-	for (size_t th = 0; th < threads; th++) {
-		std::future<void> fut = std::async(policy,
-			[=, &surface, &nextIndex, &linesAfterWrap, &mutexRetrieve]() {
-			// llTemporary is reused for non-significant lines, avoiding allocation costs.
-			std::shared_ptr<LineLayout> llTemporary = std::make_shared<LineLayout>(-1, 200);
-			while (true) {
-				const size_t i = nextIndex.fetch_add(1, std::memory_order_acq_rel);
-				if (i >= linesBeingWrapped) {
-					break;
-				}
-				const Sci::Line lineNumber = lineToWrap + i;
-				const Range rangeLine = pdoc->LineRange(lineNumber);
-				const Sci::Position lengthLine = rangeLine.Length();
-				if (lengthLine < lengthToMultiThread) {
-					std::shared_ptr<LineLayout> ll;
-					if (significantLines.LineMayCache(lineNumber)) {
-						std::lock_guard<std::mutex> guard(mutexRetrieve);
-						ll = view.RetrieveLineLayout(lineNumber, *this);
-					} else {
-						ll = llTemporary;
-						ll->ReSet(lineNumber, lengthLine);
-					}
-					view.LayoutLine(*this, surface, vs, ll.get(), wrapWidth, multiThreaded);
-					linesAfterWrap[i] = ll->lines;
-				}
+	// If only 1 thread needed then the calling thread does all the work
+	ThreadPool &pool = view.LayoutPool();
+	pool.ParallelFor(linesBeingWrapped, static_cast<unsigned int>(threads),
+		[=, &surface, &linesAfterWrap, &mutexRetrieve](size_t i, unsigned int thread) {
+		const Sci::Line lineNumber = lineToWrap + i;
+		const Range rangeLine = pdoc->LineRange(lineNumber);
+		const Sci::Position lengthLine = rangeLine.Length();
+		if (lengthLine < lengthToMultiThread) {
+			std::shared_ptr<LineLayout> ll;
+			if (significantLines.LineMayCache(lineNumber)) {
+				std::lock_guard<std::mutex> guard(mutexRetrieve);
+				ll = view.RetrieveLineLayout(lineNumber, *this);
+			} else {
+				// Each thread reuses its own layout for non-significant lines, avoiding allocation costs.
+				ll = view.llScratch[thread];
+				ll->ReSet(lineNumber, lengthLine);
 			}
-		});
-		futures.push_back(std::move(fut));
-	}
-	for (const std::future<void> &f : futures) {
-		f.wait();
-	}
+			view.LayoutLine(*this, surface, vs, ll.get(), wrapWidth, multiThreaded);
+			linesAfterWrap[i] = ll->lines;
+		}
+	});
 	// End of multiple threads
 
 	// Multiply duration by number of threads to produce (near) equivalence to duration if single threaded
@@ -1561,7 +1551,7 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 	// Wrap all the long lines in the main thread.
 	// LayoutLine may then multi-thread over segments in each line.
 
-	std::shared_ptr<LineLayout> llLarge = std::make_shared<LineLayout>(-1, 200);
+	std::shared_ptr<LineLayout> llLarge = view.llScratch[0];
 	for (size_t indexLarge = 0; indexLarge < linesBeingWrapped; indexLarge++) {
 		const Sci::Line lineNumber = lineToWrap + indexLarge;
 		const Range rangeLine = pdoc->LineRange(lineNumber);
@@ -1593,7 +1583,6 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 		if (pcs->SetHeight(lineNumber, linesWrapped)) {
 			wrapsDone++;
 		}
-		wrapPending.Wrapped(lineNumber);
 	}
 
 	durationWrapOneByte.AddSample(bytesBeingWrapped, durationShortLinesThreads + durationLongLines);
@@ -1604,7 +1593,7 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 // Perform  wrapping for a subset of the lines needing wrapping.
 // wsAll: wrap all lines which need wrapping in this single call
 // wsVisible: wrap currently visible lines
-// wsIdle: wrap one page + 100 lines
+// wsIdle: wrap lines for a short time, spreading out from those already wrapped around the view
 // Return true if wrapping occurred.
 bool Editor::WrapLines(WrapScope ws) {
 	Sci::Line goodTopLine = topLine;
@@ -1629,9 +1618,10 @@ bool Editor::WrapLines(WrapScope ws) {
 			// Idle processing not supported so full wrap required.
 			ws = WrapScope::wsAll;
 		}
+		const Sci::Line lineEndNeedWrap = std::min(wrapPending.end, pdoc->LinesTotal());
 		// Decide where to start wrapping
 		Sci::Line lineToWrap = wrapPending.start;
-		Sci::Line lineToWrapEnd = std::min(wrapPending.end, pdoc->LinesTotal());
+		Sci::Line lineToWrapEnd = lineEndNeedWrap;
 		const Sci::Line lineDocTop = pcs->DocFromDisplay(topLine);
 		const Sci::Line subLineTop = topLine - pcs->DisplayFromDoc(lineDocTop);
 		if (ws == WrapScope::wsVisible) {
@@ -1657,19 +1647,45 @@ bool Editor::WrapLines(WrapScope ws) {
 				// Currently visible text does not need wrapping
 				return false;
 			}
+			if ((lineToWrap >= wrapPending.wrappedStart) && (lineToWrapEnd <= wrapPending.wrappedEnd)) {
+				// Visible text was wrapped earlier
+				return false;
+			}
 		} else if (ws == WrapScope::wsIdle) {
 			// Try to keep time taken by wrapping reasonable so interaction remains smooth.
 			constexpr double secondsAllowed = 0.01;
 			const size_t actionsInAllowedTime = std::clamp<Sci::Line>(
 				durationWrapOneByte.ActionsInAllowedTime(secondsAllowed),
 				0x200, 0x20000);
-			lineToWrapEnd = pdoc->LineFromPositionAfter(lineToWrap, actionsInAllowedTime);
+			if (wrapPending.HasWrapped()) {
+				// Alternate between the lines after and before those already wrapped so the
+				// lines nearest the view are wrapped first.
+				const bool before = wrapPending.expandBefore || (wrapPending.wrappedEnd >= lineEndNeedWrap);
+				wrapPending.expandBefore = !wrapPending.expandBefore;
+				if (before) {
+					lineToWrapEnd = wrapPending.wrappedStart;
+					const Sci::Position posStart = pdoc->LineStart(lineToWrapEnd) - actionsInAllowedTime;
+					lineToWrap = std::clamp(pdoc->SciLineFromPosition(posStart),
+						wrapPending.start, lineToWrapEnd - 1);
+				} else {
+					lineToWrap = wrapPending.wrappedEnd;
+					lineToWrapEnd = pdoc->LineFromPositionAfter(lineToWrap, actionsInAllowedTime);
+				}
+			} else {
+				// Start from the view when it needs wrapping
+				if ((lineDocTop > wrapPending.start) && (lineDocTop < lineEndNeedWrap)) {
+					lineToWrap = lineDocTop;
+				}
+				lineToWrapEnd = pdoc->LineFromPositionAfter(lineToWrap, actionsInAllowedTime);
+			}
+		} else if (wrapPending.HasWrapped()) {
+			// Skip lines already wrapped by wrapping those before them then those after them.
+			lineToWrapEnd = wrapPending.wrappedStart;
 		}
-		const Sci::Line lineEndNeedWrap = std::min(wrapPending.end, pdoc->LinesTotal());
 		lineToWrapEnd = std::min(lineToWrapEnd, lineEndNeedWrap);
 
 		// Ensure all lines being wrapped are styled.
-		pdoc->EnsureStyledTo(pdoc->LineStart(lineToWrapEnd));
+		pdoc->EnsureStyledTo(pdoc->LineStart((ws == WrapScope::wsAll) ? lineEndNeedWrap : lineToWrapEnd));
 
 		if (lineToWrap < lineToWrapEnd) {
 
@@ -1683,6 +1699,14 @@ bool Editor::WrapLines(WrapScope ws) {
 //Platform::DebugPrintf("Wraplines: scope=%0d need=%0d..%0d perform=%0d..%0d\n", ws, wrapPending.start, wrapPending.end, lineToWrap, lineToWrapEnd);
 
 				wrapOccurred = WrapBlock(surface, lineToWrap, lineToWrapEnd);
+				wrapPending.Wrapped(lineToWrap, lineToWrapEnd);
+				if ((ws == WrapScope::wsAll) && (wrapPending.start < lineEndNeedWrap)) {
+					lineToWrap = wrapPending.start;
+					if (WrapBlock(surface, lineToWrap, lineEndNeedWrap)) {
+						wrapOccurred = true;
+					}
+					wrapPending.Wrapped(lineToWrap, lineEndNeedWrap);
+				}
 
 				goodTopLine = pcs->DisplayFromDoc(lineDocTop) + std::min(
 					subLineTop, static_cast<Sci::Line>(pcs->GetHeight(lineDocTop)-1));
@@ -2629,6 +2653,13 @@ void Editor::NotifyZoom() {
 	NotifyParent(scn);
 }
 
+void Editor::NotifyFindIndicatorCompleted() {
+	NotificationData scn = {};
+	scn.nmhdr.code = Notification::FindIndicatorCompleted;
+	scn.length = findIndicatorCount;
+	NotifyParent(scn);
+}
+
 // Notifications from document
 void Editor::NotifyModifyAttempt(Document *, void *) {
 	//Platform::DebugPrintf("** Modify Attempt\n");
@@ -2646,6 +2677,7 @@ void Editor::CheckModificationForWrap(DocModification mh) {
 		const Sci::Line lineDoc = pdoc->SciLineFromPosition(mh.position);
 		const Sci::Line lines = std::max(static_cast<Sci::Line>(0), mh.linesAdded);
 		if (Wrapping()) {
+			wrapPending.LinesChanged(lineDoc, mh.linesAdded);
 			NeedWrapping(lineDoc, lineDoc + lines + 1);
 		}
 		RefreshStyleData();
@@ -2681,8 +2713,84 @@ constexpr Sci::Position MovePositionForDeletion(Sci::Position position, Sci::Pos
 
 }
 
+// Update for each edit of a ReplaceAll as would be done for a deletion then an insertion
+// but only relayout, rewrap and redraw once for the whole span.
+void Editor::CheckReplaceAll(const DocModification &mh) {
+	const Sci::Position posTopLineBefore = posTopLine;
+	Sci::Line linesAddedBeforeTop = 0;
+	Sci::Position delta = 0;
+	for (const ReplacedRange &edit : *mh.replaced) {
+		if (edit.lengthRemoved > 0) {
+			sel.MovePositions(false, edit.position, edit.lengthRemoved);
+			braces[0] = MovePositionForDeletion(braces[0], edit.position, edit.lengthRemoved);
+			braces[1] = MovePositionForDeletion(braces[1], edit.position, edit.lengthRemoved);
+		}
+		if (edit.lengthInserted > 0) {
+			sel.MovePositions(true, edit.position, edit.lengthInserted);
+			braces[0] = MovePositionForInsertion(braces[0], edit.position, edit.lengthInserted);
+			braces[1] = MovePositionForInsertion(braces[1], edit.position, edit.lengthInserted);
+		}
+		if (edit.linesAdded != 0) {
+			// Later edits are after this one so line numbers up to here are the same as they
+			// were just after this edit.
+			const Sci::Line lineDoc = pdoc->SciLineFromPosition(edit.position);
+			Sci::Line lineOfPos = lineDoc;
+			if (edit.position > pdoc->LineStart(lineOfPos))
+				lineOfPos++;	// Affecting subsequent lines
+			if (edit.linesAdded > 0) {
+				pcs->InsertLines(lineOfPos, edit.linesAdded);
+			} else {
+				pcs->DeleteLines(lineOfPos, -edit.linesAdded);
+			}
+			view.LinesAddedOrRemoved(lineOfPos, edit.linesAdded);
+			if (Wrapping()) {
+				wrapPending.LinesChanged(lineDoc, edit.linesAdded);
+			}
+			if (edit.position - delta < posTopLineBefore) {
+				linesAddedBeforeTop += edit.linesAdded;
+			}
+		}
+		delta += edit.lengthInserted - edit.lengthRemoved;
+	}
+
+	if (pcs->HiddenLines()) {
+		for (const ReplacedRange &edit : *mh.replaced) {
+			if (edit.linesAdded != 0) {
+				NeedShown(edit.position, edit.lengthInserted);
+			}
+		}
+	}
+
+	view.llc.Invalidate(LineLayout::ValidLevel::checkTextAndStyle);
+	const Sci::Line lineFirst = pdoc->SciLineFromPosition(mh.position);
+	const Sci::Line lineLast = pdoc->SciLineFromPosition(mh.position + mh.length);
+	if (Wrapping()) {
+		NeedWrapping(lineFirst, lineLast + 1);
+	}
+	RefreshStyleData();
+	SetAnnotationHeights(lineFirst, lineLast + 2);
+
+	if (linesAddedBeforeTop != 0) {
+		const Sci::Line newTop = std::clamp<Sci::Line>(topLine + linesAddedBeforeTop, 0, MaxScrollPos());
+		if (newTop != topLine) {
+			SetTopLine(newTop);
+			SetVerticalScrollPos();
+		}
+	}
+	if (paintState == PaintState::notPainting) {
+		if (SynchronousStylingToVisible()) {
+			QueueIdleWork(WorkItems::style, (mh.linesAdded != 0) ? pdoc->Length() : mh.position + mh.length);
+		}
+		Redraw();
+	}
+}
+
 void Editor::NotifyModified(Document *, DocModification mh, void *) {
 	ContainerNeedsUpdate(Update::Content);
+	if (FlagSet(mh.modificationType, ModificationFlags::InsertText | ModificationFlags::DeleteText | ModificationFlags::ReplaceAll)) {
+		// Positions found in the old text would be wrong
+		FindIndicatorCancel();
+	}
 	if (paintState == PaintState::painting) {
 		CheckForChangeOutsidePaint(Range(mh.position, mh.position + mh.length));
 	}
@@ -2723,6 +2831,10 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		if (FlagSet(mh.modificationType, ModificationFlags::ChangeStyle)) {
 			view.llc.Invalidate(LineLayout::ValidLevel::checkTextAndStyle);
 		}
+	} else if (FlagSet(mh.modificationType, ModificationFlags::BeforeReplaceAll | ModificationFlags::ReplaceAll)) {
+		if (FlagSet(mh.modificationType, ModificationFlags::ReplaceAll) && mh.replaced) {
+			CheckReplaceAll(mh);
+		}
 	} else {
 		// Move selection and brace highlights
 		if (FlagSet(mh.modificationType, ModificationFlags::InsertText)) {
@@ -4215,6 +4327,42 @@ Sci::Position Editor::FindTextFull(
 	}
 }
 
+/**
+ * Search for all occurrences of a text in the document, in the given range.
+ * @return The number of ranges filled in, -1 for an invalid regular expression.
+ */
+Sci::Position Editor::FindTextAll(
+    uptr_t wParam,		///< Search modes : @c FindOption::MatchCase, @c FindOption::WholeWord,
+    ///< @c FindOption::WordStart, @c FindOption::RegExp or @c FindOption::Posix.
+    sptr_t lParam) {	///< @c Sci_TextToFindAll structure: The text to search for in the given range
+    ///< and an array of maxRanges ranges that receives the matches.
+
+	TextToFindAll *ft = static_cast<TextToFindAll *>(PtrFromSPtr(lParam));
+	if (!ft->ranges || (ft->maxRanges <= 0))
+		return 0;
+	if (!pdoc->HasCaseFolder())
+		pdoc->SetCaseFolder(CaseFolderForEncoding());
+	try {
+		std::vector<Range> matches;
+		pdoc->FindAll(
+			ft->chrg.cpMin,
+			ft->chrg.cpMax,
+			ft->lpstrText,
+			static_cast<FindOption>(wParam),
+			strlen(ft->lpstrText),
+			static_cast<size_t>(ft->maxRanges),
+			matches);
+		for (size_t i = 0; i < matches.size(); i++) {
+			ft->ranges[i].cpMin = matches[i].start;
+			ft->ranges[i].cpMax = matches[i].end;
+		}
+		return static_cast<Sci::Position>(matches.size());
+	} catch (RegexError &) {
+		errorStatus = Status::RegEx;
+		return -1;
+	}
+}
+
 /**
  * Relocatable search support : Searches relative to current selection
  * point and sets the selection to the found text range with
@@ -4308,6 +4456,79 @@ Sci::Position Editor::SearchInTarget(const char *text, Sci::Position length) {
 	}
 }
 
+/**
+ * Fill each match in the target range with the current indicator and value.
+ * Matches are found on other threads when possible and filled from TickFor as
+ * they arrive, otherwise they are all found and filled now.
+ * @return -1 for an invalid regular expression, otherwise 0.
+ */
+Sci::Position Editor::FindIndicatorStart(const char *text, Sci::Position length) {
+	FindIndicatorCancel();
+	findIndicatorFlags = searchFlags;
+	findIndicator = pdoc->decorations->GetCurrentIndicator();
+	findIndicatorValue = pdoc->decorations->GetCurrentValue();
+	findIndicatorCount = 0;
+
+	const unsigned int threads = std::max(std::thread::hardware_concurrency(), 1U);
+	backgroundFind = pdoc->FindAllInBackground(targetRange.start.Position(), targetRange.end.Position(),
+		std::string_view(text, length), searchFlags, threads);
+	if (backgroundFind) {
+		FineTickerStart(TickReason::find, 50, 10);
+		return 0;
+	}
+
+	if (!pdoc->HasCaseFolder())
+		pdoc->SetCaseFolder(CaseFolderForEncoding());
+	try {
+		std::vector<Range> matches;
+		pdoc->FindAll(targetRange.start.Position(), targetRange.end.Position(), text,
+			searchFlags, length, SIZE_MAX, matches);
+		FindIndicatorFill(matches);
+	} catch (RegexError &) {
+		errorStatus = Status::RegEx;
+		return -1;
+	}
+	NotifyFindIndicatorCompleted();
+	return 0;
+}
+
+void Editor::FindIndicatorFill(const std::vector<Range> &matches) {
+	if (!matches.empty()) {
+		pdoc->DecorationFillRanges(findIndicator, findIndicatorValue, matches);
+		findIndicatorCount += matches.size();
+	}
+}
+
+void Editor::FindIndicatorTake() {
+	if (!backgroundFind)
+		return;
+	BackgroundFind::Acceptor accept;
+	// Like FindText, word options only apply to literal text
+	const bool word = FlagSet(findIndicatorFlags, FindOption::WholeWord);
+	const bool wordStart = FlagSet(findIndicatorFlags, FindOption::WordStart);
+	if (!FlagSet(findIndicatorFlags, FindOption::RegExp) && (word || wordStart)) {
+		accept = [this, word, wordStart](Sci::Position start, Sci::Position end) {
+			return pdoc->MatchesWordOptions(word, wordStart, start, end - start);
+		};
+	}
+	std::vector<Range> matches;
+	const bool complete = backgroundFind->TakeMatches(matches, accept);
+	FindIndicatorFill(matches);
+	if (complete) {
+		FineTickerCancel(TickReason::find);
+		backgroundFind.reset();
+		NotifyFindIndicatorCompleted();
+	}
+}
+
+void Editor::FindIndicatorCancel() {
+	if (backgroundFind) {
+		FineTickerCancel(TickReason::find);
+		// Waits for the threads to notice cancellation which is checked for each line
+		backgroundFind.reset();
+	}
+}
+
 void Editor::GoToLine(Sci::Line lineNo) {
 	if (lineNo > pdoc->LinesTotal())
 		lineNo = pdoc->LinesTotal();
@@ -5203,6 +5424,9 @@ void Editor::TickFor(TickReason reason) {
 			}
 			FineTickerCancel(TickReason::dwell);
 			break;
+		case TickReason::find:
+			FindIndicatorTake();
+			break;
 		default:
 			// tickPlatform handled by subclass
 			break;
@@ -5450,6 +5674,7 @@ void Editor::SetAnnotationHeights(Sci::Line start, Sci::Line end) {
 
 void Editor::SetDocPointer(Document *document) {
 	//Platform::DebugPrintf("** %x setdoc to %x\n", pdoc, document);
+	FindIndicatorCancel();
 	pdoc->RemoveWatcher(this, nullptr);
 	pdoc->Release();
 	if (!document) {
@@ -5458,7 +5683,7 @@ void Editor::SetDocPointer(Document *document) {
 		pdoc = document;
 	}
 	pdoc->AddRef();
-	pcs = ContractionStateCreate(pdoc->IsLarge());
+	pcs = ContractionStateCreate(pdoc->IsLarge(), pdoc->UsesDisplayTree());
 
 	// Ensure all positions within document
 	sel.Clear();
@@ -5854,6 +6079,65 @@ Sci::Position Editor::ReplaceTarget(ReplaceType replaceType, std::string_view te
 	return text.length();
 }
 
+/**
+ * Replace every match of search in the target range, found with the search flags, as a single
+ * undo action. When searching for a regular expression, \d in replacement is substituted as for
+ * ReplaceTargetRE. The target is moved to cover the same text after replacement.
+ * @return The number of matches replaced, -1 for an invalid regular expression.
+ */
+Sci::Position Editor::ReplaceAllInTarget(std::string_view search, std::string_view replacement) {
+	if (search.empty()) {
+		return 0;
+	}
+	if (!pdoc->HasCaseFolder())
+		pdoc->SetCaseFolder(CaseFolderForEncoding());
+	const Sci::Position targetStart = std::min(targetRange.start.Position(), targetRange.end.Position());
+	const Sci::Position targetEnd = std::max(targetRange.start.Position(), targetRange.end.Position());
+	std::vector<Range> matches;
+	std::vector<std::string> substituted;
+	try {
+		if (FlagSet(searchFlags, FindOption::RegExp) && (replacement.find('\\') != std::string_view::npos)) {
+			// Each match has to be substituted before the next search replaces the groups.
+			Sci::Position pos = targetStart;
+			while (pos <= targetEnd) {
+				Sci::Position lengthFound = search.length();
+				const Sci::Position found = pdoc->FindText(pos, targetEnd, search.data(), searchFlags, &lengthFound);
+				if (found < 0)
+					break;
+				Sci::Position lengthSubstituted = replacement.length();
+				const char *p = pdoc->SubstituteByPosition(replacement.data(), &lengthSubstituted);
+				substituted.emplace_back(p ? std::string(p, lengthSubstituted) : std::string());
+				matches.emplace_back(found, found + lengthFound);
+				// Step over empty matches so they are not found again
+				const Sci::Position next = (lengthFound > 0) ? found + lengthFound : pdoc->NextPosition(found, 1);
+				if (next <= found)
+					break;
+				pos = next;
+			}
+		} else {
+			pdoc->FindAll(targetStart, targetEnd, search.data(), searchFlags, search.length(), SIZE_MAX, matches);
+		}
+	} catch (RegexError &) {
+		errorStatus = Status::RegEx;
+		return -1;
+	}
+
+	std::vector<Replacement> replacements;
+	replacements.reserve(matches.size());
+	Sci::Position delta = 0;
+	for (size_t i = 0; i < matches.size(); i++) {
+		const std::string_view text = substituted.empty() ? replacement : std::string_view(substituted[i]);
+		replacements.push_back({matches[i], text});
+		delta += text.length() - matches[i].Length();
+	}
+	const Sci::Position replaced = pdoc->ReplaceRanges(replacements);
+	if (replaced > 0) {
+		targetRange.start.SetPosition(targetStart);
+		targetRange.end.SetPosition(targetEnd + delta);
+	}
+	return replaced;
+}
+
 bool Editor::IsUnicodeMode() const noexcept {
 	return pdoc && (CpUtf8 == pdoc->dbcsCodePage);
 }
@@ -6451,6 +6735,10 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		PLATFORM_ASSERT(lParam);
 		return SearchInTarget(ConstCharPtrFromSPtr(lParam), PositionFromUPtr(wParam));
 
+	case Message::ReplaceAllInTarget:
+		PLATFORM_ASSERT(wParam && lParam);
+		return ReplaceAllInTarget(ConstCharPtrFromUPtr(wParam), ConstCharPtrFromSPtr(lParam));
+
 	case Message::SetSearchFlags:
 		searchFlags = static_cast<FindOption>(wParam);
 		break;
@@ -6458,6 +6746,20 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetSearchFlags:
 		return static_cast<sptr_t>(searchFlags);
 
+	case Message::FindIndicatorStart:
+		PLATFORM_ASSERT(lParam);
+		return FindIndicatorStart(ConstCharPtrFromSPtr(lParam), PositionFromUPtr(wParam));
+
+	case Message::FindIndicatorCancel:
+		FindIndicatorCancel();
+		break;
+
+	case Message::GetFindIndicatorBusy:
+		return backgroundFind != nullptr;
+
+	case Message::GetFindIndicatorCount:
+		return findIndicatorCount;
+
 	case Message::GetTag:
 		return GetTag(CharPtrFromSPtr(lParam), static_cast<int>(wParam));
 
@@ -6533,6 +6835,9 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::FindTextFull:
 		return FindTextFull(wParam, lParam);
 
+	case Message::FindTextAll:
+		return FindTextAll(wParam, lParam);
+
 	case Message::GetTextRange:
 		if (TextRange *tr = static_cast<TextRange *>(PtrFromSPtr(lParam))) {
 			return GetTextRange(tr->lpstrText, tr->chrg.cpMin, tr->chrg.cpMax);
@@ -6646,6 +6951,13 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetUndoSequence:
 		return pdoc->UndoSequenceDepth();
 
+	case Message::SetUndoMemoryLimit:
+		pdoc->SetUndoMemoryLimit(wParam);
+		break;
+
+	case Message::GetUndoMemoryLimit:
+		return pdoc->UndoMemoryLimit();
+
 	case Message::GetUndoActions:
 		return pdoc->UndoActions();
 
@@ -7172,6 +7484,13 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetLayoutCache:
 		return static_cast<sptr_t>(view.llc.GetLevel());
 
+	case Message::SetLayoutCacheBudget:
+		view.llc.SetBudget(wParam);
+		break;
+
+	case Message::GetLayoutCacheBudget:
+		return view.llc.GetBudget();
+
 	case Message::SetPositionCache:
 		view.posCache->SetSize(wParam);
 		break;
@@ -8342,7 +8661,7 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 			Document *doc = new Document(static_cast<DocumentOption>(lParam));
 			doc->AddRef();
 			doc->Allocate(PositionFromUPtr(wParam));
-			pcs = ContractionStateCreate(pdoc->IsLarge());
+			pcs = ContractionStateCreate(pdoc->IsLarge(), pdoc->UsesDisplayTree());
 			return SPtrFromPtr(doc->AsDocumentEditable());
 		}
 
@@ -8357,12 +8676,18 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetDocumentOptions:
 		return static_cast<sptr_t>(pdoc->Options());
 
+	case Message::GetTrigramIndex:
+		return BytesResult(lParam, pdoc->TrigramIndexData());
+
+	case Message::SetTrigramIndex:
+		return pdoc->SetTrigramIndexData(std::string_view(ConstCharPtrFromSPtr(lParam), PositionFromUPtr(wParam)));
+
 	case Message::CreateLoader: {
 			Document *doc = new Document(static_cast<DocumentOption>(lParam));
 			doc->AddRef();
 			doc->Allocate(PositionFromUPtr(wParam));
 			doc->SetUndoCollection(false);
-			pcs = ContractionStateCreate(pdoc->IsLarge());
+			pcs = ContractionStateCreate(pdoc->IsLarge(), pdoc->UsesDisplayTree());
 			return reinterpret_cast<sptr_t>(static_cast<ILoader *>(doc));
 		}
 
@@ -115,17 +115,59 @@ struct WrapPending {
 	enum { lineLarge = 0x7ffffff };
 	Sci::Line start;	// When there are wraps pending, will be in document range
 	Sci::Line end;	// May be lineLarge to indicate all of document after start
+	// Lines between start and end that are already wrapped. Wrapping starts with the
+	// visible lines and spreads out from them so this is a single range.
+	Sci::Line wrappedStart;
+	Sci::Line wrappedEnd;
+	bool expandBefore;	// Whether to wrap before or after wrappedStart..wrappedEnd next
 	WrapPending() noexcept {
-		start = lineLarge;
-		end = lineLarge;
+		Reset();
 	}
 	void Reset() noexcept {
 		start = lineLarge;
 		end = lineLarge;
+		ClearWrapped();
+	}
+	void ClearWrapped() noexcept {
+		wrappedStart = lineLarge;
+		wrappedEnd = lineLarge;
+		expandBefore = false;
+	}
+	bool HasWrapped() const noexcept {
+		return wrappedStart < wrappedEnd;
+	}
+	void Wrapped(Sci::Line lineStart, Sci::Line lineEnd) noexcept {
+		lineStart = std::max(lineStart, start);
+		lineEnd = std::min(lineEnd, end);
+		if (lineStart >= lineEnd) {
+			return;
+		}
+		if (HasWrapped() && (lineStart <= wrappedEnd) && (lineEnd >= wrappedStart)) {
+			lineStart = std::min(lineStart, wrappedStart);
+			lineEnd = std::max(lineEnd, wrappedEnd);
+		} else {
+			// Any separate range that was wrapped before is forgotten and will be wrapped again
+			expandBefore = false;
+		}
+		wrappedStart = lineStart;
+		wrappedEnd = lineEnd;
+		if (wrappedStart == start) {
+			start = wrappedEnd;
+			ClearWrapped();
+		} else if (wrappedEnd == end) {
+			end = wrappedStart;
+			ClearWrapped();
+		}
 	}
-	void Wrapped(Sci::Line line) noexcept {
-		if (start == line)
-			start++;
+	// Lines after line were inserted or, when linesAdded is negative, deleted.
+	void LinesChanged(Sci::Line line, Sci::Line linesAdded) noexcept {
+		if (linesAdded != 0) {
+			for (Sci::Line *boundary : {&start, &end, &wrappedStart, &wrappedEnd}) {
+				if ((*boundary > line) && (*boundary != lineLarge)) {
+					*boundary = std::max(*boundary + linesAdded, line + 1);
+				}
+			}
+		}
 	}
 	bool NeedsWrap() const noexcept {
 		return start < end;
@@ -133,6 +175,17 @@ struct WrapPending {
 	bool AddRange(Sci::Line lineStart, Sci::Line lineEnd) noexcept {
 		const bool neededWrap = NeedsWrap();
 		bool changed = false;
+		if (HasWrapped() && (lineStart < wrappedEnd) && (lineEnd > wrappedStart)) {
+			// Keep the larger of the wrapped ranges before and after the lines to wrap
+			if ((lineStart - wrappedStart) >= (wrappedEnd - lineEnd)) {
+				wrappedEnd = lineStart;
+			} else {
+				wrappedStart = lineEnd;
+			}
+			if (!HasWrapped()) {
+				ClearWrapped();
+			}
+		}
 		if (start > lineStart) {
 			start = lineStart;
 			changed = true;
@@ -250,6 +303,12 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	Sci::Position wordSelectInitialCaretPos;
 	SelectionSegment targetRange;
 	Scintilla::FindOption searchFlags;
+	// Search started by FindIndicatorStart with the indicator and value it fills
+	std::unique_ptr<BackgroundFind> backgroundFind;
+	Scintilla::FindOption findIndicatorFlags;
+	int findIndicator;
+	int findIndicatorValue;
+	Sci::Position findIndicatorCount;
 	Sci::Line topLine;
 	Sci::Position posTopLine;
 	Sci::Position lengthForEncode;
@@ -467,10 +526,12 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void NotifyNeedShown(Sci::Position pos, Sci::Position len);
 	void NotifyDwelling(Point pt, bool state);
 	void NotifyZoom();
+	void NotifyFindIndicatorCompleted();
 
 	void NotifyModifyAttempt(Document *document, void *userData) override;
 	void NotifySavePoint(Document *document, void *userData, bool atSavePoint) override;
 	void CheckModificationForWrap(DocModification mh);
+	void CheckReplaceAll(const DocModification &mh);
 	void NotifyModified(Document *document, DocModification mh, void *userData) override;
 	void NotifyDeleted(Document *document, void *userData) noexcept override;
 	void NotifyStyleNeeded(Document *doc, void *userData, Sci::Position endStyleNeeded) override;
@@ -510,9 +571,14 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	virtual std::unique_ptr<CaseFolder> CaseFolderForEncoding();
 	Sci::Position FindText(Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
 	Sci::Position FindTextFull(Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
+	Sci::Position FindTextAll(Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
 	void SearchAnchor() noexcept;
 	Sci::Position SearchText(Scintilla::Message iMessage, Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
 	Sci::Position SearchInTarget(const char *text, Sci::Position length);
+	Sci::Position FindIndicatorStart(const char *text, Sci::Position length);
+	void FindIndicatorFill(const std::vector<Range> &matches);
+	void FindIndicatorTake();
+	void FindIndicatorCancel();
 	void GoToLine(Sci::Line lineNo);
 
 	virtual void CopyToClipboard(const SelectionText &selectedText) = 0;
@@ -545,7 +611,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void ButtonUpWithModifiers(Point pt, unsigned int curTime, Scintilla::KeyMod modifiers);
 
 	bool Idle();
-	enum class TickReason { caret, scroll, widen, dwell, platform };
+	enum class TickReason { caret, scroll, widen, dwell, find, platform };
 	virtual void TickFor(TickReason reason);
 	virtual bool FineTickerRunning(TickReason reason);
 	virtual void FineTickerStart(TickReason reason, int millis, int tolerance);
@@ -594,6 +660,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	Sci::Position GetTag(char *tagValue, int tagNumber);
 	enum class ReplaceType {basic, patterns, minimal};
 	Sci::Position ReplaceTarget(ReplaceType replaceType, std::string_view text);
+	Sci::Position ReplaceAllInTarget(std::string_view search, std::string_view replacement);
 
 	bool PositionIsHotspot(Sci::Position position) const noexcept;
 	bool PointIsHotspot(Point pt);
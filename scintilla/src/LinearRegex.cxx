@@ -0,0 +1,1154 @@
+// Scintilla source code edit control
+/** @file LinearRegex.cxx
+ ** Regular expression search in time linear in the length of the text.
+ ** Patterns are parsed into a tree then compiled to a program for a Pike VM which
+ ** advances all NFA threads together over the text, tracking group positions per thread.
+ ** Before the VM runs, a DFA built lazily from the same program, with assertions treated
+ ** as always true, rejects text that can not contain a match, and a literal prefix of the
+ ** pattern is found with SearchForward to skip text where no match can start.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+
+#include "CharacterCategoryMap.h"
+#include "StringSearch.h"
+#include "LinearRegex.h"
+#include "CaseConvert.h"
+#include "UniConversion.h"
+
+using namespace Scintilla::Internal;
+
+namespace {
+
+constexpr int replacementCharacter = 0xFFFD;
+// Counted repetition is expanded so limit the size of the program.
+constexpr size_t maxInstructions = 20000;
+constexpr int maxRepeat = 1000;
+// Lazy DFA states are discarded when there are too many.
+constexpr size_t maxDfaStates = 1000;
+
+// Thrown while compiling when the pattern is invalid or uses unsupported features.
+struct Unsupported {};
+
+enum class Op : uint8_t { Char, Any, Set, Split, Jump, Save, Assert, Match };
+
+enum class Assertion { LineStart, LineEnd, WordBoundary, NotWordBoundary };
+
+struct Instruction {
+	Op op;
+	// Char: character, Set: index, Split and Jump: target, Save: slot, Assert: Assertion.
+	int x;
+	// Split: target with lower priority.
+	int y;
+};
+
+struct Character {
+	int ch;
+	int width;
+};
+
+Character DecodeAt(std::string_view text, size_t position, bool unicode) noexcept {
+	const unsigned char lead = text[position];
+	if (!unicode || UTF8IsAscii(lead)) {
+		return { lead, 1 };
+	}
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(text.data() + position);
+	const int utf8Status = UTF8Classify(us, text.length() - position);
+	if (utf8Status & UTF8MaskInvalid) {
+		return { replacementCharacter, 1 };
+	}
+	return { UnicodeFromUTF8(us), utf8Status & UTF8MaskWidth };
+}
+
+Character DecodeBefore(std::string_view text, size_t position, bool unicode) noexcept {
+	size_t start = position - 1;
+	if (unicode) {
+		while ((start > 0) && (position - start < 4) && UTF8IsTrailByte(text[start])) {
+			start--;
+		}
+		const Character character = DecodeAt(text, start, unicode);
+		if (start + character.width != position) {
+			return { replacementCharacter, 1 };
+		}
+		return character;
+	}
+	return DecodeAt(text, start, unicode);
+}
+
+constexpr bool IsAsciiDigit(int ch) noexcept {
+	return ch >= '0' && ch <= '9';
+}
+
+constexpr bool IsAsciiUpper(int ch) noexcept {
+	return ch >= 'A' && ch <= 'Z';
+}
+
+constexpr bool IsAsciiLower(int ch) noexcept {
+	return ch >= 'a' && ch <= 'z';
+}
+
+constexpr bool IsAsciiSpace(int ch) noexcept {
+	return (ch == ' ') || ((ch >= '\t') && (ch <= '\r'));
+}
+
+bool IsLetter(int ch, bool unicode) noexcept {
+	if (ch < 0x80) {
+		return IsAsciiUpper(ch) || IsAsciiLower(ch);
+	}
+	return unicode && CategoriseCharacter(ch) <= ccLo;
+}
+
+bool IsAlphaNumeric(int ch, bool unicode) noexcept {
+	if (ch < 0x80) {
+		return IsAsciiDigit(ch) || IsAsciiUpper(ch) || IsAsciiLower(ch);
+	}
+	if (!unicode) {
+		return false;
+	}
+	const CharacterCategory category = CategoriseCharacter(ch);
+	return category <= ccLo || (category >= ccNd && category <= ccNo);
+}
+
+bool IsWordCharacter(int ch, bool unicode) noexcept {
+	return (ch == '_') || IsAlphaNumeric(ch, unicode);
+}
+
+bool IsSpace(int ch, bool unicode) noexcept {
+	if (ch < 0x80) {
+		return IsAsciiSpace(ch);
+	}
+	if (!unicode) {
+		return false;
+	}
+	const CharacterCategory category = CategoriseCharacter(ch);
+	return category >= ccZs && category <= ccZp;
+}
+
+// Single character case conversion, leaving characters that expand to several unchanged.
+int ConvertCase(int ch, bool unicode, CaseConversion conversion) noexcept {
+	if (ch < 0x80) {
+		if (conversion == CaseConversion::upper) {
+			return IsAsciiLower(ch) ? ch - 'a' + 'A' : ch;
+		}
+		return IsAsciiUpper(ch) ? ch - 'A' + 'a' : ch;
+	}
+	if (!unicode) {
+		return ch;
+	}
+	const char *converted = CaseConvert(ch, conversion);
+	if (!converted) {
+		return ch;
+	}
+	const std::string_view sv(converted);
+	const Character character = DecodeAt(sv, 0, unicode);
+	return (static_cast<size_t>(character.width) == sv.length()) ? character.ch : ch;
+}
+
+int FoldCase(int ch, bool unicode) noexcept {
+	return ConvertCase(ch, unicode, CaseConversion::fold);
+}
+
+enum NamedClass : unsigned {
+	ncDigit = 1U << 0,
+	ncNotDigit = 1U << 1,
+	ncWord = 1U << 2,
+	ncNotWord = 1U << 3,
+	ncSpace = 1U << 4,
+	ncNotSpace = 1U << 5,
+	ncAlpha = 1U << 6,
+	ncAlnum = 1U << 7,
+	ncUpper = 1U << 8,
+	ncLower = 1U << 9,
+	ncPunct = 1U << 10,
+	ncXDigit = 1U << 11,
+	ncBlank = 1U << 12,
+	ncCntrl = 1U << 13,
+	ncPrint = 1U << 14,
+	ncGraph = 1U << 15,
+};
+
+bool InNamedClass(NamedClass nc, int ch, bool unicode) noexcept {
+	const CharacterCategory category = (unicode || ch < 0x80) ? CategoriseCharacter(ch) : ccCn;
+	switch (nc) {
+	case ncDigit:
+		return IsAsciiDigit(ch);
+	case ncNotDigit:
+		return !IsAsciiDigit(ch);
+	case ncWord:
+		return IsWordCharacter(ch, unicode);
+	case ncNotWord:
+		return !IsWordCharacter(ch, unicode);
+	case ncSpace:
+		return IsSpace(ch, unicode);
+	case ncNotSpace:
+		return !IsSpace(ch, unicode);
+	case ncAlpha:
+		return IsLetter(ch, unicode);
+	case ncAlnum:
+		return IsAlphaNumeric(ch, unicode);
+	case ncUpper:
+		return category == ccLu;
+	case ncLower:
+		return category == ccLl;
+	case ncPunct:
+		return category >= ccPc && category <= ccSo;
+	case ncXDigit:
+		return IsAsciiDigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+	case ncBlank:
+		return ch == '\t' || category == ccZs;
+	case ncCntrl:
+		return category == ccCc;
+	case ncPrint:
+		return category <= ccZs;
+	case ncGraph:
+		return category < ccZs;
+	}
+	return false;
+}
+
+class CharacterSet {
+	std::vector<std::pair<int, int>> ranges;
+	unsigned named = 0;
+	bool negated = false;
+	bool caseSensitive = true;
+	bool unicode = false;
+	// Membership of characters below 256 with case and negation applied.
+	std::array<uint64_t, 4> low {};
+
+	bool ContainsExactly(int ch) const noexcept {
+		for (const std::pair<int, int> &range : ranges) {
+			if (ch >= range.first && ch <= range.second) {
+				return true;
+			}
+		}
+		for (unsigned nc = named; nc; nc &= nc - 1) {
+			if (InNamedClass(static_cast<NamedClass>(nc & (~nc + 1)), ch, unicode)) {
+				return true;
+			}
+		}
+		return false;
+	}
+	bool ContainsSlow(int ch, int folded) const noexcept {
+		bool contained = ContainsExactly(ch);
+		if (!contained && !caseSensitive) {
+			contained = ContainsExactly(folded) || ContainsExactly(ConvertCase(ch, unicode, CaseConversion::upper));
+		}
+		return contained != negated;
+	}
+
+public:
+	CharacterSet(bool caseSensitive_, bool unicode_) noexcept : caseSensitive(caseSensitive_), unicode(unicode_) {
+	}
+	void Negate() noexcept {
+		negated = true;
+	}
+	void AddRange(int first, int last) {
+		ranges.emplace_back(first, last);
+	}
+	void AddNamed(NamedClass nc) noexcept {
+		// As with std::regex, case insensitive upper and lower match all letters.
+		if (!caseSensitive && (nc == ncUpper || nc == ncLower)) {
+			nc = ncAlpha;
+		}
+		named |= nc;
+	}
+	void Complete() noexcept {
+		for (int ch = 0; ch < 256; ch++) {
+			if (ContainsSlow(ch, FoldCase(ch, unicode))) {
+				low[ch >> 6] |= 1ULL << (ch & 63);
+			}
+		}
+	}
+	bool Contains(int ch, int folded) const noexcept {
+		if (ch < 256) {
+			return (low[ch >> 6] >> (ch & 63)) & 1;
+		}
+		return ContainsSlow(ch, folded);
+	}
+};
+
+struct Node {
+	enum class Kind { Char, Any, Set, Assert, Group, Concat, Alternate, Repeat };
+	Kind kind;
+	// Char: character, Set: index, Assert: Assertion, Group: number or -1 when not capturing.
+	int value = 0;
+	// Repeat bounds where max is -1 when unbounded.
+	int min = 0;
+	int max = 0;
+	bool greedy = true;
+	std::vector<std::unique_ptr<Node>> children;
+
+	explicit Node(Kind kind_, int value_=0) noexcept : kind(kind_), value(value_) {
+	}
+};
+
+using NodePtr = std::unique_ptr<Node>;
+
+NodePtr MakeNode(Node::Kind kind, int value=0) {
+	return std::make_unique<Node>(kind, value);
+}
+
+// Recursive descent parser for the ECMAScript grammar accepted by std::regex
+// without backreferences or lookahead.
+class Parser {
+	std::vector<int> pattern;
+	size_t position = 0;
+	bool caseSensitive;
+	bool unicode;
+
+	bool AtEnd() const noexcept {
+		return position >= pattern.size();
+	}
+	int Peek(size_t offset=0) const noexcept {
+		return (position + offset < pattern.size()) ? pattern[position + offset] : -1;
+	}
+	int Next() {
+		if (AtEnd()) {
+			throw Unsupported();
+		}
+		return pattern[position++];
+	}
+	int HexDigits(int count) {
+		int value = 0;
+		for (int i = 0; i < count; i++) {
+			const int ch = Next();
+			int digit = 0;
+			if (IsAsciiDigit(ch)) {
+				digit = ch - '0';
+			} else if (ch >= 'a' && ch <= 'f') {
+				digit = ch - 'a' + 10;
+			} else if (ch >= 'A' && ch <= 'F') {
+				digit = ch - 'A' + 10;
+			} else {
+				throw Unsupported();
+			}
+			value = value * 16 + digit;
+		}
+		return value;
+	}
+	int Decimal() {
+		if (!IsAsciiDigit(Peek())) {
+			throw Unsupported();
+		}
+		int value = 0;
+		while (IsAsciiDigit(Peek())) {
+			value = value * 10 + Next() - '0';
+			if (value > maxRepeat) {
+				throw Unsupported();
+			}
+		}
+		return value;
+	}
+	static NamedClass ClassEscape(int ch) noexcept {
+		switch (ch) {
+		case 'd': return ncDigit;
+		case 'D': return ncNotDigit;
+		case 'w': return ncWord;
+		case 'W': return ncNotWord;
+		case 's': return ncSpace;
+		case 'S': return ncNotSpace;
+		default: return static_cast<NamedClass>(0);
+		}
+	}
+	// Escapes that are the same inside and outside sets.
+	int CharacterEscape(int ch) {
+		switch (ch) {
+		case 'f': return '\f';
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+		case 'v': return '\v';
+		case 'c': {
+				const int letter = Next();
+				if (!IsAsciiUpper(letter) && !IsAsciiLower(letter)) {
+					throw Unsupported();
+				}
+				return letter % 32;
+			}
+		case 'x': return HexDigits(2);
+		case 'u': return HexDigits(4);
+		default:
+			// Backreferences, octal and unknown letter escapes are left to std::regex.
+			if (IsAlphaNumeric(ch, false)) {
+				throw Unsupported();
+			}
+			return ch;
+		}
+	}
+
+	int SetCharacter(CharacterSet &set, bool &isClass) {
+		isClass = false;
+		const int ch = Next();
+		if (ch == '\\') {
+			const int escaped = Next();
+			const NamedClass nc = ClassEscape(escaped);
+			if (nc) {
+				set.AddNamed(nc);
+				isClass = true;
+				return 0;
+			}
+			return (escaped == 'b') ? '\b' : CharacterEscape(escaped);
+		}
+		if (ch == '[' && (Peek() == '.' || Peek() == '=')) {
+			throw Unsupported();
+		}
+		if (ch == '[' && Peek() == ':') {
+			Next();
+			std::string name;
+			while (!(Peek() == ':' && Peek(1) == ']')) {
+				name.push_back(static_cast<char>(Next()));
+			}
+			position += 2;
+			static constexpr std::pair<std::string_view, NamedClass> names[] = {
+				{ "alnum", ncAlnum }, { "alpha", ncAlpha }, { "blank", ncBlank }, { "cntrl", ncCntrl },
+				{ "digit", ncDigit }, { "graph", ncGraph }, { "lower", ncLower }, { "print", ncPrint },
+				{ "punct", ncPunct }, { "space", ncSpace }, { "upper", ncUpper }, { "w", ncWord },
+				{ "xdigit", ncXDigit }, { "d", ncDigit }, { "s", ncSpace },
+			};
+			for (const auto &[className, nc] : names) {
+				if (name == className) {
+					set.AddNamed(nc);
+					isClass = true;
+					return 0;
+				}
+			}
+			throw Unsupported();
+		}
+		return ch;
+	}
+
+	NodePtr ParseSet(std::vector<CharacterSet> &sets) {
+		CharacterSet set(caseSensitive, unicode);
+		if (Peek() == '^') {
+			Next();
+			set.Negate();
+		}
+		if (Peek() == ']') {
+			// Empty sets are treated differently by std::regex implementations.
+			throw Unsupported();
+		}
+		while (Peek() != ']') {
+			bool isClass = false;
+			const int first = SetCharacter(set, isClass);
+			if (Peek() == '-' && Peek(1) != ']' && Peek(1) != -1) {
+				Next();
+				bool isClassLast = false;
+				const int last = SetCharacter(set, isClassLast);
+				if (isClass || isClassLast || last < first) {
+					throw Unsupported();
+				}
+				set.AddRange(first, last);
+			} else if (!isClass) {
+				set.AddRange(first, first);
+			}
+		}
+		Next();
+		set.Complete();
+		sets.push_back(std::move(set));
+		return MakeNode(Node::Kind::Set, static_cast<int>(sets.size() - 1));
+	}
+
+	NodePtr Literal(int ch) {
+		return MakeNode(Node::Kind::Char, caseSensitive ? ch : FoldCase(ch, unicode));
+	}
+
+	NodePtr NamedSet(NamedClass nc, std::vector<CharacterSet> &sets) {
+		CharacterSet set(caseSensitive, unicode);
+		set.AddNamed(nc);
+		set.Complete();
+		sets.push_back(std::move(set));
+		return MakeNode(Node::Kind::Set, static_cast<int>(sets.size() - 1));
+	}
+
+	NodePtr ParseAtom(std::vector<CharacterSet> &sets) {
+		const int ch = Next();
+		switch (ch) {
+		case '.':
+			return MakeNode(Node::Kind::Any);
+		case '[':
+			return ParseSet(sets);
+		case '(': {
+				int group = -1;
+				if (Peek() == '?') {
+					Next();
+					if (Next() != ':') {
+						// Lookahead
+						throw Unsupported();
+					}
+				} else {
+					group = ++groups;
+				}
+				NodePtr node = MakeNode(Node::Kind::Group, group);
+				node->children.push_back(ParseDisjunction(sets));
+				if (Next() != ')') {
+					throw Unsupported();
+				}
+				return node;
+			}
+		case '\\': {
+				const int escaped = Next();
+				const NamedClass nc = ClassEscape(escaped);
+				if (nc) {
+					return NamedSet(nc, sets);
+				}
+				return Literal(CharacterEscape(escaped));
+			}
+		case ')':
+		case ']':
+		case '{':
+		case '}':
+		case '*':
+		case '+':
+		case '?':
+			throw Unsupported();
+		default:
+			return Literal(ch);
+		}
+	}
+
+	NodePtr ParseQuantifier(NodePtr atom) {
+		int min = 0;
+		int max = -1;
+		switch (Peek()) {
+		case '*':
+			break;
+		case '+':
+			min = 1;
+			break;
+		case '?':
+			max = 1;
+			break;
+		case '{':
+			Next();
+			min = Decimal();
+			max = min;
+			if (Peek() == ',') {
+				Next();
+				max = (Peek() == '}') ? -1 : Decimal();
+			}
+			if (Peek() != '}' || (max >= 0 && max < min)) {
+				throw Unsupported();
+			}
+			break;
+		default:
+			return atom;
+		}
+		Next();
+		NodePtr node = MakeNode(Node::Kind::Repeat);
+		node->min = min;
+		node->max = max;
+		if (Peek() == '?') {
+			Next();
+			node->greedy = false;
+		}
+		const int following = Peek();
+		if (following == '*' || following == '+' || following == '?' || following == '{') {
+			throw Unsupported();
+		}
+		node->children.push_back(std::move(atom));
+		return node;
+	}
+
+	NodePtr ParseTerm(std::vector<CharacterSet> &sets) {
+		NodePtr assertion;
+		if (Peek() == '^') {
+			assertion = MakeNode(Node::Kind::Assert, static_cast<int>(Assertion::LineStart));
+		} else if (Peek() == '$') {
+			assertion = MakeNode(Node::Kind::Assert, static_cast<int>(Assertion::LineEnd));
+		} else if (Peek() == '\\' && Peek(1) == 'b') {
+			assertion = MakeNode(Node::Kind::Assert, static_cast<int>(Assertion::WordBoundary));
+		} else if (Peek() == '\\' && Peek(1) == 'B') {
+			assertion = MakeNode(Node::Kind::Assert, static_cast<int>(Assertion::NotWordBoundary));
+		}
+		if (assertion) {
+			position += (Peek() == '\\') ? 2 : 1;
+			const int following = Peek();
+			if (following == '*' || following == '+' || following == '?' || following == '{') {
+				throw Unsupported();
+			}
+			return assertion;
+		}
+		return ParseQuantifier(ParseAtom(sets));
+	}
+
+	NodePtr ParseAlternative(std::vector<CharacterSet> &sets) {
+		NodePtr node = MakeNode(Node::Kind::Concat);
+		while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+			node->children.push_back(ParseTerm(sets));
+		}
+		if (node->children.size() == 1) {
+			return std::move(node->children.front());
+		}
+		return node;
+	}
+
+public:
+	int groups = 0;
+
+	Parser(std::vector<int> &&pattern_, bool caseSensitive_, bool unicode_) noexcept :
+		pattern(std::move(pattern_)), caseSensitive(caseSensitive_), unicode(unicode_) {
+	}
+
+	NodePtr ParseDisjunction(std::vector<CharacterSet> &sets) {
+		NodePtr first = ParseAlternative(sets);
+		if (Peek() != '|') {
+			return first;
+		}
+		NodePtr node = MakeNode(Node::Kind::Alternate);
+		node->children.push_back(std::move(first));
+		while (Peek() == '|') {
+			Next();
+			node->children.push_back(ParseAlternative(sets));
+		}
+		return node;
+	}
+
+	NodePtr ParsePattern(std::vector<CharacterSet> &sets) {
+		NodePtr node = ParseDisjunction(sets);
+		if (!AtEnd()) {
+			// Unbalanced ')'
+			throw Unsupported();
+		}
+		return node;
+	}
+};
+
+// Ordered set of program counters that can be cleared in constant time.
+class SparseSet {
+	std::vector<int> sparse;
+public:
+	std::vector<int> dense;
+	size_t count = 0;
+
+	void Resize(size_t size) {
+		sparse.assign(size, 0);
+		dense.assign(size, 0);
+		count = 0;
+	}
+	bool Contains(int pc) const noexcept {
+		const size_t index = sparse[pc];
+		return index < count && dense[index] == pc;
+	}
+	size_t Insert(int pc) noexcept {
+		sparse[pc] = static_cast<int>(count);
+		dense[count] = pc;
+		return count++;
+	}
+	void Clear() noexcept {
+		count = 0;
+	}
+};
+
+struct ThreadList {
+	SparseSet pcs;
+	// Group slots for each entry in pcs.
+	std::vector<ptrdiff_t> slots;
+};
+
+struct DfaState {
+	// Consuming and matching instructions reached, sorted.
+	std::vector<int> pcs;
+	bool accepting = false;
+	// Transitions for characters below 256, -1 when not yet built.
+	std::array<int, 256> next;
+	explicit DfaState(std::vector<int> &&pcs_, bool accepting_) noexcept : pcs(std::move(pcs_)), accepting(accepting_) {
+		next.fill(-1);
+	}
+};
+
+}
+
+namespace Scintilla::Internal {
+
+struct RegexProgram {
+	std::vector<Instruction> instructions;
+	std::vector<CharacterSet> sets;
+	bool caseSensitive = true;
+	bool unicode = false;
+	size_t slotCount = 2;
+	// Text every match starts with, in the encoding of the document.
+	std::string prefix;
+
+	// Pike VM state
+	ThreadList current;
+	ThreadList following;
+	std::vector<ptrdiff_t> work;
+	std::vector<std::pair<int, ptrdiff_t>> stack;
+
+	// Lazy DFA state
+	std::vector<std::unique_ptr<DfaState>> dfaStates;
+	std::map<std::vector<int>, int> dfaIndex;
+	std::unordered_map<uint64_t, int> dfaWideNext;
+	int dfaStart = -1;
+	SparseSet closure;
+	std::vector<int> closureStack;
+
+	size_t Emit(Op op, int x=0, int y=0) {
+		if (instructions.size() >= maxInstructions) {
+			throw Unsupported();
+		}
+		instructions.push_back({ op, x, y });
+		return instructions.size() - 1;
+	}
+	void Generate(const Node &node);
+	void FindPrefix(const Node &node);
+	void Prepare();
+
+	bool Consumes(const Instruction &instruction, int ch, int folded) const noexcept;
+	bool AssertionHolds(Assertion assertion, std::string_view line, size_t position) const noexcept;
+	void AddThread(ThreadList &list, int pc, std::string_view line, size_t position);
+	bool Simulate(std::string_view line, size_t start, size_t end, LinearRegex::Groups &groups);
+
+	void AddClosure(int pc);
+	int Intern(std::vector<int> &&pcs);
+	int Transition(int state, int ch, int folded);
+	bool MayMatch(std::string_view line, size_t start, size_t end);
+
+	bool Search(std::string_view line, size_t start, size_t end, LinearRegex::Groups &groups);
+};
+
+}
+
+void RegexProgram::Generate(const Node &node) {
+	switch (node.kind) {
+	case Node::Kind::Char:
+		Emit(Op::Char, node.value);
+		break;
+	case Node::Kind::Any:
+		Emit(Op::Any);
+		break;
+	case Node::Kind::Set:
+		Emit(Op::Set, node.value);
+		break;
+	case Node::Kind::Assert:
+		Emit(Op::Assert, node.value);
+		break;
+	case Node::Kind::Group:
+		if (node.value >= 0 && static_cast<size_t>(node.value) < LinearRegex::maxGroups) {
+			Emit(Op::Save, node.value * 2);
+			Generate(*node.children.front());
+			Emit(Op::Save, node.value * 2 + 1);
+		} else {
+			Generate(*node.children.front());
+		}
+		break;
+	case Node::Kind::Concat:
+		for (const NodePtr &child : node.children) {
+			Generate(*child);
+		}
+		break;
+	case Node::Kind::Alternate: {
+			std::vector<size_t> jumps;
+			for (size_t i = 0; i < node.children.size(); i++) {
+				if (i + 1 < node.children.size()) {
+					const size_t split = Emit(Op::Split, static_cast<int>(instructions.size() + 1));
+					Generate(*node.children[i]);
+					jumps.push_back(Emit(Op::Jump));
+					instructions[split].y = static_cast<int>(instructions.size());
+				} else {
+					Generate(*node.children[i]);
+				}
+			}
+			for (const size_t jump : jumps) {
+				instructions[jump].x = static_cast<int>(instructions.size());
+			}
+		}
+		break;
+	case Node::Kind::Repeat: {
+			const Node &child = *node.children.front();
+			for (int i = 0; i < node.min; i++) {
+				Generate(child);
+			}
+			// Split to the body or past it with the preferred branch first.
+			auto branch = [this, &node](size_t split, size_t body, size_t exit) noexcept {
+				instructions[split].x = static_cast<int>(node.greedy ? body : exit);
+				instructions[split].y = static_cast<int>(node.greedy ? exit : body);
+			};
+			if (node.max < 0) {
+				const size_t split = Emit(Op::Split);
+				Generate(child);
+				Emit(Op::Jump, static_cast<int>(split));
+				branch(split, split + 1, instructions.size());
+			} else {
+				std::vector<size_t> splits;
+				for (int i = node.min; i < node.max; i++) {
+					splits.push_back(Emit(Op::Split));
+					Generate(child);
+				}
+				for (const size_t split : splits) {
+					branch(split, split + 1, instructions.size());
+				}
+			}
+		}
+		break;
+	}
+}
+
+void RegexProgram::FindPrefix(const Node &node) {
+	// Only needed for case sensitive patterns as the prefix is matched exactly.
+	if (!caseSensitive) {
+		return;
+	}
+	const Node *sequence = &node;
+	while (sequence->kind == Node::Kind::Group) {
+		sequence = sequence->children.front().get();
+	}
+	std::vector<const Node *> items;
+	if (sequence->kind == Node::Kind::Concat) {
+		for (const NodePtr &child : sequence->children) {
+			items.push_back(child.get());
+		}
+	} else {
+		items.push_back(sequence);
+	}
+	for (const Node *item : items) {
+		if (item->kind == Node::Kind::Assert) {
+			continue;
+		}
+		if (item->kind != Node::Kind::Char || item->value == 0) {
+			break;
+		}
+		if (unicode) {
+			char bytes[UTF8MaxBytes + 1] {};
+			UTF8FromUTF32Character(item->value, bytes);
+			prefix.append(bytes);
+		} else {
+			prefix.push_back(static_cast<char>(item->value));
+		}
+	}
+}
+
+void RegexProgram::Prepare() {
+	current.pcs.Resize(instructions.size());
+	following.pcs.Resize(instructions.size());
+	current.slots.assign(instructions.size() * slotCount, -1);
+	following.slots.assign(instructions.size() * slotCount, -1);
+	work.assign(slotCount, -1);
+	closure.Resize(instructions.size());
+}
+
+bool RegexProgram::Consumes(const Instruction &instruction, int ch, int folded) const noexcept {
+	switch (instruction.op) {
+	case Op::Char:
+		return instruction.x == (caseSensitive ? ch : folded);
+	case Op::Any:
+		return ch != '\n' && ch != '\r' && ch != 0x2028 && ch != 0x2029;
+	case Op::Set:
+		return sets[instruction.x].Contains(ch, folded);
+	default:
+		return false;
+	}
+}
+
+bool RegexProgram::AssertionHolds(Assertion assertion, std::string_view line, size_t position) const noexcept {
+	switch (assertion) {
+	case Assertion::LineStart:
+		return position == 0;
+	case Assertion::LineEnd:
+		return position == line.length();
+	default: {
+			const bool wordBefore = (position > 0) && IsWordCharacter(DecodeBefore(line, position, unicode).ch, unicode);
+			const bool wordAfter = (position < line.length()) && IsWordCharacter(DecodeAt(line, position, unicode).ch, unicode);
+			return (wordBefore != wordAfter) == (assertion == Assertion::WordBoundary);
+		}
+	}
+}
+
+// Follow the empty transitions from pc, adding each thread in priority order with the
+// group slots in work. A negative pc on the stack restores a slot when a branch is done.
+void RegexProgram::AddThread(ThreadList &list, int pc, std::string_view line, size_t position) {
+	stack.clear();
+	stack.emplace_back(pc, 0);
+	while (!stack.empty()) {
+		const std::pair<int, ptrdiff_t> entry = stack.back();
+		stack.pop_back();
+		if (entry.first < 0) {
+			work[-entry.first - 1] = entry.second;
+			continue;
+		}
+		for (int pcThread = entry.first; !list.pcs.Contains(pcThread);) {
+			const size_t index = list.pcs.Insert(pcThread);
+			const Instruction &instruction = instructions[pcThread];
+			if (instruction.op == Op::Jump) {
+				pcThread = instruction.x;
+			} else if (instruction.op == Op::Split) {
+				stack.emplace_back(instruction.y, 0);
+				pcThread = instruction.x;
+			} else if (instruction.op == Op::Save) {
+				if (static_cast<size_t>(instruction.x) < slotCount) {
+					stack.emplace_back(-instruction.x - 1, work[instruction.x]);
+					work[instruction.x] = position;
+				}
+				pcThread++;
+			} else if (instruction.op == Op::Assert) {
+				if (!AssertionHolds(static_cast<Assertion>(instruction.x), line, position)) {
+					break;
+				}
+				pcThread++;
+			} else {
+				std::copy(work.begin(), work.end(), list.slots.begin() + index * slotCount);
+				break;
+			}
+		}
+	}
+}
+
+bool RegexProgram::Simulate(std::string_view line, size_t start, size_t end, LinearRegex::Groups &groups) {
+	current.pcs.Clear();
+	bool matched = false;
+	size_t position = start;
+	for (;;) {
+		if (!matched && position <= end) {
+			if ((current.pcs.count == 0) && !prefix.empty()) {
+				const size_t found = SearchForward(line.substr(position, end - position), prefix);
+				if (found == std::string_view::npos) {
+					break;
+				}
+				position += found;
+			}
+			std::fill(work.begin(), work.end(), -1);
+			AddThread(current, 0, line, position);
+		}
+		if (current.pcs.count == 0) {
+			break;
+		}
+		const bool atEnd = position >= end;
+		const Character character = atEnd ? Character { -1, 0 } : DecodeAt(line, position, unicode);
+		const int folded = (caseSensitive || atEnd) ? character.ch : FoldCase(character.ch, unicode);
+		following.pcs.Clear();
+		for (size_t i = 0; i < current.pcs.count; i++) {
+			const int pc = current.pcs.dense[i];
+			const Instruction &instruction = instructions[pc];
+			const auto slots = current.slots.begin() + i * slotCount;
+			if (instruction.op == Op::Match) {
+				matched = true;
+				groups.fill(-1);
+				std::copy(slots, slots + slotCount, groups.begin());
+				// Threads after this have lower priority.
+				break;
+			}
+			if (!atEnd && Consumes(instruction, character.ch, folded)) {
+				std::copy(slots, slots + slotCount, work.begin());
+				AddThread(following, pc + 1, line, position + character.width);
+			}
+		}
+		if (atEnd) {
+			break;
+		}
+		std::swap(current, following);
+		position += character.width;
+	}
+	return matched;
+}
+
+void RegexProgram::AddClosure(int pc) {
+	closureStack.clear();
+	closureStack.push_back(pc);
+	while (!closureStack.empty()) {
+		int pcClosure = closureStack.back();
+		closureStack.pop_back();
+		while (!closure.Contains(pcClosure)) {
+			closure.Insert(pcClosure);
+			const Instruction &instruction = instructions[pcClosure];
+			if (instruction.op == Op::Jump) {
+				pcClosure = instruction.x;
+			} else if (instruction.op == Op::Split) {
+				closureStack.push_back(instruction.y);
+				pcClosure = instruction.x;
+			} else if (instruction.op == Op::Save || instruction.op == Op::Assert) {
+				pcClosure++;
+			}
+		}
+	}
+}
+
+int RegexProgram::Intern(std::vector<int> &&pcs) {
+	const auto it = dfaIndex.find(pcs);
+	if (it != dfaIndex.end()) {
+		return it->second;
+	}
+	bool accepting = false;
+	for (const int pc : pcs) {
+		accepting = accepting || (instructions[pc].op == Op::Match);
+	}
+	const int state = static_cast<int>(dfaStates.size());
+	dfaIndex[pcs] = state;
+	dfaStates.push_back(std::make_unique<DfaState>(std::move(pcs), accepting));
+	return state;
+}
+
+int RegexProgram::Transition(int state, int ch, int folded) {
+	closure.Clear();
+	for (const int pc : dfaStates[state]->pcs) {
+		if (Consumes(instructions[pc], ch, folded)) {
+			AddClosure(pc + 1);
+		}
+	}
+	// Unanchored so a match may also start after this character.
+	AddClosure(0);
+	std::vector<int> pcs;
+	for (size_t i = 0; i < closure.count; i++) {
+		const int pc = closure.dense[i];
+		const Op op = instructions[pc].op;
+		if (op == Op::Char || op == Op::Any || op == Op::Set || op == Op::Match) {
+			pcs.push_back(pc);
+		}
+	}
+	std::sort(pcs.begin(), pcs.end());
+	return Intern(std::move(pcs));
+}
+
+// Returns false when no match can end inside [start, end).
+// Assertions are treated as true so this may return true when there is no match.
+bool RegexProgram::MayMatch(std::string_view line, size_t start, size_t end) {
+	if (dfaStart < 0) {
+		closure.Clear();
+		AddClosure(0);
+		std::vector<int> pcs;
+		for (size_t i = 0; i < closure.count; i++) {
+			const Op op = instructions[closure.dense[i]].op;
+			if (op == Op::Char || op == Op::Any || op == Op::Set || op == Op::Match) {
+				pcs.push_back(closure.dense[i]);
+			}
+		}
+		std::sort(pcs.begin(), pcs.end());
+		dfaStart = Intern(std::move(pcs));
+	}
+	int state = dfaStart;
+	size_t position = start;
+	while (!dfaStates[state]->accepting && position < end) {
+		if (dfaStates.size() >= maxDfaStates) {
+			std::vector<int> pcs = dfaStates[state]->pcs;
+			dfaStates.clear();
+			dfaIndex.clear();
+			dfaWideNext.clear();
+			dfaStart = -1;
+			state = Intern(std::move(pcs));
+		}
+		const unsigned char lead = line[position];
+		if (!unicode || UTF8IsAscii(lead)) {
+			int next = dfaStates[state]->next[lead];
+			if (next < 0) {
+				next = Transition(state, lead, FoldCase(lead, unicode));
+				dfaStates[state]->next[lead] = next;
+			}
+			state = next;
+			position++;
+		} else {
+			const Character character = DecodeAt(line, position, unicode);
+			const uint64_t key = (static_cast<uint64_t>(state) << 32) | static_cast<uint32_t>(character.ch);
+			const auto it = dfaWideNext.find(key);
+			if (it != dfaWideNext.end()) {
+				state = it->second;
+			} else {
+				const int next = Transition(state, character.ch, caseSensitive ? character.ch : FoldCase(character.ch, unicode));
+				dfaWideNext[key] = next;
+				state = next;
+			}
+			position += character.width;
+		}
+	}
+	return dfaStates[state]->accepting;
+}
+
+bool RegexProgram::Search(std::string_view line, size_t start, size_t end, LinearRegex::Groups &groups) {
+	if (!prefix.empty()) {
+		const size_t found = SearchForward(line.substr(start, end - start), prefix);
+		if (found == std::string_view::npos) {
+			return false;
+		}
+		start += found;
+	}
+	if (!MayMatch(line, start, end)) {
+		return false;
+	}
+	return Simulate(line, start, end, groups);
+}
+
+LinearRegex::LinearRegex(std::unique_ptr<RegexProgram> &&program_) noexcept : program(std::move(program_)) {
+}
+
+LinearRegex::~LinearRegex() = default;
+
+std::unique_ptr<LinearRegex> LinearRegex::Compile(std::string_view pattern, bool caseSensitive, bool unicode) {
+	std::vector<int> characters;
+	for (size_t i = 0; i < pattern.length();) {
+		const Character character = DecodeAt(pattern, i, unicode);
+		if (character.ch == replacementCharacter && character.width == 1 && unicode) {
+			return {};
+		}
+		characters.push_back(character.ch);
+		i += character.width;
+	}
+	try {
+		std::unique_ptr<RegexProgram> program = std::make_unique<RegexProgram>();
+		program->caseSensitive = caseSensitive;
+		program->unicode = unicode;
+		Parser parser(std::move(characters), caseSensitive, unicode);
+		const NodePtr root = parser.ParsePattern(program->sets);
+		program->slotCount = std::min<size_t>(parser.groups + 1, maxGroups) * 2;
+		program->Emit(Op::Save, 0);
+		program->Generate(*root);
+		program->Emit(Op::Save, 1);
+		program->Emit(Op::Match);
+		program->FindPrefix(*root);
+		program->Prepare();
+		return std::make_unique<LinearRegex>(std::move(program));
+	} catch (const Unsupported &) {
+		return {};
+	}
+}
+
+bool LinearRegex::Find(std::string_view line, size_t start, size_t end, bool backwards, Groups &groups) {
+	if (!program->Search(line, start, end, groups)) {
+		return false;
+	}
+	if (backwards) {
+		// Continue after each match as std::regex_iterator does, keeping the last.
+		Groups later {};
+		for (;;) {
+			size_t next = groups[1];
+			if (groups[1] == groups[0]) {
+				if (next >= end) {
+					break;
+				}
+				next += DecodeAt(line, next, program->unicode).width;
+			}
+			if (next > end || !program->Search(line, next, end, later)) {
+				break;
+			}
+			groups = later;
+		}
+	}
+	return true;
+}
+
+std::string_view LinearRegex::Prefix() const noexcept {
+	return program->prefix;
+}
+
+LinearRegex *LinearRegexCache::Get(std::string_view pattern, bool caseSensitive, bool unicode) {
+	const auto it = std::find_if(entries.begin(), entries.end(), [=](const Entry &entry) noexcept {
+		return entry.pattern == pattern && entry.caseSensitive == caseSensitive && entry.unicode == unicode;
+	});
+	if (it != entries.end()) {
+		std::rotate(it, it + 1, entries.end());
+		return entries.back().regex.get();
+	}
+	if (entries.size() >= maxEntries) {
+		entries.erase(entries.begin());
+	}
+	entries.push_back({ std::string(pattern), caseSensitive, unicode, LinearRegex::Compile(pattern, caseSensitive, unicode) });
+	return entries.back().regex.get();
+}
@@ -0,0 +1,68 @@
+// Scintilla source code edit control
+/** @file LinearRegex.h
+ ** Regular expression search in time linear in the length of the text.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef LINEARREGEX_H
+#define LINEARREGEX_H
+
+namespace Scintilla::Internal {
+
+struct RegexProgram;
+
+/**
+ * A compiled ECMAScript regular expression that is matched by simulating its Thompson NFA,
+ * so search time never grows exponentially with the pattern as with backtracking.
+ * Patterns using backreferences, lookahead or syntax that is not understood do not compile
+ * so the caller can fall back to a more complete engine that also reports errors.
+ */
+class LinearRegex {
+	std::unique_ptr<RegexProgram> program;
+public:
+	static constexpr size_t maxGroups = 10;
+	/// Start and end of the match then each group, -1 for groups that did not participate.
+	using Groups = std::array<ptrdiff_t, maxGroups * 2>;
+
+	explicit LinearRegex(std::unique_ptr<RegexProgram> &&program_) noexcept;
+	// Deleted so LinearRegex objects can not be copied.
+	LinearRegex(const LinearRegex &) = delete;
+	LinearRegex(LinearRegex &&) = delete;
+	LinearRegex &operator=(const LinearRegex &) = delete;
+	LinearRegex &operator=(LinearRegex &&) = delete;
+	~LinearRegex();
+
+	/// Returns nullptr when the pattern is invalid or uses features not supported.
+	/// With unicode the pattern and text are UTF-8, otherwise each byte is a character.
+	static std::unique_ptr<LinearRegex> Compile(std::string_view pattern, bool caseSensitive, bool unicode);
+
+	/// Find the first match, or the last non-overlapping match when backwards, inside [start, end) of line.
+	/// The rest of line is context for assertions so ^ and $ only match at the ends of line.
+	bool Find(std::string_view line, size_t start, size_t end, bool backwards, Groups &groups);
+
+	/// Text that every match starts with. Empty for case insensitive patterns.
+	[[nodiscard]] std::string_view Prefix() const noexcept;
+};
+
+/**
+ * Recently compiled patterns, including those that failed to compile, so repeated searches
+ * do not parse and compile again.
+ */
+class LinearRegexCache {
+	struct Entry {
+		std::string pattern;
+		bool caseSensitive;
+		bool unicode;
+		std::unique_ptr<LinearRegex> regex;
+	};
+	// Least recently used first.
+	std::vector<Entry> entries;
+public:
+	static constexpr size_t maxEntries = 8;
+	/// Returns nullptr when the pattern can not be compiled.
+	LinearRegex *Get(std::string_view pattern, bool caseSensitive, bool unicode);
+};
+
+}
+
+#endif
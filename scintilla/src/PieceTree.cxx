@@ -0,0 +1,348 @@
+// Scintilla source code edit control
+/** @file PieceTree.cxx
+ ** Text storage as a persistent balanced tree of pieces.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <string_view>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "Position.h"
+#include "PieceTree.h"
+
+namespace Scintilla::Internal {
+
+// Text is only ever appended to a chunk, so bytes below a tree's appendUsed never change
+// and may be read by any snapshot without locking.
+struct PieceChunk {
+	std::unique_ptr<char[]> data;
+	size_t capacity;
+	std::atomic<size_t> used;
+	explicit PieceChunk(size_t capacity_) :
+		data(std::make_unique<char[]>(capacity_ + 1)), capacity(capacity_), used(0) {
+		// Terminate so a piece that fills the chunk can be returned by BufferPointer
+		data[capacity] = '\0';
+	}
+};
+
+struct PieceNode {
+	std::shared_ptr<PieceChunk> chunk;
+	const char *text;
+	Sci::Position length;
+	Sci::Position total;	// Length of all pieces in this subtree
+	size_t count;			// Number of pieces in this subtree
+	uint32_t priority;
+	std::shared_ptr<const PieceNode> left;
+	std::shared_ptr<const PieceNode> right;
+};
+
+namespace {
+
+using NodePtr = std::shared_ptr<const PieceNode>;
+
+// Small inserts share chunks of this size; larger ones get a chunk of their own
+constexpr size_t chunkSize = 0x10000;
+
+Sci::Position Total(const NodePtr &node) noexcept {
+	return node ? node->total : 0;
+}
+
+size_t Count(const NodePtr &node) noexcept {
+	return node ? node->count : 0;
+}
+
+NodePtr MakeNode(const std::shared_ptr<PieceChunk> &chunk, const char *text, Sci::Position length,
+	uint32_t priority, NodePtr left, NodePtr right) {
+	const Sci::Position total = Total(left) + length + Total(right);
+	const size_t count = Count(left) + 1 + Count(right);
+	return std::make_shared<const PieceNode>(PieceNode{ chunk, text, length, total, count, priority, std::move(left), std::move(right) });
+}
+
+// Copy of node with different children
+NodePtr WithChildren(const PieceNode &node, NodePtr left, NodePtr right) {
+	return MakeNode(node.chunk, node.text, node.length, node.priority, std::move(left), std::move(right));
+}
+
+// Divide into the first position bytes and the rest, splitting a piece if needed
+std::pair<NodePtr, NodePtr> Split(const NodePtr &node, Sci::Position position) {
+	if (!node || position <= 0) {
+		return { NodePtr(), node };
+	}
+	if (position >= node->total) {
+		return { node, NodePtr() };
+	}
+	const Sci::Position leftTotal = Total(node->left);
+	if (position <= leftTotal) {
+		std::pair<NodePtr, NodePtr> parts = Split(node->left, position);
+		return { std::move(parts.first), WithChildren(*node, std::move(parts.second), node->right) };
+	}
+	const Sci::Position pieceEnd = leftTotal + node->length;
+	if (position >= pieceEnd) {
+		std::pair<NodePtr, NodePtr> parts = Split(node->right, position - pieceEnd);
+		return { WithChildren(*node, node->left, std::move(parts.first)), std::move(parts.second) };
+	}
+	// Both halves keep the priority, which remains at least that of their children.
+	const Sci::Position offset = position - leftTotal;
+	return {
+		MakeNode(node->chunk, node->text, offset, node->priority, node->left, NodePtr()),
+		MakeNode(node->chunk, node->text + offset, node->length - offset, node->priority, NodePtr(), node->right)
+	};
+}
+
+NodePtr Merge(const NodePtr &a, const NodePtr &b) {
+	if (!a) {
+		return b;
+	}
+	if (!b) {
+		return a;
+	}
+	if (a->priority >= b->priority) {
+		return WithChildren(*a, a->left, Merge(a->right, b));
+	}
+	return WithChildren(*b, Merge(a, b->left), b->right);
+}
+
+// Find the piece containing position, returning it with its start position
+const PieceNode *Locate(const PieceNode *node, Sci::Position position, Sci::Position &start) noexcept {
+	start = 0;
+	while (node) {
+		const Sci::Position leftTotal = Total(node->left);
+		if (position < leftTotal) {
+			node = node->left.get();
+		} else if (position < leftTotal + node->length) {
+			start += leftTotal;
+			return node;
+		} else {
+			start += leftTotal + node->length;
+			position -= leftTotal + node->length;
+			node = node->right.get();
+		}
+	}
+	return nullptr;
+}
+
+void Collect(const PieceNode *node, Sci::Position position, Sci::Position length, char *buffer) noexcept {
+	// Copy [position, position+length) of the subtree, position relative to the subtree
+	while (node && length > 0) {
+		const Sci::Position leftTotal = Total(node->left);
+		if (position < leftTotal) {
+			const Sci::Position fromLeft = std::min(length, leftTotal - position);
+			Collect(node->left.get(), position, fromLeft, buffer);
+			buffer += fromLeft;
+			length -= fromLeft;
+			position = leftTotal;
+		}
+		if (length <= 0) {
+			return;
+		}
+		const Sci::Position offset = position - leftTotal;
+		if (offset < node->length) {
+			const Sci::Position fromPiece = std::min(length, node->length - offset);
+			memcpy(buffer, node->text + offset, fromPiece);
+			buffer += fromPiece;
+			length -= fromPiece;
+			position += fromPiece;
+		}
+		// Continue into the right subtree without recursing
+		position -= leftTotal + node->length;
+		node = node->right.get();
+	}
+}
+
+// Lengthen the piece ending at position by extra bytes that follow it in its chunk
+NodePtr Extend(const NodePtr &node, Sci::Position position, Sci::Position extra) {
+	const Sci::Position leftTotal = Total(node->left);
+	const Sci::Position pieceEnd = leftTotal + node->length;
+	if (position < pieceEnd) {
+		return WithChildren(*node, Extend(node->left, position, extra), node->right);
+	}
+	if (position > pieceEnd) {
+		return WithChildren(*node, node->left, Extend(node->right, position - pieceEnd, extra));
+	}
+	return MakeNode(node->chunk, node->text, node->length + extra, node->priority, node->left, node->right);
+}
+
+}
+
+PieceTree::PieceTree() noexcept = default;
+PieceTree::PieceTree(const PieceTree &other) noexcept = default;
+PieceTree::PieceTree(PieceTree &&) noexcept = default;
+PieceTree &PieceTree::operator=(const PieceTree &other) noexcept = default;
+PieceTree &PieceTree::operator=(PieceTree &&) noexcept = default;
+PieceTree::~PieceTree() noexcept = default;
+
+uint32_t PieceTree::NextPriority() noexcept {
+	// xorshift32
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+Sci::Position PieceTree::Length() const noexcept {
+	return Total(root);
+}
+
+size_t PieceTree::Pieces() const noexcept {
+	return Count(root);
+}
+
+char PieceTree::CharAtSlow(Sci::Position position) const noexcept {
+	Sci::Position start = 0;
+	const PieceNode *node = Locate(root.get(), position, start);
+	if (!node) {
+		return 0;
+	}
+	cacheStart = start;
+	cacheEnd = start + node->length;
+	cacheText = node->text;
+	return node->text[position - start];
+}
+
+void PieceTree::GetRange(char *buffer, Sci::Position position, Sci::Position retrieveLength) const noexcept {
+	Collect(root.get(), position, retrieveLength, buffer);
+}
+
+std::string_view PieceTree::SegmentAt(Sci::Position position, Sci::Position &segmentStart) const noexcept {
+	const PieceNode *node = Locate(root.get(), position, segmentStart);
+	if (!node) {
+		segmentStart = Length();
+		return {};
+	}
+	return std::string_view(node->text, node->length);
+}
+
+// Copy text into a chunk and make a piece for it, not yet in the tree
+NodePtr PieceTree::NewPiece(const char *s, Sci::Position insertLength) {
+	const size_t length = insertLength;
+	if (appendChunk && (appendUsed + length <= appendChunk->capacity)) {
+		size_t expected = appendUsed;
+		if (appendChunk->used.compare_exchange_strong(expected, appendUsed + length)) {
+			char *text = appendChunk->data.get() + appendUsed;
+			memcpy(text, s, length);
+			appendUsed += length;
+			return MakeNode(appendChunk, text, insertLength, NextPriority(), NodePtr(), NodePtr());
+		}
+	}
+	if (length > chunkSize / 4) {
+		std::shared_ptr<PieceChunk> chunk = std::make_shared<PieceChunk>(length);
+		chunk->used = length;
+		memcpy(chunk->data.get(), s, length);
+		return MakeNode(chunk, chunk->data.get(), insertLength, NextPriority(), NodePtr(), NodePtr());
+	}
+	appendChunk = std::make_shared<PieceChunk>(chunkSize);
+	appendChunk->used = length;
+	appendUsed = length;
+	memcpy(appendChunk->data.get(), s, length);
+	return MakeNode(appendChunk, appendChunk->data.get(), insertLength, NextPriority(), NodePtr(), NodePtr());
+}
+
+// When the piece before position ends where this tree appends, grow it in place
+bool PieceTree::ExtendPiece(Sci::Position position, const char *s, Sci::Position insertLength) {
+	if (!appendChunk || position == 0 || (appendUsed + insertLength > appendChunk->capacity)) {
+		return false;
+	}
+	Sci::Position start = 0;
+	const PieceNode *node = Locate(root.get(), position - 1, start);
+	if (!node || (node->chunk != appendChunk) ||
+		(start + node->length != position) ||
+		(node->text + node->length != appendChunk->data.get() + appendUsed)) {
+		return false;
+	}
+	size_t expected = appendUsed;
+	if (!appendChunk->used.compare_exchange_strong(expected, appendUsed + insertLength)) {
+		// Another copy of this tree has appended to the chunk
+		return false;
+	}
+	memcpy(appendChunk->data.get() + appendUsed, s, insertLength);
+	appendUsed += insertLength;
+	root = Extend(root, position, insertLength);
+	return true;
+}
+
+void PieceTree::Insert(Sci::Position position, const char *s, Sci::Position insertLength) {
+	if (insertLength <= 0 || position < 0 || position > Length()) {
+		return;
+	}
+	Invalidate();
+	if (ExtendPiece(position, s, insertLength)) {
+		return;
+	}
+	NodePtr piece = NewPiece(s, insertLength);
+	std::pair<NodePtr, NodePtr> parts = Split(root, position);
+	root = Merge(Merge(parts.first, piece), parts.second);
+}
+
+void PieceTree::Delete(Sci::Position position, Sci::Position deleteLength) {
+	if (deleteLength <= 0 || position < 0 || position + deleteLength > Length()) {
+		return;
+	}
+	Invalidate();
+	std::pair<NodePtr, NodePtr> before = Split(root, position);
+	std::pair<NodePtr, NodePtr> after = Split(before.second, deleteLength);
+	root = Merge(before.first, after.second);
+}
+
+void PieceTree::Reserve(Sci::Position size) {
+	const Sci::Position extra = size - Length();
+	if (extra <= static_cast<Sci::Position>(chunkSize)) {
+		return;
+	}
+	if (appendChunk && (appendChunk->capacity - appendUsed >= static_cast<size_t>(extra))) {
+		return;
+	}
+	appendChunk = std::make_shared<PieceChunk>(extra);
+	appendUsed = 0;
+}
+
+void PieceTree::ReplaceWithPiece(Sci::Position position, Sci::Position rangeLength, NodePtr piece) {
+	Invalidate();
+	std::pair<NodePtr, NodePtr> before = Split(root, position);
+	std::pair<NodePtr, NodePtr> after = Split(before.second, rangeLength);
+	root = Merge(Merge(before.first, piece), after.second);
+}
+
+const char *PieceTree::RangePointer(Sci::Position position, Sci::Position rangeLength) {
+	if (position < 0 || rangeLength < 0 || position + rangeLength > Length()) {
+		return nullptr;
+	}
+	Sci::Position start = 0;
+	const PieceNode *node = Locate(root.get(), position, start);
+	if (!node || (position + rangeLength <= start + node->length)) {
+		return node ? node->text + (position - start) : "";
+	}
+	// Merge the range into one piece in a chunk of its own
+	std::shared_ptr<PieceChunk> chunk = std::make_shared<PieceChunk>(rangeLength);
+	chunk->used = rangeLength;
+	GetRange(chunk->data.get(), position, rangeLength);
+	ReplaceWithPiece(position, rangeLength,
+		MakeNode(chunk, chunk->data.get(), rangeLength, NextPriority(), NodePtr(), NodePtr()));
+	return chunk->data.get();
+}
+
+const char *PieceTree::BufferPointer() {
+	if (!root) {
+		return "";
+	}
+	if (!root->left && !root->right &&
+		(root->text + root->length == root->chunk->data.get() + root->chunk->capacity)) {
+		// Single piece that ends its chunk so is followed by the terminating NUL
+		return root->text;
+	}
+	const Sci::Position length = Length();
+	std::shared_ptr<PieceChunk> chunk = std::make_shared<PieceChunk>(length);
+	chunk->used = length;
+	GetRange(chunk->data.get(), 0, length);
+	Invalidate();
+	root = MakeNode(chunk, chunk->data.get(), length, NextPriority(), NodePtr(), NodePtr());
+	return chunk->data.get();
+}
+
+}
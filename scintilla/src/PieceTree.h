@@ -0,0 +1,83 @@
+// Scintilla source code edit control
+/** @file PieceTree.h
+ ** Text storage as a persistent balanced tree of pieces.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef PIECETREE_H
+#define PIECETREE_H
+
+namespace Scintilla::Internal {
+
+struct PieceChunk;
+struct PieceNode;
+
+/**
+ * Holds text as a sequence of pieces, each a run of bytes in an immutable chunk,
+ * kept in a treap ordered by position with subtree lengths.
+ * Insertion and deletion anywhere are O(log n) and copy only the nodes on the path
+ * to the change, so copying a PieceTree is O(1) and gives an independent snapshot
+ * that shares all unchanged nodes and text with the original.
+ * Typing is appended to a shared chunk and extends the previous piece in place.
+ */
+class PieceTree {
+	std::shared_ptr<const PieceNode> root;
+	// Chunk that new text is appended to and how much of it this tree has used.
+	// Other copies may append to the same chunk so space is claimed atomically.
+	std::shared_ptr<PieceChunk> appendChunk;
+	size_t appendUsed = 0;
+	uint32_t seed = 0x9E3779B9U;
+	// Piece found by the last lookup, so sequential access avoids walking the tree.
+	mutable Sci::Position cacheStart = 0;
+	mutable Sci::Position cacheEnd = 0;
+	mutable const char *cacheText = nullptr;
+
+	uint32_t NextPriority() noexcept;
+	std::shared_ptr<const PieceNode> NewPiece(const char *s, Sci::Position insertLength);
+	bool ExtendPiece(Sci::Position position, const char *s, Sci::Position insertLength);
+	void ReplaceWithPiece(Sci::Position position, Sci::Position rangeLength, std::shared_ptr<const PieceNode> piece);
+	void Invalidate() noexcept {
+		cacheStart = 0;
+		cacheEnd = 0;
+		cacheText = nullptr;
+	}
+	char CharAtSlow(Sci::Position position) const noexcept;
+
+public:
+	PieceTree() noexcept;
+	// Copying makes a snapshot: O(1) and independent of further changes to either tree.
+	PieceTree(const PieceTree &other) noexcept;
+	PieceTree(PieceTree &&) noexcept;
+	PieceTree &operator=(const PieceTree &other) noexcept;
+	PieceTree &operator=(PieceTree &&) noexcept;
+	~PieceTree() noexcept;
+
+	[[nodiscard]] Sci::Position Length() const noexcept;
+	[[nodiscard]] size_t Pieces() const noexcept;
+
+	/// Retrieving positions outside the range of the text works and returns 0
+	char CharAt(Sci::Position position) const noexcept {
+		if (position >= cacheStart && position < cacheEnd) {
+			return cacheText[position - cacheStart];
+		}
+		return CharAtSlow(position);
+	}
+	void GetRange(char *buffer, Sci::Position position, Sci::Position retrieveLength) const noexcept;
+	/// The contiguous run of text containing position, which starts at segmentStart.
+	/// At the end of the text this is an empty view starting at Length().
+	std::string_view SegmentAt(Sci::Position position, Sci::Position &segmentStart) const noexcept;
+
+	void Insert(Sci::Position position, const char *s, Sci::Position insertLength);
+	void Delete(Sci::Position position, Sci::Position deleteLength);
+	/// Make room to append up to size bytes in total without starting further chunks.
+	void Reserve(Sci::Position size);
+
+	/// Return a pointer to a contiguous copy of a range, merging its pieces if needed.
+	const char *RangePointer(Sci::Position position, Sci::Position rangeLength);
+	/// Return a pointer to the whole text followed by a NUL.
+	const char *BufferPointer();
+};
+
+}
+
+#endif
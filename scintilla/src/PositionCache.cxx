@@ -15,13 +15,14 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <array>
 #include <map>
 #include <set>
 #include <optional>
 #include <algorithm>
 #include <iterator>
 #include <memory>
-#include <mutex>
+#include <atomic>
 
 #include "ScintillaTypes.h"
 #include "ScintillaMessages.h"
@@ -74,6 +75,9 @@ LineLayout::LineLayout(Sci::Line lineNumber_, int maxLineLength_) :
 	highlightColumn(false),
 	containsCaret(false),
 	edgeColumn(0),
+	chars(nullptr),
+	styles(nullptr),
+	positions(nullptr),
 	bracePreviousStyles{},
 	widthLine(wrapWidthInfinite),
 	lines(1),
@@ -89,11 +93,15 @@ void LineLayout::Resize(int maxLineLength_) {
 	if (maxLineLength_ > maxLineLength) {
 		Free();
 		const size_t lineAllocation = maxLineLength_ + 1;
-		chars = std::make_unique<char[]>(lineAllocation);
-		styles = std::make_unique<unsigned char []>(lineAllocation);
 		// Extra position allocated as sometimes the Windows
 		// GetTextExtentExPoint API writes an extra element.
-		positions = std::make_unique<XYPOSITION []>(lineAllocation + 1);
+		const size_t positionsAllocation = lineAllocation + 1;
+		const size_t bytesCharsStyles = lineAllocation * 2;
+		storage = std::make_unique<XYPOSITION []>(
+			positionsAllocation + (bytesCharsStyles + sizeof(XYPOSITION) - 1) / sizeof(XYPOSITION));
+		positions = storage.get();
+		chars = reinterpret_cast<char *>(positions + positionsAllocation);
+		styles = reinterpret_cast<unsigned char *>(chars + lineAllocation);
 		if (bidiData) {
 			bidiData->Resize(maxLineLength_);
 		}
@@ -117,9 +125,10 @@ void LineLayout::EnsureBidiData() {
 }
 
 void LineLayout::Free() noexcept {
-	chars.reset();
-	styles.reset();
-	positions.reset();
+	storage.reset();
+	chars = nullptr;
+	styles = nullptr;
+	positions = nullptr;
 	lineStarts.reset();
 	lenLineStarts = 0;
 	bidiData.reset();
@@ -142,6 +151,17 @@ bool LineLayout::CanHold(Sci::Line lineDoc, int lineLength_) const noexcept {
 	return (lineNumber == lineDoc) && (lineLength_ <= maxLineLength);
 }
 
+size_t LineLayout::Bytes() const noexcept {
+	size_t bytes = sizeof(LineLayout) + lenLineStarts * sizeof(int);
+	if (storage) {
+		bytes += (maxLineLength + 2) * sizeof(XYPOSITION) + (maxLineLength + 1) * 2;
+	}
+	if (bidiData) {
+		bytes += sizeof(BidiData) + (maxLineLength + 1) * (sizeof(std::shared_ptr<Font>) + sizeof(XYPOSITION));
+	}
+	return bytes;
+}
+
 int LineLayout::LineStart(int line) const noexcept {
 	if (line <= 0) {
 		return 0;
@@ -471,7 +491,8 @@ bool SignificantLines::LineMayCache(Sci::Line line) const noexcept {
 
 LineLayoutCache::LineLayoutCache() :
 	level(LineCache::None),
-	maxValidity(LineLayout::ValidLevel::invalid), styleClock(-1) {
+	maxValidity(LineLayout::ValidLevel::invalid), styleClock(-1),
+	budget(0x4000000), bytesCached(0), useClock(0) {
 }
 
 LineLayoutCache::~LineLayoutCache() = default;
@@ -522,6 +543,9 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 	if (lengthForLevel != cache.size()) {
 		maxValidity = LineLayout::ValidLevel::lines;
 		cache.resize(lengthForLevel);
+		if (level == LineCache::Document) {
+			lastUse.resize(lengthForLevel);
+		}
 		// Cache::none -> no entries
 		// Cache::caret -> 1 entry can take any line
 		// Cache::document -> entry per line so each line in correct entry after resize
@@ -562,9 +586,38 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 	PLATFORM_ASSERT(cache.size() == lengthForLevel);
 }
 
+// Drop the layouts used longest ago until a quarter of the budget is free so that
+// trimming, which examines every entry, is infrequent.
+void LineLayoutCache::Trim(size_t keep) {
+	std::vector<std::pair<uint64_t, size_t>> used;
+	bytesCached = 0;
+	for (size_t i = 0; i < cache.size(); i++) {
+		if (cache[i]) {
+			bytesCached += cache[i]->Bytes();
+			if (i != keep) {
+				used.emplace_back(lastUse[i], i);
+			}
+		}
+	}
+	if (bytesCached <= budget) {
+		return;
+	}
+	std::sort(used.begin(), used.end());
+	const size_t target = budget - budget / 4;
+	for (const auto &[use, entry] : used) {
+		if (bytesCached <= target) {
+			break;
+		}
+		bytesCached -= std::min(bytesCached, cache[entry]->Bytes());
+		cache[entry].reset();
+	}
+}
+
 void LineLayoutCache::Deallocate() noexcept {
 	maxValidity = LineLayout::ValidLevel::invalid;
 	cache.clear();
+	lastUse.clear();
+	bytesCached = 0;
 }
 
 void LineLayoutCache::Invalidate(LineLayout::ValidLevel validity_) noexcept {
@@ -583,9 +636,17 @@ void LineLayoutCache::SetLevel(LineCache level_) noexcept {
 		level = level_;
 		maxValidity = LineLayout::ValidLevel::invalid;
 		cache.clear();
+		lastUse.clear();
+		bytesCached = 0;
 	}
 }
 
+void LineLayoutCache::SetBudget(size_t budget_) noexcept {
+	budget = budget_;
+	// Trimmed on the next allocation
+	bytesCached = budget;
+}
+
 std::shared_ptr<LineLayout> LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
                                       Sci::Line linesOnScreen, Sci::Line linesInDoc) {
 	AllocateForLevel(linesOnScreen, linesInDoc);
@@ -624,11 +685,24 @@ std::shared_ptr<LineLayout> LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci:
 	}
 
 	if (pos < cache.size()) {
+		const bool budgeted = (level == LineCache::Document) && (budget > 0);
 		if (cache[pos] && !cache[pos]->CanHold(lineNumber, maxChars)) {
+			if (budgeted) {
+				bytesCached -= std::min(bytesCached, cache[pos]->Bytes());
+			}
 			cache[pos].reset();
 		}
 		if (!cache[pos]) {
 			cache[pos] = std::make_shared<LineLayout>(lineNumber, maxChars);
+			if (budgeted) {
+				bytesCached += cache[pos]->Bytes();
+				if (bytesCached > budget) {
+					Trim(pos);
+				}
+			}
+		}
+		if (level == LineCache::Document) {
+			lastUse[pos] = ++useClock;
 		}
 #ifdef CHECK_LLC
 		// Expensive check that there is only one entry for any line number
@@ -987,34 +1061,194 @@ bool BreakFinder::More() const noexcept {
 	return (subBreak >= 0) || (nextBreak < lineRange.end);
 }
 
-class PositionCacheEntry {
-	uint16_t styleNumber;
-	uint16_t len;
-	uint16_t clock;
-	bool unicode;
-	std::unique_ptr<XYPOSITION[]> positions;
+namespace {
+
+// Positions are stored as 64-bit words so they can be read and written atomically.
+static_assert(sizeof(XYPOSITION) == sizeof(uint64_t));
+
+struct CacheCounts {
+	size_t hits = 0;
+	size_t misses = 0;
+	// Stores that replaced a string
+	size_t evictions = 0;
+	CacheCounts &operator+=(const CacheCounts &other) noexcept {
+		hits += other.hits;
+		misses += other.misses;
+		evictions += other.evictions;
+		return *this;
+	}
+};
+
+/**
+ * Positions of strings up to a fixed length, held in one allocation of atomic words so that entries
+ * can be read without locking while other threads store entries.
+ * Entries are divided into shards which each have their own counters, and shards into sets of
+ * ways where a string may be stored.
+ * Each entry has a sequence number that is odd while the entry is being written. Readers discard
+ * what they copied if the sequence number changed while copying and writers do not store into an
+ * entry that another thread is writing.
+ */
+class PositionTable {
+	static constexpr size_t shards = 16;
+	static constexpr size_t ways = 4;
+	// Words at the start of each entry, followed by the text and then the positions
+	enum { wordSequence, wordKey, wordHash, wordUsed, wordText };
+	struct alignas(64) Shard {
+		std::atomic<uint32_t> clock = 0;
+		std::atomic<size_t> hits = 0;
+		std::atomic<size_t> misses = 0;
+		std::atomic<size_t> evictions = 0;
+	};
+	size_t length;
+	size_t textWords;
+	size_t stride;
+	size_t sets;
+	std::unique_ptr<std::atomic<uint64_t>[]> words;
+	std::unique_ptr<Shard[]> shardCounts;
+
+	[[nodiscard]] Shard &ShardOf(uint64_t hash) const noexcept {
+		return shardCounts[hash % shards];
+	}
+	[[nodiscard]] std::atomic<uint64_t> *Entry(uint64_t hash, size_t way) const noexcept {
+		const size_t set = (hash % shards) * sets + (hash / shards) % sets;
+		return &words[(set * ways + way) * stride];
+	}
 public:
-	PositionCacheEntry() noexcept;
-	// Copy constructor not currently used, but needed for being element in std::vector.
-	PositionCacheEntry(const PositionCacheEntry &);
-	PositionCacheEntry(PositionCacheEntry &&) noexcept = default;
-	// Deleted so PositionCacheEntry objects can not be assigned.
-	void operator=(const PositionCacheEntry &) = delete;
-	void operator=(PositionCacheEntry &&) = delete;
-	~PositionCacheEntry();
-	void Set(unsigned int styleNumber_, bool unicode_, std::string_view sv, const XYPOSITION *positions_, uint16_t clock_);
-	void Clear() noexcept;
-	bool Retrieve(unsigned int styleNumber_, bool unicode_, std::string_view sv, XYPOSITION *positions_) const noexcept;
-	static size_t Hash(unsigned int styleNumber_, bool unicode_, std::string_view sv) noexcept;
-	bool NewerThan(const PositionCacheEntry &other) const noexcept;
-	void ResetClock() noexcept;
+	static constexpr size_t maxLength = 64;
+	// Packed text of a string, padded with 0
+	using Text = std::array<uint64_t, maxLength / sizeof(uint64_t)>;
+
+	PositionTable(size_t length_, size_t entries) :
+		length(length_),
+		textWords((length_ + sizeof(uint64_t) - 1) / sizeof(uint64_t)),
+		stride(wordText + textWords + length_),
+		sets(std::max<size_t>((entries + shards * ways - 1) / (shards * ways), 1)),
+		words(std::make_unique<std::atomic<uint64_t>[]>(sets * shards * ways * stride)),
+		shardCounts(std::make_unique<Shard[]>(shards)) {
+	}
+
+	[[nodiscard]] size_t Length() const noexcept {
+		return length;
+	}
+
+	// Only call when no other thread is using the table.
+	void Clear() noexcept {
+		for (size_t word = 0; word < sets * shards * ways * stride; word++) {
+			words[word].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	[[nodiscard]] CacheCounts Counts() const noexcept {
+		CacheCounts counts;
+		for (size_t shard = 0; shard < shards; shard++) {
+			counts.hits += shardCounts[shard].hits.load(std::memory_order_relaxed);
+			counts.misses += shardCounts[shard].misses.load(std::memory_order_relaxed);
+			counts.evictions += shardCounts[shard].evictions.load(std::memory_order_relaxed);
+		}
+		return counts;
+	}
+
+	void ResetCounts() noexcept {
+		for (size_t shard = 0; shard < shards; shard++) {
+			shardCounts[shard].hits.store(0, std::memory_order_relaxed);
+			shardCounts[shard].misses.store(0, std::memory_order_relaxed);
+			shardCounts[shard].evictions.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	bool Retrieve(uint64_t hash, uint64_t key, const Text &text, size_t len, XYPOSITION *positions) const noexcept {
+		Shard &shard = ShardOf(hash);
+		const size_t wordsUsed = (len + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		for (size_t way = 0; way < ways; way++) {
+			std::atomic<uint64_t> *entry = Entry(hash, way);
+			const uint64_t sequence = entry[wordSequence].load(std::memory_order_acquire);
+			if ((sequence & 1) ||
+				(entry[wordKey].load(std::memory_order_relaxed) != key) ||
+				(entry[wordHash].load(std::memory_order_relaxed) != hash)) {
+				continue;
+			}
+			size_t word = 0;
+			while ((word < wordsUsed) && (entry[wordText + word].load(std::memory_order_relaxed) == text[word])) {
+				word++;
+			}
+			if (word < wordsUsed) {
+				continue;
+			}
+			for (size_t i = 0; i < len; i++) {
+				const uint64_t bits = entry[wordText + textWords + i].load(std::memory_order_relaxed);
+				memcpy(&positions[i], &bits, sizeof(bits));
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (entry[wordSequence].load(std::memory_order_relaxed) == sequence) {
+				entry[wordUsed].store(shard.clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				shard.hits.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		shard.misses.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	void Store(uint64_t hash, uint64_t key, const Text &text, size_t len, const XYPOSITION *positions) noexcept {
+		Shard &shard = ShardOf(hash);
+		const uint32_t now = shard.clock.fetch_add(1, std::memory_order_relaxed) + 1;
+		// Replace an empty way or else the one used longest ago
+		std::atomic<uint64_t> *entry = nullptr;
+		uint32_t ageOldest = 0;
+		for (size_t way = 0; way < ways; way++) {
+			std::atomic<uint64_t> *candidate = Entry(hash, way);
+			if (candidate[wordKey].load(std::memory_order_relaxed) == 0) {
+				entry = candidate;
+				break;
+			}
+			const uint32_t age = now - static_cast<uint32_t>(candidate[wordUsed].load(std::memory_order_relaxed));
+			if (!entry || (age > ageOldest)) {
+				entry = candidate;
+				ageOldest = age;
+			}
+		}
+		uint64_t sequence = entry[wordSequence].load(std::memory_order_relaxed);
+		if ((sequence & 1) ||
+			!entry[wordSequence].compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+			// Another thread is writing this entry
+			return;
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		if (entry[wordKey].load(std::memory_order_relaxed) != 0) {
+			shard.evictions.fetch_add(1, std::memory_order_relaxed);
+		}
+		entry[wordKey].store(key, std::memory_order_relaxed);
+		entry[wordHash].store(hash, std::memory_order_relaxed);
+		entry[wordUsed].store(now, std::memory_order_relaxed);
+		for (size_t word = 0; word < textWords; word++) {
+			entry[wordText + word].store(text[word], std::memory_order_relaxed);
+		}
+		for (size_t i = 0; i < len; i++) {
+			uint64_t bits = 0;
+			memcpy(&bits, &positions[i], sizeof(bits));
+			entry[wordText + textWords + i].store(bits, std::memory_order_relaxed);
+		}
+		entry[wordSequence].store(sequence + 2, std::memory_order_release);
+	}
 };
 
+}
+
 class PositionCache : public IPositionCache {
-	std::vector<PositionCacheEntry> pces;
-	std::mutex mutex;
-	uint16_t clock;
-	bool allClear;
+	// Most measured strings are short so most entries hold short strings
+	static constexpr size_t lengthShort = 16;
+	static constexpr size_t lengthLong = PositionTable::maxLength;
+	// Grow up to this multiple of the set size when lookups miss often
+	static constexpr size_t maxGrowth = 4;
+	static constexpr size_t sampleLookups = 0x10000;
+	size_t size;
+	size_t growth;
+	std::unique_ptr<PositionTable> tableShort;
+	std::unique_ptr<PositionTable> tableLong;
+	std::atomic<bool> allClear;
+	size_t measuresAlone;
+	void Allocate();
+	void AdaptSize();
 public:
 	PositionCache();
 	// Deleted so LineAnnotation objects can not be copied.
@@ -1031,98 +1265,55 @@ public:
 		bool unicode, std::string_view sv, XYPOSITION *positions, bool needsLocking) override;
 };
 
-PositionCacheEntry::PositionCacheEntry() noexcept :
-	styleNumber(0), len(0), clock(0), unicode(false) {
+PositionCache::PositionCache() : size(0x400), growth(1), allClear(true), measuresAlone(0) {
+	Allocate();
 }
 
-// Copy constructor not currently used, but needed for being element in std::vector.
-PositionCacheEntry::PositionCacheEntry(const PositionCacheEntry &other) :
-	styleNumber(other.styleNumber), len(other.len), clock(other.clock), unicode(other.unicode) {
-	if (other.positions) {
-		const size_t lenData = len + (len / sizeof(XYPOSITION)) + 1;
-		positions = std::make_unique<XYPOSITION[]>(lenData);
-		memcpy(positions.get(), other.positions.get(), lenData * sizeof(XYPOSITION));
+void PositionCache::Allocate() {
+	tableShort.reset();
+	tableLong.reset();
+	const size_t entries = size * growth;
+	if (entries > 0) {
+		tableShort = std::make_unique<PositionTable>(lengthShort, entries - entries / 4);
+		tableLong = std::make_unique<PositionTable>(lengthLong, entries / 4);
 	}
+	allClear = true;
 }
 
-void PositionCacheEntry::Set(unsigned int styleNumber_, bool unicode_, std::string_view sv,
-	const XYPOSITION *positions_, uint16_t clock_) {
-	Clear();
-	styleNumber = static_cast<uint16_t>(styleNumber_);
-	len = static_cast<uint16_t>(sv.length());
-	clock = clock_;
-	unicode = unicode_;
-	if (sv.data() && positions_) {
-		positions = std::make_unique<XYPOSITION[]>(len + (len / sizeof(XYPOSITION)) + 1);
-		for (unsigned int i=0; i<len; i++) {
-			positions[i] = positions_[i];
-		}
-		memcpy(&positions[len], sv.data(), sv.length());
+// Grow when many lookups miss and most of the misses replace strings so the cache is too small
+// for the variety of text being shown. Only called when no other thread is measuring.
+void PositionCache::AdaptSize() {
+	CacheCounts counts = tableShort->Counts();
+	counts += tableLong->Counts();
+	const size_t lookups = counts.hits + counts.misses;
+	if (lookups < sampleLookups) {
+		return;
 	}
-}
-
-PositionCacheEntry::~PositionCacheEntry() {
-	Clear();
-}
-
-void PositionCacheEntry::Clear() noexcept {
-	positions.reset();
-	styleNumber = 0;
-	len = 0;
-	clock = 0;
-}
-
-bool PositionCacheEntry::Retrieve(unsigned int styleNumber_, bool unicode_, std::string_view sv, XYPOSITION *positions_) const noexcept {
-	if ((styleNumber == styleNumber_) && (unicode == unicode_) && (len == sv.length()) &&
-		(memcmp(&positions[len], sv.data(), sv.length())== 0)) {
-		for (unsigned int i=0; i<len; i++) {
-			positions_[i] = positions[i];
-		}
-		return true;
+	if ((counts.misses * 4 > lookups) && (counts.evictions * 2 > counts.misses) && (growth < maxGrowth)) {
+		growth *= 2;
+		Allocate();
 	} else {
-		return false;
+		tableShort->ResetCounts();
+		tableLong->ResetCounts();
 	}
 }
 
-size_t PositionCacheEntry::Hash(unsigned int styleNumber_, bool unicode_, std::string_view sv) noexcept {
-	const size_t h1 = std::hash<std::string_view>{}(sv);
-	const size_t h2 = std::hash<unsigned int>{}(styleNumber_);
-	return h1 ^ (h2 << 1) ^ static_cast<size_t>(unicode_);
-}
-
-bool PositionCacheEntry::NewerThan(const PositionCacheEntry &other) const noexcept {
-	return clock > other.clock;
-}
-
-void PositionCacheEntry::ResetClock() noexcept {
-	if (clock > 0) {
-		clock = 1;
-	}
-}
-
-PositionCache::PositionCache() {
-	clock = 1;
-	pces.resize(0x400);
-	allClear = true;
-}
-
 void PositionCache::Clear() noexcept {
-	if (!allClear) {
-		for (PositionCacheEntry &pce : pces) {
-			pce.Clear();
-		}
+	if (!allClear && tableShort) {
+		tableShort->Clear();
+		tableLong->Clear();
 	}
-	clock = 1;
 	allClear = true;
 }
 
 void PositionCache::SetSize(size_t size_) {
-	Clear();
-	pces.resize(size_);
+	size = size_;
+	growth = 1;
+	Allocate();
 }
 
 size_t PositionCache::GetSize() const noexcept {
-	return pces.size();
+	return size;
 }
 
 void PositionCache::MeasureWidths(Surface *surface, const ViewStyle &vstyle, unsigned int styleNumber,
@@ -1137,30 +1328,42 @@ void PositionCache::MeasureWidths(Surface *surface, const ViewStyle &vstyle, uns
 			return;
 		}
 	}
+	if (style.advances) {
+		// Summing advances is quicker than looking in the cache
+		const bool measured = unicode ?
+			style.advances->MeasureWidthsUTF8(sv, positions) :
+			style.advances->MeasureWidths(sv, positions);
+		if (measured) {
+			return;
+		}
+	}
 
-	size_t probe = pces.size();	// Out of bounds
-	if ((!pces.empty()) && (sv.length() < 30)) {
+	PositionTable *table = nullptr;
+	if (tableShort && (sv.length() <= lengthLong)) {
 		// Only store short strings in the cache so it doesn't churn with
 		// long comments with only a single comment.
-
-		// Two way associative: try two probe positions.
-		const size_t hashValue = PositionCacheEntry::Hash(styleNumber, unicode, sv);
-		probe = hashValue % pces.size();
-		std::unique_lock<std::mutex> guard(mutex, std::defer_lock);
-		if (needsLocking) {
-			guard.lock();
-		}
-		if (pces[probe].Retrieve(styleNumber, unicode, sv, positions)) {
-			return;
+		if (!needsLocking) {
+			measuresAlone++;
+			if ((measuresAlone % 0x400) == 0) {
+				AdaptSize();
+			}
 		}
-		const size_t probe2 = (hashValue * 37) % pces.size();
-		if (pces[probe2].Retrieve(styleNumber, unicode, sv, positions)) {
+		table = (sv.length() <= lengthShort) ? tableShort.get() : tableLong.get();
+	}
+
+	uint64_t hash = 0;
+	uint64_t key = 0;
+	PositionTable::Text text {};
+	if (table) {
+		hash = std::hash<std::string_view>{}(sv) ^
+			(((static_cast<uint64_t>(styleNumber) << 1) | (unicode ? 1 : 0)) * 0x9E3779B97F4A7C15U);
+		// Marked so that empty entries with a 0 key never match
+		key = (static_cast<uint64_t>(1) << 40) | (static_cast<uint64_t>(unicode) << 32) |
+			(static_cast<uint64_t>(sv.length()) << 16) | styleNumber;
+		memcpy(text.data(), sv.data(), sv.length());
+		if (table->Retrieve(hash, key, text, sv.length(), positions)) {
 			return;
 		}
-		// Not found. Choose the oldest of the two slots to replace
-		if (pces[probe].NewerThan(pces[probe2])) {
-			probe = probe2;
-		}
 	}
 
 	const Font *fontStyle = style.font.get();
@@ -1169,23 +1372,10 @@ void PositionCache::MeasureWidths(Surface *surface, const ViewStyle &vstyle, uns
 	} else {
 		surface->MeasureWidths(fontStyle, sv, positions);
 	}
-	if (probe < pces.size()) {
+	if (table) {
 		// Store into cache
-		std::unique_lock<std::mutex> guard(mutex, std::defer_lock);
-		if (needsLocking) {
-			guard.lock();
-		}
-		clock++;
-		if (clock > 60000) {
-			// Since there are only 16 bits for the clock, wrap it round and
-			// reset all cache entries so none get stuck with a high clock.
-			for (PositionCacheEntry &pce : pces) {
-				pce.ResetClock();
-			}
-			clock = 2;
-		}
 		allClear = false;
-		pces[probe].Set(styleNumber, unicode, sv, positions, clock);
+		table->Store(hash, key, text, sv.length(), positions);
 	}
 }
 
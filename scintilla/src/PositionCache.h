@@ -48,6 +48,8 @@ public:
  */
 class LineLayout {
 private:
+	// positions, chars and styles share one allocation
+	std::unique_ptr<XYPOSITION []> storage;
 	std::unique_ptr<int []>lineStarts;
 	int lenLineStarts;
 	/// Drawing is only performed for @a maxLineLength characters on each line.
@@ -63,9 +65,9 @@ public:
 	bool highlightColumn;
 	bool containsCaret;
 	int edgeColumn;
-	std::unique_ptr<char[]> chars;
-	std::unique_ptr<unsigned char[]> styles;
-	std::unique_ptr<XYPOSITION[]> positions;
+	char *chars;
+	unsigned char *styles;
+	XYPOSITION *positions;
 	unsigned char bracePreviousStyles[2];
 
 	std::unique_ptr<BidiData> bidiData;
@@ -90,6 +92,8 @@ public:
 	void Invalidate(ValidLevel validity_) noexcept;
 	Sci::Line LineNumber() const noexcept;
 	bool CanHold(Sci::Line lineDoc, int lineLength_) const noexcept;
+	/// Approximate memory used by this layout.
+	size_t Bytes() const noexcept;
 	int LineStart(int line) const noexcept;
 	int LineLength(int line) const noexcept;
 	enum class Scope { visibleOnly, includeEnd };
@@ -158,8 +162,14 @@ private:
 	std::vector<std::shared_ptr<LineLayout>>cache;
 	LineLayout::ValidLevel maxValidity;
 	int styleClock;
+	// For LineCache::Document, layouts used longest ago are dropped when they use more than budget bytes
+	size_t budget;
+	size_t bytesCached;
+	uint64_t useClock;
+	std::vector<uint64_t> lastUse;
 	size_t EntryForLine(Sci::Line line) const noexcept;
 	void AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc);
+	void Trim(size_t keep);
 public:
 	LineLayoutCache();
 	// Deleted so LineLayoutCache objects can not be copied.
@@ -172,6 +182,8 @@ public:
 	void Invalidate(LineLayout::ValidLevel validity_) noexcept;
 	void SetLevel(Scintilla::LineCache level_) noexcept;
 	Scintilla::LineCache GetLevel() const noexcept { return level; }
+	void SetBudget(size_t budget_) noexcept;
+	size_t GetBudget() const noexcept { return budget; }
 	std::shared_ptr<LineLayout> Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
 		Sci::Line linesOnScreen, Sci::Line linesInDoc);
 };
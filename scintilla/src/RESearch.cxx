@@ -205,6 +205,8 @@
 
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <array>
 #include <algorithm>
 #include <iterator>
@@ -240,7 +242,7 @@ using namespace Scintilla::Internal;
  */
 #define BITIND  07
 
-#define badpat(x)	(*nfa = END, x)
+#define badpat(x)	(nfa[0] = END, x)
 
 /*
  * Character classification table for word boundary operators BOW
@@ -255,7 +257,7 @@ RESearch::RESearch(CharClassify *charClassTable) {
 	sta = NOP;                  /* status of lastpat */
 	lineStartPos = 0;
 	lineEndPos = 0;
-	nfa[0] = END;
+	nfa.assign(MINNFA, END);
 	Clear();
 }
 
@@ -422,12 +424,41 @@ const char *RESearch::Compile(const char *pattern, Sci::Position length, bool ca
 			return badpat("No previous regular expression");
 	}
 
+	std::array<unsigned char, BITBLK> wordChars {};
+	for (int c = 0; c < MAXCHR; c++) {
+		if (iswordc(static_cast<unsigned char>(c))) {
+			wordChars[c / CHRBIT] |= 1 << (c & BITIND);
+		}
+	}
+	const std::string_view patternView(pattern, length);
+	for (auto it = compiled.begin(); it != compiled.end(); ++it) {
+		if (it->pattern == patternView && it->caseSensitive == caseSensitive &&
+			it->posix == posix && it->wordChars == wordChars) {
+			nfa = it->nfa;
+			std::rotate(it, it + 1, compiled.end());
+			sta = OKP;
+			return nullptr;
+		}
+	}
+
+	const char *errmsg = CompilePattern(pattern, length, caseSensitive, posix);
+	if (!errmsg) {
+		if (compiled.size() >= MAXCOMPILED) {
+			compiled.erase(compiled.begin());
+		}
+		compiled.push_back({ std::string(patternView), caseSensitive, posix, wordChars, nfa });
+	}
+	return errmsg;
+}
+
+const char *RESearch::CompilePattern(const char *pattern, Sci::Position length, bool caseSensitive, bool posix) {
 	bittab.fill(0);
 	nfa[0] = END;
 
-	char *mp=nfa;          /* nfa pointer       */
-	char *sp=nfa;          /* another saved pointer */
-	const char * const mpMax = mp + MAXNFA - BITBLK - 10;
+	char *mp=nfa.data();          /* nfa pointer       */
+	char *sp=nfa.data();          /* another saved pointer */
+	// Most that one pattern character can add: a '+' copying a character class and its closure
+	constexpr ptrdiff_t maxGrowth = 2 * (BITBLK + 1) + 10;
 
 	int tagstk[MAXTAG]{};  /* subpat tag stack */
 	int tagi = 0;          /* tag stack index   */
@@ -437,8 +468,13 @@ const char *RESearch::Compile(const char *pattern, Sci::Position length, bool ca
 
 	const char *p=pattern;     /* pattern pointer   */
 	for (int i=0; i<length; i++, p++) {
-		if (mp > mpMax)
-			return badpat("Pattern too long");
+		if (mp - nfa.data() + maxGrowth > static_cast<ptrdiff_t>(nfa.size())) {
+			const ptrdiff_t mpOffset = mp - nfa.data();
+			const ptrdiff_t spOffset = sp - nfa.data();
+			nfa.resize(nfa.size() * 2);
+			mp = nfa.data() + mpOffset;
+			sp = nfa.data() + spOffset;
+		}
 		char *lp = mp;			/* saved pointer     */
 		switch (*p) {
 
@@ -739,7 +775,7 @@ const char *RESearch::Compile(const char *pattern, Sci::Position length, bool ca
  */
 int RESearch::Execute(const CharacterIndexer &ci, Sci::Position lp, Sci::Position endp) {
 	Sci::Position ep = NOTFOUND;
-	const char * const ap = nfa;
+	const char * const ap = nfa.data();
 
 	failure = 0;
 
@@ -21,7 +21,7 @@ class RESearch {
 
 public:
 	explicit RESearch(CharClassify *charClassTable);
-	// No dynamic allocation so default copy constructor and assignment operator are OK.
+	// All members are values so default copy constructor and assignment operator are OK.
 	void Clear();
 	const char *Compile(const char *pattern, Sci::Position length, bool caseSensitive, bool posix);
 	int Execute(const CharacterIndexer &ci, Sci::Position lp, Sci::Position endp);
@@ -39,7 +39,10 @@ public:
 
 private:
 
-	static constexpr int MAXNFA = 4096;
+	// The automaton starts at MINNFA bytes and grows as needed.
+	static constexpr size_t MINNFA = 256;
+	// Recently compiled patterns are kept so repeated searches do not compile again.
+	static constexpr size_t MAXCOMPILED = 4;
 	// The following constants are not meant to be changeable.
 	// They are for readability only.
 	static constexpr int MAXCHR = 256;
@@ -49,17 +52,27 @@ private:
 	void ChSet(unsigned char c) noexcept;
 	void ChSetWithCase(unsigned char c, bool caseSensitive) noexcept;
 	int GetBackslashExpression(const char *pattern, int &incr) noexcept;
+	const char *CompilePattern(const char *pattern, Sci::Position length, bool caseSensitive, bool posix);
 
 	Sci::Position PMatch(const CharacterIndexer &ci, Sci::Position lp, Sci::Position endp, const char *ap);
 
 	// positions to match line start and line end
 	Sci::Position lineStartPos;
 	Sci::Position lineEndPos;
-	char nfa[MAXNFA];    /* automaton */
+	std::vector<char> nfa;    /* automaton */
 	int sta;
 	int failure;
 	std::array<unsigned char, BITBLK> bittab {}; /* bit table for CCL pre-set bits */
 	CharClassify *charClass;
+	struct CompiledPattern {
+		std::string pattern;
+		bool caseSensitive;
+		bool posix;
+		// Word characters affect \w, \W, \< and \> so are part of the key
+		std::array<unsigned char, BITBLK> wordChars;
+		std::vector<char> nfa;
+	};
+	std::vector<CompiledPattern> compiled;	// Least recently used first
 	bool iswordc(unsigned char x) const noexcept {
 		return charClass->IsWord(x);
 	}
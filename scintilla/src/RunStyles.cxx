@@ -28,81 +28,559 @@
 
 using namespace Scintilla::Internal;
 
-// Find the first run at a position
 template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::RunFromPosition(DISTANCE position) const noexcept {
-	DISTANCE run = starts.PartitionFromPosition(position);
+void RunTree<DISTANCE, STYLE>::Leaf::Append(const Leaf &other, int start, int n) noexcept {
+	std::copy(other.lengths + start, other.lengths + start + n, lengths + count);
+	std::copy(other.values + start, other.values + start + n, values + count);
+	count += n;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Leaf::Prepend(const Leaf &other, int start, int n) noexcept {
+	std::copy_backward(lengths, lengths + count, lengths + count + n);
+	std::copy_backward(values, values + count, values + count + n);
+	std::copy(other.lengths + start, other.lengths + start + n, lengths);
+	std::copy(other.values + start, other.values + start + n, values);
+	count += n;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Leaf::Erase(int start, int n) noexcept {
+	std::copy(lengths + start + n, lengths + count, lengths + start);
+	std::copy(values + start + n, values + count, values + start);
+	count -= n;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Branch::Append(const Branch &other, int start, int n) noexcept {
+	std::copy(other.lengths + start, other.lengths + start + n, lengths + count);
+	std::copy(other.runs + start, other.runs + start + n, runs + count);
+	std::copy(other.children + start, other.children + start + n, children + count);
+	count += n;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Branch::Prepend(const Branch &other, int start, int n) noexcept {
+	std::copy_backward(lengths, lengths + count, lengths + count + n);
+	std::copy_backward(runs, runs + count, runs + count + n);
+	std::copy_backward(children, children + count, children + count + n);
+	std::copy(other.lengths + start, other.lengths + start + n, lengths);
+	std::copy(other.runs + start, other.runs + start + n, runs);
+	std::copy(other.children + start, other.children + start + n, children);
+	count += n;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Branch::Erase(int start, int n) noexcept {
+	std::copy(lengths + start + n, lengths + count, lengths + start);
+	std::copy(runs + start + n, runs + count, runs + start);
+	std::copy(children + start + n, children + count, children + start);
+	count -= n;
+}
+
+template <typename DISTANCE, typename STYLE>
+int RunTree<DISTANCE, STYLE>::AllocateLeaf() {
+	if (freeLeaves.empty()) {
+		leaves.emplace_back();
+		return static_cast<int>(leaves.size() - 1);
+	}
+	const int leaf = freeLeaves.back();
+	freeLeaves.pop_back();
+	leaves[leaf].count = 0;
+	return leaf;
+}
+
+template <typename DISTANCE, typename STYLE>
+int RunTree<DISTANCE, STYLE>::AllocateBranch() {
+	if (freeBranches.empty()) {
+		branches.emplace_back();
+		return static_cast<int>(branches.size() - 1);
+	}
+	const int branch = freeBranches.back();
+	freeBranches.pop_back();
+	branches[branch].count = 0;
+	return branch;
+}
+
+template <typename DISTANCE, typename STYLE>
+int RunTree<DISTANCE, STYLE>::Count(int node, int level) const noexcept {
+	return (level == 0) ? leaves[node].count : branches[node].count;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Totals(int node, int level, DISTANCE &runs, DISTANCE &length) const noexcept {
+	length = 0;
+	if (level == 0) {
+		const Leaf &leaf = leaves[node];
+		runs = leaf.count;
+		for (int i = 0; i < leaf.count; i++) {
+			length += leaf.lengths[i];
+		}
+	} else {
+		const Branch &branch = branches[node];
+		runs = 0;
+		for (int i = 0; i < branch.count; i++) {
+			runs += branch.runs[i];
+			length += branch.lengths[i];
+		}
+	}
+}
+
+// Level is that of the branch.
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::SetChild(Branch &branch, int slot, int child, int level) const noexcept {
+	branch.children[slot] = child;
+	Totals(child, level - 1, branch.runs[slot], branch.lengths[slot]);
+}
+
+// Returns the leaf holding partition and changes partition to its index in that leaf.
+template <typename DISTANCE, typename STYLE>
+int RunTree<DISTANCE, STYLE>::LeafFor(DISTANCE &partition) const noexcept {
+	int node = root;
+	for (int level = height; level > 0; level--) {
+		const Branch &branch = branches[node];
+		int slot = 0;
+		while (partition >= branch.runs[slot]) {
+			partition -= branch.runs[slot];
+			slot++;
+		}
+		node = branch.children[slot];
+	}
+	return node;
+}
+
+// Returns a new node to follow node when node had to be split.
+template <typename DISTANCE, typename STYLE>
+int RunTree<DISTANCE, STYLE>::InsertAt(int node, int level, DISTANCE index, DISTANCE length, STYLE value) {
+	constexpr int half = nodeSize / 2;
+	if (level == 0) {
+		Leaf &leaf = leaves[node];
+		const int i = static_cast<int>(index);
+		std::copy_backward(leaf.lengths + i, leaf.lengths + leaf.count, leaf.lengths + leaf.count + 1);
+		std::copy_backward(leaf.values + i, leaf.values + leaf.count, leaf.values + leaf.count + 1);
+		leaf.lengths[i] = length;
+		leaf.values[i] = value;
+		leaf.count++;
+		if (leaf.count < nodeSize) {
+			return -1;
+		}
+		const int sibling = AllocateLeaf();
+		leaves[sibling].Append(leaves[node], half, nodeSize - half);
+		leaves[node].count = half;
+		return sibling;
+	}
+	int slot = 0;
+	while ((slot < branches[node].count - 1) && (index > branches[node].runs[slot])) {
+		index -= branches[node].runs[slot];
+		slot++;
+	}
+	const int child = branches[node].children[slot];
+	const int split = InsertAt(child, level - 1, index, length, value);
+	Branch &branch = branches[node];
+	branch.runs[slot]++;
+	branch.lengths[slot] += length;
+	if (split < 0) {
+		return -1;
+	}
+	std::copy_backward(branch.lengths + slot + 1, branch.lengths + branch.count, branch.lengths + branch.count + 1);
+	std::copy_backward(branch.runs + slot + 1, branch.runs + branch.count, branch.runs + branch.count + 1);
+	std::copy_backward(branch.children + slot + 1, branch.children + branch.count, branch.children + branch.count + 1);
+	branch.count++;
+	SetChild(branch, slot, child, level);
+	SetChild(branch, slot + 1, split, level);
+	if (branch.count < nodeSize) {
+		return -1;
+	}
+	const int sibling = AllocateBranch();
+	branches[sibling].Append(branches[node], half, nodeSize - half);
+	branches[node].count = half;
+	return sibling;
+}
+
+// Returns the length of the removed run.
+template <typename DISTANCE, typename STYLE>
+DISTANCE RunTree<DISTANCE, STYLE>::EraseAt(int node, int level, DISTANCE index) {
+	if (level == 0) {
+		Leaf &leaf = leaves[node];
+		const int i = static_cast<int>(index);
+		const DISTANCE length = leaf.lengths[i];
+		leaf.Erase(i, 1);
+		return length;
+	}
+	int slot = 0;
+	while (index >= branches[node].runs[slot]) {
+		index -= branches[node].runs[slot];
+		slot++;
+	}
+	const int child = branches[node].children[slot];
+	const DISTANCE length = EraseAt(child, level - 1, index);
+	Branch &branch = branches[node];
+	branch.runs[slot]--;
+	branch.lengths[slot] -= length;
+	if ((branch.count > 1) && (Count(child, level - 1) < nodeMin)) {
+		Rebalance(node, level, slot);
+	}
+	return length;
+}
+
+// Merge second into first when they fit in one node, otherwise share out their elements evenly.
+// Returns true when merged.
+template <typename DISTANCE, typename STYLE>
+template <typename NODE>
+bool RunTree<DISTANCE, STYLE>::Balance(NODE &first, NODE &second) noexcept {
+	if (first.count + second.count < nodeSize) {
+		first.Append(second, 0, second.count);
+		second.count = 0;
+		return true;
+	}
+	const int target = (first.count + second.count) / 2;
+	if (first.count > target) {
+		second.Prepend(first, target, first.count - target);
+		first.count = target;
+	} else {
+		const int n = target - first.count;
+		first.Append(second, 0, n);
+		second.Erase(0, n);
+	}
+	return false;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Rebalance(int node, int level, int slot) {
+	Branch &branch = branches[node];
+	const int left = (slot > 0) ? slot - 1 : slot;
+	const int right = left + 1;
+	const int first = branch.children[left];
+	const int second = branch.children[right];
+	bool merged = false;
+	if (level == 1) {
+		merged = Balance(leaves[first], leaves[second]);
+		if (merged) {
+			freeLeaves.push_back(second);
+		}
+	} else {
+		merged = Balance(branches[first], branches[second]);
+		if (merged) {
+			freeBranches.push_back(second);
+		}
+	}
+	SetChild(branch, left, first, level);
+	if (merged) {
+		branch.Erase(right, 1);
+	} else {
+		SetChild(branch, right, second, level);
+	}
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::InsertRun(DISTANCE run, DISTANCE length, STYLE value) {
+	const int split = InsertAt(root, height, run, length, value);
+	if (split >= 0) {
+		// Grow a level
+		const int above = AllocateBranch();
+		Branch &branch = branches[above];
+		branch.count = 2;
+		height++;
+		SetChild(branch, 0, root, height);
+		SetChild(branch, 1, split, height);
+		root = above;
+	}
+	totalRuns++;
+	totalLength += length;
+}
+
+template <typename DISTANCE, typename STYLE>
+DISTANCE RunTree<DISTANCE, STYLE>::EraseRun(DISTANCE run) {
+	const DISTANCE length = EraseAt(root, height, run);
+	while ((height > 0) && (branches[root].count == 1)) {
+		// Remove a level
+		freeBranches.push_back(root);
+		root = branches[root].children[0];
+		height--;
+	}
+	totalRuns--;
+	totalLength -= length;
+	return length;
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::CheckNode(int node, int level) const {
+	if ((Count(node, level) < 1) || (Count(node, level) >= nodeSize)) {
+		throw std::runtime_error("RunTree: Node has wrong number of elements.");
+	}
+	if (level > 0) {
+		const Branch &branch = branches[node];
+		for (int i = 0; i < branch.count; i++) {
+			DISTANCE runs = 0;
+			DISTANCE length = 0;
+			Totals(branch.children[i], level - 1, runs, length);
+			if ((runs != branch.runs[i]) || (length != branch.lengths[i])) {
+				throw std::runtime_error("RunTree: Branch totals differ from child.");
+			}
+			CheckNode(branch.children[i], level - 1);
+		}
+	}
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Clear() {
+	leaves.assign(1, Leaf());
+	leaves[0].count = 1;
+	branches.clear();
+	freeLeaves.clear();
+	freeBranches.clear();
+	root = 0;
+	height = 0;
+	totalRuns = 1;
+	totalLength = 0;
+}
+
+template <typename DISTANCE, typename STYLE>
+DISTANCE RunTree<DISTANCE, STYLE>::Partitions() const noexcept {
+	return totalRuns;
+}
+
+template <typename DISTANCE, typename STYLE>
+DISTANCE RunTree<DISTANCE, STYLE>::Length() const noexcept {
+	return totalLength;
+}
+
+template <typename DISTANCE, typename STYLE>
+DISTANCE RunTree<DISTANCE, STYLE>::PositionFromPartition(DISTANCE partition) const noexcept {
+	if (partition <= 0) {
+		return 0;
+	}
+	if (partition >= totalRuns) {
+		return totalLength;
+	}
+	DISTANCE pos = 0;
+	int node = root;
+	for (int level = height; level > 0; level--) {
+		const Branch &branch = branches[node];
+		int slot = 0;
+		while (partition >= branch.runs[slot]) {
+			partition -= branch.runs[slot];
+			pos += branch.lengths[slot];
+			slot++;
+		}
+		node = branch.children[slot];
+	}
+	const Leaf &leaf = leaves[node];
+	for (int i = 0; i < partition; i++) {
+		pos += leaf.lengths[i];
+	}
+	return pos;
+}
+
+// Same as Partitioning: the last partition that starts at or before pos.
+template <typename DISTANCE, typename STYLE>
+DISTANCE RunTree<DISTANCE, STYLE>::PartitionFromPosition(DISTANCE pos) const noexcept {
+	if (pos < 0) {
+		return 0;
+	}
+	if (pos >= totalLength) {
+		return totalRuns - 1;
+	}
+	DISTANCE partition = 0;
+	int node = root;
+	for (int level = height; level > 0; level--) {
+		const Branch &branch = branches[node];
+		int slot = 0;
+		while (pos >= branch.lengths[slot]) {
+			pos -= branch.lengths[slot];
+			partition += branch.runs[slot];
+			slot++;
+		}
+		node = branch.children[slot];
+	}
+	const Leaf &leaf = leaves[node];
+	int i = 0;
+	while (pos >= leaf.lengths[i]) {
+		pos -= leaf.lengths[i];
+		i++;
+	}
+	return partition + i;
+}
+
+template <typename DISTANCE, typename STYLE>
+STYLE RunTree<DISTANCE, STYLE>::ValueAt(DISTANCE partition) const noexcept {
+	if ((partition < 0) || (partition >= totalRuns)) {
+		return STYLE();
+	}
+	const int leaf = LeafFor(partition);
+	return leaves[leaf].values[partition];
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::SetValueAt(DISTANCE partition, STYLE value) noexcept {
+	if ((partition >= 0) && (partition < totalRuns)) {
+		const int leaf = LeafFor(partition);
+		leaves[leaf].values[partition] = value;
+	}
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::InsertPartition(DISTANCE partition, DISTANCE pos, STYLE value) {
+	// The partition before ends at pos and the new partition continues to where it ended.
+	const DISTANCE end = PositionFromPartition(partition);
+	InsertText(partition - 1, pos - end);
+	InsertRun(partition, end - pos, value);
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::RemovePartition(DISTANCE partition) {
+	const DISTANCE length = EraseRun(partition);
+	InsertText((partition > 0) ? partition - 1 : 0, length);
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::InsertText(DISTANCE partition, DISTANCE delta) noexcept {
+	if ((partition < 0) || (partition >= totalRuns)) {
+		return;
+	}
+	totalLength += delta;
+	int node = root;
+	for (int level = height; level > 0; level--) {
+		Branch &branch = branches[node];
+		int slot = 0;
+		while (partition >= branch.runs[slot]) {
+			partition -= branch.runs[slot];
+			slot++;
+		}
+		branch.lengths[slot] += delta;
+		node = branch.children[slot];
+	}
+	leaves[node].lengths[partition] += delta;
+}
+
+// Build the tree bottom up with nodes three quarters full.
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Assign(const DISTANCE *positions, const STYLE *values, size_t partitions) {
+	Clear();
+	if (partitions == 0) {
+		return;
+	}
+	constexpr size_t fill = nodeSize * 3 / 4;
+	leaves.clear();
+	std::vector<int> level;
+	size_t nodes = (partitions + fill - 1) / fill;
+	size_t start = 0;
+	for (size_t n = 0; n < nodes; n++) {
+		const size_t end = partitions * (n + 1) / nodes;
+		Leaf leaf;
+		for (size_t i = start; i < end; i++) {
+			leaf.lengths[leaf.count] = positions[i + 1] - positions[i];
+			leaf.values[leaf.count] = values[i];
+			leaf.count++;
+		}
+		leaves.push_back(leaf);
+		level.push_back(static_cast<int>(n));
+		start = end;
+	}
+	while (level.size() > 1) {
+		height++;
+		std::vector<int> above;
+		nodes = (level.size() + fill - 1) / fill;
+		start = 0;
+		for (size_t n = 0; n < nodes; n++) {
+			const size_t end = level.size() * (n + 1) / nodes;
+			Branch branch;
+			for (size_t i = start; i < end; i++) {
+				SetChild(branch, branch.count, level[i], height);
+				branch.count++;
+			}
+			branches.push_back(branch);
+			above.push_back(static_cast<int>(branches.size() - 1));
+			start = end;
+		}
+		level.swap(above);
+	}
+	root = level[0];
+	totalRuns = static_cast<DISTANCE>(partitions);
+	totalLength = positions[partitions];
+}
+
+template <typename DISTANCE, typename STYLE>
+void RunTree<DISTANCE, STYLE>::Check() const {
+	DISTANCE runs = 0;
+	DISTANCE length = 0;
+	Totals(root, height, runs, length);
+	if ((runs != totalRuns) || (length != totalLength)) {
+		throw std::runtime_error("RunTree: Totals differ from root.");
+	}
+	CheckNode(root, height);
+}
+
+// Find the first run at a position
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::RunFromPosition(DISTANCE position) const noexcept {
+	DISTANCE run = runs.PartitionFromPosition(position);
 	// Go to first element with this position
-	while ((run > 0) && (position == starts.PositionFromPartition(run-1))) {
+	while ((run > 0) && (position == runs.PositionFromPartition(run-1))) {
 		run--;
 	}
 	return run;
 }
 
 // If there is no run boundary at position, insert one continuing style.
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::SplitRun(DISTANCE position) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::SplitRun(DISTANCE position) {
 	DISTANCE run = RunFromPosition(position);
-	const DISTANCE posRun = starts.PositionFromPartition(run);
+	const DISTANCE posRun = runs.PositionFromPartition(run);
 	if (posRun < position) {
 		STYLE runStyle = ValueAt(position);
 		run++;
-		starts.InsertPartition(run, position);
-		styles.InsertValue(run, 1, runStyle);
+		runs.InsertPartition(run, position, runStyle);
 	}
 	return run;
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::RemoveRun(DISTANCE run) {
-	starts.RemovePartition(run);
-	styles.DeleteRange(run, 1);
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::RemoveRun(DISTANCE run) {
+	runs.RemovePartition(run);
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::RemoveRunIfEmpty(DISTANCE run) {
-	if ((run < starts.Partitions()) && (starts.Partitions() > 1)) {
-		if (starts.PositionFromPartition(run) == starts.PositionFromPartition(run+1)) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::RemoveRunIfEmpty(DISTANCE run) {
+	if ((run < runs.Partitions()) && (runs.Partitions() > 1)) {
+		if (runs.PositionFromPartition(run) == runs.PositionFromPartition(run+1)) {
 			RemoveRun(run);
 		}
 	}
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::RemoveRunIfSameAsPrevious(DISTANCE run) {
-	if ((run > 0) && (run < starts.Partitions())) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::RemoveRunIfSameAsPrevious(DISTANCE run) {
+	if ((run > 0) && (run < runs.Partitions())) {
 		const DISTANCE runBefore = run - 1;
-		if (styles.ValueAt(runBefore) == styles.ValueAt(run)) {
+		if (runs.ValueAt(runBefore) == runs.ValueAt(run)) {
 			RemoveRun(run);
 		}
 	}
 }
 
-template <typename DISTANCE, typename STYLE>
-RunStyles<DISTANCE, STYLE>::RunStyles() {
-	starts = Partitioning<DISTANCE>(8);
-	styles = SplitVector<STYLE>();
-	styles.InsertValue(0, 2, 0);
+template <typename DISTANCE, typename STYLE, typename RUNS>
+RunStyles<DISTANCE, STYLE, RUNS>::RunStyles() {
 }
 
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::Length() const noexcept {
-	return starts.PositionFromPartition(starts.Partitions());
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::Length() const noexcept {
+	return runs.PositionFromPartition(runs.Partitions());
 }
 
-template <typename DISTANCE, typename STYLE>
-STYLE RunStyles<DISTANCE, STYLE>::ValueAt(DISTANCE position) const noexcept {
-	return styles.ValueAt(starts.PartitionFromPosition(position));
+template <typename DISTANCE, typename STYLE, typename RUNS>
+STYLE RunStyles<DISTANCE, STYLE, RUNS>::ValueAt(DISTANCE position) const noexcept {
+	return runs.ValueAt(runs.PartitionFromPosition(position));
 }
 
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::FindNextChange(DISTANCE position, DISTANCE end) const noexcept {
-	const DISTANCE run = starts.PartitionFromPosition(position);
-	if (run < starts.Partitions()) {
-		const DISTANCE runChange = starts.PositionFromPartition(run);
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::FindNextChange(DISTANCE position, DISTANCE end) const noexcept {
+	const DISTANCE run = runs.PartitionFromPosition(position);
+	if (run < runs.Partitions()) {
+		const DISTANCE runChange = runs.PositionFromPartition(run);
 		if (runChange > position)
 			return runChange;
-		const DISTANCE nextChange = starts.PositionFromPartition(run + 1);
+		const DISTANCE nextChange = runs.PositionFromPartition(run + 1);
 		if (nextChange > position) {
 			return nextChange;
 		} else if (position < end) {
@@ -115,18 +593,18 @@ DISTANCE RunStyles<DISTANCE, STYLE>::FindNextChange(DISTANCE position, DISTANCE
 	}
 }
 
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::StartRun(DISTANCE position) const noexcept {
-	return starts.PositionFromPartition(starts.PartitionFromPosition(position));
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::StartRun(DISTANCE position) const noexcept {
+	return runs.PositionFromPartition(runs.PartitionFromPosition(position));
 }
 
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::EndRun(DISTANCE position) const noexcept {
-	return starts.PositionFromPartition(starts.PartitionFromPosition(position) + 1);
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::EndRun(DISTANCE position) const noexcept {
+	return runs.PositionFromPartition(runs.PartitionFromPosition(position) + 1);
 }
 
-template <typename DISTANCE, typename STYLE>
-FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, STYLE value, DISTANCE fillLength) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+FillResult<DISTANCE> RunStyles<DISTANCE, STYLE, RUNS>::FillRange(DISTANCE position, STYLE value, DISTANCE fillLength) {
 	const FillResult<DISTANCE> resultNoChange{false, position, fillLength};
 	if (fillLength <= 0) {
 		return resultNoChange;
@@ -136,9 +614,9 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 		return resultNoChange;
 	}
 	DISTANCE runEnd = RunFromPosition(end);
-	if (styles.ValueAt(runEnd) == value) {
+	if (runs.ValueAt(runEnd) == value) {
 		// End already has value so trim range.
-		end = starts.PositionFromPartition(runEnd);
+		end = runs.PositionFromPartition(runEnd);
 		if (position >= end) {
 			// Whole range is already same as value so no action
 			return resultNoChange;
@@ -148,20 +626,20 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 		runEnd = SplitRun(end);
 	}
 	DISTANCE runStart = RunFromPosition(position);
-	if (styles.ValueAt(runStart) == value) {
+	if (runs.ValueAt(runStart) == value) {
 		// Start is in expected value so trim range.
 		runStart++;
-		position = starts.PositionFromPartition(runStart);
+		position = runs.PositionFromPartition(runStart);
 		fillLength = end - position;
 	} else {
-		if (starts.PositionFromPartition(runStart) < position) {
+		if (runs.PositionFromPartition(runStart) < position) {
 			runStart = SplitRun(position);
 			runEnd++;
 		}
 	}
 	if (runStart < runEnd) {
 		const FillResult<DISTANCE> result{ true, position, fillLength };
-		styles.SetValueAt(runStart, value);
+		runs.SetValueAt(runStart, value);
 		// Remove each old run over the range
 		for (DISTANCE run=runStart+1; run<runEnd; run++) {
 			RemoveRun(runStart+1);
@@ -177,60 +655,112 @@ FillResult<DISTANCE> RunStyles<DISTANCE, STYLE>::FillRange(DISTANCE position, ST
 	}
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::SetValueAt(DISTANCE position, STYLE value) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::SetValueAt(DISTANCE position, STYLE value) {
 	FillRange(position, value, 1);
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::InsertSpace(DISTANCE position, DISTANCE insertLength) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+FillResult<DISTANCE> RunStyles<DISTANCE, STYLE, RUNS>::FillRanges(const DISTANCE *bounds, size_t ranges, STYLE value) {
+	FillResult<DISTANCE> result { false, 0, 0 };
+	bool build = (value != STYLE()) && AllSameAs(STYLE());
+	DISTANCE previousEnd = 0;
+	for (size_t range = 0; build && (range < ranges); range++) {
+		build = (bounds[range * 2] >= previousEnd) && (bounds[range * 2 + 1] >= bounds[range * 2]);
+		previousEnd = bounds[range * 2 + 1];
+	}
+	if (build && (previousEnd <= Length())) {
+		std::vector<DISTANCE> positions(1, 0);
+		std::vector<STYLE> values;
+		for (size_t range = 0; range < ranges; range++) {
+			const DISTANCE start = bounds[range * 2];
+			const DISTANCE end = bounds[range * 2 + 1];
+			if (start == end) {
+				continue;
+			}
+			if (!result.changed) {
+				result = { true, start, 0 };
+			}
+			result.fillLength = end - result.position;
+			if (start > positions.back()) {
+				values.push_back(STYLE());
+				positions.push_back(start);
+			} else if (!values.empty()) {
+				// Touches the previous range
+				positions.back() = end;
+				continue;
+			}
+			values.push_back(value);
+			positions.push_back(end);
+		}
+		if (result.changed) {
+			if (positions.back() < Length()) {
+				values.push_back(STYLE());
+				positions.push_back(Length());
+			}
+			runs.Assign(positions.data(), values.data(), values.size());
+		}
+		return result;
+	}
+	for (size_t range = 0; range < ranges; range++) {
+		const FillResult<DISTANCE> fr = FillRange(bounds[range * 2], value, bounds[range * 2 + 1] - bounds[range * 2]);
+		if (fr.changed) {
+			const DISTANCE end = result.changed ?
+				std::max(result.position + result.fillLength, fr.position + fr.fillLength) : fr.position + fr.fillLength;
+			result.position = result.changed ? std::min(result.position, fr.position) : fr.position;
+			result.fillLength = end - result.position;
+			result.changed = true;
+		}
+	}
+	return result;
+}
+
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::InsertSpace(DISTANCE position, DISTANCE insertLength) {
 	DISTANCE runStart = RunFromPosition(position);
-	if (starts.PositionFromPartition(runStart) == position) {
+	if (runs.PositionFromPartition(runStart) == position) {
 		STYLE runStyle = ValueAt(position);
 		// Inserting at start of run so make previous longer
 		if (runStart == 0) {
 			// Inserting at start of document so ensure 0
 			if (runStyle) {
-				styles.SetValueAt(0, STYLE());
-				starts.InsertPartition(1, 0);
-				styles.InsertValue(1, 1, runStyle);
-				starts.InsertText(0, insertLength);
+				runs.SetValueAt(0, STYLE());
+				runs.InsertPartition(1, 0, runStyle);
+				runs.InsertText(0, insertLength);
 			} else {
-				starts.InsertText(runStart, insertLength);
+				runs.InsertText(runStart, insertLength);
 			}
 		} else {
 			if (runStyle) {
-				starts.InsertText(runStart-1, insertLength);
+				runs.InsertText(runStart-1, insertLength);
 			} else {
 				// Insert at end of run so do not extend style
-				starts.InsertText(runStart, insertLength);
+				runs.InsertText(runStart, insertLength);
 			}
 		}
 	} else {
-		starts.InsertText(runStart, insertLength);
+		runs.InsertText(runStart, insertLength);
 	}
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::DeleteAll() {
-	starts = Partitioning<DISTANCE>(8);
-	styles = SplitVector<STYLE>();
-	styles.InsertValue(0, 2, 0);
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::DeleteAll() {
+	runs.Clear();
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::DeleteRange(DISTANCE position, DISTANCE deleteLength) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::DeleteRange(DISTANCE position, DISTANCE deleteLength) {
 	DISTANCE end = position + deleteLength;
 	DISTANCE runStart = RunFromPosition(position);
 	DISTANCE runEnd = RunFromPosition(end);
 	if (runStart == runEnd) {
 		// Deleting from inside one run
-		starts.InsertText(runStart, -deleteLength);
+		runs.InsertText(runStart, -deleteLength);
 		RemoveRunIfEmpty(runStart);
 	} else {
 		runStart = SplitRun(position);
 		runEnd = SplitRun(end);
-		starts.InsertText(runStart, -deleteLength);
+		runs.InsertText(runStart, -deleteLength);
 		// Remove each old run over the range
 		for (DISTANCE run=runStart; run<runEnd; run++) {
 			RemoveRun(runStart);
@@ -240,53 +770,51 @@ void RunStyles<DISTANCE, STYLE>::DeleteRange(DISTANCE position, DISTANCE deleteL
 	}
 }
 
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::Runs() const noexcept {
-	return starts.Partitions();
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::Runs() const noexcept {
+	return runs.Partitions();
 }
 
-template <typename DISTANCE, typename STYLE>
-bool RunStyles<DISTANCE, STYLE>::AllSame() const noexcept {
-	for (DISTANCE run = 1; run < starts.Partitions(); run++) {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+bool RunStyles<DISTANCE, STYLE, RUNS>::AllSame() const noexcept {
+	for (DISTANCE run = 1; run < runs.Partitions(); run++) {
 		const DISTANCE runBefore = run - 1;
-		if (styles.ValueAt(run) != styles.ValueAt(runBefore))
+		if (runs.ValueAt(run) != runs.ValueAt(runBefore))
 			return false;
 	}
 	return true;
 }
 
-template <typename DISTANCE, typename STYLE>
-bool RunStyles<DISTANCE, STYLE>::AllSameAs(STYLE value) const noexcept {
-	return AllSame() && (styles.ValueAt(0) == value);
+template <typename DISTANCE, typename STYLE, typename RUNS>
+bool RunStyles<DISTANCE, STYLE, RUNS>::AllSameAs(STYLE value) const noexcept {
+	return AllSame() && (runs.ValueAt(0) == value);
 }
 
-template <typename DISTANCE, typename STYLE>
-DISTANCE RunStyles<DISTANCE, STYLE>::Find(STYLE value, DISTANCE start) const noexcept {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+DISTANCE RunStyles<DISTANCE, STYLE, RUNS>::Find(STYLE value, DISTANCE start) const noexcept {
 	if (start < Length()) {
 		DISTANCE run = start ? RunFromPosition(start) : 0;
-		if (styles.ValueAt(run) == value)
+		if (runs.ValueAt(run) == value)
 			return start;
 		run++;
-		while (run < starts.Partitions()) {
-			if (styles.ValueAt(run) == value)
-				return starts.PositionFromPartition(run);
+		while (run < runs.Partitions()) {
+			if (runs.ValueAt(run) == value)
+				return runs.PositionFromPartition(run);
 			run++;
 		}
 	}
 	return -1;
 }
 
-template <typename DISTANCE, typename STYLE>
-void RunStyles<DISTANCE, STYLE>::Check() const {
+template <typename DISTANCE, typename STYLE, typename RUNS>
+void RunStyles<DISTANCE, STYLE, RUNS>::Check() const {
 	if (Length() < 0) {
 		throw std::runtime_error("RunStyles: Length can not be negative.");
 	}
-	if (starts.Partitions() < 1) {
+	if (runs.Partitions() < 1) {
 		throw std::runtime_error("RunStyles: Must always have 1 or more partitions.");
 	}
-	if (starts.Partitions() != styles.Length()-1) {
-		throw std::runtime_error("RunStyles: Partitions and styles different lengths.");
-	}
+	runs.Check();
 	DISTANCE start=0;
 	while (start < Length()) {
 		const DISTANCE end = EndRun(start);
@@ -295,11 +823,8 @@ void RunStyles<DISTANCE, STYLE>::Check() const {
 		}
 		start = end;
 	}
-	if (styles.ValueAt(styles.Length()-1) != 0) {
-		throw std::runtime_error("RunStyles: Unused style at end changed.");
-	}
-	for (ptrdiff_t j=1; j<styles.Length()-1; j++) {
-		if (styles.ValueAt(j) == styles.ValueAt(j-1)) {
+	for (DISTANCE j=1; j<runs.Partitions(); j++) {
+		if (runs.ValueAt(j) == runs.ValueAt(j-1)) {
 			throw std::runtime_error("RunStyles: Style of a partition same as previous.");
 		}
 	}
@@ -307,7 +832,11 @@ void RunStyles<DISTANCE, STYLE>::Check() const {
 
 template class Scintilla::Internal::RunStyles<int, int>;
 template class Scintilla::Internal::RunStyles<int, char>;
+template class Scintilla::Internal::RunTree<int, int>;
+template class Scintilla::Internal::RunStyles<int, int, RunTree<int, int>>;
 #if (PTRDIFF_MAX != INT_MAX) || defined(__HAIKU__)
 template class Scintilla::Internal::RunStyles<ptrdiff_t, int>;
 template class Scintilla::Internal::RunStyles<ptrdiff_t, char>;
+template class Scintilla::Internal::RunTree<ptrdiff_t, int>;
+template class Scintilla::Internal::RunStyles<ptrdiff_t, int, RunTree<ptrdiff_t, int>>;
 #endif
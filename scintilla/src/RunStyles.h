@@ -22,11 +22,139 @@ struct FillResult {
 	DISTANCE fillLength;
 };
 
+// Storage for RunStyles. Runs are partitions of the positions and each has a style.
+// RunList holds partition starts and styles in gap buffers which is fast when changes are
+// close together but moves many elements for changes scattered over a long document.
 template <typename DISTANCE, typename STYLE>
-class RunStyles {
-private:
+class RunList {
 	Partitioning<DISTANCE> starts;
 	SplitVector<STYLE> styles;
+public:
+	RunList() {
+		Clear();
+	}
+	void Clear() {
+		starts = Partitioning<DISTANCE>(8);
+		styles = SplitVector<STYLE>();
+		styles.InsertValue(0, 2, STYLE());
+	}
+	DISTANCE Partitions() const noexcept {
+		return starts.Partitions();
+	}
+	DISTANCE Length() const noexcept {
+		return starts.Length();
+	}
+	DISTANCE PositionFromPartition(DISTANCE partition) const noexcept {
+		return starts.PositionFromPartition(partition);
+	}
+	DISTANCE PartitionFromPosition(DISTANCE pos) const noexcept {
+		return starts.PartitionFromPosition(pos);
+	}
+	STYLE ValueAt(DISTANCE partition) const noexcept {
+		return styles.ValueAt(partition);
+	}
+	void SetValueAt(DISTANCE partition, STYLE value) {
+		styles.SetValueAt(partition, value);
+	}
+	// Split the partition before at pos with the new partition having value.
+	void InsertPartition(DISTANCE partition, DISTANCE pos, STYLE value) {
+		starts.InsertPartition(partition, pos);
+		styles.InsertValue(partition, 1, value);
+	}
+	void RemovePartition(DISTANCE partition) {
+		starts.RemovePartition(partition);
+		styles.DeleteRange(partition, 1);
+	}
+	void InsertText(DISTANCE partition, DISTANCE delta) noexcept {
+		starts.InsertText(partition, delta);
+	}
+	// Replace all partitions. positions has one more element than values.
+	void Assign(const DISTANCE *positions, const STYLE *values, size_t partitions) {
+		starts.Assign(positions, partitions + 1);
+		styles = SplitVector<STYLE>();
+		styles.InsertFromArray(0, values, 0, partitions);
+		styles.InsertValue(partitions, 1, STYLE());
+	}
+	void Check() const {
+		if (starts.Partitions() != styles.Length()-1) {
+			throw std::runtime_error("RunStyles: Partitions and styles different lengths.");
+		}
+		if (styles.ValueAt(styles.Length()-1) != STYLE()) {
+			throw std::runtime_error("RunStyles: Unused style at end changed.");
+		}
+	}
+};
+
+// RunTree holds runs in a B+tree counted by both runs and length so finding, splitting and
+// removing runs anywhere takes logarithmic time. Nodes are stored in vectors and refer to
+// each other by index.
+template <typename DISTANCE, typename STYLE>
+class RunTree {
+	static constexpr int nodeSize = 32;
+	static constexpr int nodeMin = nodeSize / 4;
+	struct Leaf {
+		int count = 0;
+		DISTANCE lengths[nodeSize] {};
+		STYLE values[nodeSize] {};
+		void Append(const Leaf &other, int start, int n) noexcept;
+		void Prepend(const Leaf &other, int start, int n) noexcept;
+		void Erase(int start, int n) noexcept;
+	};
+	struct Branch {
+		int count = 0;
+		DISTANCE lengths[nodeSize] {};
+		DISTANCE runs[nodeSize] {};
+		int children[nodeSize] {};
+		void Append(const Branch &other, int start, int n) noexcept;
+		void Prepend(const Branch &other, int start, int n) noexcept;
+		void Erase(int start, int n) noexcept;
+	};
+	std::vector<Leaf> leaves;
+	std::vector<Branch> branches;
+	std::vector<int> freeLeaves;
+	std::vector<int> freeBranches;
+	int root = 0;
+	int height = 0;	// Levels of branches above the leaves
+	DISTANCE totalRuns = 0;
+	DISTANCE totalLength = 0;
+	int AllocateLeaf();
+	int AllocateBranch();
+	int Count(int node, int level) const noexcept;
+	void Totals(int node, int level, DISTANCE &runs, DISTANCE &length) const noexcept;
+	void SetChild(Branch &branch, int slot, int child, int level) const noexcept;
+	int LeafFor(DISTANCE &partition) const noexcept;
+	int InsertAt(int node, int level, DISTANCE index, DISTANCE length, STYLE value);
+	DISTANCE EraseAt(int node, int level, DISTANCE index);
+	template <typename NODE>
+	static bool Balance(NODE &first, NODE &second) noexcept;
+	void Rebalance(int node, int level, int slot);
+	void InsertRun(DISTANCE run, DISTANCE length, STYLE value);
+	DISTANCE EraseRun(DISTANCE run);
+	void CheckNode(int node, int level) const;
+public:
+	RunTree() {
+		Clear();
+	}
+	void Clear();
+	DISTANCE Partitions() const noexcept;
+	DISTANCE Length() const noexcept;
+	DISTANCE PositionFromPartition(DISTANCE partition) const noexcept;
+	DISTANCE PartitionFromPosition(DISTANCE pos) const noexcept;
+	STYLE ValueAt(DISTANCE partition) const noexcept;
+	void SetValueAt(DISTANCE partition, STYLE value) noexcept;
+	void InsertPartition(DISTANCE partition, DISTANCE pos, STYLE value);
+	void RemovePartition(DISTANCE partition);
+	void InsertText(DISTANCE partition, DISTANCE delta) noexcept;
+	void Assign(const DISTANCE *positions, const STYLE *values, size_t partitions);
+	void Check() const;
+};
+
+// The storage used is selected with RUNS: RunList suits styles that change in one area at a
+// time while RunTree suits many runs changed in any order like indicators over a document.
+template <typename DISTANCE, typename STYLE, typename RUNS = RunList<DISTANCE, STYLE>>
+class RunStyles {
+private:
+	RUNS runs;
 	DISTANCE RunFromPosition(DISTANCE position) const noexcept;
 	DISTANCE SplitRun(DISTANCE position);
 	void RemoveRun(DISTANCE run);
@@ -41,6 +169,9 @@ public:
 	DISTANCE EndRun(DISTANCE position) const noexcept;
 	// Returns changed=true if some values may have changed
 	FillResult<DISTANCE> FillRange(DISTANCE position, STYLE value, DISTANCE fillLength);
+	// Fill ranges given as start and end pairs in bounds which are in order and do not
+	// overlap. When all the values are 0, the runs are built at once.
+	FillResult<DISTANCE> FillRanges(const DISTANCE *bounds, size_t ranges, STYLE value);
 	void SetValueAt(DISTANCE position, STYLE value);
 	void InsertSpace(DISTANCE position, DISTANCE insertLength);
 	void DeleteAll();
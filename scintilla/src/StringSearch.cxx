@@ -0,0 +1,469 @@
+// Scintilla source code edit control
+/** @file StringSearch.cxx
+ ** Fast exact substring search over contiguous text.
+ ** Candidates are found a block at a time by matching both the first and last bytes
+ ** of the needle with SIMD compares then verified with memcmp.
+ ** When there are too many false candidates, as with repetitive text, the search
+ ** switches to the Two-Way algorithm which is linear in the worst case.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SCI_SEARCH_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SCI_SEARCH_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "StringSearch.h"
+
+using namespace Scintilla::Internal;
+
+namespace {
+
+constexpr size_t blockSize = 16;
+
+// Indexes a byte sequence either forwards or from the end so the Two-Way search
+// can find the last occurrence by searching the reversed text for the reversed needle.
+template <bool reverse>
+class Bytes {
+	const unsigned char *data;
+	ptrdiff_t length;
+public:
+	explicit Bytes(std::string_view sv) noexcept :
+		data(reinterpret_cast<const unsigned char *>(sv.data())), length(sv.length()) {
+	}
+	unsigned char operator[](ptrdiff_t i) const noexcept {
+		if constexpr (reverse) {
+			return data[length - 1 - i];
+		} else {
+			return data[i];
+		}
+	}
+};
+
+// Start of the maximal suffix of needle under an ordering and its period.
+// Returns -1 when the whole needle is the maximal suffix.
+template <bool reverse>
+ptrdiff_t MaximalSuffix(const Bytes<reverse> &x, ptrdiff_t m, bool inverted, ptrdiff_t &period) noexcept {
+	ptrdiff_t ms = -1;
+	ptrdiff_t j = 0;
+	ptrdiff_t k = 1;
+	period = 1;
+	while (j + k < m) {
+		const unsigned char a = x[j + k];
+		const unsigned char b = x[ms + k];
+		if (inverted ? (a > b) : (a < b)) {
+			j += k;
+			k = 1;
+			period = j - ms;
+		} else if (a == b) {
+			if (k != period) {
+				k++;
+			} else {
+				j += period;
+				k = 1;
+			}
+		} else {
+			ms = j;
+			j = ms + 1;
+			k = 1;
+			period = 1;
+		}
+	}
+	return ms;
+}
+
+// Crochemore-Perrin Two-Way string matching: O(n + m) time and O(1) space.
+template <bool reverse>
+ptrdiff_t TwoWay(std::string_view text, std::string_view needle) noexcept {
+	const Bytes<reverse> y(text);
+	const Bytes<reverse> x(needle);
+	const ptrdiff_t n = text.length();
+	const ptrdiff_t m = needle.length();
+
+	ptrdiff_t period1 = 1;
+	ptrdiff_t period2 = 1;
+	const ptrdiff_t ms1 = MaximalSuffix(x, m, false, period1);
+	const ptrdiff_t ms2 = MaximalSuffix(x, m, true, period2);
+	const ptrdiff_t ell = (ms1 > ms2) ? ms1 : ms2;
+	ptrdiff_t period = (ms1 > ms2) ? period1 : period2;
+
+	bool periodic = (period + ell + 1) <= m;
+	for (ptrdiff_t i = 0; periodic && (i <= ell); i++) {
+		periodic = x[i] == x[i + period];
+	}
+
+	ptrdiff_t j = 0;
+	if (periodic) {
+		ptrdiff_t memory = -1;
+		while (j <= n - m) {
+			ptrdiff_t i = ((ell > memory) ? ell : memory) + 1;
+			while (i < m && x[i] == y[i + j]) {
+				i++;
+			}
+			if (i >= m) {
+				i = ell;
+				while (i > memory && x[i] == y[i + j]) {
+					i--;
+				}
+				if (i <= memory) {
+					return j;
+				}
+				j += period;
+				memory = m - period - 1;
+			} else {
+				j += i - ell;
+				memory = -1;
+			}
+		}
+	} else {
+		period = ((ell + 1 > m - ell - 1) ? (ell + 1) : (m - ell - 1)) + 1;
+		while (j <= n - m) {
+			ptrdiff_t i = ell + 1;
+			while (i < m && x[i] == y[i + j]) {
+				i++;
+			}
+			if (i >= m) {
+				i = ell;
+				while (i >= 0 && x[i] == y[i + j]) {
+					i--;
+				}
+				if (i < 0) {
+					return j;
+				}
+				j += period;
+			} else {
+				j += i - ell;
+			}
+		}
+	}
+	return -1;
+}
+
+// Candidate verification is cheap while it mostly succeeds or is rare. Once it has
+// failed this often and more than once per this many bytes, use Two-Way instead.
+constexpr size_t minimumFailures = 64;
+constexpr size_t bytesPerFailure = 8;
+
+bool TooManyFailures(size_t failures, size_t scanned) noexcept {
+	return (failures > minimumFailures) && (failures * bytesPerFailure > scanned);
+}
+
+#if defined(SCI_SEARCH_SSE2) || defined(SCI_SEARCH_NEON)
+
+unsigned int LowestBit(unsigned int mask) noexcept {
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+unsigned int HighestBit(unsigned int mask) noexcept {
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanReverse(&index, mask);
+	return index;
+#else
+	return 31 - __builtin_clz(mask);
+#endif
+}
+
+#if defined(SCI_SEARCH_SSE2)
+
+class FirstLast {
+	__m128i first;
+	__m128i last;
+public:
+	FirstLast(char first_, char last_) noexcept :
+		first(_mm_set1_epi8(first_)), last(_mm_set1_epi8(last_)) {
+	}
+	// Bit i set when a needle may start at block + i
+	unsigned int Candidates(const char *block, size_t lastOffset) const noexcept {
+		const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+		const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + lastOffset));
+		const __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last));
+		return static_cast<unsigned int>(_mm_movemask_epi8(eq));
+	}
+};
+
+class PairOrHigh {
+	__m128i a;
+	__m128i b;
+public:
+	PairOrHigh(char a_, char b_) noexcept :
+		a(_mm_set1_epi8(a_)), b(_mm_set1_epi8(b_)) {
+	}
+	// Bit i set when block[i] is a, b or not ASCII
+	unsigned int Stops(const char *block) const noexcept {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+		const __m128i eq = _mm_or_si128(_mm_cmpeq_epi8(bytes, a), _mm_cmpeq_epi8(bytes, b));
+		return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(eq, bytes)));
+	}
+};
+
+class LineEndBytes {
+	__m128i cr;
+	__m128i lf;
+	__m128i nel;
+	__m128i lsps;
+	__m128i lowBitClear;
+	bool unicode;
+public:
+	explicit LineEndBytes(bool unicode_) noexcept :
+		cr(_mm_set1_epi8('\r')), lf(_mm_set1_epi8('\n')), nel(_mm_set1_epi8(static_cast<char>(0x85))),
+		lsps(_mm_set1_epi8(static_cast<char>(0xA8))), lowBitClear(_mm_set1_epi8(static_cast<char>(0xFE))),
+		unicode(unicode_) {
+	}
+	// Bit i set when block[i] may end a line
+	unsigned int Stops(const char *block) const noexcept {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+		__m128i eq = _mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, lf));
+		if (unicode) {
+			// 0xA8 and 0xA9 end LS and PS
+			eq = _mm_or_si128(eq, _mm_or_si128(_mm_cmpeq_epi8(bytes, nel),
+				_mm_cmpeq_epi8(_mm_and_si128(bytes, lowBitClear), lsps)));
+		}
+		return static_cast<unsigned int>(_mm_movemask_epi8(eq));
+	}
+};
+
+#else
+
+// NEON has no movemask: weight each lane by its bit then sum each half
+unsigned int MoveMask(uint8x16_t lanes) noexcept {
+	static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	const uint8x16_t bits = vandq_u8(lanes, vld1q_u8(weights));
+	return vaddv_u8(vget_low_u8(bits)) | (vaddv_u8(vget_high_u8(bits)) << 8);
+}
+
+class FirstLast {
+	uint8x16_t first;
+	uint8x16_t last;
+public:
+	FirstLast(char first_, char last_) noexcept :
+		first(vdupq_n_u8(static_cast<uint8_t>(first_))), last(vdupq_n_u8(static_cast<uint8_t>(last_))) {
+	}
+	// Bit i set when a needle may start at block + i
+	unsigned int Candidates(const char *block, size_t lastOffset) const noexcept {
+		const uint8x16_t blockFirst = vld1q_u8(reinterpret_cast<const uint8_t *>(block));
+		const uint8x16_t blockLast = vld1q_u8(reinterpret_cast<const uint8_t *>(block + lastOffset));
+		return MoveMask(vandq_u8(vceqq_u8(blockFirst, first), vceqq_u8(blockLast, last)));
+	}
+};
+
+class PairOrHigh {
+	uint8x16_t a;
+	uint8x16_t b;
+public:
+	PairOrHigh(char a_, char b_) noexcept :
+		a(vdupq_n_u8(static_cast<uint8_t>(a_))), b(vdupq_n_u8(static_cast<uint8_t>(b_))) {
+	}
+	// Bit i set when block[i] is a, b or not ASCII
+	unsigned int Stops(const char *block) const noexcept {
+		const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(block));
+		const uint8x16_t eq = vorrq_u8(vceqq_u8(bytes, a), vceqq_u8(bytes, b));
+		return MoveMask(vorrq_u8(eq, vcgeq_u8(bytes, vdupq_n_u8(0x80))));
+	}
+};
+
+class LineEndBytes {
+	bool unicode;
+public:
+	explicit LineEndBytes(bool unicode_) noexcept : unicode(unicode_) {
+	}
+	// Bit i set when block[i] may end a line
+	unsigned int Stops(const char *block) const noexcept {
+		const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(block));
+		uint8x16_t eq = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\r')), vceqq_u8(bytes, vdupq_n_u8('\n')));
+		if (unicode) {
+			// 0xA8 and 0xA9 end LS and PS
+			eq = vorrq_u8(eq, vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(0x85)),
+				vceqq_u8(vandq_u8(bytes, vdupq_n_u8(0xFE)), vdupq_n_u8(0xA8))));
+		}
+		return MoveMask(eq);
+	}
+};
+
+#endif
+
+#endif
+
+bool MatchesAt(const char *candidate, std::string_view needle) noexcept {
+	// First and last bytes already matched
+	return memcmp(candidate + 1, needle.data() + 1, needle.length() - 2) == 0;
+}
+
+}
+
+size_t Scintilla::Internal::SearchForward(std::string_view text, std::string_view needle) noexcept {
+	const size_t m = needle.length();
+	if (m == 0) {
+		return 0;
+	}
+	if (m > text.length()) {
+		return std::string_view::npos;
+	}
+	if (m == 1) {
+		const void *found = memchr(text.data(), needle[0], text.length());
+		return found ? static_cast<const char *>(found) - text.data() : std::string_view::npos;
+	}
+	// Last position a match can start
+	const size_t lastStart = text.length() - m;
+	size_t position = 0;
+	size_t failures = 0;
+#if defined(SCI_SEARCH_SSE2) || defined(SCI_SEARCH_NEON)
+	const FirstLast firstLast(needle[0], needle[m - 1]);
+	while (position + blockSize <= lastStart + 1) {
+		unsigned int mask = firstLast.Candidates(text.data() + position, m - 1);
+		while (mask) {
+			const size_t candidate = position + LowestBit(mask);
+			if (MatchesAt(text.data() + candidate, needle)) {
+				return candidate;
+			}
+			failures++;
+			mask &= mask - 1;
+		}
+		position += blockSize;
+		if (TooManyFailures(failures, position)) {
+			break;
+		}
+	}
+#endif
+	while (position <= lastStart) {
+		if (TooManyFailures(failures, position)) {
+			const ptrdiff_t found = TwoWay<false>(text.substr(position), needle);
+			return (found >= 0) ? position + found : std::string_view::npos;
+		}
+		if (text[position] == needle[0] && text[position + m - 1] == needle[m - 1]) {
+			if (MatchesAt(text.data() + position, needle)) {
+				return position;
+			}
+			failures++;
+		}
+		position++;
+	}
+	return std::string_view::npos;
+}
+
+size_t Scintilla::Internal::SearchBackward(std::string_view text, std::string_view needle) noexcept {
+	const size_t m = needle.length();
+	if (m == 0) {
+		return text.length();
+	}
+	if (m > text.length()) {
+		return std::string_view::npos;
+	}
+	// Candidate starts not yet examined are [0, end)
+	size_t end = text.length() - m + 1;
+	size_t failures = 0;
+#if defined(SCI_SEARCH_SSE2) || defined(SCI_SEARCH_NEON)
+	const FirstLast firstLast(needle[0], needle[m - 1]);
+	while (end >= blockSize) {
+		const size_t block = end - blockSize;
+		unsigned int mask = firstLast.Candidates(text.data() + block, m - 1);
+		while (mask) {
+			const unsigned int bit = HighestBit(mask);
+			const size_t candidate = block + bit;
+			if ((m == 1) || MatchesAt(text.data() + candidate, needle)) {
+				return candidate;
+			}
+			failures++;
+			mask &= ~(1U << bit);
+		}
+		end = block;
+		if (TooManyFailures(failures, text.length() - end)) {
+			break;
+		}
+	}
+#endif
+	while (end > 0) {
+		if (TooManyFailures(failures, text.length() - end)) {
+			// Search the reversed prefix that could still hold a match
+			const std::string_view prefix = text.substr(0, end + m - 1);
+			const ptrdiff_t found = TwoWay<true>(prefix, needle);
+			return (found >= 0) ? prefix.length() - found - m : std::string_view::npos;
+		}
+		const size_t candidate = end - 1;
+		if (text[candidate] == needle[0] && text[candidate + m - 1] == needle[m - 1]) {
+			if ((m == 1) || MatchesAt(text.data() + candidate, needle)) {
+				return candidate;
+			}
+			failures++;
+		}
+		end--;
+	}
+	return std::string_view::npos;
+}
+
+size_t Scintilla::Internal::SkipAsciiExcept(std::string_view text, char a, char b) noexcept {
+	size_t position = 0;
+#if defined(SCI_SEARCH_SSE2) || defined(SCI_SEARCH_NEON)
+	const PairOrHigh pairOrHigh(a, b);
+	while (position + blockSize <= text.length()) {
+		const unsigned int mask = pairOrHigh.Stops(text.data() + position);
+		if (mask) {
+			return position + LowestBit(mask);
+		}
+		position += blockSize;
+	}
+#endif
+	while (position < text.length()) {
+		const char ch = text[position];
+		if ((ch == a) || (ch == b) || (static_cast<unsigned char>(ch) >= 0x80)) {
+			break;
+		}
+		position++;
+	}
+	return position;
+}
+
+size_t Scintilla::Internal::SkipNonLineEnds(std::string_view text, bool unicode) noexcept {
+	size_t position = 0;
+#if defined(SCI_SEARCH_SSE2) || defined(SCI_SEARCH_NEON)
+	const LineEndBytes lineEndBytes(unicode);
+	// Lines are often longer than a block so examine 4 blocks at a time
+	constexpr size_t wideSize = blockSize * 4;
+	while (position + wideSize <= text.length()) {
+		const char *block = text.data() + position;
+		const unsigned int low = lineEndBytes.Stops(block) | (lineEndBytes.Stops(block + blockSize) << 16);
+		if (low) {
+			return position + LowestBit(low);
+		}
+		const unsigned int high = lineEndBytes.Stops(block + blockSize * 2) | (lineEndBytes.Stops(block + blockSize * 3) << 16);
+		if (high) {
+			return position + blockSize * 2 + LowestBit(high);
+		}
+		position += wideSize;
+	}
+	while (position + blockSize <= text.length()) {
+		const unsigned int mask = lineEndBytes.Stops(text.data() + position);
+		if (mask) {
+			return position + LowestBit(mask);
+		}
+		position += blockSize;
+	}
+#endif
+	while (position < text.length()) {
+		const unsigned char ch = text[position];
+		if ((ch == '\r') || (ch == '\n') || (unicode && ((ch == 0x85) || (ch == 0xA8) || (ch == 0xA9)))) {
+			break;
+		}
+		position++;
+	}
+	return position;
+}
@@ -0,0 +1,24 @@
+// Scintilla source code edit control
+/** @file StringSearch.h
+ ** Fast exact substring search over contiguous text.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef STRINGSEARCH_H
+#define STRINGSEARCH_H
+
+namespace Scintilla::Internal {
+
+/// Offset of the first occurrence of needle in text or std::string_view::npos.
+size_t SearchForward(std::string_view text, std::string_view needle) noexcept;
+/// Offset of the last occurrence of needle in text or std::string_view::npos.
+size_t SearchBackward(std::string_view text, std::string_view needle) noexcept;
+/// Length of the leading run of ASCII bytes in text other than a and b.
+size_t SkipAsciiExcept(std::string_view text, char a, char b) noexcept;
+/// Length of the leading run of bytes in text other than CR and LF and, with unicode, the last
+/// bytes of NEL, LS and PS. The bytes before those must be checked to confirm a line end.
+size_t SkipNonLineEnds(std::string_view text, bool unicode) noexcept;
+
+}
+
+#endif
@@ -5,10 +5,14 @@
 // Copyright 1998-2001 by Neil Hodgson <neilh@scintilla.org>
 // The License.txt file describes the conditions under which this software may be distributed.
 
+#include <cmath>
+
 #include <stdexcept>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <optional>
+#include <iterator>
 #include <memory>
 
 #include "ScintillaTypes.h"
@@ -55,6 +59,38 @@ bool FontSpecification::operator<(const FontSpecification &other) const noexcept
 
 namespace {
 
+// Latin, Greek and Cyrillic letters are rarely shaped beyond kerning and ligatures.
+// Combining marks and unassigned code points are left to the platform.
+struct CodePointRange {
+	unsigned int first;
+	unsigned int last;
+};
+constexpr CodePointRange simpleRanges[] = {
+	{ 0x20, 0x7E },
+	{ 0xA0, 0xAC },	// Not soft hyphen 0xAD which may be hidden
+	{ 0xAE, 0x24F },
+	{ 0x386, 0x386 },
+	{ 0x388, 0x38A },
+	{ 0x38C, 0x38C },
+	{ 0x38E, 0x3A1 },
+	{ 0x3A3, 0x3CE },
+	{ 0x400, 0x45F },
+};
+
+// Pairs that are commonly kerned or joined into ligatures
+constexpr std::string_view shapingSample = "AVAWAYTaToVaWaYoLTLVLYFaPafiflffiffTh\"A\'T.r.y,"
+	"\xCE\x93\xCE\x91\xCE\xA4\xCE\x91\xCE\xA5\xCE\x91"	// Greek ΓΑΤΑΥΑ
+	"\xD0\x93\xD0\x90\xD0\xA2\xD0\x90\xD0\xA3\xD0\xB0";	// Cyrillic ГАТАУа
+
+void AppendUTF8(std::string &s, unsigned int ch) {
+	if (ch < 0x80) {
+		s.push_back(static_cast<char>(ch));
+	} else {
+		s.push_back(static_cast<char>(0xC0 | (ch >> 6)));
+		s.push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+	}
+}
+
 // noexcept Platform::DefaultFontSize
 int DefaultFontSize() noexcept {
 	try {
@@ -83,3 +119,88 @@ void Style::Copy(std::shared_ptr<Font> font_, const FontMeasurements &fm_) noexc
 	font = std::move(font_);
 	(FontMeasurements &)(*this) = fm_;
 }
+
+std::shared_ptr<const GlyphAdvances> GlyphAdvances::Measure(Surface &surface, const Font *font) {
+	std::string text;
+	for (const CodePointRange &range : simpleRanges) {
+		for (unsigned int ch = range.first; ch <= range.last; ch++) {
+			AppendUTF8(text, ch);
+		}
+	}
+	std::vector<XYPOSITION> positions(text.length());
+	surface.MeasureWidthsUTF8(font, text, positions.data());
+
+	std::shared_ptr<GlyphAdvances> glyphs = std::make_shared<GlyphAdvances>();
+	glyphs->advances.resize(simpleRanges[std::size(simpleRanges) - 1].last + 1);
+	size_t end = 0;
+	XYPOSITION previous = 0;
+	for (const CodePointRange &range : simpleRanges) {
+		for (unsigned int ch = range.first; ch <= range.last; ch++) {
+			end += (ch < 0x80) ? 1 : 2;
+			const XYPOSITION advance = positions[end - 1] - previous;
+			previous = positions[end - 1];
+			// Zero width characters may be formatting so leave them to the platform
+			glyphs->advances[ch] = (advance > 0) ? advance : 0;
+		}
+	}
+
+	// Any kerning or ligatures make the run narrower or wider than the sum of its advances
+	std::vector<XYPOSITION> sample(shapingSample.length());
+	surface.MeasureWidthsUTF8(font, shapingSample, sample.data());
+	std::vector<XYPOSITION> summed(shapingSample.length());
+	if (!glyphs->MeasureWidthsUTF8(shapingSample, summed.data())) {
+		return {};
+	}
+	const XYPOSITION tolerance = previous / text.length() / 1000.0;
+	for (size_t i = 0; i < shapingSample.length(); i++) {
+		if (std::abs(sample[i] - summed[i]) > tolerance) {
+			return {};
+		}
+	}
+	return glyphs;
+}
+
+bool GlyphAdvances::MeasureWidthsUTF8(std::string_view text, XYPOSITION *positions) const noexcept {
+	XYPOSITION position = 0;
+	size_t i = 0;
+	while (i < text.length()) {
+		const unsigned char lead = text[i];
+		unsigned int ch = lead;
+		size_t width = 1;
+		if (lead >= 0x80) {
+			// Every character with an advance is encoded in 1 or 2 bytes
+			if (((lead & 0xE0) != 0xC0) || (i + 1 >= text.length())) {
+				return false;
+			}
+			const unsigned char trail = text[i + 1];
+			if ((trail & 0xC0) != 0x80) {
+				return false;
+			}
+			ch = ((lead & 0x1F) << 6) | (trail & 0x3F);
+			width = 2;
+		}
+		const XYPOSITION advance = Advance(ch);
+		if ((advance == 0) || ((width == 2) && (ch < 0x80))) {
+			return false;
+		}
+		position += advance;
+		for (size_t j = 0; j < width; j++) {
+			positions[i++] = position;
+		}
+	}
+	return true;
+}
+
+bool GlyphAdvances::MeasureWidths(std::string_view text, XYPOSITION *positions) const noexcept {
+	XYPOSITION position = 0;
+	for (size_t i = 0; i < text.length(); i++) {
+		const unsigned char ch = text[i];
+		const XYPOSITION advance = (ch < 0x80) ? Advance(ch) : 0;
+		if (advance == 0) {
+			return false;
+		}
+		position += advance;
+		positions[i] = position;
+	}
+	return true;
+}
@@ -28,6 +28,26 @@ struct FontSpecification {
 	bool operator<(const FontSpecification &other) const noexcept;
 };
 
+/**
+ * Advance widths of the characters of simple scripts in a font that places them without
+ * kerning, ligatures or other shaping so a run of them can be measured by summing advances.
+ */
+class GlyphAdvances {
+	// Indexed by code point with 0 for characters that must be measured by the platform
+	std::vector<XYPOSITION> advances;
+public:
+	/// Returns nullptr when the font shapes runs of these characters.
+	static std::shared_ptr<const GlyphAdvances> Measure(Surface &surface, const Font *font);
+	[[nodiscard]] XYPOSITION Advance(unsigned int ch) const noexcept {
+		return (ch < advances.size()) ? advances[ch] : 0;
+	}
+	/// Fill positions and return true when every character of text has an advance.
+	/// All bytes of a character are at the end of that character.
+	bool MeasureWidthsUTF8(std::string_view text, XYPOSITION *positions) const noexcept;
+	/// Single byte text can only be measured when it is all ASCII.
+	bool MeasureWidths(std::string_view text, XYPOSITION *positions) const noexcept;
+};
+
 struct FontMeasurements {
 	XYPOSITION ascent = 1;
 	XYPOSITION descent = 1;
@@ -37,6 +57,7 @@ struct FontMeasurements {
 	XYPOSITION spaceWidth = 1;
 	bool monospaceASCII = false;
 	int sizeZoomed = 2;
+	std::shared_ptr<const GlyphAdvances> advances;
 };
 
 /**
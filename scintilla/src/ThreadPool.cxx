@@ -0,0 +1,204 @@
+// Scintilla source code edit control
+/** @file ThreadPool.cxx
+ ** Persistent threads that share tasks for fork-join parallelism.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "ThreadPool.h"
+
+namespace Scintilla::Internal {
+
+namespace {
+
+// The tasks of one ForkJoin call which is queued once for each thread that should run it.
+struct Join {
+	const ThreadPool::Task *task;
+	std::atomic<unsigned int> remaining;
+	std::mutex mutexException;
+	std::exception_ptr exception;
+	Join(const ThreadPool::Task *task_, unsigned int participants) noexcept :
+		task(task_), remaining(participants) {
+	}
+};
+
+struct Queue {
+	std::mutex mutex;
+	std::deque<Join *> joins;
+};
+
+// Identifies pool threads so that tasks which fork use their own queue.
+thread_local const PoolState *currentPool = nullptr;
+thread_local unsigned int currentThread = 0;
+
+}
+
+struct PoolState {
+	std::vector<Queue> queues;
+	std::vector<std::thread> threads;
+	// Sleeping threads wait on wake which is notified when tasks are queued or joins finish.
+	std::mutex mutexWake;
+	std::condition_variable wake;
+	std::atomic<size_t> queued;
+	bool stopping;
+
+	explicit PoolState(unsigned int threads_) : queues(threads_), queued(0), stopping(false) {
+	}
+	// Deleted so PoolState objects can not be copied.
+	PoolState(const PoolState &) = delete;
+	PoolState(PoolState &&) = delete;
+	PoolState &operator=(const PoolState &) = delete;
+	PoolState &operator=(PoolState &&) = delete;
+	~PoolState() {
+		{
+			std::lock_guard<std::mutex> guard(mutexWake);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+	}
+
+	void Push(unsigned int thread, Join *join, unsigned int count) {
+		{
+			std::lock_guard<std::mutex> guard(mutexWake);
+			queued += count;
+		}
+		{
+			std::lock_guard<std::mutex> guard(queues[thread].mutex);
+			queues[thread].joins.insert(queues[thread].joins.end(), count, join);
+		}
+		wake.notify_all();
+	}
+
+	// Take the newest task from the thread's own queue or else the oldest from another queue.
+	Join *Take(unsigned int thread) {
+		const size_t count = queues.size();
+		for (size_t i = 0; i < count; i++) {
+			Queue &queue = queues[(thread + i) % count];
+			std::lock_guard<std::mutex> guard(queue.mutex);
+			if (!queue.joins.empty()) {
+				Join *join = nullptr;
+				if (i == 0) {
+					join = queue.joins.back();
+					queue.joins.pop_back();
+				} else {
+					join = queue.joins.front();
+					queue.joins.pop_front();
+				}
+				queued--;
+				return join;
+			}
+		}
+		return nullptr;
+	}
+
+	void Run(Join *join, unsigned int thread) {
+		try {
+			(*join->task)(thread);
+		} catch (...) {
+			std::lock_guard<std::mutex> guard(join->mutexException);
+			if (!join->exception) {
+				join->exception = std::current_exception();
+			}
+		}
+		// The joining thread may destroy join as soon as remaining reaches 0
+		if (join->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			{
+				std::lock_guard<std::mutex> guard(mutexWake);
+			}
+			wake.notify_all();
+		}
+	}
+
+	void Work(unsigned int thread) {
+		currentPool = this;
+		currentThread = thread;
+		while (true) {
+			Join *join = Take(thread);
+			if (join) {
+				Run(join, thread);
+			} else {
+				std::unique_lock<std::mutex> lock(mutexWake);
+				wake.wait(lock, [this]() {
+					return stopping || (queued > 0);
+				});
+				if (stopping) {
+					return;
+				}
+			}
+		}
+	}
+
+	// Help with any queued tasks until all the tasks of join have finished.
+	void Wait(Join &join, unsigned int thread) {
+		while (join.remaining > 0) {
+			Join *other = Take(thread);
+			if (other) {
+				Run(other, thread);
+			} else {
+				std::unique_lock<std::mutex> lock(mutexWake);
+				wake.wait(lock, [&join, this]() {
+					return (join.remaining == 0) || (queued > 0);
+				});
+			}
+		}
+	}
+};
+
+ThreadPool::ThreadPool(unsigned int threads) : state(std::make_unique<PoolState>(std::max(threads, 1U))) {
+	for (unsigned int thread = 1; thread < Threads(); thread++) {
+		state->threads.emplace_back(&PoolState::Work, state.get(), thread);
+	}
+}
+
+ThreadPool::~ThreadPool() = default;
+
+unsigned int ThreadPool::Threads() const noexcept {
+	return static_cast<unsigned int>(state->queues.size());
+}
+
+void ThreadPool::ForkJoin(unsigned int participants, const Task &task) {
+	const unsigned int thread = (currentPool == state.get()) ? currentThread : 0;
+	participants = std::clamp(participants, 1U, Threads());
+	if (participants == 1) {
+		task(thread);
+		return;
+	}
+	Join join(&task, participants);
+	state->Push(thread, &join, participants - 1);
+	state->Run(&join, thread);
+	state->Wait(join, thread);
+	if (join.exception) {
+		std::rethrow_exception(join.exception);
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, unsigned int participants, const Body &body) {
+	std::atomic<size_t> nextIndex = 0;
+	const unsigned int threads = static_cast<unsigned int>(std::min<size_t>(participants, count));
+	ForkJoin(threads, [count, &body, &nextIndex](unsigned int thread) {
+		while (true) {
+			const size_t index = nextIndex.fetch_add(1, std::memory_order_acq_rel);
+			if (index >= count) {
+				break;
+			}
+			body(index, thread);
+		}
+	});
+}
+
+}
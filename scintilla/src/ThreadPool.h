@@ -0,0 +1,52 @@
+// Scintilla source code edit control
+/** @file ThreadPool.h
+ ** Persistent threads that share tasks for fork-join parallelism.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+namespace Scintilla::Internal {
+
+struct PoolState;
+
+/**
+ * A fixed set of threads that run tasks so that laying out and wrapping do not create threads
+ * for each call.
+ * Each thread has a queue of tasks. Tasks forked by a thread go on its own queue where it takes
+ * them newest first while idle threads steal from the other end. A thread waiting to join runs
+ * queued tasks until its own have finished so tasks may fork and join further tasks.
+ * Threads are numbered from 0, the thread that created the pool, to Threads() - 1 so callers can
+ * keep scratch space for each thread in a vector. Scratch space should only be used this way by
+ * tasks that do not fork since a joining thread may run another task before returning.
+ */
+class ThreadPool {
+	std::unique_ptr<PoolState> state;
+public:
+	/// Tasks are passed the number of the thread running them.
+	using Task = std::function<void(unsigned int thread)>;
+	using Body = std::function<void(size_t index, unsigned int thread)>;
+
+	/// Starts threads - 1 threads to share work with the calling thread.
+	explicit ThreadPool(unsigned int threads);
+	// Deleted so ThreadPool objects can not be copied.
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool(ThreadPool &&) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	ThreadPool &operator=(ThreadPool &&) = delete;
+	~ThreadPool();
+
+	[[nodiscard]] unsigned int Threads() const noexcept;
+
+	/// Run task on up to participants threads, including the calling thread, and return when they
+	/// have all finished. The first exception thrown by a task is rethrown.
+	/// Only call from the thread that created the pool or from inside a task.
+	void ForkJoin(unsigned int participants, const Task &task);
+	/// Call body for each index in [0, count) on up to participants threads.
+	void ParallelFor(size_t count, unsigned int participants, const Body &body);
+};
+
+}
+
+#endif
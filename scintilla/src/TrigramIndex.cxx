@@ -0,0 +1,529 @@
+// Scintilla source code edit control
+/** @file TrigramIndex.cxx
+ ** Index of the trigrams in each block of a document to narrow searches.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <future>
+#include <chrono>
+
+#include "ScintillaTypes.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+
+#include "CharacterCategoryMap.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "PieceTree.h"
+#include "CellBuffer.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "StringSearch.h"
+#include "LinearRegex.h"
+#include "Document.h"
+#include "DocumentSnapshot.h"
+#include "TrigramIndex.h"
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+namespace Scintilla::Internal {
+
+// Posting lists from a build: for each trigram, the blocks that hold it.
+struct TrigramPostings {
+	// Sorted with the posting list of trigrams[i] in data from offsets[i] to offsets[i+1].
+	std::vector<uint32_t> trigrams;
+	std::vector<size_t> offsets;
+	std::string data;
+	template <typename F>
+	void ForEachBlock(uint32_t trigram, F f) const;
+};
+
+struct TrigramBuild {
+	std::atomic<bool> cancelled = false;
+	// Declared after cancelled so it is destroyed first, waiting for the thread to finish.
+	std::future<std::unique_ptr<TrigramPostings>> result;
+};
+
+}
+
+namespace {
+
+constexpr size_t trigramValues = 1U << 24;
+constexpr std::string_view signature = "SciTrigram";
+constexpr uint64_t formatVersion = 1;
+
+uint32_t TrigramAt(std::string_view text, size_t position) noexcept {
+	return (static_cast<unsigned char>(text[position]) << 16) |
+		(static_cast<unsigned char>(text[position + 1]) << 8) |
+		static_cast<unsigned char>(text[position + 2]);
+}
+
+void AppendVarint(std::string &data, uint64_t value) {
+	while (value >= 0x80) {
+		data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	data.push_back(static_cast<char>(value));
+}
+
+// Returns false at the end of data or when the varint is too long.
+bool ReadVarint(std::string_view data, size_t &offset, uint64_t &value) noexcept {
+	value = 0;
+	for (unsigned int shift = 0; shift < 64; shift += 7) {
+		if (offset >= data.length()) {
+			return false;
+		}
+		const unsigned char byte = data[offset++];
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Reads a block along with the text its trigrams may extend into and returns
+// how many positions at the start of text begin trigrams of the block.
+size_t ReadBlock(const TrigramIndex::Reader &reader, Sci::Position start, Sci::Position end,
+	Sci::Position length, std::string &text) {
+	const Sci::Position readEnd = std::min(end + TrigramIndex::overlap + TrigramIndex::gram - 1, length);
+	text.resize(readEnd - start);
+	reader(text.data(), start, readEnd - start);
+	const Sci::Position startsEnd = std::min(end + TrigramIndex::overlap, length - (TrigramIndex::gram - 1));
+	return (startsEnd > start) ? startsEnd - start : 0;
+}
+
+// Appends each trigram beginning in the first starts positions of text that is not already set in seen.
+// The bits set are cleared before returning so seen can be reused.
+void AppendDistinct(std::string_view text, size_t starts, std::vector<uint64_t> &seen, std::vector<uint32_t> &trigrams) {
+	const size_t first = trigrams.size();
+	for (size_t position = 0; position < starts; position++) {
+		const uint32_t trigram = TrigramAt(text, position);
+		uint64_t &bits = seen[trigram / 64];
+		const uint64_t bit = 1ULL << (trigram % 64);
+		if (!(bits & bit)) {
+			bits |= bit;
+			trigrams.push_back(trigram);
+		}
+	}
+	for (size_t i = first; i < trigrams.size(); i++) {
+		seen[trigrams[i] / 64] = 0;
+	}
+}
+
+std::unique_ptr<TrigramPostings> BuildPostings(const DocumentSnapshot &snapshot,
+	const std::vector<Sci::Position> &starts, const std::atomic<bool> &cancelled) {
+	struct Posting {
+		size_t last = 0;
+		std::string data;
+	};
+	std::unordered_map<uint32_t, Posting> lists;
+	const TrigramIndex::Reader reader = [&snapshot](char *buffer, Sci::Position position, Sci::Position lengthRetrieve) {
+		snapshot.GetCharRange(buffer, position, lengthRetrieve);
+	};
+	std::vector<uint64_t> seen(trigramValues / 64);
+	std::vector<uint32_t> trigrams;
+	std::string text;
+	for (size_t block = 0; block + 1 < starts.size(); block++) {
+		if (cancelled) {
+			return {};
+		}
+		trigrams.clear();
+		const size_t positions = ReadBlock(reader, starts[block], starts[block + 1], snapshot.Length(), text);
+		AppendDistinct(text, positions, seen, trigrams);
+		for (const uint32_t trigram : trigrams) {
+			Posting &posting = lists[trigram];
+			AppendVarint(posting.data, block - posting.last);
+			posting.last = block;
+		}
+	}
+
+	std::unique_ptr<TrigramPostings> postings = std::make_unique<TrigramPostings>();
+	postings->trigrams.reserve(lists.size());
+	for (const auto &[trigram, posting] : lists) {
+		postings->trigrams.push_back(trigram);
+	}
+	std::sort(postings->trigrams.begin(), postings->trigrams.end());
+	postings->offsets.reserve(lists.size() + 1);
+	for (const uint32_t trigram : postings->trigrams) {
+		postings->offsets.push_back(postings->data.length());
+		const auto it = lists.find(trigram);
+		postings->data.append(it->second.data);
+		lists.erase(it);
+	}
+	postings->offsets.push_back(postings->data.length());
+	return postings;
+}
+
+}
+
+template <typename F>
+void TrigramPostings::ForEachBlock(uint32_t trigram, F f) const {
+	const auto it = std::lower_bound(trigrams.begin(), trigrams.end(), trigram);
+	if (it == trigrams.end() || *it != trigram) {
+		return;
+	}
+	const size_t index = it - trigrams.begin();
+	const std::string_view list(data.data() + offsets[index], offsets[index + 1] - offsets[index]);
+	size_t offset = 0;
+	uint64_t block = 0;
+	uint64_t delta = 0;
+	while (ReadVarint(list, offset, delta)) {
+		block += delta;
+		f(block);
+	}
+}
+
+TrigramIndex::TrigramIndex(Sci::Position length, Sci::Position blockSize_) :
+	blockSize(std::max<Sci::Position>(blockSize_, 1)), unbalanced(false) {
+	std::vector<Sci::Position> lengths;
+	for (Sci::Position position = 0; position < length; position += blockSize) {
+		lengths.push_back(std::min(blockSize, length - position));
+	}
+	Layout(lengths);
+}
+
+TrigramIndex::~TrigramIndex() {
+	if (build) {
+		build->cancelled = true;
+	}
+}
+
+void TrigramIndex::Layout(const std::vector<Sci::Position> &lengths) {
+	blocks.DeleteAll();
+	Sci::Position position = 0;
+	for (size_t block = 0; block < lengths.size(); block++) {
+		if (block > 0) {
+			blocks.InsertPartition(block, position);
+		}
+		blocks.InsertText(block, lengths[block]);
+		position += lengths[block];
+	}
+	const size_t count = static_cast<size_t>(blocks.Partitions());
+	dirty.assign(count, false);
+	reindexed.assign(count, false);
+	blockTrigrams.clear();
+	blockTrigrams.resize(count);
+}
+
+std::unique_ptr<TrigramIndex> TrigramIndex::Start(std::shared_ptr<const DocumentSnapshot> snapshot, Sci::Position blockSize) {
+	std::unique_ptr<TrigramIndex> index = std::make_unique<TrigramIndex>(snapshot->Length(), blockSize);
+	std::vector<Sci::Position> starts;
+	for (Sci::Position block = 0; block <= index->blocks.Partitions(); block++) {
+		starts.push_back(index->blocks.PositionFromPartition(block));
+	}
+	index->build = std::make_unique<TrigramBuild>();
+	const std::atomic<bool> *cancelled = &index->build->cancelled;
+	index->build->result = std::async(std::launch::async, [snapshot, starts = std::move(starts), cancelled]() {
+		return BuildPostings(*snapshot, starts, *cancelled);
+	});
+	return index;
+}
+
+bool TrigramIndex::Ready() {
+	if (!build) {
+		return true;
+	}
+	if (build->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		return false;
+	}
+	try {
+		postings = build->result.get();
+	} catch (...) {
+		// Without posting lists, every block that has not been re-indexed is a candidate.
+		postings.reset();
+	}
+	build.reset();
+	return true;
+}
+
+void TrigramIndex::Wait() {
+	if (build) {
+		build->result.wait();
+		Ready();
+	}
+}
+
+bool TrigramIndex::Unbalanced() const noexcept {
+	return unbalanced;
+}
+
+Sci::Position TrigramIndex::Blocks() const noexcept {
+	return blocks.Partitions();
+}
+
+// Mark the blocks indexing trigrams that begin in [start, end).
+void TrigramIndex::MarkDirty(Sci::Position start, Sci::Position end) {
+	start = std::max<Sci::Position>(start, 0);
+	for (Sci::Position block = blocks.PartitionFromPosition(std::max<Sci::Position>(start - overlap, 0));
+		block < blocks.Partitions(); block++) {
+		if (blocks.PositionFromPartition(block) >= end) {
+			break;
+		}
+		if (blocks.PositionFromPartition(block + 1) + overlap > start) {
+			dirty[block] = true;
+		}
+	}
+}
+
+void TrigramIndex::InsertText(Sci::Position position, Sci::Position insertLength) {
+	const Sci::Position block = blocks.PartitionFromPosition(position);
+	blocks.InsertText(block, insertLength);
+	if (blocks.PositionFromPartition(block + 1) - blocks.PositionFromPartition(block) > blockSize * 4) {
+		unbalanced = true;
+	}
+	// Trigrams that begin up to 2 bytes before the insertion now include inserted text.
+	MarkDirty(position - (gram - 1), position + insertLength);
+}
+
+void TrigramIndex::DeleteText(Sci::Position position, Sci::Position deleteLength) {
+	// The deletion may span several blocks which each shrink but remain.
+	while (deleteLength > 0) {
+		const Sci::Position block = blocks.PartitionFromPosition(position);
+		const Sci::Position removed = std::min(deleteLength, blocks.PositionFromPartition(block + 1) - position);
+		if (removed <= 0) {
+			break;
+		}
+		blocks.InsertText(block, -removed);
+		deleteLength -= removed;
+	}
+	MarkDirty(position - (gram - 1), position + 1);
+}
+
+void TrigramIndex::Update(const Reader &reader) {
+	std::vector<uint64_t> seen;
+	std::string text;
+	for (Sci::Position block = 0; block < blocks.Partitions(); block++) {
+		if (dirty[block]) {
+			if (seen.empty()) {
+				seen.resize(trigramValues / 64);
+			}
+			std::vector<uint32_t> &trigrams = blockTrigrams[block];
+			trigrams.clear();
+			const size_t positions = ReadBlock(reader, blocks.PositionFromPartition(block),
+				blocks.PositionFromPartition(block + 1), blocks.Length(), text);
+			AppendDistinct(text, positions, seen, trigrams);
+			std::sort(trigrams.begin(), trigrams.end());
+			trigrams.shrink_to_fit();
+			reindexed[block] = true;
+			dirty[block] = false;
+		}
+	}
+}
+
+std::vector<Range> TrigramIndex::Candidates(std::string_view literal, Sci::Position start, Sci::Position end) const {
+	std::vector<Range> windows;
+	start = std::max<Sci::Position>(start, 0);
+	end = std::min(end, blocks.Length());
+	if (start >= end) {
+		return windows;
+	}
+	if (literal.length() < gram) {
+		windows.emplace_back(start, end);
+		return windows;
+	}
+
+	// A match beginning in a block has all of these trigrams in that block.
+	std::vector<uint32_t> trigrams;
+	const size_t starts = std::min<size_t>(literal.length() - (gram - 1), overlap);
+	for (size_t position = 0; position < starts; position++) {
+		trigrams.push_back(TrigramAt(literal, position));
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	const Sci::Position first = blocks.PartitionFromPosition(start);
+	const Sci::Position last = blocks.PartitionFromPosition(end - 1);
+	std::vector<size_t> hits(last - first + 1);
+	if (postings) {
+		for (const uint32_t trigram : trigrams) {
+			postings->ForEachBlock(trigram, [&](uint64_t block) noexcept {
+				if (block >= static_cast<uint64_t>(first) && block <= static_cast<uint64_t>(last)) {
+					hits[block - first]++;
+				}
+			});
+		}
+	}
+
+	for (Sci::Position block = first; block <= last; block++) {
+		bool candidate = false;
+		if (reindexed[block]) {
+			const std::vector<uint32_t> &present = blockTrigrams[block];
+			candidate = std::all_of(trigrams.begin(), trigrams.end(), [&present](uint32_t trigram) {
+				return std::binary_search(present.begin(), present.end(), trigram);
+			});
+		} else {
+			candidate = !postings || (hits[block - first] == trigrams.size());
+		}
+		if (candidate) {
+			const Sci::Position blockStart = std::max(blocks.PositionFromPartition(block), start);
+			const Sci::Position blockEnd = std::min(blocks.PositionFromPartition(block + 1), end);
+			if (blockStart < blockEnd) {
+				if (!windows.empty() && (windows.back().end == blockStart)) {
+					windows.back().end = blockEnd;
+				} else {
+					windows.emplace_back(blockStart, blockEnd);
+				}
+			}
+		}
+	}
+	return windows;
+}
+
+// Serialized as the signature followed by varints: format version, document length, block size,
+// number of blocks then each block's length, whether there are posting lists, number of trigrams,
+// each trigram as a difference from the previous, each posting list's length then its data,
+// number of re-indexed blocks then for each its number, trigram count and trigram differences.
+std::string TrigramIndex::Serialize() const {
+	std::string data(signature);
+	AppendVarint(data, formatVersion);
+	AppendVarint(data, blocks.Length());
+	AppendVarint(data, blockSize);
+	AppendVarint(data, blocks.Partitions());
+	for (Sci::Position block = 0; block < blocks.Partitions(); block++) {
+		AppendVarint(data, blocks.PositionFromPartition(block + 1) - blocks.PositionFromPartition(block));
+	}
+	AppendVarint(data, postings ? 1 : 0);
+	if (postings) {
+		AppendVarint(data, postings->trigrams.size());
+		uint32_t previous = 0;
+		for (const uint32_t trigram : postings->trigrams) {
+			AppendVarint(data, trigram - previous);
+			previous = trigram;
+		}
+		for (size_t i = 0; i < postings->trigrams.size(); i++) {
+			AppendVarint(data, postings->offsets[i + 1] - postings->offsets[i]);
+		}
+		data.append(postings->data);
+	}
+	AppendVarint(data, std::count(reindexed.begin(), reindexed.end(), true));
+	for (Sci::Position block = 0; block < blocks.Partitions(); block++) {
+		if (reindexed[block]) {
+			AppendVarint(data, block);
+			AppendVarint(data, blockTrigrams[block].size());
+			uint32_t previous = 0;
+			for (const uint32_t trigram : blockTrigrams[block]) {
+				AppendVarint(data, trigram - previous);
+				previous = trigram;
+			}
+		}
+	}
+	return data;
+}
+
+std::unique_ptr<TrigramIndex> TrigramIndex::Deserialize(std::string_view data, Sci::Position length) {
+	if (data.substr(0, signature.length()) != signature) {
+		return {};
+	}
+	size_t offset = signature.length();
+	uint64_t version = 0;
+	uint64_t documentLength = 0;
+	uint64_t blockSize = 0;
+	uint64_t blockCount = 0;
+	if (!ReadVarint(data, offset, version) || (version != formatVersion) ||
+		!ReadVarint(data, offset, documentLength) || (documentLength != static_cast<uint64_t>(length)) ||
+		!ReadVarint(data, offset, blockSize) || (blockSize == 0) || (blockSize > documentLength + defaultBlockSize) ||
+		!ReadVarint(data, offset, blockCount) || (blockCount == 0) || (blockCount > data.length())) {
+		return {};
+	}
+	std::vector<Sci::Position> lengths;
+	uint64_t total = 0;
+	for (uint64_t block = 0; block < blockCount; block++) {
+		uint64_t blockLength = 0;
+		if (!ReadVarint(data, offset, blockLength) || (blockLength > documentLength - total)) {
+			return {};
+		}
+		lengths.push_back(static_cast<Sci::Position>(blockLength));
+		total += blockLength;
+	}
+	if (total != documentLength) {
+		return {};
+	}
+
+	std::unique_ptr<TrigramIndex> index = std::make_unique<TrigramIndex>(0, static_cast<Sci::Position>(blockSize));
+	index->Layout(lengths);
+
+	// Reads count ascending trigrams stored as differences.
+	auto readTrigrams = [&data, &offset](uint64_t count, std::vector<uint32_t> &trigrams) {
+		uint64_t trigram = 0;
+		for (uint64_t i = 0; i < count; i++) {
+			uint64_t delta = 0;
+			if (!ReadVarint(data, offset, delta) || ((i > 0) && (delta == 0))) {
+				return false;
+			}
+			trigram += delta;
+			if (trigram >= trigramValues) {
+				return false;
+			}
+			trigrams.push_back(static_cast<uint32_t>(trigram));
+		}
+		return true;
+	};
+
+	uint64_t hasPostings = 0;
+	if (!ReadVarint(data, offset, hasPostings) || (hasPostings > 1)) {
+		return {};
+	}
+	if (hasPostings) {
+		std::unique_ptr<TrigramPostings> postings = std::make_unique<TrigramPostings>();
+		uint64_t count = 0;
+		if (!ReadVarint(data, offset, count) || (count > trigramValues) ||
+			!readTrigrams(count, postings->trigrams)) {
+			return {};
+		}
+		size_t listsLength = 0;
+		for (uint64_t i = 0; i < count; i++) {
+			uint64_t listLength = 0;
+			if (!ReadVarint(data, offset, listLength) || (listLength > data.length())) {
+				return {};
+			}
+			postings->offsets.push_back(listsLength);
+			listsLength += static_cast<size_t>(listLength);
+		}
+		postings->offsets.push_back(listsLength);
+		if (listsLength > data.length() - offset) {
+			return {};
+		}
+		postings->data = data.substr(offset, listsLength);
+		offset += listsLength;
+		index->postings = std::move(postings);
+	}
+
+	uint64_t reindexedCount = 0;
+	if (!ReadVarint(data, offset, reindexedCount) || (reindexedCount > blockCount)) {
+		return {};
+	}
+	for (uint64_t i = 0; i < reindexedCount; i++) {
+		uint64_t block = 0;
+		uint64_t count = 0;
+		if (!ReadVarint(data, offset, block) || (block >= blockCount) ||
+			!ReadVarint(data, offset, count) || (count > trigramValues) ||
+			!readTrigrams(count, index->blockTrigrams[block])) {
+			return {};
+		}
+		index->reindexed[block] = true;
+	}
+	if (offset != data.length()) {
+		return {};
+	}
+	return index;
+}
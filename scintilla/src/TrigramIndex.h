@@ -0,0 +1,85 @@
+// Scintilla source code edit control
+/** @file TrigramIndex.h
+ ** Index of the trigrams in each block of a document to narrow searches.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+namespace Scintilla::Internal {
+
+struct TrigramPostings;
+struct TrigramBuild;
+
+/**
+ * Records which blocks of a document contain each sequence of 3 bytes so a search for
+ * literal text only has to examine the blocks that contain every trigram of that text.
+ * For each trigram, the blocks holding it are stored as a posting list of delta encoded
+ * varints. The index is built on another thread from a DocumentSnapshot.
+ * Blocks move and change size with insertions and deletions but are never split or merged
+ * so block numbers in posting lists stay valid. Blocks touched by an edit are marked dirty
+ * and re-indexed into their own trigram list by Update before the next query.
+ * Trigrams are indexed as exact bytes so only case sensitive searches can be narrowed.
+ */
+class TrigramIndex {
+public:
+	using Reader = std::function<void(char *buffer, Sci::Position position, Sci::Position lengthRetrieve)>;
+	static constexpr Sci::Position gram = 3;
+	/// Each block also indexes trigrams starting this far past its end so that needles up to
+	/// this long are matched by all their trigrams in the block where they start.
+	static constexpr Sci::Position overlap = 0x100;
+	static constexpr Sci::Position defaultBlockSize = 0x100000;
+private:
+	Partitioning<Sci::Position> blocks;
+	Sci::Position blockSize;
+	// Set when a block has grown so much that the index should be built again.
+	bool unbalanced;
+	std::unique_ptr<TrigramPostings> postings;
+	std::unique_ptr<TrigramBuild> build;
+	std::vector<bool> dirty;
+	// Blocks that have been re-indexed use their sorted trigrams instead of the posting lists.
+	std::vector<bool> reindexed;
+	std::vector<std::vector<uint32_t>> blockTrigrams;
+	void Layout(const std::vector<Sci::Position> &lengths);
+	void MarkDirty(Sci::Position start, Sci::Position end);
+public:
+	TrigramIndex(Sci::Position length, Sci::Position blockSize_);
+	// Deleted so TrigramIndex objects can not be copied.
+	TrigramIndex(const TrigramIndex &) = delete;
+	TrigramIndex(TrigramIndex &&) = delete;
+	TrigramIndex &operator=(const TrigramIndex &) = delete;
+	TrigramIndex &operator=(TrigramIndex &&) = delete;
+	~TrigramIndex();
+
+	/// Start building an index of the snapshot on another thread.
+	static std::unique_ptr<TrigramIndex> Start(std::shared_ptr<const DocumentSnapshot> snapshot,
+		Sci::Position blockSize=defaultBlockSize);
+	/// Returns nullptr when data is not a serialized index for a document of this length.
+	static std::unique_ptr<TrigramIndex> Deserialize(std::string_view data, Sci::Position length);
+
+	/// True once the build has finished. Does not wait.
+	bool Ready();
+	/// Wait for the build to finish.
+	void Wait();
+	[[nodiscard]] bool Unbalanced() const noexcept;
+	[[nodiscard]] Sci::Position Blocks() const noexcept;
+
+	/// Call after text is inserted or deleted with the same arguments as the modification.
+	void InsertText(Sci::Position position, Sci::Position insertLength);
+	void DeleteText(Sci::Position position, Sci::Position deleteLength);
+	/// Re-index the blocks changed since the last update. Only call when Ready.
+	void Update(const Reader &reader);
+
+	/// Ranges of positions in [start, end) where a match of literal may begin, in document order.
+	/// Literals shorter than a trigram can not be narrowed so return the whole range.
+	/// Only call when Ready and updated.
+	[[nodiscard]] std::vector<Range> Candidates(std::string_view literal, Sci::Position start, Sci::Position end) const;
+
+	/// Only call when Ready and updated.
+	[[nodiscard]] std::string Serialize() const;
+};
+
+}
+
+#endif
@@ -21,6 +21,8 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <chrono>
+#include <future>
 
 #include "ScintillaTypes.h"
 
@@ -184,42 +186,455 @@ Sci::Position UndoActions::Length(int action) const noexcept {
 	return lengths.SignedValueAt(action);
 }
 
+namespace {
+
+// Scrap text is compressed by replacing repeats with references back to their earlier copy.
+// Each step is a varint count of literal bytes followed by those bytes then, unless at the end,
+// a varint of the repeat length minus minMatch and a varint of the distance back to the copy.
+
+constexpr size_t minMatch = 4;
+constexpr int hashBits = 14;
+constexpr size_t noPosition = SIZE_MAX;
+
+void AppendVarint(std::string &out, size_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+size_t ReadVarint(std::string_view in, size_t &pos) {
+	size_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (pos >= in.length()) {
+			break;
+		}
+		const unsigned char byte = in[pos++];
+		value |= static_cast<size_t>(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return value;
+		}
+	}
+	throw std::runtime_error("ScrapStack: corrupt compressed undo text.");
+}
+
+uint32_t Read32(const char *bytes) noexcept {
+	uint32_t value = 0;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+std::string Compress(std::string_view text) {
+	std::string out;
+	out.reserve(text.length() / 2);
+	std::vector<size_t> table(size_t(1) << hashBits, noPosition);
+	size_t anchor = 0;
+	size_t i = 0;
+	while (i + minMatch <= text.length()) {
+		const uint32_t sequence = Read32(text.data() + i);
+		const size_t hash = (sequence * 2654435761U) >> (32 - hashBits);
+		const size_t candidate = table[hash];
+		table[hash] = i;
+		if ((candidate != noPosition) && (Read32(text.data() + candidate) == sequence)) {
+			size_t lengthMatch = minMatch;
+			while ((i + lengthMatch < text.length()) && (text[candidate + lengthMatch] == text[i + lengthMatch])) {
+				lengthMatch++;
+			}
+			AppendVarint(out, i - anchor);
+			out.append(text.substr(anchor, i - anchor));
+			AppendVarint(out, lengthMatch - minMatch);
+			AppendVarint(out, i - candidate);
+			i += lengthMatch;
+			anchor = i;
+		} else {
+			i++;
+		}
+	}
+	AppendVarint(out, text.length() - anchor);
+	out.append(text.substr(anchor));
+	return out;
+}
+
+void Decompress(std::string_view in, std::string &text, size_t length) {
+	text.resize(length);
+	size_t written = 0;
+	size_t pos = 0;
+	while (pos < in.length()) {
+		const size_t literals = ReadVarint(in, pos);
+		if ((literals > in.length() - pos) || (literals > length - written)) {
+			throw std::runtime_error("ScrapStack: corrupt compressed undo text.");
+		}
+		memcpy(text.data() + written, in.data() + pos, literals);
+		pos += literals;
+		written += literals;
+		if (pos >= in.length()) {
+			break;
+		}
+		const size_t lengthMatch = ReadVarint(in, pos) + minMatch;
+		const size_t distance = ReadVarint(in, pos);
+		if ((distance == 0) || (distance > written) || (lengthMatch > length - written)) {
+			throw std::runtime_error("ScrapStack: corrupt compressed undo text.");
+		}
+		// Byte by byte as the repeat may overlap the text it is copied from
+		for (size_t k = 0; k < lengthMatch; k++, written++) {
+			text[written] = text[written - distance];
+		}
+	}
+	if (written != length) {
+		throw std::runtime_error("ScrapStack: corrupt compressed undo text.");
+	}
+}
+
+}
+
+struct ScrapSegment {
+	size_t start = 0;
+	size_t length = 0;
+	// Text is empty when not resident, with a copy either compressed in memory or in the file.
+	bool resident = true;
+	std::string text;
+	std::string compressed;
+	std::optional<uint64_t> spilled;
+	size_t spilledLength = 0;
+	[[nodiscard]] bool HasCopy() const noexcept {
+		return !compressed.empty() || spilled;
+	}
+};
+
+// Compressing a batch of segments on another thread. The segments stay resident until the
+// compression is finished and can not be changed before then.
+struct ScrapCompression {
+	std::vector<size_t> segments;
+	std::future<std::vector<std::string>> result;
+};
+
+// Temporary file deleted when closed.
+struct ScrapFile {
+	FILE *fp = nullptr;
+	uint64_t end = 0;
+	ScrapFile() noexcept : fp(tmpfile()) {
+	}
+	// Deleted so ScrapFile objects can not be copied.
+	ScrapFile(const ScrapFile &) = delete;
+	ScrapFile(ScrapFile &&) = delete;
+	ScrapFile &operator=(const ScrapFile &) = delete;
+	ScrapFile &operator=(ScrapFile &&) = delete;
+	~ScrapFile() {
+		if (fp) {
+			fclose(fp);
+		}
+	}
+	bool Seek(uint64_t offset) noexcept {
+#if defined(_WIN32)
+		return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+		return fseeko(fp, offset, SEEK_SET) == 0;
+#endif
+	}
+	std::optional<uint64_t> Write(std::string_view data) noexcept {
+		if (!fp || !Seek(end) || (fwrite(data.data(), 1, data.length(), fp) != data.length())) {
+			return {};
+		}
+		const uint64_t offset = end;
+		end += data.length();
+		return offset;
+	}
+	bool Read(uint64_t offset, std::string &data) noexcept {
+		return fp && Seek(offset) && (fread(data.data(), 1, data.length(), fp) == data.length());
+	}
+};
+
+ScrapStack::ScrapStack() = default;
+
+ScrapStack::~ScrapStack() {
+	WaitForCompression();
+}
+
+size_t ScrapStack::SegmentFromPosition(size_t position) const noexcept {
+	const auto it = std::upper_bound(segments.begin(), segments.end(), position,
+		[](size_t pos, const ScrapSegment &segment) noexcept {
+		return pos < segment.start;
+	});
+	return (it == segments.begin()) ? 0 : it - segments.begin() - 1;
+}
+
+size_t ScrapStack::Distance(size_t segment) const noexcept {
+	const ScrapSegment &s = segments[segment];
+	if (s.start + s.length <= current) {
+		return current - (s.start + s.length);
+	} else if (s.start > current) {
+		return s.start - current;
+	}
+	return 0;
+}
+
+size_t ScrapStack::HotDistance() const noexcept {
+	return std::max(memoryLimit / 4, segmentSize);
+}
+
+void ScrapStack::MakeResident(size_t segment) {
+	ScrapSegment &s = segments[segment];
+	if (s.resident) {
+		return;
+	}
+	if (s.compressed.empty()) {
+		std::string compressed(s.spilledLength, '\0');
+		if (!file || !file->Read(*s.spilled, compressed)) {
+			throw std::runtime_error("ScrapStack: failed to read undo text from temporary file.");
+		}
+		Decompress(compressed, s.text, s.length);
+	} else {
+		Decompress(s.compressed, s.text, s.length);
+	}
+	s.resident = true;
+	residentBytes += s.length;
+	Trim(segment);
+}
+
+void ScrapStack::DropCopies(size_t segment) noexcept {
+	ScrapSegment &s = segments[segment];
+	compressedBytes -= s.compressed.length();
+	s.compressed = std::string();
+	s.spilled.reset();
+}
+
+void ScrapStack::Evict(size_t segment) noexcept {
+	ScrapSegment &s = segments[segment];
+	if (s.resident && s.HasCopy()) {
+		residentBytes -= s.length;
+		s.text = std::string();
+		s.resident = false;
+	}
+}
+
+void ScrapStack::FinishCompression(bool wait) {
+	if (!compression) {
+		return;
+	}
+	if (!wait && (compression->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)) {
+		return;
+	}
+	const std::unique_ptr<ScrapCompression> finished = std::move(compression);
+	std::vector<std::string> results = finished->result.get();
+	for (size_t i = 0; i < finished->segments.size(); i++) {
+		ScrapSegment &s = segments[finished->segments[i]];
+		compressedBytes += results[i].length();
+		s.compressed = std::move(results[i]);
+		if (Distance(finished->segments[i]) > HotDistance()) {
+			Evict(finished->segments[i]);
+		}
+	}
+}
+
+void ScrapStack::WaitForCompression() {
+	if (compression) {
+		compression->result.wait();
+	}
+}
+
+void ScrapStack::Truncate(size_t position) {
+	const size_t segment = SegmentFromPosition(position);
+	if (compression && (compression->segments.back() >= segment)) {
+		FinishCompression(true);
+	}
+	while (!segments.empty() && (segments.back().start >= position)) {
+		DropCopies(segments.size() - 1);
+		if (segments.back().resident) {
+			residentBytes -= segments.back().length;
+		}
+		segments.pop_back();
+	}
+	if (!segments.empty() && (segments.back().start + segments.back().length > position)) {
+		const size_t last = segments.size() - 1;
+		MakeResident(last);
+		DropCopies(last);
+		ScrapSegment &s = segments[last];
+		residentBytes -= s.length;
+		s.length = position - s.start;
+		s.text.resize(s.length);
+		residentBytes += s.length;
+	}
+	length = position;
+	if (file) {
+		// Reclaim the end of the file when it was only used by removed segments
+		file->end = 0;
+		for (const ScrapSegment &s : segments) {
+			if (s.spilled) {
+				file->end = std::max<uint64_t>(file->end, *s.spilled + s.spilledLength);
+			}
+		}
+	}
+}
+
+// Keep the memory used within the limit by compressing, then writing to the file, the segments
+// furthest from the current position. Segments near the current position and keep stay resident
+// so undoing and redoing recent actions does not have to wait.
+void ScrapStack::Trim(size_t keep) {
+	if (memoryLimit == 0) {
+		return;
+	}
+	FinishCompression(false);
+	if (residentBytes + compressedBytes <= memoryLimit) {
+		return;
+	}
+	if (compression) {
+		// Allow text to grow past the limit while compression catches up, but not too far.
+		if (residentBytes + compressedBytes <= memoryLimit + memoryLimit / 4) {
+			return;
+		}
+		FinishCompression(true);
+	}
+
+	std::vector<size_t> cold;
+	for (size_t segment = 0; segment < segments.size(); segment++) {
+		if ((segment != keep) && (Distance(segment) > HotDistance())) {
+			cold.push_back(segment);
+		}
+	}
+	std::sort(cold.begin(), cold.end(), [this](size_t a, size_t b) noexcept {
+		return Distance(a) > Distance(b);
+	});
+
+	std::vector<size_t> compress;
+	size_t resident = residentBytes;
+	for (const size_t segment : cold) {
+		if (resident <= memoryLimit / 2) {
+			break;
+		}
+		if (segments[segment].resident) {
+			resident -= segments[segment].length;
+			if (segments[segment].HasCopy()) {
+				Evict(segment);
+			} else {
+				compress.push_back(segment);
+			}
+		}
+	}
+	if (!compress.empty()) {
+		std::sort(compress.begin(), compress.end());
+		std::vector<std::string_view> texts;
+		for (const size_t segment : compress) {
+			// Only the last segment can be short enough for its text to move when the segments
+			// vector grows and Push waits for its compression before adding a segment.
+			texts.push_back(segments[segment].text);
+		}
+		compression = std::make_unique<ScrapCompression>();
+		compression->segments = std::move(compress);
+		compression->result = std::async(std::launch::async, [texts = std::move(texts)]() {
+			std::vector<std::string> results;
+			for (const std::string_view text : texts) {
+				results.push_back(Compress(text));
+			}
+			return results;
+		});
+	}
+
+	if (compressedBytes > memoryLimit / 2) {
+		if (!file) {
+			file = std::make_unique<ScrapFile>();
+		}
+		for (const size_t segment : cold) {
+			if (compressedBytes <= memoryLimit / 4) {
+				break;
+			}
+			ScrapSegment &s = segments[segment];
+			if (!s.compressed.empty()) {
+				const std::optional<uint64_t> offset = file->Write(s.compressed);
+				if (!offset) {
+					// Keep the compressed text in memory
+					break;
+				}
+				s.spilled = offset;
+				s.spilledLength = s.compressed.length();
+				compressedBytes -= s.compressed.length();
+				s.compressed = std::string();
+			}
+		}
+	}
+}
+
 void ScrapStack::Clear() noexcept {
-	stack.clear();
+	WaitForCompression();
+	compression.reset();
+	segments.clear();
+	file.reset();
+	length = 0;
 	current = 0;
+	residentBytes = 0;
+	compressedBytes = 0;
 }
 
-const char *ScrapStack::Push(const char *text, size_t length) {
-	if (current < stack.length()) {
-		stack.resize(current);
+const char *ScrapStack::Push(const char *text, size_t length_) {
+	if (current < length) {
+		Truncate(current);
+	}
+	if (length_ == 0) {
+		return CurrentText();
 	}
-	stack.append(text, length);
-	current = stack.length();
-	return stack.data() + current - length;
+	if (segments.empty() || (segments.back().length >= segmentSize)) {
+		ScrapSegment &s = segments.emplace_back();
+		s.start = length;
+	}
+	const size_t last = segments.size() - 1;
+	MakeResident(last);
+	DropCopies(last);
+	ScrapSegment &s = segments[last];
+	s.text.append(text, length_);
+	s.length += length_;
+	residentBytes += length_;
+	length += length_;
+	current = length;
+	const char *pushed = s.text.data() + s.length - length_;
+	Trim(last);
+	return pushed;
 }
 
 void ScrapStack::SetCurrent(size_t position) noexcept {
 	current = position;
 }
 
-void ScrapStack::MoveForward(size_t length) noexcept {
-	if ((current + length) <= stack.length()) {
-		current += length;
+void ScrapStack::MoveForward(size_t length_) noexcept {
+	if ((current + length_) <= length) {
+		current += length_;
+	}
+}
+
+void ScrapStack::MoveBack(size_t length_) noexcept {
+	if (current >= length_) {
+		current -= length_;
 	}
 }
 
-void ScrapStack::MoveBack(size_t length) noexcept {
-	if (current >= length) {
-		current -= length;
+size_t ScrapStack::Current() const noexcept {
+	return current;
+}
+
+const char *ScrapStack::CurrentText() {
+	return TextAt(current);
+}
+
+const char *ScrapStack::TextAt(size_t position) {
+	if (segments.empty()) {
+		return "";
 	}
+	const size_t segment = SegmentFromPosition(position);
+	MakeResident(segment);
+	const ScrapSegment &s = segments[segment];
+	return s.text.data() + (position - s.start);
+}
+
+void ScrapStack::SetMemoryLimit(size_t bytes) {
+	memoryLimit = bytes;
+	Trim(segments.empty() ? 0 : segments.size() - 1);
 }
 
-const char *ScrapStack::CurrentText() const noexcept {
-	return stack.data() + current;
+size_t ScrapStack::MemoryLimit() const noexcept {
+	return memoryLimit;
 }
 
-const char *ScrapStack::TextAt(size_t position) const noexcept {
-	return stack.data() + position;
+size_t ScrapStack::SizeInMemory() const noexcept {
+	return residentBytes + compressedBytes;
 }
 
 // The undo history stores a sequence of user operations that represent the user's view of the
@@ -487,7 +902,7 @@ Sci::Position UndoHistory::Length(int action) const noexcept {
 	return actions.Length(action);
 }
 
-std::string_view UndoHistory::Text(int action) noexcept {
+std::string_view UndoHistory::Text(int action) {
 	// Assumes first call after any changes is for action 0.
 	// TODO: may need to invalidate memory in other circumstances
 	if (action == 0) {
@@ -520,6 +935,14 @@ void UndoHistory::ChangeLastUndoActionText(size_t length, const char *text) {
 	scraps->Push(text, length);
 }
 
+void UndoHistory::SetMemoryLimit(size_t bytes) {
+	scraps->SetMemoryLimit(bytes);
+}
+
+size_t UndoHistory::MemoryLimit() const noexcept {
+	return scraps->MemoryLimit();
+}
+
 void UndoHistory::SetTentative(int action) noexcept {
 	tentativePoint = action;
 }
@@ -569,7 +992,7 @@ int UndoHistory::StartUndo() const noexcept {
 	return currentAction - act;
 }
 
-Action UndoHistory::GetUndoStep() const noexcept {
+Action UndoHistory::GetUndoStep() const {
 	const int previousAction = PreviousAction();
 	Action acta {
 		actions.types[previousAction].at,
@@ -579,7 +1002,7 @@ Action UndoHistory::GetUndoStep() const noexcept {
 		actions.Length(previousAction)
 	};
 	if (acta.lenData) {
-		acta.data = scraps->CurrentText() - acta.lenData;
+		acta.data = scraps->TextAt(scraps->Current() - acta.lenData);
 	}
 	return acta;
 }
@@ -613,7 +1036,7 @@ int UndoHistory::StartRedo() const noexcept {
 	return act - currentAction + 1;
 }
 
-Action UndoHistory::GetRedoStep() const noexcept {
+Action UndoHistory::GetRedoStep() const {
 	Action acta{
 		actions.types[currentAction].at,
 		actions.types[currentAction].mayCoalesce,
@@ -62,17 +62,61 @@ struct UndoActions {
 	[[nodiscard]] Sci::Position Length(int action) const noexcept;
 };
 
+// The text of undo actions is stored in segments that each hold whole actions.
+// With a memory limit, segments far from the current action are compressed on another thread
+// and, when the compressed text also grows too large, written to a temporary file. They are
+// read back when undo, redo, or SCI_GETUNDOACTIONTEXT reach them.
+
+struct ScrapSegment;
+struct ScrapCompression;
+struct ScrapFile;
+
 class ScrapStack {
-	std::string stack;
+	std::vector<ScrapSegment> segments;
+	size_t length = 0;
 	size_t current = 0;
+	size_t memoryLimit = 0;
+	size_t residentBytes = 0;
+	size_t compressedBytes = 0;
+	std::unique_ptr<ScrapCompression> compression;
+	std::unique_ptr<ScrapFile> file;
+	[[nodiscard]] size_t SegmentFromPosition(size_t position) const noexcept;
+	[[nodiscard]] size_t Distance(size_t segment) const noexcept;
+	[[nodiscard]] size_t HotDistance() const noexcept;
+	void MakeResident(size_t segment);
+	void DropCopies(size_t segment) noexcept;
+	void Evict(size_t segment) noexcept;
+	void FinishCompression(bool wait);
+	void Truncate(size_t position);
+	void Trim(size_t keep);
 public:
+	static constexpr size_t segmentSize = 0x100000;
+
+	ScrapStack();
+	// Deleted so ScrapStack objects can not be copied.
+	ScrapStack(const ScrapStack &) = delete;
+	ScrapStack(ScrapStack &&) = delete;
+	ScrapStack &operator=(const ScrapStack &) = delete;
+	ScrapStack &operator=(ScrapStack &&) = delete;
+	~ScrapStack();
+
 	void Clear() noexcept;
-	const char *Push(const char *text, size_t length);
+	const char *Push(const char *text, size_t length_);
 	void SetCurrent(size_t position) noexcept;
-	void MoveForward(size_t length) noexcept;
-	void MoveBack(size_t length) noexcept;
-	[[nodiscard]] const char *CurrentText() const noexcept;
-	[[nodiscard]] const char *TextAt(size_t position) const noexcept;
+	void MoveForward(size_t length_) noexcept;
+	void MoveBack(size_t length_) noexcept;
+	[[nodiscard]] size_t Current() const noexcept;
+	[[nodiscard]] const char *CurrentText();
+	/// The returned text is valid until the next call that may read back another segment.
+	[[nodiscard]] const char *TextAt(size_t position);
+
+	/// 0 for no limit.
+	void SetMemoryLimit(size_t bytes);
+	[[nodiscard]] size_t MemoryLimit() const noexcept;
+
+	// For testing
+	[[nodiscard]] size_t SizeInMemory() const noexcept;
+	void WaitForCompression();
 };
 
 constexpr int coalesceFlag = 0x100;
@@ -131,10 +175,13 @@ public:
 	[[nodiscard]] int Type(int action) const noexcept;
 	[[nodiscard]] Sci::Position Position(int action) const noexcept;
 	[[nodiscard]] Sci::Position Length(int action) const noexcept;
-	[[nodiscard]] std::string_view Text(int action) noexcept;
+	[[nodiscard]] std::string_view Text(int action);
 	void PushUndoActionType(int type, Sci::Position position);
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
+	void SetMemoryLimit(size_t bytes);
+	[[nodiscard]] size_t MemoryLimit() const noexcept;
+
 	// Tentative actions are used for input composition so that it can be undone cleanly
 	void SetTentative(int action) noexcept;
 	[[nodiscard]] int TentativePoint() const noexcept;
@@ -147,11 +194,11 @@ public:
 	/// called that many times. Similarly for redo.
 	bool CanUndo() const noexcept;
 	int StartUndo() const noexcept;
-	Action GetUndoStep() const noexcept;
+	Action GetUndoStep() const;
 	void CompletedUndoStep() noexcept;
 	bool CanRedo() const noexcept;
 	int StartRedo() const noexcept;
-	Action GetRedoStep() const noexcept;
+	Action GetRedoStep() const;
 	void CompletedRedoStep() noexcept;
 };
 
@@ -98,6 +98,7 @@ void FontRealised::Realise(Surface &surface, int zoomLevel, Technology technolog
 	} else {
 		measurements.monospaceASCII = false;
 	}
+	measurements.advances = GlyphAdvances::Measure(surface, font.get());
 }
 
 ViewStyle::ViewStyle(size_t stylesSize_) :
@@ -145,5 +145,23 @@ class TestPerformance(unittest.TestCase):
 		print("%6.3f testUTF8AsciiSearches" % duration)
 		self.xite.DoEvents()
 
+	def testScatteredIndicators(self):
+		oneLine = (string.ascii_letters + string.digits + "\n").encode('utf-8')
+		data = oneLine * 100000
+		self.ed.AddText(len(data), data)
+		self.ed.IndicatorCurrent = 3
+		# Fill 100000 highlights in a scrambled order
+		step = 7919
+		start = timer()
+		for i in range(100000):
+			self.ed.IndicatorFillRange((i * step) % 100000 * len(oneLine) + 5, 10)
+		for i in range(2000):
+			self.ed.InsertText((i * step) % self.ed.Length, b"x")
+		end = timer()
+		duration = end - start
+		print("%6.3f testScatteredIndicators" % duration)
+		self.xite.DoEvents()
+		self.assertEqual(self.ed.IndicatorValueAt(3, self.ed.IndicatorEnd(3, 0)), 1)
+
 if __name__ == '__main__':
 	Xite.main("performanceTests")
@@ -12,6 +12,7 @@ CXXFLAGS = /MP /EHsc /std:c++17 $(OPTIMIZATION) /nologo /D_HAS_AUTO_PTR_ETC=1 /w
 TESTSRC=test*.cxx
 # Files being tested from scintilla/src directory
 TESTEDSRC=\
+ ../../src/BackgroundFind.cxx \
  ../../src/CaseConvert.cxx \
  ../../src/CaseFolder.cxx \
  ../../src/CellBuffer.cxx \
@@ -21,10 +22,16 @@ TESTEDSRC=\
  ../../src/ContractionState.cxx \
  ../../src/Decoration.cxx \
  ../../src/Document.cxx \
+ ../../src/DocumentSnapshot.cxx \
  ../../src/Geometry.cxx \
+ ../../src/LinearRegex.cxx \
  ../../src/PerLine.cxx \
+ ../../src/PieceTree.cxx \
  ../../src/RESearch.cxx \
  ../../src/RunStyles.cxx \
+ ../../src/StringSearch.cxx \
+ ../../src/ThreadPool.cxx \
+ ../../src/TrigramIndex.cxx \
  ../../src/UndoHistory.cxx \
  ../../src/UniConversion.cxx \
  ../../src/UniqueString.cxx
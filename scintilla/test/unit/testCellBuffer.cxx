@@ -12,6 +12,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <random>
 
 #include "ScintillaTypes.h"
 
@@ -24,6 +25,7 @@
 #include "SparseVector.h"
 #include "ChangeHistory.h"
 #include "CellBuffer.h"
+#include "UniConversion.h"
 #include "UndoHistory.h"
 
 #include "catch.hpp"
@@ -63,6 +65,55 @@ TEST_CASE("ScrapStack") {
 		const char *text5 = ss.Push("1", 1);
 		REQUIRE(memcmp(text5, "1", 1) == 0);
 	}
+
+	SECTION("MemoryLimit") {
+		constexpr size_t limit = 4 * ScrapStack::segmentSize;
+		ss.SetMemoryLimit(limit);
+		REQUIRE(ss.MemoryLimit() == limit);
+		std::mt19937 rng(6);
+		std::vector<std::string> pushed;
+		for (int i = 0; i < 24; i++) {
+			std::string text;
+			while (text.length() < ScrapStack::segmentSize / 2) {
+				if (i % 3 == 0) {
+					// Incompressible so is written to the file
+					text.push_back(static_cast<char>(rng()));
+				} else {
+					text.append("line " + std::to_string(text.length() * i) + "\n");
+				}
+			}
+			const char *t = ss.Push(text.data(), text.length());
+			REQUIRE(Equal(t, text));
+			pushed.push_back(text);
+		}
+		ss.WaitForCompression();
+		ss.SetMemoryLimit(limit);
+		REQUIRE(ss.SizeInMemory() <= limit);
+
+		for (size_t i = pushed.size(); i-- > 0;) {
+			ss.MoveBack(pushed[i].length());
+			REQUIRE(Equal(ss.CurrentText(), pushed[i]));
+		}
+		for (const std::string &text : pushed) {
+			REQUIRE(Equal(ss.CurrentText(), text));
+			ss.MoveForward(text.length());
+		}
+
+		// Truncate then add after undoing half way
+		size_t position = 0;
+		for (size_t i = 0; i < pushed.size() / 2; i++) {
+			position += pushed[i].length();
+		}
+		ss.SetCurrent(position);
+		const char *t = ss.Push("xyz", 3);
+		REQUIRE(Equal(t, "xyz"));
+		REQUIRE(Equal(ss.TextAt(position - pushed[11].length()), pushed[11]));
+		REQUIRE(Equal(ss.TextAt(0), pushed[0]));
+		REQUIRE(Equal(ss.TextAt(position), "xyz"));
+		ss.WaitForCompression();
+		ss.SetMemoryLimit(limit);
+		REQUIRE(ss.SizeInMemory() <= limit);
+	}
 }
 
 TEST_CASE("CellBuffer") {
@@ -277,6 +328,48 @@ void TentativeUndo(UndoHistory &uh) noexcept {
 	uh.TentativeCommit();
 }
 
+TEST_CASE("CellBufferPieceTree") {
+
+	CellBuffer cb(true, false, true);
+	REQUIRE(cb.UsesPieceTree());
+
+	SECTION("InsertDeleteUndo") {
+		bool startSequence = false;
+		constexpr std::string_view sText = "Two\nLines";
+		cb.InsertString(0, sText.data(), sText.length(), startSequence);
+		REQUIRE(2 == cb.Lines());
+		cb.InsertString(3, "\r", 1, startSequence);
+		REQUIRE(2 == cb.Lines());
+		REQUIRE(5 == cb.LineStart(1));
+		cb.InsertString(0, "One\n", 4, startSequence);
+		REQUIRE(3 == cb.Lines());
+		REQUIRE(Equal(cb.BufferPointer(), "One\nTwo\r\nLines"));
+		cb.DeleteChars(7, 2, startSequence);
+		REQUIRE(2 == cb.Lines());
+		REQUIRE(Equal(cb.BufferPointer(), "One\nTwoLines"));
+
+		REQUIRE(cb.CanUndo());
+		const int steps = cb.StartUndo();
+		REQUIRE(1 == steps);
+		cb.PerformUndoStep();
+		REQUIRE(3 == cb.Lines());
+		REQUIRE(Equal(cb.BufferPointer(), "One\nTwo\r\nLines"));
+	}
+
+	SECTION("Segments") {
+		bool startSequence = false;
+		cb.InsertString(0, "bbb", 3, startSequence);
+		cb.InsertString(0, "aaa", 3, startSequence);
+		Sci::Position start = 0;
+		REQUIRE("bbb" == cb.SegmentAt(4, start));
+		REQUIRE(3 == start);
+		const SplitView view = cb.AllView();
+		REQUIRE('a' == view.CharAt(0));
+		REQUIRE('b' == view.CharAt(5));
+		REQUIRE(6 == view.length);
+	}
+}
+
 TEST_CASE("ScaledVector") {
 
 	ScaledVector sv;
@@ -1312,6 +1405,108 @@ void UndoBlock(CellBuffer &cb) {
 	}
 }
 
+TEST_CASE("EditionRuns") {
+
+	// Compare with RunStyles over enough runs to need several blocks
+	EditionRuns er;
+	RunStyles<Sci::Position, int> rs;
+	er.Clear(0);
+	std::mt19937 rng(11);
+	for (int i = 0; i < 4000; i++) {
+		const Sci::Position length = rs.Length();
+		const Sci::Position position = rng() % (length + 1);
+		const Sci::Position span = 1 + rng() % 20;
+		switch (rng() % 4) {
+		case 0:
+		case 1:
+			er.InsertSpace(position, span);
+			rs.InsertSpace(position, span);
+			break;
+		case 2:
+			if (position + span <= length) {
+				er.DeleteRange(position, span / 4);
+				rs.DeleteRange(position, span / 4);
+			}
+			break;
+		default: {
+				const int value = static_cast<int>(rng() % 8);
+				er.FillRange(position, value, span / 4);
+				rs.FillRange(position, value, span / 4);
+			}
+			break;
+		}
+		REQUIRE(er.Length() == rs.Length());
+		bool same = true;
+		for (Sci::Position pos = 0; pos < rs.Length(); pos++) {
+			same = same && (er.ValueAt(pos) == rs.ValueAt(pos)) && (er.EndRun(pos) == rs.EndRun(pos));
+		}
+		REQUIRE(same);
+	}
+	REQUIRE(rs.Runs() > static_cast<Sci::Position>(RunBlocks::blockMax * 4));
+}
+
+TEST_CASE("DeletionPoints") {
+
+	// Compare with a value for every position
+	DeletionPoints dp;
+	std::vector<int> values(1);
+	dp.Clear(0);
+	std::mt19937 rng(12);
+	for (int i = 0; i < 4000; i++) {
+		const Sci::Position length = values.size() - 1;
+		const Sci::Position position = rng() % (length + 1);
+		const Sci::Position span = 1 + rng() % 10;
+		switch (rng() % 8) {
+		case 0:
+		case 1:
+			dp.InsertSpace(position, span);
+			values.insert(values.begin() + position, span, 0);
+			break;
+		case 2:
+			if (position + span <= length) {
+				dp.DeleteRange(position, span);
+				const int kept = values[position] ? values[position] : values[position + span];
+				values.erase(values.begin() + position, values.begin() + position + span);
+				values[position] = kept;
+			}
+			break;
+		case 3:
+			dp.Remove(position);
+			values[position] = 0;
+			break;
+		case 4:
+			if (position + span <= length) {
+				dp.Move(position + span, position);
+				values[position] = values[position + span];
+				values[position + span] = 0;
+			}
+			break;
+		default:
+			if (!values[position]) {
+				values[position] = i + 1;
+				dp.Ensure(position).push_back({ i + 1, 1 });
+			}
+			break;
+		}
+		REQUIRE(dp.Length() == static_cast<Sci::Position>(values.size() - 1));
+		bool same = true;
+		Sci::Position next = 0;
+		for (Sci::Position pos = 0; pos <= dp.Length(); pos++) {
+			const EditionSet *editions = dp.ValueAt(pos);
+			same = same && (editions ? (editions->front().edition == values[pos]) : !values[pos]);
+			if (pos > 0 && pos < dp.Length() && values[pos]) {
+				same = same && (next == pos);
+			}
+			if (pos >= next) {
+				next = dp.PositionNext(pos);
+			}
+		}
+		REQUIRE(same);
+	}
+	REQUIRE(std::count_if(values.begin(), values.end(), [](int v) { return v != 0; }) >
+		static_cast<ptrdiff_t>(RunBlocks::blockMax * 4));
+}
+
 void RedoBlock(CellBuffer &cb) {
 	const int steps = cb.StartRedo();
 	for (int step = 0; step < steps; step++) {
@@ -1655,3 +1850,140 @@ TEST_CASE("CellBufferLong") {
 	}
 }
 #endif
+
+namespace {
+
+// Line starts found by examining every byte
+std::vector<Sci::Position> LineStartsOf(std::string_view text, bool unicode) {
+	std::vector<Sci::Position> starts { 0 };
+	for (size_t i = 0; i < text.length(); i++) {
+		const unsigned char ch = text[i];
+		const bool lineEnd = (ch == '\n') ||
+			((ch == '\r') && ((i + 1 == text.length()) || (text[i + 1] != '\n'))) ||
+			(unicode && (i >= 1) && (static_cast<unsigned char>(text[i - 1]) == 0xc2) && (ch == 0x85)) ||
+			(unicode && (i >= 2) && (static_cast<unsigned char>(text[i - 2]) == 0xe2) &&
+				(static_cast<unsigned char>(text[i - 1]) == 0x80) && ((ch == 0xa8) || (ch == 0xa9)));
+		if (lineEnd) {
+			starts.push_back(i + 1);
+		}
+	}
+	return starts;
+}
+
+// Starts of lines in UTF-16 or UTF-32 code units found by examining every character
+std::vector<Sci::Position> IndexLineStartsOf(std::string_view text, const std::vector<Sci::Position> &starts,
+	LineCharacterIndexType index) {
+	std::vector<Sci::Position> indexStarts { 0 };
+	for (size_t line = 0; line < starts.size(); line++) {
+		const Sci::Position end = (line + 1 < starts.size()) ? starts[line + 1] : text.length();
+		std::string_view sv = text.substr(starts[line], end - starts[line]);
+		Sci::Position width = 0;
+		while (!sv.empty()) {
+			const int lenChar = UTF8Classify(sv) & UTF8MaskWidth;
+			width += ((lenChar == 4) && (index == LineCharacterIndexType::Utf16)) ? 2 : 1;
+			sv.remove_prefix(lenChar);
+		}
+		indexStarts.push_back(indexStarts.back() + width);
+	}
+	return indexStarts;
+}
+
+std::vector<Sci::Position> LineStartsOf(const CellBuffer &cb) {
+	std::vector<Sci::Position> starts;
+	for (Sci::Line line = 0; line < cb.Lines(); line++) {
+		starts.push_back(cb.LineStart(line));
+	}
+	return starts;
+}
+
+std::vector<Sci::Position> IndexLineStartsOf(const CellBuffer &cb, LineCharacterIndexType index) {
+	std::vector<Sci::Position> starts;
+	for (Sci::Line line = 0; line <= cb.Lines(); line++) {
+		starts.push_back(cb.IndexLineStart(line, index));
+	}
+	return starts;
+}
+
+}
+
+TEST_CASE("CellBufferLineEnds") {
+
+	// Insert text made of line end fragments, including long runs that are scanned in blocks
+
+	const std::string_view pieces[] = {
+		"a", "\r", "\n", "\r\n", "\xc2\x85", "\xe2\x80\xa8", "\xe2\x80\xa9", "\xe2", "\x80", "\xc2", "\xa9",
+		"0123456789012345678901234567890123456789012345678901234567890123456789",
+	};
+
+	for (const LineEndType lineEndType : { LineEndType::Default, LineEndType::Unicode }) {
+		CellBuffer cb(true, false);
+		cb.SetUndoCollection(false);
+		cb.SetLineEndTypes(lineEndType);
+		RandomSequence rseq;
+		std::string text;
+		for (size_t i = 0; i < 2000; i++) {
+			const Sci::Position pos = rseq.Next() % (cb.Length() + 1);
+			std::string sInsert;
+			const int count = rseq.Next() % 8 + 1;
+			for (int j = 0; j < count; j++) {
+				sInsert += pieces[rseq.Next() % std::size(pieces)];
+			}
+			bool startSequence = false;
+			cb.InsertString(pos, sInsert.c_str(), sInsert.length(), startSequence);
+			text.insert(pos, sInsert);
+			REQUIRE(LineStartsOf(cb) == LineStartsOf(text, lineEndType == LineEndType::Unicode));
+		}
+	}
+}
+
+TEST_CASE("CellBufferLoad") {
+
+	// Loading into an empty buffer builds the line data in bulk
+
+	const std::string_view pieces[] = {
+		"a", "\r", "\n", "\r\n", "\xc2\x85", "\xe2\x80\xa8", "\xe2\x80\xa9", "\xe2", "\x80", "\xc2", "\xa9",
+		"\xf0\x9f\x98\x80", "0123456789012345678901234567890123456789012345678901234567890123456789",
+	};
+	constexpr LineCharacterIndexType indexes = LineCharacterIndexType::Utf16 | LineCharacterIndexType::Utf32;
+
+	for (const LineEndType lineEndType : { LineEndType::Default, LineEndType::Unicode }) {
+		RandomSequence rseq;
+		std::string text;
+		for (size_t i = 0; i < 3000; i++) {
+			text += pieces[rseq.Next() % std::size(pieces)];
+		}
+		const std::vector<Sci::Position> starts = LineStartsOf(text, lineEndType == LineEndType::Unicode);
+
+		CellBuffer cb(true, false);
+		cb.SetUndoCollection(false);
+		cb.SetUTF8Substance(true);
+		cb.SetLineEndTypes(lineEndType);
+		cb.AllocateLineCharacterIndex(indexes);
+		bool startSequence = false;
+		cb.InsertString(0, text.c_str(), text.length(), startSequence);
+		REQUIRE(LineStartsOf(cb) == starts);
+		for (const LineCharacterIndexType index : { LineCharacterIndexType::Utf16, LineCharacterIndexType::Utf32 }) {
+			REQUIRE(IndexLineStartsOf(cb, index) == IndexLineStartsOf(text, starts, index));
+		}
+
+		// Changing line end type rebuilds the line data for the whole buffer
+		const LineEndType other = (lineEndType == LineEndType::Default) ? LineEndType::Unicode : LineEndType::Default;
+		cb.SetLineEndTypes(other);
+		const std::vector<Sci::Position> startsOther = LineStartsOf(text, other == LineEndType::Unicode);
+		REQUIRE(LineStartsOf(cb) == startsOther);
+		for (const LineCharacterIndexType index : { LineCharacterIndexType::Utf16, LineCharacterIndexType::Utf32 }) {
+			REQUIRE(IndexLineStartsOf(cb, index) == IndexLineStartsOf(text, startsOther, index));
+		}
+
+		// As does allocating an index
+		CellBuffer cbLater(true, false);
+		cbLater.SetUndoCollection(false);
+		cbLater.SetUTF8Substance(true);
+		cbLater.SetLineEndTypes(lineEndType);
+		cbLater.InsertString(0, text.c_str(), text.length(), startSequence);
+		cbLater.AllocateLineCharacterIndex(LineCharacterIndexType::Utf16);
+		REQUIRE(LineStartsOf(cbLater) == starts);
+		REQUIRE(IndexLineStartsOf(cbLater, LineCharacterIndexType::Utf16) ==
+			IndexLineStartsOf(text, starts, LineCharacterIndexType::Utf16));
+	}
+}
@@ -11,6 +11,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <random>
 
 #include "Debugging.h"
 
@@ -203,3 +204,108 @@ TEST_CASE("ContractionState") {
 	}
 
 }
+
+// Test the tree variant by comparing it with ContractionState.
+
+TEST_CASE("ContractionTree") {
+
+	std::unique_ptr<IContractionState> pcs = ContractionStateCreate(false, true);
+
+	SECTION("ManyLines") {
+		pcs->InsertLines(0, 3000);
+		REQUIRE(3001 == pcs->LinesInDoc());
+		REQUIRE(3001 == pcs->LinesDisplayed());
+		pcs->SetHeight(2000, 3);
+		REQUIRE(3003 == pcs->LinesDisplayed());
+		REQUIRE(2000 == pcs->DisplayFromDoc(2000));
+		REQUIRE(2003 == pcs->DisplayFromDoc(2001));
+		REQUIRE(2002 == pcs->DisplayLastFromDoc(2000));
+		REQUIRE(2000 == pcs->DocFromDisplay(2002));
+		pcs->SetVisible(10, 2999, false);
+		REQUIRE(pcs->HiddenLines());
+		REQUIRE(11 == pcs->LinesDisplayed());
+		REQUIRE(10 == pcs->DisplayFromDoc(3000));
+		REQUIRE(3000 == pcs->DocFromDisplay(10));
+		pcs->SetExpanded(2500, false);
+		REQUIRE(2500 == pcs->ContractedNext(0));
+		REQUIRE(-1 == pcs->ContractedNext(2501));
+		pcs->DeleteLines(5, 2990);
+		REQUIRE(11 == pcs->LinesInDoc());
+		REQUIRE(6 == pcs->LinesDisplayed());
+		REQUIRE(-1 == pcs->ContractedNext(0));
+		pcs->ShowAll();
+		REQUIRE(11 == pcs->LinesDisplayed());
+		REQUIRE(!pcs->HiddenLines());
+	}
+
+	SECTION("Random") {
+		std::unique_ptr<IContractionState> model = ContractionStateCreate(false);
+		std::mt19937 rng(4);
+		for (int i = 0; i < 3000; i++) {
+			const Sci::Line lines = model->LinesInDoc();
+			const Sci::Line line = rng() % lines;
+			switch (rng() % 7) {
+			case 0: {
+					const Sci::Line count = 1 + rng() % ((rng() % 20 == 0) ? 2000 : 20);
+					model->InsertLines(line, count);
+					pcs->InsertLines(line, count);
+				}
+				break;
+			case 1: {
+					const Sci::Line count = std::min<Sci::Line>(1 + rng() % 300, lines - 1 - line);
+					model->DeleteLines(line, count);
+					pcs->DeleteLines(line, count);
+				}
+				break;
+			case 2: {
+					const Sci::Line end = std::min<Sci::Line>(line + rng() % 600, lines - 1);
+					const bool visible = rng() % 3 == 0;
+					REQUIRE(model->SetVisible(line, end, visible) == pcs->SetVisible(line, end, visible));
+				}
+				break;
+			case 3: {
+					const bool expanded = rng() % 2 == 0;
+					REQUIRE(model->SetExpanded(line, expanded) == pcs->SetExpanded(line, expanded));
+				}
+				break;
+			case 4: {
+					const int height = 1 + rng() % 4;
+					REQUIRE(model->SetHeight(line, height) == pcs->SetHeight(line, height));
+				}
+				break;
+			case 5:
+				if (rng() % 20 == 0) {
+					REQUIRE(model->ExpandAll() == pcs->ExpandAll());
+				}
+				break;
+			default:
+				if (rng() % 50 == 0) {
+					model->ShowAll();
+					pcs->ShowAll();
+				}
+				break;
+			}
+			REQUIRE(model->LinesInDoc() == pcs->LinesInDoc());
+			REQUIRE(model->LinesDisplayed() == pcs->LinesDisplayed());
+			REQUIRE(model->HiddenLines() == pcs->HiddenLines());
+			for (int probe = 0; probe < 10; probe++) {
+				const Sci::Line lineDoc = rng() % (pcs->LinesInDoc() + 1);
+				REQUIRE(model->DisplayFromDoc(lineDoc) == pcs->DisplayFromDoc(lineDoc));
+				REQUIRE(model->GetVisible(lineDoc) == pcs->GetVisible(lineDoc));
+				const Sci::Line lineInside = std::min(lineDoc, pcs->LinesInDoc() - 1);
+				REQUIRE(model->GetExpanded(lineInside) == pcs->GetExpanded(lineInside));
+				REQUIRE(model->GetHeight(lineInside) == pcs->GetHeight(lineInside));
+				REQUIRE(model->ContractedNext(lineInside) == pcs->ContractedNext(lineInside));
+				const Sci::Line lineDisplay = rng() % (pcs->LinesDisplayed() + 1);
+				REQUIRE(model->DocFromDisplay(lineDisplay) == pcs->DocFromDisplay(lineDisplay));
+			}
+		}
+		for (Sci::Line lineDoc = 0; lineDoc <= pcs->LinesInDoc(); lineDoc++) {
+			REQUIRE(model->DisplayFromDoc(lineDoc) == pcs->DisplayFromDoc(lineDoc));
+		}
+		for (Sci::Line lineDisplay = 0; lineDisplay <= pcs->LinesDisplayed(); lineDisplay++) {
+			REQUIRE(model->DocFromDisplay(lineDisplay) == pcs->DocFromDisplay(lineDisplay));
+		}
+	}
+
+}
@@ -10,7 +10,10 @@
 #include <set>
 #include <optional>
 #include <algorithm>
+#include <functional>
 #include <memory>
+#include <thread>
+#include <random>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -27,11 +30,15 @@
 #include "SplitVector.h"
 #include "Partitioning.h"
 #include "RunStyles.h"
+#include "PieceTree.h"
 #include "CellBuffer.h"
 #include "CharClassify.h"
 #include "Decoration.h"
 #include "CaseFolder.h"
 #include "Document.h"
+#include "DocumentSnapshot.h"
+#include "BackgroundFind.h"
+#include "TrigramIndex.h"
 
 #include "catch.hpp"
 
@@ -151,6 +158,12 @@ struct DocPlus {
 		return { location, lengthFinding };
 	}
 
+	std::vector<Range> FindAll(std::string_view needle, FindOption flags, size_t maxMatches=100) {
+		std::vector<Range> matches;
+		document.FindAll(0, document.Length(), needle.data(), flags, needle.length(), maxMatches, matches);
+		return matches;
+	}
+
 	std::string Substitute(std::string_view substituteText) {
 		Sci::Position lengthsubstitute = substituteText.length();
 		std::string substituted = document.SubstituteByPosition(substituteText.data(), &lengthsubstitute);
@@ -226,9 +239,51 @@ TEST_CASE("Document") {
 			REQUIRE(location == 0);
 			location = doc.document.FindText(2, doc.document.Length(), finding.data(), FindOption::MatchCase, &lengthFinding);
 			REQUIRE(location == 3);
+			location = doc.document.FindText(doc.document.Length(), 0, finding.data(), FindOption::MatchCase, &lengthFinding);
+			REQUIRE(location == 3);
+			location = doc.document.FindText(4, 0, finding.data(), FindOption::MatchCase, &lengthFinding);
+			REQUIRE(location == 0);
+		}
+	}
+
+	SECTION("SearchSpanningSegments") {
+		// Matches that start in one segment and end in another, in both directions and
+		// with the gap or a piece boundary at every position.
+		const std::string text = "{{ x  y {{{  z }";
+		const std::string_view findings[] = { "{{", "  ", "{{{", " }", "y {{{  z", "{{ x  y {{{  z }" };
+		for (const DocumentOption option : { DocumentOption::Default, DocumentOption::TextPieces }) {
+			for (size_t split = 0; split <= text.length(); split++) {
+				Document document(option);
+				document.InsertString(0, text.substr(split));
+				document.InsertString(0, text.substr(0, split));
+				for (const std::string_view finding : findings) {
+					for (Sci::Position lower = 0; lower <= document.Length(); lower += 3) {
+						Sci::Position lengthFinding = finding.length();
+						const size_t expected = text.find(finding, lower);
+						Sci::Position location = document.FindText(lower, document.Length(), finding.data(), FindOption::MatchCase, &lengthFinding);
+						REQUIRE(location == ((expected == std::string::npos) ? -1 : static_cast<Sci::Position>(expected)));
+						const Sci::Position upper = document.Length() - lower;
+						const size_t lastStart = upper - std::min<Sci::Position>(upper, finding.length());
+						const size_t expectedReverse = (static_cast<Sci::Position>(finding.length()) <= upper) ?
+							text.rfind(finding, lastStart) : std::string::npos;
+						location = document.FindText(upper, 0, finding.data(), FindOption::MatchCase, &lengthFinding);
+						REQUIRE(location == ((expectedReverse == std::string::npos) ? -1 : static_cast<Sci::Position>(expectedReverse)));
+					}
+				}
+			}
 		}
 	}
 
+	SECTION("SearchBackwardWholeWord") {
+		DocPlus doc("ab abc ab xab", 0);
+		constexpr std::string_view finding = "ab";
+		Sci::Position lengthFinding = finding.length();
+		Sci::Position location = doc.FindNeedleReverse(finding, FindOption::MatchCase | FindOption::WholeWord, &lengthFinding);
+		REQUIRE(location == 7);
+		location = doc.document.FindText(7, 0, finding.data(), FindOption::MatchCase | FindOption::WholeWord, &lengthFinding);
+		REQUIRE(location == 0);
+	}
+
 	SECTION("InsensitiveSearchInLatin") {
 		DocPlus doc("abcde", 0);	// a b c d e
 		constexpr std::string_view finding = "B";
@@ -338,6 +393,84 @@ TEST_CASE("Document") {
 		REQUIRE(location == -1);
 	}
 
+	SECTION("InsensitiveSearchInUTF8Random") {
+		// Compare with folding each character separately, including characters whose folded
+		// forms differ in length and characters that straddle the gap or pieces.
+		const std::string_view characters[] = {
+			"a", "A", "s", "S", " ", "\xC3\x9F", "\xE1\xBA\x9E", "\xCE\x93", "\xCE\xB3",
+			"\xE2\x84\xAA", "k", "\xEF\xAC\x80", "f", "\xE4\xB8\xAD", "\xFF",
+		};
+		CaseFolderUnicode folder;
+		auto fold = [&folder](std::string_view sv) {
+			std::string folded((sv.length() + 1) * 16, '\0');
+			folded.resize(folder.Fold(folded.data(), folded.length(), sv.data(), sv.length()));
+			return folded;
+		};
+		std::mt19937 rng(3);
+		auto randomText = [&](size_t count, size_t alphabet, std::vector<size_t> *boundaries) {
+			std::string text;
+			for (size_t i = 0; i < count; i++) {
+				if (boundaries) {
+					boundaries->push_back(text.length());
+				}
+				text += characters[rng() % alphabet];
+			}
+			if (boundaries) {
+				boundaries->push_back(text.length());
+			}
+			return text;
+		};
+		for (int trial = 0; trial < 200; trial++) {
+			const size_t alphabet = 2 + rng() % (std::size(characters) - 1);
+			std::vector<size_t> boundaries;
+			const std::string text = randomText(rng() % 60, alphabet, &boundaries);
+			const std::string needle = randomText(1 + rng() % 3, alphabet, nullptr);
+			const std::string needleFolded = fold(needle);
+			// Matches as [start, end) pairs in order
+			std::vector<std::pair<size_t, size_t>> matches;
+			for (size_t i = 0; i + 1 < boundaries.size(); i++) {
+				std::string accumulated;
+				for (size_t j = i; j + 1 < boundaries.size(); j++) {
+					accumulated += fold(std::string_view(text).substr(boundaries[j], boundaries[j + 1] - boundaries[j]));
+					if (accumulated == needleFolded) {
+						matches.emplace_back(boundaries[i], boundaries[j + 1]);
+						break;
+					}
+					if (needleFolded.compare(0, accumulated.length(), accumulated) != 0) {
+						break;
+					}
+				}
+			}
+			const DocumentOption option = (trial % 2) ? DocumentOption::TextPieces : DocumentOption::Default;
+			Document document(option);
+			document.SetDBCSCodePage(CpUtf8);
+			document.SetCaseFolder(std::make_unique<CaseFolderUnicode>());
+			const size_t split = rng() % (text.length() + 1);
+			document.InsertString(0, text.substr(split));
+			document.InsertString(0, text.substr(0, split));
+			for (const size_t bound : boundaries) {
+				Sci::Position lengthFinding = needle.length();
+				Sci::Position location = document.FindText(bound, document.Length(), needle.c_str(), FindOption::None, &lengthFinding);
+				auto forward = std::find_if(matches.begin(), matches.end(), [bound](const auto &m) { return m.first >= bound; });
+				if (forward == matches.end()) {
+					REQUIRE(location == -1);
+				} else {
+					REQUIRE(location == static_cast<Sci::Position>(forward->first));
+					REQUIRE(lengthFinding == static_cast<Sci::Position>(forward->second - forward->first));
+				}
+				lengthFinding = needle.length();
+				location = document.FindText(bound, 0, needle.c_str(), FindOption::None, &lengthFinding);
+				auto backward = std::find_if(matches.rbegin(), matches.rend(), [bound](const auto &m) { return m.second <= bound; });
+				if (backward == matches.rend()) {
+					REQUIRE(location == -1);
+				} else {
+					REQUIRE(location == static_cast<Sci::Position>(backward->first));
+					REQUIRE(lengthFinding == static_cast<Sci::Position>(backward->second - backward->first));
+				}
+			}
+		}
+	}
+
 	SECTION("SearchInShiftJIS") {
 		// {CJK UNIFIED IDEOGRAPH-9955} is two bytes: {0xE9, 'b'} in Shift-JIS
 		// The 'b' can be incorrectly matched by the search string 'b' when the search
@@ -728,6 +861,34 @@ TEST_CASE("Document") {
 		REQUIRE(substituted == "\ta\n");
 	}
 
+	SECTION("FindAll") {
+		DocPlus doc("ab abc\r\nabab x\nab", CpUtf8);
+		const std::vector<Range> expected { {0, 2}, {3, 5}, {8, 10}, {10, 12}, {15, 17} };
+		REQUIRE(doc.FindAll("ab", FindOption::MatchCase) == expected);
+		REQUIRE(doc.FindAll("ab", rePosix) == expected);
+		REQUIRE(doc.FindAll("AB", FindOption::None) == expected);
+		REQUIRE(doc.FindAll("ab", FindOption::WholeWord) == std::vector<Range> { {0, 2}, {15, 17} });
+
+		// Only one match at the start of each line
+		REQUIRE(doc.FindAll("^ab", rePosix) == std::vector<Range> { {0, 2}, {8, 10}, {15, 17} });
+		REQUIRE(doc.FindAll("b$", rePosix) == std::vector<Range> { {16, 17} });
+
+		// Stops when full
+		REQUIRE(doc.FindAll("ab", rePosix, 2) == std::vector<Range> { {0, 2}, {3, 5} });
+		REQUIRE(doc.FindAll("zz", rePosix).empty());
+
+		// Empty matches are each found once
+		DocPlus docEmpty("xax", CpUtf8);
+		REQUIRE(docEmpty.FindAll("a*", rePosix) == std::vector<Range> { {0, 0}, {1, 2}, {2, 2} });
+
+		#ifndef NO_CXX11_REGEX
+		REQUIRE(doc.FindAll("ab", reCxx11) == expected);
+		REQUIRE(doc.FindAll("^ab", reCxx11) == std::vector<Range> { {0, 2}, {8, 10}, {15, 17} });
+		// Backreferences are handled by std::regex
+		REQUIRE(doc.FindAll("(ab)\\1", reCxx11) == std::vector<Range> { {8, 12} });
+		#endif
+	}
+
 }
 
 TEST_CASE("DocumentUndo") {
@@ -804,6 +965,436 @@ TEST_CASE("DocumentUndo") {
 	}
 }
 
+namespace {
+
+// Records the text modifications sent to watchers.
+struct ModificationWatcher : public DocWatcher {
+	std::vector<ModificationFlags> modifications;
+	std::vector<ReplacedRange> replaced;
+	void NotifyModifyAttempt(Document *, void *) override {}
+	void NotifySavePoint(Document *, void *, bool) override {}
+	void NotifyModified(Document *, DocModification mh, void *) override {
+		modifications.push_back(mh.modificationType);
+		if (mh.replaced) {
+			replaced = *mh.replaced;
+		}
+	}
+	void NotifyDeleted(Document *, void *) noexcept override {}
+	void NotifyStyleNeeded(Document *, void *, Sci::Position) override {}
+	void NotifyErrorOccurred(Document *, void *, Status) override {}
+};
+
+}
+
+TEST_CASE("DocumentReplaceRanges") {
+
+	constexpr std::string_view sText = "ab\ncd\nab\nef ab";
+	DocPlus doc(sText, 0);
+	doc.document.DeleteUndoHistory();
+
+	SECTION("Replace") {
+		const std::vector<Replacement> replacements {
+			{Range(0, 2), "x"}, {Range(3, 4), ""}, {Range(6, 6), "1\n2"}, {Range(12, 14), "yyy"},
+		};
+		REQUIRE(doc.document.ReplaceRanges(replacements) == 4);
+		REQUIRE(doc.Contents() == "x\nd\n1\n2ab\nef yyy");
+		REQUIRE(doc.document.LinesTotal() == 5);
+		REQUIRE(doc.document.LineStart(2) == 4);
+		doc.document.Undo();
+		REQUIRE(doc.Contents() == sText);
+		REQUIRE(doc.document.LinesTotal() == 4);
+		REQUIRE(!doc.document.CanUndo());
+		doc.document.Redo();
+		REQUIRE(doc.Contents() == "x\nd\n1\n2ab\nef yyy");
+	}
+
+	SECTION("Invalid") {
+		// Out of order, overlapping, or past the end
+		REQUIRE(doc.document.ReplaceRanges({{Range(5, 6), "x"}, {Range(0, 1), "y"}}) == 0);
+		REQUIRE(doc.document.ReplaceRanges({{Range(0, 3), "x"}, {Range(2, 4), "y"}}) == 0);
+		REQUIRE(doc.document.ReplaceRanges({{Range(13, 15), "x"}}) == 0);
+		REQUIRE(doc.Contents() == sText);
+		REQUIRE(!doc.document.CanUndo());
+	}
+
+	SECTION("Notifications") {
+		ModificationWatcher watcher;
+		doc.document.AddWatcher(&watcher, nullptr);
+		REQUIRE(doc.document.ReplaceRanges({{Range(0, 2), "A\n\n"}, {Range(6, 8), "B"}, {Range(12, 14), ""}}) == 3);
+		doc.document.RemoveWatcher(&watcher, nullptr);
+		REQUIRE(doc.Contents() == "A\n\n\ncd\nB\nef ");
+		REQUIRE(watcher.modifications.size() == 2);
+		REQUIRE(FlagSet(watcher.modifications[0], ModificationFlags::BeforeReplaceAll));
+		REQUIRE(FlagSet(watcher.modifications[1], ModificationFlags::ReplaceAll));
+		REQUIRE(FlagSet(watcher.modifications[1], ModificationFlags::StartAction));
+		// Positions are after the earlier edits
+		REQUIRE(watcher.replaced.size() == 3);
+		REQUIRE(watcher.replaced[0].position == 0);
+		REQUIRE(watcher.replaced[0].linesAdded == 2);
+		REQUIRE(watcher.replaced[1].position == 7);
+		REQUIRE(watcher.replaced[2].position == 12);
+		REQUIRE(watcher.replaced[2].lengthRemoved == 2);
+	}
+}
+
+namespace {
+
+std::string SnapshotText(const DocumentSnapshot &snapshot) {
+	std::string text(snapshot.Length(), '\0');
+	snapshot.GetCharRange(text.data(), 0, snapshot.Length());
+	return text;
+}
+
+}
+
+TEST_CASE("DocumentSnapshot") {
+
+	SECTION("Unchanged") {
+		DocPlus doc("abc\ndef", CpUtf8);
+		const std::shared_ptr<const DocumentSnapshot> snapshot = doc.document.Snapshot();
+		REQUIRE(snapshot->Version() == doc.document.EditVersion());
+		// Same snapshot while the document has not changed
+		REQUIRE(snapshot == doc.document.Snapshot());
+		REQUIRE(SnapshotText(*snapshot) == "abc\ndef");
+		REQUIRE(snapshot->CharAt(4) == 'd');
+		REQUIRE(snapshot->CharAt(6) == 'f');
+		REQUIRE(snapshot->CharAt(7) == 0);
+		REQUIRE(snapshot->CharAt(-1) == 0);
+		REQUIRE(snapshot->Lines() == 2);
+		REQUIRE(snapshot->LineStart(1) == 4);
+		REQUIRE(snapshot->LineStart(2) == 7);
+		REQUIRE(snapshot->LineFromPosition(3) == 0);
+		REQUIRE(snapshot->LineFromPosition(4) == 1);
+		REQUIRE(snapshot->LineFromPosition(7) == 1);
+	}
+
+	SECTION("Independent") {
+		DocPlus doc("abc\ndef", CpUtf8);
+		const std::shared_ptr<const DocumentSnapshot> before = doc.document.Snapshot();
+		doc.document.InsertString(0, "x\n");
+		doc.document.DeleteChars(5, 1);
+		REQUIRE(before->Version() != doc.document.EditVersion());
+		const std::shared_ptr<const DocumentSnapshot> after = doc.document.Snapshot();
+		REQUIRE(before != after);
+		REQUIRE(SnapshotText(*before) == "abc\ndef");
+		REQUIRE(before->Lines() == 2);
+		REQUIRE(SnapshotText(*after) == "x\nabcdef");
+		REQUIRE(after->Lines() == 2);
+		REQUIRE(after->LineStart(1) == 2);
+	}
+
+	SECTION("Styles") {
+		DocPlus doc("abcdef", CpUtf8);
+		const std::shared_ptr<const DocumentSnapshot> unstyled = doc.document.Snapshot();
+		doc.document.StartStyling(0);
+		doc.document.SetStyleFor(3, 7);
+		const std::shared_ptr<const DocumentSnapshot> styled = doc.document.Snapshot();
+		REQUIRE(unstyled != styled);
+		REQUIRE(styled->HasStyles());
+		REQUIRE(unstyled->StyleAt(1) == 0);
+		REQUIRE(styled->StyleAt(1) == 7);
+		REQUIRE(styled->StyleAt(3) == 0);
+		unsigned char styles[4] {};
+		styled->GetStyleRange(styles, 1, 3);
+		REQUIRE(styles[0] == 7);
+		REQUIRE(styles[1] == 7);
+		REQUIRE(styles[2] == 0);
+	}
+
+	SECTION("StylesNone") {
+		Document document(DocumentOption::StylesNone);
+		document.InsertString(0, "abc");
+		const std::shared_ptr<const DocumentSnapshot> snapshot = document.Snapshot();
+		REQUIRE(!snapshot->HasStyles());
+		REQUIRE(snapshot->StyleAt(1) == 0);
+	}
+
+	SECTION("TextPieces") {
+		Document document(DocumentOption::TextPieces);
+		document.InsertString(0, "world");
+		document.InsertString(0, "hello ");
+		const std::shared_ptr<const DocumentSnapshot> snapshot = document.Snapshot();
+		document.DeleteChars(0, 6);
+		REQUIRE(SnapshotText(*snapshot) == "hello world");
+		REQUIRE(SnapshotText(*document.Snapshot()) == "world");
+	}
+
+	SECTION("ReadOnOtherThread") {
+		DocPlus doc("", CpUtf8);
+		std::string text;
+		for (int line = 0; line < 1000; line++) {
+			text += "line " + std::to_string(line) + "\n";
+		}
+		doc.document.InsertString(0, text);
+		std::shared_ptr<const DocumentSnapshot> snapshot = doc.document.Snapshot();
+		std::string seen;
+		std::thread reader([snapshot, &seen]() {
+			Sci::Position position = 0;
+			while (position < snapshot->Length()) {
+				Sci::Position segmentStart = 0;
+				const std::string_view segment = snapshot->SegmentAt(position, segmentStart);
+				seen.append(segment.substr(position - segmentStart));
+				position = segmentStart + segment.length();
+			}
+		});
+		for (int edit = 0; edit < 1000; edit++) {
+			doc.document.InsertString(edit * 3, "ab");
+			doc.document.DeleteChars(edit * 2, 1);
+		}
+		reader.join();
+		REQUIRE(seen == text);
+		snapshot.reset();
+		REQUIRE(doc.document.Snapshot()->Length() == doc.document.Length());
+	}
+}
+
+namespace {
+
+std::vector<Range> FindInBackground(DocPlus &doc, std::string_view needle, FindOption flags,
+	Sci::Position chunkSize, const BackgroundFind::Acceptor &accept = {}) {
+	const CharClassify charClass;
+	std::unique_ptr<BackgroundFind> finder = BackgroundFind::Start(doc.document.Snapshot(), 0, doc.document.Length(),
+		needle, flags, doc.document.dbcsCodePage, charClass, 4, chunkSize);
+	REQUIRE(finder);
+	std::vector<Range> matches;
+	while (!finder->TakeMatches(matches, accept)) {
+		std::this_thread::yield();
+	}
+	return matches;
+}
+
+}
+
+TEST_CASE("BackgroundFind") {
+
+	constexpr FindOption rePosix = FindOption::RegExp | FindOption::Posix;
+	constexpr FindOption reCxx11 = FindOption::RegExp | FindOption::Cxx11RegEx;
+
+	SECTION("Literal") {
+		DocPlus doc("ab abc\r\nabab x\nab", CpUtf8);
+		const std::vector<Range> expected { {0, 2}, {3, 5}, {8, 10}, {10, 12}, {15, 17} };
+		for (Sci::Position chunkSize = 1; chunkSize < 20; chunkSize++) {
+			REQUIRE(FindInBackground(doc, "ab", FindOption::MatchCase, chunkSize) == expected);
+			REQUIRE(FindInBackground(doc, "AB", FindOption::None, chunkSize) == expected);
+			REQUIRE(FindInBackground(doc, "c\r\na", FindOption::MatchCase, chunkSize) == std::vector<Range> { {5, 9} });
+		}
+	}
+
+	SECTION("Overlapping") {
+		// Chunks find overlapping occurrences which are then reduced as a forward search would
+		DocPlus doc("aaaaaaa", CpUtf8);
+		for (Sci::Position chunkSize = 1; chunkSize < 8; chunkSize++) {
+			REQUIRE(FindInBackground(doc, "aa", FindOption::MatchCase, chunkSize) == std::vector<Range> { {0, 2}, {2, 4}, {4, 6} });
+		}
+	}
+
+	SECTION("WholeWord") {
+		DocPlus doc("ab abc\r\nabab x\nab", CpUtf8);
+		const BackgroundFind::Acceptor word = [&doc](Sci::Position start, Sci::Position end) {
+			return doc.document.IsWordAt(start, end);
+		};
+		REQUIRE(FindInBackground(doc, "ab", FindOption::MatchCase, 3, word) == std::vector<Range> { {0, 2}, {15, 17} });
+	}
+
+	SECTION("SameAsFindAll") {
+		std::mt19937 rng(3);
+		const std::vector<std::pair<std::string_view, FindOption>> searches {
+			{ "ab", FindOption::MatchCase },
+			{ "Ab", FindOption::None },
+			{ "\xCE\x93", FindOption::None },
+			{ "b\na", FindOption::MatchCase },
+			{ "^ab", rePosix },
+			{ "b+$", rePosix },
+			{ "a*", rePosix },
+			{ "[ab]\\>", rePosix },
+			{ "^", reCxx11 },
+			{ "(a|b)+", reCxx11 },
+			{ "\\bb", reCxx11 },
+			{ "A?", reCxx11 },
+		};
+		const std::string_view pieces[] = { "a", "b", "A", " ", "\n", "\r\n", "\xCE\x93", "\xCE\xB3" };
+		for (int trial = 0; trial < 200; trial++) {
+			std::string text;
+			const int length = rng() % 200;
+			for (int i = 0; i < length; i++) {
+				text += pieces[rng() % std::size(pieces)];
+			}
+			DocPlus doc(text, CpUtf8);
+			for (const auto &[needle, flags] : searches) {
+				std::vector<Range> expected;
+				doc.document.FindAll(0, doc.document.Length(), needle.data(), flags, needle.length(), SIZE_MAX, expected);
+				REQUIRE(FindInBackground(doc, needle, flags, 1 + rng() % 30) == expected);
+			}
+		}
+	}
+
+	SECTION("Unsupported") {
+		const CharClassify charClass;
+		DocPlus doc("ab\n", CpUtf8);
+		REQUIRE(!BackgroundFind::Start(doc.document.Snapshot(), 0, 3, "", FindOption::MatchCase, CpUtf8, charClass, 2));
+		// Backreferences need std::regex
+		REQUIRE(!BackgroundFind::Start(doc.document.Snapshot(), 0, 3, "(a)\\1", reCxx11, CpUtf8, charClass, 2));
+		REQUIRE(!BackgroundFind::Start(doc.document.Snapshot(), 0, 3, "[a", rePosix, CpUtf8, charClass, 2));
+		REQUIRE(!BackgroundFind::Start(doc.document.Snapshot(), 0, 3, "ab", FindOption::MatchCase, 932, charClass, 2));
+		REQUIRE(!BackgroundFind::Start(doc.document.Snapshot(), 0, 3, "\xC0", FindOption::None, 0, charClass, 2));
+	}
+
+	SECTION("Cancel") {
+		DocPlus doc(std::string(1000000, 'a'), CpUtf8);
+		const CharClassify charClass;
+		std::unique_ptr<BackgroundFind> finder = BackgroundFind::Start(doc.document.Snapshot(), 0, doc.document.Length(),
+			"a", FindOption::MatchCase, CpUtf8, charClass, 2, 1000);
+		REQUIRE(finder);
+		finder->Cancel();
+		std::vector<Range> matches;
+		REQUIRE(finder->TakeMatches(matches, {}));
+		REQUIRE(matches.size() < 1000000);
+	}
+}
+
+namespace {
+
+std::unique_ptr<TrigramIndex> BuildIndex(DocPlus &doc, Sci::Position blockSize) {
+	std::unique_ptr<TrigramIndex> index = TrigramIndex::Start(doc.document.Snapshot(), blockSize);
+	index->Wait();
+	return index;
+}
+
+bool Covers(const std::vector<Range> &windows, Sci::Position position) {
+	return std::any_of(windows.begin(), windows.end(), [position](const Range &window) {
+		return position >= window.start && position < window.end;
+	});
+}
+
+}
+
+TEST_CASE("TrigramIndex") {
+
+	constexpr FindOption reCxx11 = FindOption::RegExp | FindOption::Cxx11RegEx | FindOption::MatchCase;
+
+	const std::string_view pieces[] = { "ab", "ba", "abc", "x", "\n", "\xCE\x93" };
+	const std::string_view needles[] = { "abc", "bab", "xab", "cab\n", "ab\nab", "\x93" "ab", "xxxx" };
+
+	SECTION("Candidates") {
+		DocPlus doc(std::string(1000, 'x') + "needle" + std::string(1000, 'y'), CpUtf8);
+		std::unique_ptr<TrigramIndex> index = BuildIndex(doc, 100);
+		REQUIRE(index->Ready());
+		REQUIRE(index->Blocks() == 21);
+		// Blocks also index the trigrams that start in the following 256 bytes
+		REQUIRE(index->Candidates("needle", 0, 2006) == std::vector<Range> { {700, 1100} });
+		REQUIRE(index->Candidates("needle", 800, 1050) == std::vector<Range> { {800, 1050} });
+		REQUIRE(index->Candidates("xneedley", 0, 2006) == std::vector<Range> { {700, 1000} });
+		REQUIRE(index->Candidates("yyyy", 0, 2006) == std::vector<Range> { {700, 2006} });
+		REQUIRE(index->Candidates("xyz", 0, 2006).empty());
+		// Too short to narrow
+		REQUIRE(index->Candidates("zz", 10, 20) == std::vector<Range> { {10, 20} });
+	}
+
+	SECTION("Edits") {
+		std::mt19937 rng(5);
+		for (int trial = 0; trial < 100; trial++) {
+			std::string text;
+			const int length = rng() % 300;
+			for (int i = 0; i < length; i++) {
+				text += pieces[rng() % std::size(pieces)];
+			}
+			DocPlus doc(text, CpUtf8);
+			std::unique_ptr<TrigramIndex> index = BuildIndex(doc, 1 + rng() % 40);
+			const TrigramIndex::Reader reader = [&doc](char *buffer, Sci::Position position, Sci::Position lengthRetrieve) {
+				doc.document.GetCharRange(buffer, position, lengthRetrieve);
+			};
+			for (int edit = 0; edit < 20; edit++) {
+				const Sci::Position position = rng() % (doc.document.Length() + 1);
+				if ((rng() % 2) && (position < doc.document.Length())) {
+					const Sci::Position deleteLength = 1 + rng() % std::min<Sci::Position>(doc.document.Length() - position, 600);
+					doc.document.DeleteChars(position, deleteLength);
+					index->DeleteText(position, deleteLength);
+				} else {
+					const std::string_view insertion = pieces[rng() % std::size(pieces)];
+					doc.document.InsertString(position, insertion);
+					index->InsertText(position, insertion.length());
+				}
+				if (rng() % 3 == 0) {
+					index->Update(reader);
+				}
+			}
+			index->Update(reader);
+			const std::string contents = doc.Contents();
+			for (const std::string_view needle : needles) {
+				const std::vector<Range> windows = index->Candidates(needle, 0, doc.document.Length());
+				for (size_t found = contents.find(needle); found != std::string::npos; found = contents.find(needle, found + 1)) {
+					REQUIRE(Covers(windows, found));
+				}
+			}
+		}
+	}
+
+	SECTION("Document") {
+		std::mt19937 rng(7);
+		for (int trial = 0; trial < 50; trial++) {
+			std::string text;
+			const int length = rng() % 300;
+			for (int i = 0; i < length; i++) {
+				text += pieces[rng() % std::size(pieces)];
+			}
+			DocPlus doc(text, CpUtf8);
+			DocPlus docPlain(text, CpUtf8);
+			REQUIRE(doc.document.SetTrigramIndexData(BuildIndex(doc, 1 + rng() % 40)->Serialize()));
+			REQUIRE(FlagSet(doc.document.Options(), DocumentOption::TrigramIndex));
+			for (int edit = 0; edit < 5; edit++) {
+				const Sci::Position position = rng() % (doc.document.Length() + 1);
+				const std::string_view insertion = pieces[rng() % std::size(pieces)];
+				doc.document.InsertString(position, insertion);
+				docPlain.document.InsertString(position, insertion);
+				if (doc.document.Length() > 10) {
+					doc.document.DeleteChars(position / 2, 3);
+					docPlain.document.DeleteChars(position / 2, 3);
+				}
+			}
+			const Sci::Position end = doc.document.Length();
+			for (const std::string_view needle : needles) {
+				const Sci::Position minPos = rng() % (end + 1);
+				const Sci::Position maxPos = rng() % (end + 1);
+				REQUIRE(doc.FindString(minPos, maxPos, needle, FindOption::MatchCase) ==
+					docPlain.FindString(minPos, maxPos, needle, FindOption::MatchCase));
+				REQUIRE(doc.FindString(0, end, needle, FindOption::MatchCase) ==
+					docPlain.FindString(0, end, needle, FindOption::MatchCase));
+				REQUIRE(doc.FindString(end, 0, needle, FindOption::MatchCase) ==
+					docPlain.FindString(end, 0, needle, FindOption::MatchCase));
+			}
+			for (const std::string_view pattern : { "abc?b", "^bab+", "xab.", "aba|x" }) {
+				REQUIRE(doc.FindAll(pattern, reCxx11, SIZE_MAX) == docPlain.FindAll(pattern, reCxx11, SIZE_MAX));
+				REQUIRE(doc.FindString(end, 0, pattern, reCxx11) == docPlain.FindString(end, 0, pattern, reCxx11));
+			}
+		}
+	}
+
+	SECTION("Serialize") {
+		DocPlus doc("abcabd\nxyz abc\n", CpUtf8);
+		std::unique_ptr<TrigramIndex> index = BuildIndex(doc, 4);
+		const TrigramIndex::Reader reader = [&doc](char *buffer, Sci::Position position, Sci::Position lengthRetrieve) {
+			doc.document.GetCharRange(buffer, position, lengthRetrieve);
+		};
+		doc.document.InsertString(2, "q");
+		index->InsertText(2, 1);
+		index->Update(reader);
+		const std::string data = index->Serialize();
+		const Sci::Position length = doc.document.Length();
+		std::unique_ptr<TrigramIndex> restored = TrigramIndex::Deserialize(data, length);
+		REQUIRE(restored);
+		REQUIRE(restored->Serialize() == data);
+		REQUIRE(restored->Candidates("abd", 0, length) == index->Candidates("abd", 0, length));
+		REQUIRE(!TrigramIndex::Deserialize(data, length + 1));
+		REQUIRE(!TrigramIndex::Deserialize(data.substr(0, data.length() - 1), length));
+		REQUIRE(!TrigramIndex::Deserialize(data + "x", length));
+		REQUIRE(!TrigramIndex::Deserialize("abc", length));
+		REQUIRE(!doc.document.SetTrigramIndexData("abc"));
+		REQUIRE(!FlagSet(doc.document.Options(), DocumentOption::TrigramIndex));
+		REQUIRE(doc.document.SetTrigramIndexData(data));
+		REQUIRE(doc.document.TrigramIndexData() == data);
+	}
+}
+
 TEST_CASE("Words") {
 
 	SECTION("WordsInText") {
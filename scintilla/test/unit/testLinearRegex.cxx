@@ -0,0 +1,239 @@
+/** @file testLinearRegex.cxx
+ ** Unit Tests for Scintilla internal data structures
+ **/
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <random>
+#include <regex>
+
+#include "LinearRegex.h"
+
+#include "catch.hpp"
+
+using namespace Scintilla::Internal;
+
+// Test LinearRegex.
+
+namespace {
+
+struct Found {
+	ptrdiff_t start = -1;
+	ptrdiff_t length = 0;
+	bool operator==(const Found &other) const noexcept {
+		return start == other.start && length == other.length;
+	}
+};
+
+std::ostream &operator<<(std::ostream &os, const Found &found) {
+	os << found.start << "," << found.length;
+	return os;
+}
+
+Found Find(std::string_view pattern, std::string_view text, bool caseSensitive=true, bool unicode=true, bool backwards=false) {
+	std::unique_ptr<LinearRegex> regex = LinearRegex::Compile(pattern, caseSensitive, unicode);
+	REQUIRE(regex);
+	LinearRegex::Groups groups {};
+	if (!regex->Find(text, 0, text.length(), backwards, groups)) {
+		return {};
+	}
+	return { groups[0], groups[1] - groups[0] };
+}
+
+bool Compiles(std::string_view pattern) {
+	return LinearRegex::Compile(pattern, true, true) != nullptr;
+}
+
+}
+
+TEST_CASE("LinearRegex") {
+
+	SECTION("Literals") {
+		REQUIRE(Find("cd", "abcdef") == Found{ 2, 2 });
+		REQUIRE(Find("cx", "abcdef") == Found{});
+		REQUIRE(Find("", "abc") == Found{ 0, 0 });
+		REQUIRE(Find("a\\.c", "abc a.c") == Found{ 4, 3 });
+		REQUIRE(Find("\\x41\\u0042\\t", "xAB\t") == Found{ 1, 3 });
+		REQUIRE(Find("\xCE\x93z", "1a\xCE\x93z") == Found{ 2, 3 });
+	}
+
+	SECTION("Sets") {
+		REQUIRE(Find("[b-d]+", "abcde") == Found{ 1, 3 });
+		REQUIRE(Find("[^a-c]", "abcde") == Found{ 3, 1 });
+		REQUIRE(Find("[-x]", "a-x") == Found{ 1, 1 });
+		REQUIRE(Find("[[:digit:]]+", "ab123c") == Found{ 2, 3 });
+		REQUIRE(Find("\\d+", "ab123c") == Found{ 2, 3 });
+		REQUIRE(Find("[\\s]", "ab c") == Found{ 2, 1 });
+		REQUIRE(Find("\\S+", "  ab ") == Found{ 2, 2 });
+		// Non-ASCII letters are word characters
+		REQUIRE(Find("\\w+", " a\xCE\x93z ") == Found{ 1, 4 });
+		REQUIRE(Find("\\W", "a\xCE\x93z ") == Found{ 4, 1 });
+		REQUIRE(Find(".", "\xCE\x93") == Found{ 0, 2 });
+	}
+
+	SECTION("Quantifiers") {
+		REQUIRE(Find("a*", "aaab") == Found{ 0, 3 });
+		REQUIRE(Find("a*?", "aaab") == Found{ 0, 0 });
+		REQUIRE(Find("a+?", "aaab") == Found{ 0, 1 });
+		REQUIRE(Find("ba?", "bab") == Found{ 0, 2 });
+		REQUIRE(Find("a{2}", "abaaa") == Found{ 2, 2 });
+		REQUIRE(Find("a{2,}", "abaaa") == Found{ 2, 3 });
+		REQUIRE(Find("a{1,2}", "aaa") == Found{ 0, 2 });
+		REQUIRE(Find("a{1,2}?", "aaa") == Found{ 0, 1 });
+		REQUIRE(Find("<.*>", "<a><b>") == Found{ 0, 6 });
+		REQUIRE(Find("<.*?>", "<a><b>") == Found{ 0, 3 });
+	}
+
+	SECTION("Alternation") {
+		// Leftmost then first alternative, not longest
+		REQUIRE(Find("a|ab", "xab") == Found{ 1, 1 });
+		REQUIRE(Find("ab|a", "xab") == Found{ 1, 2 });
+		REQUIRE(Find("b|xa", "xab") == Found{ 0, 2 });
+		REQUIRE(Find("(?:cat|dog)s", "hotdogs") == Found{ 3, 4 });
+	}
+
+	SECTION("Groups") {
+		std::unique_ptr<LinearRegex> regex = LinearRegex::Compile("(\\d+)-(\\d+)(x)?", true, true);
+		REQUIRE(regex);
+		LinearRegex::Groups groups {};
+		REQUIRE(regex->Find("ab 12-345 c", 0, 11, false, groups));
+		REQUIRE(groups[0] == 3);
+		REQUIRE(groups[1] == 9);
+		REQUIRE(groups[2] == 3);
+		REQUIRE(groups[3] == 5);
+		REQUIRE(groups[4] == 6);
+		REQUIRE(groups[5] == 9);
+		// Group that did not participate
+		REQUIRE(groups[6] == -1);
+		REQUIRE(groups[7] == -1);
+		// Last iteration is reported
+		regex = LinearRegex::Compile("(?:(a)|(b))+", true, true);
+		REQUIRE(regex->Find("ab", 0, 2, false, groups));
+		REQUIRE(groups[4] == 1);
+		REQUIRE(groups[5] == 2);
+	}
+
+	SECTION("Assertions") {
+		REQUIRE(Find("^b", "ab") == Found{});
+		REQUIRE(Find("^a", "ab") == Found{ 0, 1 });
+		REQUIRE(Find("a$", "aba") == Found{ 2, 1 });
+		REQUIRE(Find("\\bcd", "abcd cd") == Found{ 5, 2 });
+		REQUIRE(Find("\\Bcd", "cd abcd") == Found{ 5, 2 });
+		REQUIRE(Find("\\b", "  ab") == Found{ 2, 0 });
+
+		// The text outside the range is context for assertions
+		std::unique_ptr<LinearRegex> regex = LinearRegex::Compile("\\b\\w", true, true);
+		LinearRegex::Groups groups {};
+		REQUIRE(regex->Find("ab cd", 1, 5, false, groups));
+		REQUIRE(groups[0] == 3);
+		regex = LinearRegex::Compile("^", true, true);
+		REQUIRE(!regex->Find("ab", 1, 2, false, groups));
+		regex = LinearRegex::Compile("$", true, true);
+		REQUIRE(!regex->Find("ab", 0, 1, false, groups));
+		REQUIRE(regex->Find("ab", 0, 2, false, groups));
+		REQUIRE(groups[0] == 2);
+	}
+
+	SECTION("CaseInsensitive") {
+		REQUIRE(Find("AbC", "xabc", false) == Found{ 1, 3 });
+		REQUIRE(Find("[A-C]+", "xabcd", false) == Found{ 1, 3 });
+		REQUIRE(Find("[[:upper:]]+", "1aB2", false) == Found{ 1, 2 });
+		// Greek gamma and final sigma
+		REQUIRE(Find("\xCE\x93", "a\xCE\xB3", false) == Found{ 1, 2 });
+		REQUIRE(Find("[\xCE\xA3]", "a\xCF\x82", false) == Found{ 1, 2 });
+		REQUIRE(Find("\xCE\x93", "a\xCE\xB3") == Found{});
+		// Only ASCII is folded without unicode
+		REQUIRE(Find("ab", "xAB", false, false) == Found{ 1, 2 });
+		REQUIRE(Find("\xC0", "\xE0", false, false) == Found{});
+	}
+
+	SECTION("Bytes") {
+		// Each byte is a character and bytes above 0x7F are not word characters.
+		REQUIRE(Find(".", "\xCE\x93", true, false) == Found{ 0, 1 });
+		REQUIRE(Find("\\w+", "\xCE\x93" "ab", true, false) == Found{ 2, 2 });
+		REQUIRE(Find("[\x80-\xFF]+", "a\xCE\x93", true, false) == Found{ 1, 2 });
+	}
+
+	SECTION("Backwards") {
+		REQUIRE(Find("\\w+", "ab cd ef", true, true, true) == Found{ 6, 2 });
+		REQUIRE(Find("a", "abab", true, true, true) == Found{ 2, 1 });
+		// Matches do not overlap
+		REQUIRE(Find("aa", "aaa", true, true, true) == Found{ 0, 2 });
+		REQUIRE(Find("\\b", "ab cd", true, true, true) == Found{ 5, 0 });
+		REQUIRE(Find("x*", "ab", true, true, true) == Found{ 2, 0 });
+	}
+
+	SECTION("Unsupported") {
+		// Backreferences, lookahead and invalid patterns are left to std::regex
+		REQUIRE(!Compiles("(a)\\1"));
+		REQUIRE(!Compiles("a(?=b)"));
+		REQUIRE(!Compiles("a(?!b)"));
+		REQUIRE(!Compiles("(ab"));
+		REQUIRE(!Compiles("ab)"));
+		REQUIRE(!Compiles("*a"));
+		REQUIRE(!Compiles("a**"));
+		REQUIRE(!Compiles("[b-a]"));
+		REQUIRE(!Compiles("[ab"));
+		REQUIRE(!Compiles("a{2,1}"));
+		REQUIRE(!Compiles("a{100000}"));
+		REQUIRE(!Compiles("a\\"));
+		REQUIRE(Compiles("(?:a|b)*[[:alpha:]]{2,3}?\\b$"));
+	}
+
+	SECTION("Pathological") {
+		// Exponential for backtracking engines
+		constexpr int n = 30;
+		std::string pattern;
+		for (int i = 0; i < n; i++) {
+			pattern += "a?";
+		}
+		pattern += std::string(n, 'a');
+		REQUIRE(Find(pattern, std::string(n, 'a')) == Found{ 0, n });
+		const std::string text = std::string(100000, 'a') + "b";
+		REQUIRE(Find("(a|aa)*c", text) == Found{});
+		REQUIRE(Find("(a*)*b", text) == Found{ 0, 100001 });
+	}
+
+	SECTION("Random") {
+		// Compare the whole match with std::regex for patterns without assertions.
+		// Repeating an empty alternative is avoided as std::regex implementations differ there.
+		std::mt19937 generator(5);
+		const std::array<std::string_view, 14> atoms = {
+			"a", "b", "c", ".", "[ab]", "[^a]", "\\w", "\\W", "(a|b)", "(?:ab|a)", "(a*)", "(b+?a)", "[a-c]", "(ab|ba|c)",
+		};
+		const std::array<std::string_view, 9> quantifiers = {
+			"", "", "", "*", "+", "?", "*?", "{1,2}", "{2}",
+		};
+		for (int test = 0; test < 5000; test++) {
+			std::string pattern;
+			const int terms = 1 + generator() % 4;
+			for (int term = 0; term < terms; term++) {
+				pattern += atoms[generator() % atoms.size()];
+				pattern += quantifiers[generator() % quantifiers.size()];
+			}
+			if (generator() % 4 == 0) {
+				pattern += "|";
+				pattern += atoms[generator() % atoms.size()];
+			}
+			std::string text;
+			const int length = generator() % 12;
+			for (int i = 0; i < length; i++) {
+				text.push_back(" abc"[generator() % 4]);
+			}
+			const std::regex re(pattern, std::regex::ECMAScript);
+			std::smatch match;
+			Found expected;
+			if (std::regex_search(text, match, re)) {
+				expected = { match.position(0), match.length(0) };
+			}
+			INFO(pattern << " in '" << text << "'");
+			REQUIRE(Find(pattern, text, true, false) == expected);
+		}
+	}
+}
@@ -124,6 +124,27 @@ TEST_CASE("Partitioning") {
 		part.Check();
 	}
 
+	SECTION("Assign") {
+		part.InsertText(0, 3);
+		part.InsertPartition(1, 2);
+		part.InsertText(1, 5);
+		const int positions[] { 0, 3, 4, 9 };
+		part.Assign(positions, std::size(positions));
+		REQUIRE(3 == part.Partitions());
+		REQUIRE(0 == part.PositionFromPartition(0));
+		REQUIRE(3 == part.PositionFromPartition(1));
+		REQUIRE(4 == part.PositionFromPartition(2));
+		REQUIRE(9 == part.PositionFromPartition(3));
+		REQUIRE(1 == part.PartitionFromPosition(3));
+		part.InsertText(1, 2);
+		part.InsertPartition(2, 5);
+		REQUIRE(4 == part.Partitions());
+		REQUIRE(5 == part.PositionFromPartition(2));
+		REQUIRE(6 == part.PositionFromPartition(3));
+		REQUIRE(11 == part.PositionFromPartition(4));
+		part.Check();
+	}
+
 	SECTION("InsertReversed") {
 		part.InsertText(0, 3);
 		part.InsertPartition(1, 2);
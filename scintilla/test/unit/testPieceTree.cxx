@@ -0,0 +1,170 @@
+/** @file testPieceTree.cxx
+ ** Unit Tests for Scintilla internal data structures
+ **/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <random>
+
+#include "Position.h"
+#include "PieceTree.h"
+
+#include "catch.hpp"
+
+using namespace Scintilla::Internal;
+
+// Test PieceTree.
+
+namespace {
+
+std::string Text(const PieceTree &pt) {
+	std::string s(pt.Length(), '\0');
+	pt.GetRange(s.data(), 0, pt.Length());
+	return s;
+}
+
+}
+
+TEST_CASE("PieceTree") {
+
+	PieceTree pt;
+
+	SECTION("IsEmptyInitially") {
+		REQUIRE(0 == pt.Length());
+		REQUIRE(0 == pt.Pieces());
+		REQUIRE(0 == pt.CharAt(0));
+		REQUIRE(std::string_view(pt.BufferPointer()).empty());
+	}
+
+	SECTION("InsertOne") {
+		pt.Insert(0, "Scintilla", 9);
+		REQUIRE(9 == pt.Length());
+		REQUIRE('S' == pt.CharAt(0));
+		REQUIRE('a' == pt.CharAt(8));
+		REQUIRE(0 == pt.CharAt(9));
+		REQUIRE(0 == pt.CharAt(-1));
+		REQUIRE("Scintilla" == Text(pt));
+	}
+
+	SECTION("TypingExtendsPiece") {
+		const std::string_view text = "Typing one character at a time";
+		for (size_t i = 0; i < text.length(); i++) {
+			pt.Insert(i, text.data() + i, 1);
+		}
+		REQUIRE(text == Text(pt));
+		REQUIRE(1 == pt.Pieces());
+	}
+
+	SECTION("InsertInside") {
+		pt.Insert(0, "ac", 2);
+		pt.Insert(1, "b", 1);
+		REQUIRE("abc" == Text(pt));
+		REQUIRE(3 == pt.Pieces());
+		pt.Insert(0, "<", 1);
+		pt.Insert(4, ">", 1);
+		REQUIRE("<abc>" == Text(pt));
+	}
+
+	SECTION("Delete") {
+		pt.Insert(0, "0123456789", 10);
+		pt.Delete(2, 3);
+		REQUIRE("0156789" == Text(pt));
+		pt.Delete(0, 1);
+		REQUIRE("156789" == Text(pt));
+		pt.Delete(5, 1);
+		REQUIRE("15678" == Text(pt));
+		// Out of range is ignored
+		pt.Delete(4, 2);
+		REQUIRE("15678" == Text(pt));
+		pt.Delete(0, 5);
+		REQUIRE(0 == pt.Length());
+	}
+
+	SECTION("Segments") {
+		pt.Insert(0, "world", 5);
+		pt.Insert(0, "hello ", 6);
+		Sci::Position start = -1;
+		std::string_view segment = pt.SegmentAt(3, start);
+		REQUIRE(0 == start);
+		REQUIRE("hello " == segment);
+		segment = pt.SegmentAt(6, start);
+		REQUIRE(6 == start);
+		REQUIRE("world" == segment);
+		segment = pt.SegmentAt(11, start);
+		REQUIRE(11 == start);
+		REQUIRE(segment.empty());
+	}
+
+	SECTION("RangePointer") {
+		pt.Insert(0, "def", 3);
+		pt.Insert(0, "abc", 3);
+		pt.Insert(6, "ghi", 3);
+		REQUIRE(3 == pt.Pieces());
+		// Within a piece needs no merge
+		REQUIRE(0 == memcmp(pt.RangePointer(4, 2), "ef", 2));
+		REQUIRE(3 == pt.Pieces());
+		REQUIRE(0 == memcmp(pt.RangePointer(2, 5), "cdefg", 5));
+		REQUIRE(3 == pt.Pieces());
+		REQUIRE("abcdefghi" == Text(pt));
+		const char *all = pt.BufferPointer();
+		REQUIRE(std::string_view(all) == "abcdefghi");
+		REQUIRE(1 == pt.Pieces());
+		// Stable when already a single terminated piece
+		REQUIRE(all == pt.BufferPointer());
+	}
+
+	SECTION("Snapshot") {
+		pt.Insert(0, "original", 8);
+		const PieceTree snapshot(pt);
+		pt.Insert(8, " text", 5);
+		pt.Delete(0, 1);
+		REQUIRE("riginal text" == Text(pt));
+		REQUIRE("original" == Text(snapshot));
+		PieceTree branch(snapshot);
+		branch.Insert(8, "!", 1);
+		REQUIRE("original!" == Text(branch));
+		REQUIRE("original" == Text(snapshot));
+		REQUIRE("riginal text" == Text(pt));
+		pt.Insert(pt.Length(), "?", 1);
+		REQUIRE("riginal text?" == Text(pt));
+		REQUIRE("original!" == Text(branch));
+	}
+
+	SECTION("Random") {
+		std::mt19937 rng(1);
+		std::string model;
+		for (int i = 0; i < 5000; i++) {
+			const size_t position = rng() % (model.length() + 1);
+			if (model.empty() || (rng() % 3)) {
+				std::string insertion(1 + rng() % 20, 'a' + static_cast<char>(i % 26));
+				if (rng() % 50 == 0) {
+					insertion.assign(20000, 'Z');
+				}
+				model.insert(position, insertion);
+				pt.Insert(position, insertion.data(), insertion.length());
+			} else {
+				const size_t length = std::min<size_t>(1 + rng() % 30, model.length() - position);
+				model.erase(position, length);
+				pt.Delete(position, length);
+			}
+			REQUIRE(static_cast<Sci::Position>(model.length()) == pt.Length());
+		}
+		REQUIRE(model == Text(pt));
+		for (size_t i = 0; i < model.length(); i += 7) {
+			REQUIRE(model[i] == pt.CharAt(i));
+		}
+		Sci::Position start = 0;
+		std::string joined;
+		while (start < pt.Length()) {
+			const std::string_view segment = pt.SegmentAt(start, start);
+			joined.append(segment);
+			start += segment.length();
+		}
+		REQUIRE(model == joined);
+	}
+}
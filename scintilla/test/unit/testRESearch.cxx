@@ -94,4 +94,41 @@ TEST_CASE("RESearch") {
 		REQUIRE(pat == "cintilla");
 	}
 
+	SECTION("LongPattern") {
+		// Each set occupies 33 bytes of automaton so this is far beyond the initial size
+		RESearch re(&cc);
+		std::string longPattern;
+		for (int i = 0; i < 1000; i++) {
+			longPattern += "[ab]";
+		}
+		const char *msg = re.Compile(longPattern.data(), longPattern.length(), true, false);
+		REQUIRE(nullptr == msg);
+		const StringCI sci(" " + std::string(1000, 'a') + " ");
+		REQUIRE(re.Execute(sci, 0, sci.Length()) == 1);
+		REQUIRE(re.bopat[0] == 1);
+		REQUIRE(re.eopat[0] == 1001);
+	}
+
+	SECTION("RecompileAfterWordCharsChange") {
+		// Cached automata depend on the word characters
+		RESearch re(&cc);
+		constexpr std::string_view word = "\\w+";
+		const StringCI sci("ab-cd");
+		re.Compile(word.data(), word.length(), true, false);
+		REQUIRE(re.Execute(sci, 0, sci.Length()) == 1);
+		REQUIRE(re.eopat[0] == 2);
+
+		CharClassify ccDash;
+		const unsigned char dash[] = "-";
+		ccDash.SetCharClasses(dash, CharacterClass::word);
+		RESearch reDash(&ccDash);
+		reDash.Compile(word.data(), word.length(), true, false);
+		REQUIRE(reDash.Execute(sci, 0, sci.Length()) == 1);
+		REQUIRE(reDash.eopat[0] == 5);
+		ccDash.SetCharClasses(dash, CharacterClass::punctuation);
+		reDash.Compile(word.data(), word.length(), true, false);
+		REQUIRE(reDash.Execute(sci, 0, sci.Length()) == 1);
+		REQUIRE(reDash.eopat[0] == 2);
+	}
+
 }
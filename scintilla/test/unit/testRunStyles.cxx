@@ -11,6 +11,7 @@
 #include <optional>
 #include <algorithm>
 #include <memory>
+#include <random>
 
 #include "Debugging.h"
 
@@ -79,9 +80,9 @@ namespace Scintilla::Internal {	// Xcode clang 9.0 doesn't like this when in the
 	}
 }
 
-TEST_CASE("RunStyles") {
+TEMPLATE_TEST_CASE("RunStyles", "", (RunStyles<int, int>), (RunStyles<int, int, RunTree<int, int>>)) {
 
-	RunStyles<int, int> rs;
+	TestType rs;
 
 	SECTION("IsEmptyInitially") {
 		REQUIRE(0 == rs.Length());
@@ -379,3 +380,84 @@ TEST_CASE("RunStyles") {
 	}
 
 }
+
+TEST_CASE("RunTree") {
+
+	// Compare the tree with the list over enough runs for several levels
+	RunStyles<int, int> rs;
+	RunStyles<int, int, RunTree<int, int>> rt;
+	std::mt19937 rng(3);
+
+	SECTION("Random") {
+		for (int i = 0; i < 20000; i++) {
+			const int length = rs.Length();
+			const int position = static_cast<int>(rng() % (length + 1));
+			const int span = 1 + static_cast<int>(rng() % 8);
+			switch (rng() % 6) {
+			case 0:
+			case 1:
+				rs.InsertSpace(position, span);
+				rt.InsertSpace(position, span);
+				break;
+			case 2:
+				if (position + span <= length) {
+					rs.DeleteRange(position, span);
+					rt.DeleteRange(position, span);
+				}
+				break;
+			default: {
+					const int value = static_cast<int>(rng() % 8);
+					const FillResult<int> frs = rs.FillRange(position, value, span / 2);
+					const FillResult<int> frt = rt.FillRange(position, value, span / 2);
+					REQUIRE(frs == frt);
+				}
+				break;
+			}
+			REQUIRE(rs.Length() == rt.Length());
+			REQUIRE(rs.Runs() == rt.Runs());
+			if (i % 1000 == 0) {
+				rt.Check();
+				for (int pos = 0; pos <= rs.Length(); pos++) {
+					REQUIRE(rs.ValueAt(pos) == rt.ValueAt(pos));
+					REQUIRE(rs.EndRun(pos) == rt.EndRun(pos));
+				}
+			}
+		}
+		REQUIRE(rt.Runs() > 1000);
+		while (rt.Length() > 0) {
+			const int position = static_cast<int>(rng() % rt.Length());
+			const int span = std::min(1 + static_cast<int>(rng() % 30), rt.Length() - position);
+			rs.DeleteRange(position, span);
+			rt.DeleteRange(position, span);
+			REQUIRE(rs.Runs() == rt.Runs());
+		}
+		rt.Check();
+		REQUIRE(1 == rt.Runs());
+	}
+
+	SECTION("FillRanges") {
+		rs.InsertSpace(0, 100000);
+		rt.InsertSpace(0, 100000);
+		std::vector<int> bounds;
+		for (int position = 0; position < 100000 - 10; position += 1 + static_cast<int>(rng() % 10)) {
+			bounds.push_back(position);
+			position += static_cast<int>(rng() % 5);
+			bounds.push_back(position);
+		}
+		const FillResult<int> frs = rs.FillRanges(bounds.data(), bounds.size() / 2, 1);
+		const FillResult<int> frt = rt.FillRanges(bounds.data(), bounds.size() / 2, 1);
+		REQUIRE(frs.changed);
+		REQUIRE(frs == frt);
+		rs.Check();
+		rt.Check();
+		REQUIRE(rs.Runs() == rt.Runs());
+		for (int pos = 0; pos <= rs.Length(); pos++) {
+			REQUIRE(rs.ValueAt(pos) == rt.ValueAt(pos));
+		}
+		// Not built at once when there are already runs
+		const int more[] = { 5, 50, 70, 90 };
+		REQUIRE(rs.FillRanges(more, 2, 2) == rt.FillRanges(more, 2, 2));
+		REQUIRE(rs.Runs() == rt.Runs());
+		REQUIRE(rs.ValueAt(60) == rt.ValueAt(60));
+	}
+}
@@ -0,0 +1,129 @@
+/** @file testStringSearch.cxx
+ ** Unit Tests for Scintilla internal data structures
+ **/
+
+#include <cstddef>
+#include <cstdint>
+
+#include <string>
+#include <string_view>
+#include <random>
+
+#include "StringSearch.h"
+
+#include "catch.hpp"
+
+using namespace Scintilla::Internal;
+
+// Test StringSearch.
+
+namespace {
+
+void CheckAgainstStandard(std::string_view text, std::string_view needle) {
+	REQUIRE(text.find(needle) == SearchForward(text, needle));
+	REQUIRE(text.rfind(needle) == SearchBackward(text, needle));
+}
+
+}
+
+TEST_CASE("StringSearch") {
+
+	SECTION("Empty") {
+		REQUIRE(0 == SearchForward("", ""));
+		REQUIRE(0 == SearchForward("abc", ""));
+		REQUIRE(3 == SearchBackward("abc", ""));
+		REQUIRE(std::string_view::npos == SearchForward("", "a"));
+		REQUIRE(std::string_view::npos == SearchBackward("", "a"));
+		REQUIRE(std::string_view::npos == SearchForward("ab", "abc"));
+	}
+
+	SECTION("Short") {
+		CheckAgainstStandard("a", "a");
+		CheckAgainstStandard("abcabc", "c");
+		CheckAgainstStandard("abcabc", "bc");
+		CheckAgainstStandard("abcabc", "abc");
+		CheckAgainstStandard("abcabc", "cb");
+		CheckAgainstStandard("abcabc", "abcabc");
+	}
+
+	SECTION("Blocks") {
+		// Matches in each lane of a block, near the ends and straddling blocks
+		const std::string text(100, '.');
+		for (size_t length = 1; length < 20; length++) {
+			const std::string needle = "<" + std::string(length - 1, '-');
+			for (size_t position = 0; position + length <= text.length(); position++) {
+				std::string modified = text;
+				modified.replace(position, length, needle);
+				CheckAgainstStandard(modified, needle);
+			}
+			CheckAgainstStandard(text, needle);
+		}
+	}
+
+	SECTION("Spaces") {
+		// Common first and last bytes give many false candidates
+		std::string text;
+		for (int i = 0; i < 200; i++) {
+			text += "    x";
+		}
+		CheckAgainstStandard(text, "     ");
+		CheckAgainstStandard(text, "    ");
+		CheckAgainstStandard(text + "     ", "     ");
+		CheckAgainstStandard("     " + text, "     ");
+	}
+
+	SECTION("Repetitive") {
+		// Exercises the Two-Way fallback
+		const std::string text(5000, 'a');
+		CheckAgainstStandard(text, std::string(50, 'a') + "b");
+		CheckAgainstStandard(text, "b" + std::string(50, 'a'));
+		CheckAgainstStandard(text + "b", std::string(50, 'a') + "b");
+		CheckAgainstStandard("b" + text, "b" + std::string(50, 'a'));
+		CheckAgainstStandard(text, std::string(50, 'a'));
+		std::string periodic;
+		for (int i = 0; i < 2000; i++) {
+			periodic += "abaab";
+		}
+		CheckAgainstStandard(periodic, "abaababaabaaba");
+		CheckAgainstStandard(periodic + "abaababaabaab", "abaababaabaababaabaabaab");
+		CheckAgainstStandard(periodic, "aabaabaaba");
+	}
+
+	SECTION("Random") {
+		std::mt19937 rng(2);
+		for (int trial = 0; trial < 2000; trial++) {
+			// Small alphabets make partial matches common
+			const int alphabet = 1 + rng() % 4;
+			std::string text(rng() % 300, ' ');
+			for (char &ch : text) {
+				ch = static_cast<char>('a' + rng() % alphabet);
+			}
+			std::string needle(1 + rng() % 12, ' ');
+			for (char &ch : needle) {
+				ch = static_cast<char>('a' + rng() % alphabet);
+			}
+			CheckAgainstStandard(text, needle);
+		}
+	}
+
+	SECTION("SkipAsciiExcept") {
+		REQUIRE(0 == SkipAsciiExcept("", 'a', 'A'));
+		REQUIRE(3 == SkipAsciiExcept("xyz", 'a', 'A'));
+		std::string text(70, '.');
+		REQUIRE(70 == SkipAsciiExcept(text, 'a', 'A'));
+		for (size_t position = 0; position < text.length(); position++) {
+			for (const char stop : { 'a', 'A', '\x80', '\xff' }) {
+				std::string modified = text;
+				modified[position] = stop;
+				REQUIRE(position == SkipAsciiExcept(modified, 'a', 'A'));
+			}
+		}
+	}
+
+	SECTION("HighBytes") {
+		const std::string text = "\xe4\xb8\xad\xe6\x96\x87 text \xe6\x96\x87\xe5\xad\x97 \xff\x80";
+		CheckAgainstStandard(text, "\xe6\x96\x87");
+		CheckAgainstStandard(text, "\xff\x80");
+		CheckAgainstStandard(text, "\x80");
+	}
+}
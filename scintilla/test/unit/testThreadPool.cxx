@@ -0,0 +1,85 @@
+/** @file testThreadPool.cxx
+ ** Unit Tests for Scintilla internal data structures
+ **/
+
+#include <cstddef>
+
+#include <stdexcept>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
+
+#include "ThreadPool.h"
+
+#include "catch.hpp"
+
+using namespace Scintilla::Internal;
+
+// Test ThreadPool.
+
+TEST_CASE("ThreadPool") {
+
+	ThreadPool pool(4);
+
+	SECTION("Threads") {
+		REQUIRE(pool.Threads() == 4);
+		const ThreadPool single(0);
+		REQUIRE(single.Threads() == 1);
+	}
+
+	SECTION("ForkJoin") {
+		for (int repeat = 0; repeat < 100; repeat++) {
+			std::atomic<int> runs = 0;
+			std::vector<std::atomic<int>> perThread(pool.Threads());
+			pool.ForkJoin(3, [&](unsigned int thread) {
+				runs++;
+				perThread.at(thread)++;
+			});
+			REQUIRE(runs == 3);
+			// The calling thread is 0 and always runs the task at least once
+			REQUIRE(perThread[0] >= 1);
+		}
+	}
+
+	SECTION("ParallelFor") {
+		std::vector<int> counts(1000);
+		pool.ParallelFor(counts.size(), 4, [&counts](size_t index, unsigned int) {
+			counts[index]++;
+		});
+		for (const int count : counts) {
+			REQUIRE(count == 1);
+		}
+		// Nothing to do
+		pool.ParallelFor(0, 4, [&counts](size_t, unsigned int) {
+			counts[0]++;
+		});
+		REQUIRE(counts[0] == 1);
+	}
+
+	SECTION("Nested") {
+		// Every thread forks and joins its own tasks while the outer join is in progress
+		std::atomic<int> runs = 0;
+		pool.ParallelFor(16, 4, [&](size_t, unsigned int) {
+			pool.ParallelFor(16, 4, [&](size_t, unsigned int) {
+				runs++;
+			});
+		});
+		REQUIRE(runs == 16 * 16);
+	}
+
+	SECTION("Exception") {
+		std::atomic<int> runs = 0;
+		REQUIRE_THROWS_AS(pool.ForkJoin(4, [&](unsigned int) {
+			if (runs++ == 1) {
+				throw std::runtime_error("task failed");
+			}
+		}), std::runtime_error);
+		REQUIRE(runs == 4);
+		// Still usable after an exception
+		pool.ForkJoin(4, [&](unsigned int) {
+			runs++;
+		});
+		REQUIRE(runs == 8);
+	}
+}
@@ -72,6 +72,30 @@ $(DIR_O)/AutoComplete.obj: \
 	../src/CharacterType.h \
 	../src/Position.h \
 	../src/AutoComplete.h
+$(DIR_O)/BackgroundFind.obj: \
+	../src/BackgroundFind.cxx \
+	../include/ScintillaTypes.h \
+	../include/ILoader.h \
+	../include/Sci_Position.h \
+	../include/ILexer.h \
+	../src/Debugging.h \
+	../src/CharacterCategoryMap.h \
+	../src/Position.h \
+	../src/SplitVector.h \
+	../src/Partitioning.h \
+	../src/RunStyles.h \
+	../src/PieceTree.h \
+	../src/CellBuffer.h \
+	../src/CharClassify.h \
+	../src/Decoration.h \
+	../src/CaseFolder.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
+	../src/Document.h \
+	../src/DocumentSnapshot.h \
+	../src/BackgroundFind.h \
+	../src/RESearch.h \
+	../src/UniConversion.h
 $(DIR_O)/CallTip.obj: \
 	../src/CallTip.cxx \
 	../include/ScintillaTypes.h \
@@ -100,8 +124,10 @@ $(DIR_O)/CellBuffer.obj: \
 	../src/RunStyles.h \
 	../src/SparseVector.h \
 	../src/ChangeHistory.h \
+	../src/PieceTree.h \
 	../src/CellBuffer.h \
 	../src/UndoHistory.h \
+	../src/StringSearch.h \
 	../src/UniConversion.h
 $(DIR_O)/ChangeHistory.obj: \
 	../src/ChangeHistory.cxx \
@@ -158,15 +184,26 @@ $(DIR_O)/Document.obj: \
 	../src/SplitVector.h \
 	../src/Partitioning.h \
 	../src/RunStyles.h \
+	../src/PieceTree.h \
 	../src/CellBuffer.h \
 	../src/PerLine.h \
 	../src/CharClassify.h \
 	../src/Decoration.h \
 	../src/CaseFolder.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
 	../src/Document.h \
+	../src/DocumentSnapshot.h \
+	../src/BackgroundFind.h \
+	../src/TrigramIndex.h \
 	../src/RESearch.h \
 	../src/UniConversion.h \
 	../src/ElapsedPeriod.h
+$(DIR_O)/DocumentSnapshot.obj: \
+	../src/DocumentSnapshot.cxx \
+	../src/Position.h \
+	../src/PieceTree.h \
+	../src/DocumentSnapshot.h
 $(DIR_O)/EditModel.obj: \
 	../src/EditModel.cxx \
 	../include/ScintillaTypes.h \
@@ -226,8 +263,10 @@ $(DIR_O)/Editor.obj: \
 	../src/Decoration.h \
 	../src/CaseFolder.h \
 	../src/Document.h \
+	../src/BackgroundFind.h \
 	../src/UniConversion.h \
 	../src/DBCS.h \
+	../src/ThreadPool.h \
 	../src/Selection.h \
 	../src/PositionCache.h \
 	../src/EditModel.h \
@@ -266,6 +305,7 @@ $(DIR_O)/EditView.obj: \
 	../src/CaseFolder.h \
 	../src/Document.h \
 	../src/UniConversion.h \
+	../src/ThreadPool.h \
 	../src/Selection.h \
 	../src/PositionCache.h \
 	../src/EditModel.h \
@@ -291,6 +331,13 @@ $(DIR_O)/KeyMap.obj: \
 	../src/Geometry.h \
 	../src/Platform.h \
 	../src/KeyMap.h
+$(DIR_O)/LinearRegex.obj: \
+	../src/LinearRegex.cxx \
+	../src/CharacterCategoryMap.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
+	../src/CaseConvert.h \
+	../src/UniConversion.h
 $(DIR_O)/LineMarker.obj: \
 	../src/LineMarker.cxx \
 	../include/ScintillaTypes.h \
@@ -345,6 +392,10 @@ $(DIR_O)/PerLine.obj: \
 	../src/Partitioning.h \
 	../src/CellBuffer.h \
 	../src/PerLine.h
+$(DIR_O)/PieceTree.obj: \
+	../src/PieceTree.cxx \
+	../src/Position.h \
+	../src/PieceTree.h
 $(DIR_O)/PositionCache.obj: \
 	../src/PositionCache.cxx \
 	../include/ScintillaTypes.h \
@@ -431,6 +482,9 @@ $(DIR_O)/Selection.obj: \
 	../src/Debugging.h \
 	../src/Position.h \
 	../src/Selection.h
+$(DIR_O)/StringSearch.obj: \
+	../src/StringSearch.cxx \
+	../src/StringSearch.h
 $(DIR_O)/Style.obj: \
 	../src/Style.cxx \
 	../include/ScintillaTypes.h \
@@ -438,6 +492,30 @@ $(DIR_O)/Style.obj: \
 	../src/Geometry.h \
 	../src/Platform.h \
 	../src/Style.h
+$(DIR_O)/ThreadPool.obj: \
+	../src/ThreadPool.cxx \
+	../src/ThreadPool.h
+$(DIR_O)/TrigramIndex.obj: \
+	../src/TrigramIndex.cxx \
+	../include/ScintillaTypes.h \
+	../include/ILoader.h \
+	../include/ILexer.h \
+	../src/Debugging.h \
+	../src/CharacterCategoryMap.h \
+	../src/Position.h \
+	../src/SplitVector.h \
+	../src/Partitioning.h \
+	../src/RunStyles.h \
+	../src/PieceTree.h \
+	../src/CellBuffer.h \
+	../src/CharClassify.h \
+	../src/Decoration.h \
+	../src/CaseFolder.h \
+	../src/StringSearch.h \
+	../src/LinearRegex.h \
+	../src/Document.h \
+	../src/DocumentSnapshot.h \
+	../src/TrigramIndex.h
 $(DIR_O)/UndoHistory.obj: \
 	../src/UndoHistory.cxx \
 	../include/ScintillaTypes.h \
@@ -78,6 +78,7 @@ depend:
 # Required for base Scintilla
 SRC_OBJS=\
 	$(DIR_O)\AutoComplete.obj \
+	$(DIR_O)\BackgroundFind.obj \
 	$(DIR_O)\CallTip.obj \
 	$(DIR_O)\CaseConvert.obj \
 	$(DIR_O)\CaseFolder.obj \
@@ -90,20 +91,26 @@ SRC_OBJS=\
 	$(DIR_O)\DBCS.obj \
 	$(DIR_O)\Decoration.obj \
 	$(DIR_O)\Document.obj \
+	$(DIR_O)\DocumentSnapshot.obj \
 	$(DIR_O)\EditModel.obj \
 	$(DIR_O)\Editor.obj \
 	$(DIR_O)\EditView.obj \
 	$(DIR_O)\Geometry.obj \
 	$(DIR_O)\Indicator.obj \
 	$(DIR_O)\KeyMap.obj \
+	$(DIR_O)\LinearRegex.obj \
 	$(DIR_O)\LineMarker.obj \
 	$(DIR_O)\MarginView.obj \
 	$(DIR_O)\PerLine.obj \
+	$(DIR_O)\PieceTree.obj \
 	$(DIR_O)\PositionCache.obj \
 	$(DIR_O)\RESearch.obj \
 	$(DIR_O)\RunStyles.obj \
 	$(DIR_O)\Selection.obj \
+	$(DIR_O)\StringSearch.obj \
 	$(DIR_O)\Style.obj \
+	$(DIR_O)\ThreadPool.obj \
+	$(DIR_O)\TrigramIndex.obj \
 	$(DIR_O)\UndoHistory.obj \
 	$(DIR_O)\UniConversion.obj \
 	$(DIR_O)\UniqueString.obj \
@@ -360,6 +360,16 @@ public:
 				break;
 			}
 		}
+		else if (wParam == 2) // the document is encrypted
+		{
+			CPassphraseDlg dlg;
+			if (IDOK == dlg.DoModal())
+			{
+				memcpy(g_fileInfo.passphrase, dlg.m_passphrase, ZT_PASSPHRASE_MAX);
+				g_fileInfo.hWnd = m_hWnd;
+				StarUpWorkThread(&g_fileInfo);
+			}
+		}
 		else
 		{
 			if (g_textData && g_textLen > 8)
@@ -1,8 +1,65 @@
 #include "pch.h"
 #include "App.h"
 
+#include <sys/stat.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+
 #define ZT_FILE_MAX_SIZE       (1<<28)
 
+/*
+ * The encrypted xPad container
+ *
+ *   XPadEncHeader
+ *   XPadEncBlock[blockCount]       the block table
+ *   blockCount sealed blocks       zipSize bytes of cipher text + 16-byte tag
+ *
+ * Every block holds one independent zlib stream of at most blockSize bytes of
+ * text, sealed with AES-256-GCM under the nonce (header.nonce || block number),
+ * with the header and its own table entry as additional authenticated data.
+ * So the blocks can be decrypted and inflated in any order, on any thread,
+ * while reordering, truncation or tampering makes the tag check fail.
+ * The key is derived from the passphrase with PBKDF2-HMAC-SHA256.
+ */
+#define XPAD_ENC_MAGIC          0x45445058  /* "XPDE", never a valid plain file size */
+#define XPAD_ENC_VERSION        1
+#define XPAD_ENC_BLOCKSIZE      (1<<20)
+#define XPAD_ENC_MAX_BLOCKSIZE  (1<<26)
+#define XPAD_ENC_ITERATIONS     100000
+#define XPAD_ENC_TAG_SIZE       16
+#define XPAD_ENC_MAX_THREADS    16
+
+#pragma pack(push, 1)
+typedef struct
+{
+    U32 magic;
+    U32 version;
+    U32 iterations;
+    U32 blockCount;
+    U32 blockSize;      /* text bytes per block, the last one may be shorter */
+    U32 rawSize;        /* text bytes in total */
+    U8  salt[16];
+    U8  nonce[8];
+} XPadEncHeader;
+
+typedef struct
+{
+    U32 zipSize;        /* compressed bytes, not counting the tag */
+    U32 rawSize;
+} XPadEncBlock;
+#pragma pack(pop)
+
+typedef struct
+{
+    const XPadEncHeader* header;
+    const XPadEncBlock* table;
+    U8** blocks;        /* start of each sealed block inside the file image */
+    U8* output;
+    U8 key[32];
+    volatile LONG next;
+    volatile LONG failed;
+} XPadDecodeJob;
+
 typedef struct
 {
     HWND hWnd;
@@ -19,7 +76,7 @@ FileInfo g_fileInfo = { 0 };
 static volatile LONG  g_threadCount = 0;
 static volatile LONG  g_Quit = 0;
 
-static void DoOpenFileWork(HWND hWnd, LPTSTR path);
+static void DoOpenFileWork(HWND hWnd, FileInfo* pfi);
 static void DoOpenURLWork(HWND hWnd, LPTSTR docId);
 
 static DWORD WINAPI workthreadfunc(void* param);
@@ -78,7 +135,7 @@ static DWORD WINAPI workthreadfunc(void* param)
         InterlockedIncrement(&g_threadCount);
 
         if(pfi->path[0] != L'\0')
-            DoOpenFileWork(pfi->hWnd, pfi->path);
+            DoOpenFileWork(pfi->hWnd, pfi);
         else if(pfi->docId[0] != L'\0')
             DoOpenURLWork(pfi->hWnd, pfi->docId);
 
@@ -93,9 +150,274 @@ static void DoOpenURLWork(HWND hWnd, LPTSTR docId)
 
 }
 
-static void DoOpenFileWork(HWND hWnd, LPTSTR path)
+static void XPadEncNonce(U8* nonce, const XPadEncHeader* header, U32 idx)
+{
+    memcpy(nonce, header->nonce, 8);
+    nonce[8] = (U8)(idx >> 24);
+    nonce[9] = (U8)(idx >> 16);
+    nonce[10] = (U8)(idx >> 8);
+    nonce[11] = (U8)idx;
+}
+
+static bool XPadOpenBlock(AES256GCMContext gcm, XPadDecodeJob* job, U32 idx)
+{
+    U8 nonce[12];
+    const XPadEncBlock* blk = job->table + idx;
+    U8* sealed = job->blocks[idx];
+
+    XPadEncNonce(nonce, job->header, idx);
+
+    if (zt_aes256_gcm_start(gcm, nonce, sizeof(nonce)) != ZT_OK)
+        return false;
+    zt_aes256_gcm_aad(gcm, reinterpret_cast<const U8*>(job->header), sizeof(XPadEncHeader));
+    zt_aes256_gcm_aad(gcm, reinterpret_cast<const U8*>(blk), sizeof(XPadEncBlock));
+
+    /* the file image is ours, so decrypt in place */
+    zt_aes256_gcm_decrypt(gcm, sealed, sealed, blk->zipSize);
+    if (zt_aes256_gcm_verify(gcm, sealed + blk->zipSize, XPAD_ENC_TAG_SIZE) != ZT_OK)
+        return false;
+
+    uLongf destLen = blk->rawSize;
+    uLong sourceLen = blk->zipSize;
+    U8* dst = job->output + static_cast<size_t>(idx) * job->header->blockSize;
+    int rc = uncompress2(dst, &destLen, sealed, &sourceLen);
+
+    return (rc == Z_OK && destLen == blk->rawSize);
+}
+
+static DWORD WINAPI XPadDecodeThread(void* param)
+{
+    XPadDecodeJob* job = static_cast<XPadDecodeJob*>(param);
+    AES256GCMContext gcm = zt_aes256_gcm_create(job->key);
+
+    if (gcm == NULL)
+    {
+        InterlockedExchange(&job->failed, 1);
+        return 0;
+    }
+
+    for (;;)
+    {
+        LONG idx = InterlockedIncrement(&job->next) - 1;
+        if (idx >= static_cast<LONG>(job->header->blockCount) || job->failed)
+            break;
+        if (g_Quit)
+        {
+            InterlockedExchange(&job->failed, 1);
+            break;
+        }
+        if (!XPadOpenBlock(gcm, job, static_cast<U32>(idx)))
+        {
+            InterlockedExchange(&job->failed, 1);
+            break;
+        }
+    }
+
+    zt_aes256_gcm_destroy(gcm);
+    return 0;
+}
+
+/*
+ * Decode an encrypted container. Returns the text buffer in the same layout
+ * as the plain format (8 bytes of prefix, the text, a trailing zero) or NULL.
+ */
+static U8* XPadDecodeEncrypted(U8* bindata, long fileSize, const U8* passphrase, U32* textLen)
+{
+    const XPadEncHeader* header = reinterpret_cast<const XPadEncHeader*>(bindata);
+    const XPadEncBlock* table = reinterpret_cast<const XPadEncBlock*>(bindata + sizeof(XPadEncHeader));
+    XPadDecodeJob job = { 0 };
+    U8* unzipBuf = NULL;
+    U8** blocks = NULL;
+    U64 offset, total = 0;
+    U32 i;
+
+    if (fileSize < static_cast<long>(sizeof(XPadEncHeader)) || header->version != XPAD_ENC_VERSION)
+        return NULL;
+    if (header->blockSize == 0 || header->blockSize > XPAD_ENC_MAX_BLOCKSIZE || header->rawSize >= ZT_FILE_MAX_SIZE)
+        return NULL;
+    if (header->iterations == 0 || header->blockCount != (header->rawSize + header->blockSize - 1) / header->blockSize)
+        return NULL;
+
+    /* validate the block table before touching any block */
+    offset = sizeof(XPadEncHeader) + static_cast<U64>(header->blockCount) * sizeof(XPadEncBlock);
+    if (offset > static_cast<U64>(fileSize))
+        return NULL;
+
+    blocks = static_cast<U8**>(std::malloc((header->blockCount + 1) * sizeof(U8*)));
+    if (blocks == NULL)
+        return NULL;
+
+    for (i = 0; i < header->blockCount; i++)
+    {
+        U32 expected = (i + 1 < header->blockCount) ? header->blockSize : header->rawSize - i * header->blockSize;
+        if (table[i].rawSize != expected)
+            break;
+        blocks[i] = bindata + offset;
+        offset += static_cast<U64>(table[i].zipSize) + XPAD_ENC_TAG_SIZE;
+        if (offset > static_cast<U64>(fileSize))
+            break;
+        total += table[i].rawSize;
+    }
+
+    if (i == header->blockCount && offset == static_cast<U64>(fileSize) && total == header->rawSize)
+    {
+        unzipBuf = static_cast<U8*>(std::malloc(static_cast<size_t>(header->rawSize) + 9));
+    }
+
+    if (unzipBuf)
+    {
+        size_t passLen = strlen(reinterpret_cast<const char*>(passphrase));
+
+        zt_pbkdf2_sha256(passphrase, passLen, header->salt, sizeof(header->salt), header->iterations, job.key, sizeof(job.key));
+
+        job.header = header;
+        job.table = table;
+        job.blocks = blocks;
+        job.output = unzipBuf + 8;
+        job.next = 0;
+        job.failed = 0;
+
+        /* this thread takes part in the work, the others are helpers */
+        HANDLE helpers[XPAD_ENC_MAX_THREADS];
+        DWORD helperCount = 0;
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+
+        DWORD threads = si.dwNumberOfProcessors;
+        if (threads > XPAD_ENC_MAX_THREADS)
+            threads = XPAD_ENC_MAX_THREADS;
+        if (threads > header->blockCount)
+            threads = header->blockCount;
+
+        for (DWORD t = 1; t < threads; t++)
+        {
+            HANDLE hThread = CreateThread(NULL, 0, XPadDecodeThread, &job, 0, NULL);
+            if (hThread)
+                helpers[helperCount++] = hThread;
+        }
+
+        XPadDecodeThread(&job);
+
+        if (helperCount)
+        {
+            WaitForMultipleObjects(helperCount, helpers, TRUE, INFINITE);
+            for (DWORD t = 0; t < helperCount; t++)
+                CloseHandle(helpers[t]);
+        }
+
+        SecureZeroMemory(job.key, sizeof(job.key));
+
+        if (job.failed)
+        {
+            std::free(unzipBuf);
+            unzipBuf = NULL;
+        }
+        else
+        {
+            /* no CRC is kept, the GCM tags already authenticate every byte */
+            memset(unzipBuf, 0, 8);
+            unzipBuf[header->rawSize + 8] = 0;
+            *textLen = header->rawSize + 8;
+        }
+    }
+
+    std::free(blocks);
+    return unzipBuf;
+}
+
+int ztSaveEncryptedFile(LPCTSTR path, const U8* text, U32 textLen, const U8* passphrase)
+{
+    XPadEncHeader header = { 0 };
+    XPadEncBlock* table = NULL;
+    U8* body = NULL;
+    U8 key[32];
+    U64 bodySize = 0;
+    int ret = ZT_FAIL;
+
+    if (path == NULL || passphrase == NULL || (text == NULL && textLen) || textLen >= ZT_FILE_MAX_SIZE)
+        return ZT_FAIL;
+
+    header.magic = XPAD_ENC_MAGIC;
+    header.version = XPAD_ENC_VERSION;
+    header.iterations = XPAD_ENC_ITERATIONS;
+    header.blockSize = XPAD_ENC_BLOCKSIZE;
+    header.rawSize = textLen;
+    header.blockCount = (textLen + XPAD_ENC_BLOCKSIZE - 1) / XPAD_ENC_BLOCKSIZE;
+
+    if (BCryptGenRandom(NULL, header.salt, sizeof(header.salt), BCRYPT_USE_SYSTEM_PREFERRED_RNG) < 0)
+        return ZT_FAIL;
+    if (BCryptGenRandom(NULL, header.nonce, sizeof(header.nonce), BCRYPT_USE_SYSTEM_PREFERRED_RNG) < 0)
+        return ZT_FAIL;
+
+    zt_pbkdf2_sha256(passphrase, strlen(reinterpret_cast<const char*>(passphrase)), header.salt, sizeof(header.salt), header.iterations, key, sizeof(key));
+
+    AES256GCMContext gcm = zt_aes256_gcm_create(key);
+    SecureZeroMemory(key, sizeof(key));
+
+    if (gcm)
+    {
+        uLong bound = compressBound(XPAD_ENC_BLOCKSIZE) + XPAD_ENC_TAG_SIZE;
+        table = static_cast<XPadEncBlock*>(std::malloc((header.blockCount + 1) * sizeof(XPadEncBlock)));
+        body = static_cast<U8*>(std::malloc(static_cast<size_t>(header.blockCount) * bound + 1));
+    }
+
+    if (table && body)
+    {
+        U32 i;
+        for (i = 0; i < header.blockCount; i++)
+        {
+            U8 nonce[12];
+            const U8* src = text + static_cast<size_t>(i) * XPAD_ENC_BLOCKSIZE;
+            U8* dst = body + bodySize;
+            uLongf zipSize = compressBound(XPAD_ENC_BLOCKSIZE);
+
+            table[i].rawSize = (i + 1 < header.blockCount) ? XPAD_ENC_BLOCKSIZE : textLen - i * XPAD_ENC_BLOCKSIZE;
+            if (compress2(dst, &zipSize, src, table[i].rawSize, Z_DEFAULT_COMPRESSION) != Z_OK)
+                break;
+            table[i].zipSize = static_cast<U32>(zipSize);
+
+            XPadEncNonce(nonce, &header, i);
+            zt_aes256_gcm_start(gcm, nonce, sizeof(nonce));
+            zt_aes256_gcm_aad(gcm, reinterpret_cast<const U8*>(&header), sizeof(XPadEncHeader));
+            zt_aes256_gcm_aad(gcm, reinterpret_cast<const U8*>(table + i), sizeof(XPadEncBlock));
+            zt_aes256_gcm_encrypt(gcm, dst, dst, zipSize);
+            zt_aes256_gcm_finish(gcm, dst + zipSize, XPAD_ENC_TAG_SIZE);
+
+            bodySize += zipSize + XPAD_ENC_TAG_SIZE;
+        }
+
+        if (i == header.blockCount)
+        {
+            U64 tableSize = static_cast<U64>(header.blockCount) * sizeof(XPadEncBlock);
+            if (sizeof(XPadEncHeader) + tableSize + bodySize < ZT_FILE_MAX_SIZE)
+            {
+                int fd = _wopen(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+                if (fd >= 0)
+                {
+                    if (_write(fd, &header, sizeof(XPadEncHeader)) == static_cast<int>(sizeof(XPadEncHeader))
+                        && _write(fd, table, static_cast<unsigned int>(tableSize)) == static_cast<int>(tableSize)
+                        && _write(fd, body, static_cast<unsigned int>(bodySize)) == static_cast<int>(bodySize))
+                    {
+                        ret = ZT_OK;
+                    }
+                    _close(fd);
+                }
+            }
+        }
+    }
+
+    std::free(table);
+    std::free(body);
+    zt_aes256_gcm_destroy(gcm);
+
+    return ret;
+}
+
+static void DoOpenFileWork(HWND hWnd, FileInfo* pfi)
 {
+    LPTSTR path = pfi->path;
     U8* unzipBuf = NULL;
+    bool needPassphrase = false;
 
     if (g_textData)
     {
@@ -118,7 +440,29 @@ static void DoOpenFileWork(HWND hWnd, LPTSTR path)
                 _lseek(fd, 0, SEEK_SET);
                 
                 bytes = _read(fd, bindata, fileSize);
-                if (bytes == fileSize)
+                if (bytes == fileSize && *reinterpret_cast<U32*>(bindata) == XPAD_ENC_MAGIC)
+                {
+                    if (pfi->passphrase[0] == '\0')
+                    {
+                        needPassphrase = true;
+                    }
+                    else
+                    {
+                        U32 textLen = 0;
+                        unzipBuf = XPadDecodeEncrypted(bindata, fileSize, reinterpret_cast<const U8*>(pfi->passphrase), &textLen);
+                        if (unzipBuf)
+                        {
+                            g_textData = reinterpret_cast<char*>(unzipBuf);
+                            g_textLen = textLen;
+                        }
+                        else
+                        {
+                            needPassphrase = true; /* most likely a wrong passphrase, ask again */
+                        }
+                        SecureZeroMemory(pfi->passphrase, sizeof(pfi->passphrase));
+                    }
+                }
+                else if (bytes == fileSize)
                 {
                     uLongf zipSize;
                     U32* p32 = reinterpret_cast<U32*>(bindata);
@@ -166,6 +510,10 @@ static void DoOpenFileWork(HWND hWnd, LPTSTR path)
                 std::free(unzipBuf);
                 unzipBuf = NULL;
             }
+            if (needPassphrase && ::IsWindow(hWnd))
+            {
+                ::PostMessage(hWnd, WM_WINEVENT, 2, 0);
+            }
         }
         else
         {
@@ -1,10 +1,13 @@
 #pragma once
 
+#define ZT_PASSPHRASE_MAX		256
+
 typedef struct FileInfo
 {
 	HWND hWnd;
 	WCHAR docId[16];
 	WCHAR path[MAX_PATH + 1];
+	char passphrase[ZT_PASSPHRASE_MAX]; /* UTF-8, only for encrypted files */
 } FileInfo;
 
 extern FileInfo g_fileInfo;
@@ -16,6 +19,8 @@ void StarUpWorkThread(FileInfo* pFI);
 
 int ztInitNetworkResource();
 
+int ztSaveEncryptedFile(LPCTSTR path, const U8* text, U32 textLen, const U8* passphrase);
+
 void ztShutdownNetworkThread();
 
 
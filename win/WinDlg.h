@@ -33,6 +33,54 @@ public:
 	}
 };
 
+class CPassphraseDlg : public CDialogImpl<CPassphraseDlg>
+{
+public:
+	enum { IDD = IDD_PASSPHRASE };
+
+	char m_passphrase[ZT_PASSPHRASE_MAX] = { 0 }; // UTF-8
+
+	BEGIN_MSG_MAP(CPassphraseDlg)
+		MESSAGE_HANDLER(WM_INITDIALOG, OnInitDialog)
+		COMMAND_ID_HANDLER(IDOK, OnOK)
+		COMMAND_ID_HANDLER(IDCANCEL, OnCloseCmd)
+	END_MSG_MAP()
+
+	~CPassphraseDlg()
+	{
+		SecureZeroMemory(m_passphrase, sizeof(m_passphrase));
+	}
+
+	LRESULT OnInitDialog(UINT /*uMsg*/, WPARAM /*wParam*/, LPARAM /*lParam*/, BOOL& /*bHandled*/)
+	{
+		CenterWindow(GetParent());
+		return TRUE;
+	}
+
+	LRESULT OnOK(WORD /*wNotifyCode*/, WORD wID, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+	{
+		WCHAR text[ZT_PASSPHRASE_MAX] = { 0 };
+		int len = GetDlgItemTextW(IDC_EDIT_PASSPHRASE, text, ZT_PASSPHRASE_MAX);
+
+		m_passphrase[0] = '\0';
+		if (len > 0)
+		{
+			int bytes = WideCharToMultiByte(CP_UTF8, 0, text, len, m_passphrase, ZT_PASSPHRASE_MAX - 1, NULL, NULL);
+			m_passphrase[bytes > 0 ? bytes : 0] = '\0';
+		}
+		SecureZeroMemory(text, sizeof(text));
+
+		EndDialog(m_passphrase[0] ? wID : IDCANCEL);
+		return 0;
+	}
+
+	LRESULT OnCloseCmd(WORD /*wNotifyCode*/, WORD wID, HWND /*hWndCtl*/, BOOL& /*bHandled*/)
+	{
+		EndDialog(wID);
+		return 0;
+	}
+};
+
 class CAboutDlg : public CDialogImpl<CAboutDlg>
 {
 public:
@@ -8,9 +8,11 @@
 
 #define IDD_ABOUTDLG                    100
 #define IDD_OPENURL	                    101
+#define IDD_PASSPHRASE                  102
 #define IDR_MAINFRAME                   128
 
 #define IDC_EDIT_URL					130
+#define IDC_EDIT_PASSPHRASE				131
 
 #define IDM_DARKMODE	                (0x100)
 #define IDM_OPENURL                     (0x110)
@@ -614,3 +614,926 @@ static void AES256_decrypt(const AES256_ctx* ctx, size_t blocks, unsigned char*
     }
 }
 
+
+/*
+ * AES-256 in CTR and GCM modes
+ * ============================
+ *
+ * The bitsliced code above is kept as the constant-time fallback. When the
+ * CPU has dedicated instructions (AES-NI + PCLMULQDQ on x86/x64, the ARMv8
+ * Cryptography Extension on ARM64) the counter blocks are encrypted eight at
+ * a time so that the AES rounds of independent blocks overlap in the pipeline,
+ * and GHASH folds the same eight ciphertext blocks with one reduction using the
+ * precomputed powers H^1 .. H^8.
+ *
+ * The dispatch happens once per context in zt_aes256_gcm_create().
+ */
+
+#define AES256_ROUNDS           14
+#define AES_BLOCK_SIZE          16
+#define AES_PARALLEL_BLOCKS     8
+
+#define ZT_AES_ENGINE_SOFT      0
+#define ZT_AES_ENGINE_AESNI     1
+#define ZT_AES_ENGINE_ARMV8     2
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ZT_HAVE_AESNI
+#endif
+
+#if defined(_M_ARM64) || ((defined(__aarch64__) || defined(__arm64__)) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)))
+#define ZT_HAVE_ARMV8_AES
+#endif
+
+#if defined(ZT_HAVE_AESNI)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define ZT_TARGET_AESNI
+#else
+#include <cpuid.h>
+#define ZT_TARGET_AESNI __attribute__((target("aes,pclmul,ssse3,sse4.1")))
+#endif
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#endif
+
+#if defined(ZT_HAVE_ARMV8_AES)
+#include <arm_neon.h>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+typedef struct
+{
+    U8              rk[AES256_ROUNDS + 1][AES_BLOCK_SIZE]; /* round keys in byte order for the hardware path */
+    U8              H[AES_PARALLEL_BLOCKS][AES_BLOCK_SIZE]; /* H^1 .. H^8 for the hardware GHASH */
+    AES256_ctx      sw;             /* bitsliced round keys for the constant-time path */
+    U8              H0[AES_BLOCK_SIZE];   /* the hash subkey H = E(K, 0^128) */
+    U8              J0[AES_BLOCK_SIZE];   /* pre-counter block */
+    U8              X[AES_BLOCK_SIZE];    /* running GHASH value */
+    U8              ks[AES_BLOCK_SIZE];   /* key stream of the current partial block */
+    U8              buf[AES_BLOCK_SIZE];  /* bytes of the current partial GHASH block */
+    U32             ctr;            /* 32-bit counter of the next block to encrypt */
+    U64             aadLen;
+    U64             textLen;
+    int             engine;
+    int             phase;
+} AES256_gcm_ctx;
+
+#define GCM_PHASE_NONE      0   /* no IV yet */
+#define GCM_PHASE_AAD       1   /* accepting additional authenticated data */
+#define GCM_PHASE_TEXT      2   /* accepting plain/cipher text */
+#define GCM_PHASE_DONE      3   /* tag computed, a new IV is needed */
+
+static U32 ReadBE32(const U8* p)
+{
+    return ((U32)p[0] << 24) | ((U32)p[1] << 16) | ((U32)p[2] << 8) | (U32)p[3];
+}
+
+static void WriteBE32(U8* p, U32 v)
+{
+    p[0] = (U8)(v >> 24);
+    p[1] = (U8)(v >> 16);
+    p[2] = (U8)(v >> 8);
+    p[3] = (U8)v;
+}
+
+static void WriteBE64(U8* p, U64 v)
+{
+    WriteBE32(p, (U32)(v >> 32));
+    WriteBE32(p + 4, (U32)v);
+}
+
+static void XorBlock(U8* dst, const U8* src)
+{
+    int i;
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        dst[i] ^= src[i];
+    }
+}
+
+/*
+ * Constant-time GF(2^128) multiplication, X = X * H, following Algorithm 1 of
+ * NIST SP 800-38D. Branches are replaced with masks so that the timing does not
+ * depend on the secret hash subkey or on the data.
+ */
+static void GHashMultiplySoft(U8* X, const U8* H)
+{
+    U64 zh = 0, zl = 0;
+    U64 vh = ((U64)ReadBE32(H) << 32) | ReadBE32(H + 4);
+    U64 vl = ((U64)ReadBE32(H + 8) << 32) | ReadBE32(H + 12);
+    int i, b;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+        U8 x = X[i];
+        for (b = 7; b >= 0; b--)
+        {
+            U64 mask = (U64)0 - (U64)((x >> b) & 1);
+            U64 lsb = (U64)0 - (vl & 1);
+            zh ^= vh & mask;
+            zl ^= vl & mask;
+            vl = (vl >> 1) | (vh << 63);
+            vh = (vh >> 1) ^ (UINT64_C(0xE100000000000000) & lsb);
+        }
+    }
+    WriteBE64(X, zh);
+    WriteBE64(X + 8, zl);
+}
+
+static void CounterBlock(U8* block, const U8* J0, U32 ctr)
+{
+    memcpy(block, J0, 12);
+    WriteBE32(block + 12, ctr);
+}
+
+static void CtrSoft(AES256_gcm_ctx* ctx, const U8* in, U8* out, size_t blocks, int enc)
+{
+    U8 ks[AES_BLOCK_SIZE];
+    int i;
+
+    while (blocks--)
+    {
+        CounterBlock(ks, ctx->J0, ctx->ctr++);
+        AES_encrypt(ctx->sw.rk, AES256_ROUNDS, ks, ks);
+        for (i = 0; i < AES_BLOCK_SIZE; i++)
+        {
+            out[i] = in[i] ^ ks[i];
+        }
+        XorBlock(ctx->X, enc ? out : in);
+        GHashMultiplySoft(ctx->X, ctx->H0);
+        in += AES_BLOCK_SIZE;
+        out += AES_BLOCK_SIZE;
+    }
+}
+
+#if defined(ZT_HAVE_AESNI)
+
+static int CpuHasAESNI(void)
+{
+    unsigned int ecx;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    ecx = (unsigned int)info[2];
+#else
+    unsigned int eax, ebx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+#endif
+    /* AES (bit 25), PCLMULQDQ (bit 1), SSSE3 (bit 9), SSE4.1 (bit 19) */
+    return (ecx & (1u << 25)) && (ecx & (1u << 1)) && (ecx & (1u << 9)) && (ecx & (1u << 19));
+}
+
+ZT_TARGET_AESNI
+static __m128i ByteSwap128(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+/*
+ * Carry-less multiplication of two byte-reflected blocks without reduction.
+ * The 256-bit product is accumulated into lo:hi so that several products can
+ * share one reduction (Intel, "Carry-Less Multiplication and Its Usage for
+ * Computing the GCM Mode", algorithm 5).
+ */
+ZT_TARGET_AESNI
+static void ClmulAccumulate(__m128i a, __m128i b, __m128i* lo, __m128i* mid, __m128i* hi)
+{
+    *lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+    *hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+    *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x10));
+    *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x01));
+}
+
+ZT_TARGET_AESNI
+static __m128i ClmulReduce(__m128i lo, __m128i mid, __m128i hi)
+{
+    __m128i t2, t4, t5, t7, t8, t9;
+
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    /* shift hi:lo left by one bit, the operands are bit-reflected */
+    t7 = _mm_srli_epi32(lo, 31);
+    t8 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    lo = _mm_or_si128(lo, t7);
+    hi = _mm_or_si128(hi, t8);
+    hi = _mm_or_si128(hi, t9);
+
+    /* reduce modulo x^128 + x^7 + x^2 + x + 1 */
+    t7 = _mm_slli_epi32(lo, 31);
+    t8 = _mm_slli_epi32(lo, 30);
+    t9 = _mm_slli_epi32(lo, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    lo = _mm_xor_si128(lo, t7);
+    t2 = _mm_srli_epi32(lo, 1);
+    t4 = _mm_srli_epi32(lo, 2);
+    t5 = _mm_srli_epi32(lo, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    lo = _mm_xor_si128(lo, t2);
+    return _mm_xor_si128(hi, lo);
+}
+
+ZT_TARGET_AESNI
+static __m128i GHashMultiplyAESNI(__m128i x, __m128i h)
+{
+    __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+    ClmulAccumulate(x, h, &lo, &mid, &hi);
+    return ClmulReduce(lo, mid, hi);
+}
+
+ZT_TARGET_AESNI
+static void EncryptBlockAESNI(const AES256_gcm_ctx* ctx, U8* out16, const U8* in16)
+{
+    int r;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in16), _mm_loadu_si128((const __m128i*)ctx->rk[0]));
+    for (r = 1; r < AES256_ROUNDS; r++)
+    {
+        s = _mm_aesenc_si128(s, _mm_loadu_si128((const __m128i*)ctx->rk[r]));
+    }
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128((const __m128i*)ctx->rk[AES256_ROUNDS]));
+    _mm_storeu_si128((__m128i*)out16, s);
+}
+
+/* Store H^1 .. H^8, byte-reflected, in ctx->H */
+ZT_TARGET_AESNI
+static void GHashInitAESNI(AES256_gcm_ctx* ctx)
+{
+    int i;
+    __m128i h = ByteSwap128(_mm_loadu_si128((const __m128i*)ctx->H0));
+    __m128i p = h;
+    for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+    {
+        _mm_storeu_si128((__m128i*)ctx->H[i], p);
+        p = GHashMultiplyAESNI(p, h);
+    }
+}
+
+ZT_TARGET_AESNI
+static void GHashBlockAESNI(AES256_gcm_ctx* ctx, const U8* block)
+{
+    __m128i x = ByteSwap128(_mm_loadu_si128((const __m128i*)ctx->X));
+    x = _mm_xor_si128(x, ByteSwap128(_mm_loadu_si128((const __m128i*)block)));
+    x = GHashMultiplyAESNI(x, _mm_loadu_si128((const __m128i*)ctx->H[0]));
+    _mm_storeu_si128((__m128i*)ctx->X, ByteSwap128(x));
+}
+
+ZT_TARGET_AESNI
+static void CtrAESNI(AES256_gcm_ctx* ctx, const U8* in, U8* out, size_t blocks, int enc)
+{
+    __m128i rk[AES256_ROUNDS + 1];
+    __m128i hp[AES_PARALLEL_BLOCKS];
+    __m128i x = ByteSwap128(_mm_loadu_si128((const __m128i*)ctx->X));
+    __m128i j0 = _mm_loadu_si128((const __m128i*)ctx->J0);
+    U32 ctr = ctx->ctr;
+    int i, r;
+
+    for (r = 0; r <= AES256_ROUNDS; r++)
+    {
+        rk[r] = _mm_loadu_si128((const __m128i*)ctx->rk[r]);
+    }
+    for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+    {
+        hp[i] = _mm_loadu_si128((const __m128i*)ctx->H[i]);
+    }
+
+    while (blocks >= AES_PARALLEL_BLOCKS)
+    {
+        __m128i s[AES_PARALLEL_BLOCKS];
+        __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+        for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+        {
+            U32 c = ctr + (U32)i;
+            c = (c >> 24) | ((c >> 8) & 0xFF00) | ((c << 8) & 0xFF0000) | (c << 24);
+            s[i] = _mm_xor_si128(_mm_insert_epi32(j0, (int)c, 3), rk[0]);
+        }
+        /* written out so that the eight states stay in registers */
+        for (r = 1; r < AES256_ROUNDS; r++)
+        {
+            __m128i k = rk[r];
+            s[0] = _mm_aesenc_si128(s[0], k);
+            s[1] = _mm_aesenc_si128(s[1], k);
+            s[2] = _mm_aesenc_si128(s[2], k);
+            s[3] = _mm_aesenc_si128(s[3], k);
+            s[4] = _mm_aesenc_si128(s[4], k);
+            s[5] = _mm_aesenc_si128(s[5], k);
+            s[6] = _mm_aesenc_si128(s[6], k);
+            s[7] = _mm_aesenc_si128(s[7], k);
+        }
+        for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i*)(in + i * AES_BLOCK_SIZE));
+            __m128i c = _mm_xor_si128(_mm_aesenclast_si128(s[i], rk[AES256_ROUNDS]), d);
+            _mm_storeu_si128((__m128i*)(out + i * AES_BLOCK_SIZE), c);
+            /* the oldest block is multiplied by the highest power of H */
+            d = ByteSwap128(enc ? c : d);
+            if (i == 0)
+                d = _mm_xor_si128(d, x);
+            ClmulAccumulate(d, hp[AES_PARALLEL_BLOCKS - 1 - i], &lo, &mid, &hi);
+        }
+        x = ClmulReduce(lo, mid, hi);
+
+        ctr += AES_PARALLEL_BLOCKS;
+        in += AES_PARALLEL_BLOCKS * AES_BLOCK_SIZE;
+        out += AES_PARALLEL_BLOCKS * AES_BLOCK_SIZE;
+        blocks -= AES_PARALLEL_BLOCKS;
+    }
+
+    while (blocks--)
+    {
+        U32 c = (ctr >> 24) | ((ctr >> 8) & 0xFF00) | ((ctr << 8) & 0xFF0000) | (ctr << 24);
+        __m128i s = _mm_xor_si128(_mm_insert_epi32(j0, (int)c, 3), rk[0]);
+        __m128i d = _mm_loadu_si128((const __m128i*)in);
+        for (r = 1; r < AES256_ROUNDS; r++)
+        {
+            s = _mm_aesenc_si128(s, rk[r]);
+        }
+        s = _mm_xor_si128(_mm_aesenclast_si128(s, rk[AES256_ROUNDS]), d);
+        _mm_storeu_si128((__m128i*)out, s);
+        x = GHashMultiplyAESNI(_mm_xor_si128(x, ByteSwap128(enc ? s : d)), hp[0]);
+
+        ctr++;
+        in += AES_BLOCK_SIZE;
+        out += AES_BLOCK_SIZE;
+    }
+
+    ctx->ctr = ctr;
+    _mm_storeu_si128((__m128i*)ctx->X, ByteSwap128(x));
+}
+
+#endif /* ZT_HAVE_AESNI */
+
+#if defined(ZT_HAVE_ARMV8_AES)
+
+static int CpuHasARMv8AES(void)
+{
+#if defined(_WIN32)
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) ? 1 : 0;
+#elif defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    return (hwcap & HWCAP_AES) && (hwcap & HWCAP_PMULL);
+#else
+    return 1; /* the compiler was told the target has the crypto extension */
+#endif
+}
+
+/* vextq_u8 based byte shifts that mirror _mm_slli_si128 / _mm_srli_si128 */
+#define NEON_SLLI128(x, n)  vreinterpretq_u32_u8(vextq_u8(vdupq_n_u8(0), vreinterpretq_u8_u32(x), 16 - (n)))
+#define NEON_SRLI128(x, n)  vreinterpretq_u32_u8(vextq_u8(vreinterpretq_u8_u32(x), vdupq_n_u8(0), (n)))
+
+static uint8x16_t ByteSwapNEON(uint8x16_t x)
+{
+    x = vrev64q_u8(x);
+    return vextq_u8(x, x, 8);
+}
+
+static uint32x4_t PMull(uint8x16_t a, uint8x16_t b, int ha, int hb)
+{
+    poly64_t pa = (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(a), 0);
+    poly64_t pb = (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(b), 0);
+    if (ha)
+        pa = (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(a), 1);
+    if (hb)
+        pb = (poly64_t)vgetq_lane_u64(vreinterpretq_u64_u8(b), 1);
+    return vreinterpretq_u32_p128(vmull_p64(pa, pb));
+}
+
+static void PMullAccumulate(uint8x16_t a, uint8x16_t b, uint32x4_t* lo, uint32x4_t* mid, uint32x4_t* hi)
+{
+    *lo = veorq_u32(*lo, PMull(a, b, 0, 0));
+    *hi = veorq_u32(*hi, PMull(a, b, 1, 1));
+    *mid = veorq_u32(*mid, PMull(a, b, 0, 1));
+    *mid = veorq_u32(*mid, PMull(a, b, 1, 0));
+}
+
+/* Same reduction as ClmulReduce(), written with NEON lane shifts */
+static uint8x16_t PMullReduce(uint32x4_t lo, uint32x4_t mid, uint32x4_t hi)
+{
+    uint32x4_t t2, t4, t5, t7, t8, t9;
+
+    lo = veorq_u32(lo, NEON_SLLI128(mid, 8));
+    hi = veorq_u32(hi, NEON_SRLI128(mid, 8));
+
+    t7 = vshrq_n_u32(lo, 31);
+    t8 = vshrq_n_u32(hi, 31);
+    lo = vshlq_n_u32(lo, 1);
+    hi = vshlq_n_u32(hi, 1);
+    t9 = NEON_SRLI128(t7, 12);
+    t8 = NEON_SLLI128(t8, 4);
+    t7 = NEON_SLLI128(t7, 4);
+    lo = vorrq_u32(lo, t7);
+    hi = vorrq_u32(hi, t8);
+    hi = vorrq_u32(hi, t9);
+
+    t7 = vshlq_n_u32(lo, 31);
+    t8 = vshlq_n_u32(lo, 30);
+    t9 = vshlq_n_u32(lo, 25);
+    t7 = veorq_u32(t7, t8);
+    t7 = veorq_u32(t7, t9);
+    t8 = NEON_SRLI128(t7, 4);
+    t7 = NEON_SLLI128(t7, 12);
+    lo = veorq_u32(lo, t7);
+    t2 = vshrq_n_u32(lo, 1);
+    t4 = vshrq_n_u32(lo, 2);
+    t5 = vshrq_n_u32(lo, 7);
+    t2 = veorq_u32(t2, t4);
+    t2 = veorq_u32(t2, t5);
+    t2 = veorq_u32(t2, t8);
+    lo = veorq_u32(lo, t2);
+    return vreinterpretq_u8_u32(veorq_u32(hi, lo));
+}
+
+static uint8x16_t GHashMultiplyARMv8(uint8x16_t x, uint8x16_t h)
+{
+    uint32x4_t lo = vdupq_n_u32(0), mid = vdupq_n_u32(0), hi = vdupq_n_u32(0);
+    PMullAccumulate(x, h, &lo, &mid, &hi);
+    return PMullReduce(lo, mid, hi);
+}
+
+static uint8x16_t EncryptNEON(const uint8x16_t* rk, uint8x16_t s)
+{
+    int r;
+    for (r = 0; r < AES256_ROUNDS - 1; r++)
+    {
+        s = vaesmcq_u8(vaeseq_u8(s, rk[r]));
+    }
+    s = vaeseq_u8(s, rk[AES256_ROUNDS - 1]);
+    return veorq_u8(s, rk[AES256_ROUNDS]);
+}
+
+static void EncryptBlockARMv8(const AES256_gcm_ctx* ctx, U8* out16, const U8* in16)
+{
+    uint8x16_t rk[AES256_ROUNDS + 1];
+    int r;
+    for (r = 0; r <= AES256_ROUNDS; r++)
+    {
+        rk[r] = vld1q_u8(ctx->rk[r]);
+    }
+    vst1q_u8(out16, EncryptNEON(rk, vld1q_u8(in16)));
+}
+
+static void GHashInitARMv8(AES256_gcm_ctx* ctx)
+{
+    int i;
+    uint8x16_t h = ByteSwapNEON(vld1q_u8(ctx->H0));
+    uint8x16_t p = h;
+    for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+    {
+        vst1q_u8(ctx->H[i], p);
+        p = GHashMultiplyARMv8(p, h);
+    }
+}
+
+static void GHashBlockARMv8(AES256_gcm_ctx* ctx, const U8* block)
+{
+    uint8x16_t x = ByteSwapNEON(veorq_u8(vld1q_u8(ctx->X), vld1q_u8(block)));
+    x = GHashMultiplyARMv8(x, vld1q_u8(ctx->H[0]));
+    vst1q_u8(ctx->X, ByteSwapNEON(x));
+}
+
+static void CtrARMv8(AES256_gcm_ctx* ctx, const U8* in, U8* out, size_t blocks, int enc)
+{
+    uint8x16_t rk[AES256_ROUNDS + 1];
+    uint8x16_t hp[AES_PARALLEL_BLOCKS];
+    uint8x16_t x = ByteSwapNEON(vld1q_u8(ctx->X));
+    uint32x4_t j0 = vreinterpretq_u32_u8(vld1q_u8(ctx->J0));
+    U32 ctr = ctx->ctr;
+    int i, r;
+
+    for (r = 0; r <= AES256_ROUNDS; r++)
+    {
+        rk[r] = vld1q_u8(ctx->rk[r]);
+    }
+    for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+    {
+        hp[i] = vld1q_u8(ctx->H[i]);
+    }
+
+    while (blocks >= AES_PARALLEL_BLOCKS)
+    {
+        uint8x16_t s[AES_PARALLEL_BLOCKS];
+        uint32x4_t lo = vdupq_n_u32(0), mid = vdupq_n_u32(0), hi = vdupq_n_u32(0);
+
+        for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+        {
+            U32 c = ctr + (U32)i;
+            c = (c >> 24) | ((c >> 8) & 0xFF00) | ((c << 8) & 0xFF0000) | (c << 24);
+            s[i] = vreinterpretq_u8_u32(vsetq_lane_u32(c, j0, 3));
+        }
+        /* written out so that the eight states stay in registers */
+        for (r = 0; r < AES256_ROUNDS - 1; r++)
+        {
+            uint8x16_t k = rk[r];
+            s[0] = vaesmcq_u8(vaeseq_u8(s[0], k));
+            s[1] = vaesmcq_u8(vaeseq_u8(s[1], k));
+            s[2] = vaesmcq_u8(vaeseq_u8(s[2], k));
+            s[3] = vaesmcq_u8(vaeseq_u8(s[3], k));
+            s[4] = vaesmcq_u8(vaeseq_u8(s[4], k));
+            s[5] = vaesmcq_u8(vaeseq_u8(s[5], k));
+            s[6] = vaesmcq_u8(vaeseq_u8(s[6], k));
+            s[7] = vaesmcq_u8(vaeseq_u8(s[7], k));
+        }
+        for (i = 0; i < AES_PARALLEL_BLOCKS; i++)
+        {
+            uint8x16_t d = vld1q_u8(in + i * AES_BLOCK_SIZE);
+            uint8x16_t c = veorq_u8(veorq_u8(vaeseq_u8(s[i], rk[AES256_ROUNDS - 1]), rk[AES256_ROUNDS]), d);
+            vst1q_u8(out + i * AES_BLOCK_SIZE, c);
+            d = ByteSwapNEON(enc ? c : d);
+            if (i == 0)
+                d = veorq_u8(d, x);
+            PMullAccumulate(d, hp[AES_PARALLEL_BLOCKS - 1 - i], &lo, &mid, &hi);
+        }
+        x = PMullReduce(lo, mid, hi);
+
+        ctr += AES_PARALLEL_BLOCKS;
+        in += AES_PARALLEL_BLOCKS * AES_BLOCK_SIZE;
+        out += AES_PARALLEL_BLOCKS * AES_BLOCK_SIZE;
+        blocks -= AES_PARALLEL_BLOCKS;
+    }
+
+    while (blocks--)
+    {
+        U32 c = (ctr >> 24) | ((ctr >> 8) & 0xFF00) | ((ctr << 8) & 0xFF0000) | (ctr << 24);
+        uint8x16_t s = vreinterpretq_u8_u32(vsetq_lane_u32(c, j0, 3));
+        uint8x16_t d = vld1q_u8(in);
+        s = veorq_u8(EncryptNEON(rk, s), d);
+        vst1q_u8(out, s);
+        x = GHashMultiplyARMv8(veorq_u8(x, ByteSwapNEON(enc ? s : d)), hp[0]);
+
+        ctr++;
+        in += AES_BLOCK_SIZE;
+        out += AES_BLOCK_SIZE;
+    }
+
+    ctx->ctr = ctr;
+    vst1q_u8(ctx->X, ByteSwapNEON(x));
+}
+
+#endif /* ZT_HAVE_ARMV8_AES */
+
+static int DetectEngine(void)
+{
+#if defined(ZT_HAVE_AESNI)
+    if (CpuHasAESNI())
+        return ZT_AES_ENGINE_AESNI;
+#endif
+#if defined(ZT_HAVE_ARMV8_AES)
+    if (CpuHasARMv8AES())
+        return ZT_AES_ENGINE_ARMV8;
+#endif
+    return ZT_AES_ENGINE_SOFT;
+}
+
+static void EncryptBlock(const AES256_gcm_ctx* ctx, U8* out16, const U8* in16)
+{
+    switch (ctx->engine)
+    {
+#if defined(ZT_HAVE_AESNI)
+    case ZT_AES_ENGINE_AESNI:
+        EncryptBlockAESNI(ctx, out16, in16);
+        break;
+#endif
+#if defined(ZT_HAVE_ARMV8_AES)
+    case ZT_AES_ENGINE_ARMV8:
+        EncryptBlockARMv8(ctx, out16, in16);
+        break;
+#endif
+    default:
+        AES_encrypt(ctx->sw.rk, AES256_ROUNDS, out16, in16);
+        break;
+    }
+}
+
+/* X = (X ^ block) * H */
+static void GHashBlock(AES256_gcm_ctx* ctx, const U8* block)
+{
+    switch (ctx->engine)
+    {
+#if defined(ZT_HAVE_AESNI)
+    case ZT_AES_ENGINE_AESNI:
+        GHashBlockAESNI(ctx, block);
+        break;
+#endif
+#if defined(ZT_HAVE_ARMV8_AES)
+    case ZT_AES_ENGINE_ARMV8:
+        GHashBlockARMv8(ctx, block);
+        break;
+#endif
+    default:
+        XorBlock(ctx->X, block);
+        GHashMultiplySoft(ctx->X, ctx->H0);
+        break;
+    }
+}
+
+/* CTR-encrypt whole blocks and fold the cipher text into GHASH */
+static void CtrBlocks(AES256_gcm_ctx* ctx, const U8* in, U8* out, size_t blocks, int enc)
+{
+    switch (ctx->engine)
+    {
+#if defined(ZT_HAVE_AESNI)
+    case ZT_AES_ENGINE_AESNI:
+        CtrAESNI(ctx, in, out, blocks, enc);
+        break;
+#endif
+#if defined(ZT_HAVE_ARMV8_AES)
+    case ZT_AES_ENGINE_ARMV8:
+        CtrARMv8(ctx, in, out, blocks, enc);
+        break;
+#endif
+    default:
+        CtrSoft(ctx, in, out, blocks, enc);
+        break;
+    }
+}
+
+/* Pad and hash a pending partial block of AAD or text */
+static void GHashFlush(AES256_gcm_ctx* ctx, U64 len)
+{
+    unsigned int used = (unsigned int)(len % AES_BLOCK_SIZE);
+    if (used)
+    {
+        memset(ctx->buf + used, 0, AES_BLOCK_SIZE - used);
+        GHashBlock(ctx, ctx->buf);
+    }
+}
+
+static int GcmCrypt(AES256_gcm_ctx* ctx, const U8* in, U8* out, size_t len, int enc)
+{
+    unsigned int used;
+    size_t blocks;
+
+    if (ctx == NULL || (len && (in == NULL || out == NULL)))
+        return ZT_FAIL;
+
+    if (ctx->phase == GCM_PHASE_AAD)
+    {
+        GHashFlush(ctx, ctx->aadLen);
+        ctx->phase = GCM_PHASE_TEXT;
+    }
+    if (ctx->phase != GCM_PHASE_TEXT)
+        return ZT_FAIL;
+
+    /* GCM limits one message to 2^32 - 2 blocks */
+    if (ctx->textLen + len < ctx->textLen || ctx->textLen + len > ((UINT64_C(1) << 32) - 2) * AES_BLOCK_SIZE)
+        return ZT_FAIL;
+
+    /* finish the partial block left over by the previous call */
+    used = (unsigned int)(ctx->textLen % AES_BLOCK_SIZE);
+    ctx->textLen += len;
+    if (used)
+    {
+        while (used < AES_BLOCK_SIZE && len)
+        {
+            U8 c = *in ^ ctx->ks[used];
+            ctx->buf[used++] = enc ? c : *in;
+            *out++ = c;
+            in++;
+            len--;
+        }
+        if (used < AES_BLOCK_SIZE)
+            return ZT_OK;
+        GHashBlock(ctx, ctx->buf);
+    }
+
+    blocks = len / AES_BLOCK_SIZE;
+    if (blocks)
+    {
+        CtrBlocks(ctx, in, out, blocks, enc);
+        in += blocks * AES_BLOCK_SIZE;
+        out += blocks * AES_BLOCK_SIZE;
+        len -= blocks * AES_BLOCK_SIZE;
+    }
+
+    /* keep the key stream of the trailing partial block for the next call */
+    if (len)
+    {
+        CounterBlock(ctx->ks, ctx->J0, ctx->ctr++);
+        EncryptBlock(ctx, ctx->ks, ctx->ks);
+        for (used = 0; used < len; used++)
+        {
+            U8 c = in[used] ^ ctx->ks[used];
+            ctx->buf[used] = enc ? c : in[used];
+            out[used] = c;
+        }
+    }
+
+    return ZT_OK;
+}
+
+static void GcmTag(AES256_gcm_ctx* ctx, U8* tag16)
+{
+    U8 block[AES_BLOCK_SIZE];
+
+    if (ctx->phase == GCM_PHASE_AAD)
+        GHashFlush(ctx, ctx->aadLen);
+    else
+        GHashFlush(ctx, ctx->textLen);
+
+    WriteBE64(block, ctx->aadLen << 3);
+    WriteBE64(block + 8, ctx->textLen << 3);
+    GHashBlock(ctx, block);
+
+    EncryptBlock(ctx, tag16, ctx->J0);
+    XorBlock(tag16, ctx->X);
+    ctx->phase = GCM_PHASE_DONE;
+}
+
+int zt_aes256_hwaccel(void)
+{
+    return DetectEngine() != ZT_AES_ENGINE_SOFT;
+}
+
+AES256GCMContext zt_aes256_gcm_create(const U8* key32)
+{
+    AES256_gcm_ctx* ctx;
+    U8 zero[AES_BLOCK_SIZE] = { 0 };
+    int r;
+
+    if (key32 == NULL)
+        return NULL;
+
+    ctx = (AES256_gcm_ctx*)malloc(sizeof(AES256_gcm_ctx));
+    if (ctx == NULL)
+        return NULL;
+
+    memset(ctx, 0, sizeof(AES256_gcm_ctx));
+    AES256_init(&ctx->sw, key32);
+
+    /* the bitsliced key schedule is reused by the hardware path */
+    for (r = 0; r <= AES256_ROUNDS; r++)
+    {
+        SaveBytes(ctx->rk[r], &ctx->sw.rk[r]);
+    }
+
+    ctx->engine = DetectEngine();
+    EncryptBlock(ctx, ctx->H0, zero);
+
+#if defined(ZT_HAVE_AESNI)
+    if (ctx->engine == ZT_AES_ENGINE_AESNI)
+        GHashInitAESNI(ctx);
+#endif
+#if defined(ZT_HAVE_ARMV8_AES)
+    if (ctx->engine == ZT_AES_ENGINE_ARMV8)
+        GHashInitARMv8(ctx);
+#endif
+
+    return (AES256GCMContext)ctx;
+}
+
+void zt_aes256_gcm_destroy(AES256GCMContext cxt)
+{
+    if (cxt)
+    {
+        /* do not leave key material behind in the heap */
+        volatile U8* p = (volatile U8*)cxt;
+        size_t i;
+        for (i = 0; i < sizeof(AES256_gcm_ctx); i++)
+        {
+            p[i] = 0;
+        }
+        free(cxt);
+    }
+}
+
+int zt_aes256_gcm_start(AES256GCMContext cxt, const U8* iv, size_t ivlen)
+{
+    AES256_gcm_ctx* ctx = (AES256_gcm_ctx*)cxt;
+
+    if (ctx == NULL || iv == NULL || ivlen == 0)
+        return ZT_FAIL;
+
+    memset(ctx->X, 0, AES_BLOCK_SIZE);
+    if (ivlen == 12)
+    {
+        memcpy(ctx->J0, iv, 12);
+        WriteBE32(ctx->J0 + 12, 1);
+    }
+    else
+    {
+        /* J0 = GHASH(IV || 0^s || 0^64 || [len(IV)]64) */
+        U8 block[AES_BLOCK_SIZE];
+        size_t n = ivlen;
+        while (n >= AES_BLOCK_SIZE)
+        {
+            GHashBlock(ctx, iv);
+            iv += AES_BLOCK_SIZE;
+            n -= AES_BLOCK_SIZE;
+        }
+        if (n)
+        {
+            memset(block, 0, AES_BLOCK_SIZE);
+            memcpy(block, iv, n);
+            GHashBlock(ctx, block);
+        }
+        memset(block, 0, 8);
+        WriteBE64(block + 8, (U64)ivlen << 3);
+        GHashBlock(ctx, block);
+        memcpy(ctx->J0, ctx->X, AES_BLOCK_SIZE);
+        memset(ctx->X, 0, AES_BLOCK_SIZE);
+    }
+
+    ctx->ctr = ReadBE32(ctx->J0 + 12) + 1;
+    ctx->aadLen = 0;
+    ctx->textLen = 0;
+    ctx->phase = GCM_PHASE_AAD;
+
+    return ZT_OK;
+}
+
+int zt_aes256_gcm_aad(AES256GCMContext cxt, const U8* aad, size_t len)
+{
+    AES256_gcm_ctx* ctx = (AES256_gcm_ctx*)cxt;
+    unsigned int used;
+
+    if (ctx == NULL || ctx->phase != GCM_PHASE_AAD || (len && aad == NULL))
+        return ZT_FAIL;
+
+    used = (unsigned int)(ctx->aadLen % AES_BLOCK_SIZE);
+    ctx->aadLen += len;
+    while (len)
+    {
+        ctx->buf[used++] = *aad++;
+        len--;
+        if (used == AES_BLOCK_SIZE)
+        {
+            GHashBlock(ctx, ctx->buf);
+            used = 0;
+            while (len >= AES_BLOCK_SIZE)
+            {
+                GHashBlock(ctx, aad);
+                aad += AES_BLOCK_SIZE;
+                len -= AES_BLOCK_SIZE;
+            }
+        }
+    }
+
+    return ZT_OK;
+}
+
+int zt_aes256_gcm_encrypt(AES256GCMContext cxt, const U8* input, U8* output, size_t len)
+{
+    return GcmCrypt((AES256_gcm_ctx*)cxt, input, output, len, 1);
+}
+
+int zt_aes256_gcm_decrypt(AES256GCMContext cxt, const U8* input, U8* output, size_t len)
+{
+    return GcmCrypt((AES256_gcm_ctx*)cxt, input, output, len, 0);
+}
+
+int zt_aes256_gcm_finish(AES256GCMContext cxt, U8* tag, size_t taglen)
+{
+    AES256_gcm_ctx* ctx = (AES256_gcm_ctx*)cxt;
+    U8 full[AES_BLOCK_SIZE];
+
+    if (ctx == NULL || tag == NULL || taglen == 0 || taglen > AES_BLOCK_SIZE)
+        return ZT_FAIL;
+    if (ctx->phase != GCM_PHASE_AAD && ctx->phase != GCM_PHASE_TEXT)
+        return ZT_FAIL;
+
+    GcmTag(ctx, full);
+    memcpy(tag, full, taglen);
+
+    return ZT_OK;
+}
+
+int zt_aes256_gcm_verify(AES256GCMContext cxt, const U8* tag, size_t taglen)
+{
+    AES256_gcm_ctx* ctx = (AES256_gcm_ctx*)cxt;
+    U8 full[AES_BLOCK_SIZE];
+    U8 diff = 0;
+    size_t i;
+
+    if (ctx == NULL || tag == NULL || taglen == 0 || taglen > AES_BLOCK_SIZE)
+        return ZT_FAIL;
+    if (ctx->phase != GCM_PHASE_AAD && ctx->phase != GCM_PHASE_TEXT)
+        return ZT_FAIL;
+
+    GcmTag(ctx, full);
+
+    /* compare in constant time */
+    for (i = 0; i < taglen; i++)
+    {
+        diff |= full[i] ^ tag[i];
+    }
+
+    return diff ? ZT_FAIL : ZT_OK;
+}
@@ -192,6 +192,77 @@ int zt_siphash(const void* in, const size_t inlen, uint8_t* out, const size_t ou
     return 0;
 }
 
+/*
+    Computes a 64-bit SipHash-1-3 value with the caller's 16-byte key.
+    One compression and three finalization rounds are the trade-off used by
+    hash tables that want HashDoS resistance without paying for SipHash-2-4.
+    The fixed sipkey above is used when k is NULL.
+*/
+uint64_t zt_siphash13(const void* in, const size_t inlen, const uint8_t* k)
+{
+    const unsigned char* ni = (const unsigned char*)in;
+    const unsigned char* kk = k ? (const unsigned char*)k : (const unsigned char*)sipkey;
+
+    uint64_t v0 = UINT64_C(0x736f6d6570736575);
+    uint64_t v1 = UINT64_C(0x646f72616e646f6d);
+    uint64_t v2 = UINT64_C(0x6c7967656e657261);
+    uint64_t v3 = UINT64_C(0x7465646279746573);
+    uint64_t k0 = U8TO64_LE(kk);
+    uint64_t k1 = U8TO64_LE(kk + 8);
+    uint64_t m;
+    const unsigned char* end = ni + inlen - (inlen % sizeof(uint64_t));
+    const int left = inlen & 7;
+    uint64_t b = ((uint64_t)inlen) << 56;
+    v3 ^= k1;
+    v2 ^= k0;
+    v1 ^= k1;
+    v0 ^= k0;
+
+    for (; ni != end; ni += 8) {
+        m = U8TO64_LE(ni);
+        v3 ^= m;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    switch (left) {
+    case 7:
+        b |= ((uint64_t)ni[6]) << 48;
+        /* FALLTHRU */
+    case 6:
+        b |= ((uint64_t)ni[5]) << 40;
+        /* FALLTHRU */
+    case 5:
+        b |= ((uint64_t)ni[4]) << 32;
+        /* FALLTHRU */
+    case 4:
+        b |= ((uint64_t)ni[3]) << 24;
+        /* FALLTHRU */
+    case 3:
+        b |= ((uint64_t)ni[2]) << 16;
+        /* FALLTHRU */
+    case 2:
+        b |= ((uint64_t)ni[1]) << 8;
+        /* FALLTHRU */
+    case 1:
+        b |= ((uint64_t)ni[0]);
+        break;
+    case 0:
+        break;
+    }
+
+    v3 ^= b;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
 /*-
  *  COPYRIGHT (C) 1986 Gary S. Brown.  You may use this program, or
  *  code or tables extracted from it, as desired without restriction.
@@ -303,7 +374,6 @@ unsigned int zt_crc32(const unsigned char* s, const unsigned int len)
 	return crc32val;
 }
 
-#if 0
 /*-------------------------------------------------------------------------
  *
  * sha2.c
@@ -1226,4 +1296,114 @@ pg_sha512_final(pg_sha512_ctx* context, uint8* digest)
 	/* Zero out state data */
 	memset(context, 0, sizeof(pg_sha512_ctx));
 }
-#endif 
\ No newline at end of file
+
+/*** HMAC-SHA256 / PBKDF2: ********************************************/
+typedef struct
+{
+	pg_sha256_ctx	inner;
+	pg_sha256_ctx	outer;
+} hmac_sha256_ctx;
+
+static void
+hmac_sha256_init(hmac_sha256_ctx* ctx, const uint8* key, size_t keylen)
+{
+	uint8		block[PG_SHA256_BLOCK_LENGTH];
+	uint8		khash[PG_SHA256_DIGEST_LENGTH];
+	int			i;
+
+	/* keys longer than one block are hashed first */
+	if (keylen > PG_SHA256_BLOCK_LENGTH)
+	{
+		pg_sha256_init(&ctx->inner);
+		pg_sha256_update(&ctx->inner, key, keylen);
+		pg_sha256_final(&ctx->inner, khash);
+		key = khash;
+		keylen = PG_SHA256_DIGEST_LENGTH;
+	}
+
+	memset(block, 0, PG_SHA256_BLOCK_LENGTH);
+	if (keylen)
+		memcpy(block, key, keylen);
+
+	for (i = 0; i < PG_SHA256_BLOCK_LENGTH; i++)
+		block[i] ^= 0x36;
+	pg_sha256_init(&ctx->inner);
+	pg_sha256_update(&ctx->inner, block, PG_SHA256_BLOCK_LENGTH);
+
+	for (i = 0; i < PG_SHA256_BLOCK_LENGTH; i++)
+		block[i] ^= 0x36 ^ 0x5c;
+	pg_sha256_init(&ctx->outer);
+	pg_sha256_update(&ctx->outer, block, PG_SHA256_BLOCK_LENGTH);
+
+	memset(block, 0, PG_SHA256_BLOCK_LENGTH);
+	memset(khash, 0, PG_SHA256_DIGEST_LENGTH);
+}
+
+/* finish a copy of the keyed state so that the key is only set up once */
+static void
+hmac_sha256_final(const hmac_sha256_ctx* key, pg_sha256_ctx* inner, uint8* mac)
+{
+	pg_sha256_ctx outer = key->outer;
+
+	pg_sha256_final(inner, mac);
+	pg_sha256_update(&outer, mac, PG_SHA256_DIGEST_LENGTH);
+	pg_sha256_final(&outer, mac);
+}
+
+/*
+ * PBKDF2-HMAC-SHA256 as specified in RFC 8018. Derives outlen bytes of key
+ * material from a passphrase and a salt.
+ */
+int zt_pbkdf2_sha256(const U8* pass, size_t passlen, const U8* salt, size_t saltlen, U32 iterations, U8* out, size_t outlen)
+{
+	hmac_sha256_ctx key;
+	pg_sha256_ctx	ctx;
+	uint8		U[PG_SHA256_DIGEST_LENGTH];
+	uint8		T[PG_SHA256_DIGEST_LENGTH];
+	uint8		be[4];
+	U32			block = 1;
+	U32			i;
+	int			j;
+
+	if ((pass == NULL && passlen) || (salt == NULL && saltlen) || out == NULL || iterations == 0)
+		return ZT_FAIL;
+
+	hmac_sha256_init(&key, pass, passlen);
+
+	while (outlen)
+	{
+		size_t		n = outlen < PG_SHA256_DIGEST_LENGTH ? outlen : PG_SHA256_DIGEST_LENGTH;
+
+		be[0] = (uint8)(block >> 24);
+		be[1] = (uint8)(block >> 16);
+		be[2] = (uint8)(block >> 8);
+		be[3] = (uint8)block;
+
+		/* U1 = PRF(P, S || INT(i)) */
+		ctx = key.inner;
+		pg_sha256_update(&ctx, salt, saltlen);
+		pg_sha256_update(&ctx, be, 4);
+		hmac_sha256_final(&key, &ctx, U);
+		memcpy(T, U, PG_SHA256_DIGEST_LENGTH);
+
+		for (i = 1; i < iterations; i++)
+		{
+			ctx = key.inner;
+			pg_sha256_update(&ctx, U, PG_SHA256_DIGEST_LENGTH);
+			hmac_sha256_final(&key, &ctx, U);
+			for (j = 0; j < PG_SHA256_DIGEST_LENGTH; j++)
+				T[j] ^= U[j];
+		}
+
+		memcpy(out, T, n);
+		out += n;
+		outlen -= n;
+		block++;
+	}
+
+	memset(&key, 0, sizeof(key));
+	memset(U, 0, sizeof(U));
+	memset(T, 0, sizeof(T));
+
+	return ZT_OK;
+}
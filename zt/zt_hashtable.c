@@ -0,0 +1,409 @@
+#include "ztlib.h"
+
+/*
+ * zt_hashtable.c
+ *	  Open-addressing hash table with inline keys and values.
+ *
+ * The layout follows the "Swiss table" design: next to the slot array there is
+ * one control byte per slot that is either EMPTY, DELETED or the low 7 bits
+ * of the slot's hash (H2). Slots are grouped by 16 and a lookup compares the
+ * 16 control bytes of a group against H2 with one SIMD compare, so only slots
+ * whose H2 matches are ever touched. The remaining bits (H1) select the first
+ * group, and the probe sequence visits the groups in triangular order, which
+ * covers every group of a power-of-two table.
+ *
+ * Groups are aligned, i.e. group g owns slots [16 * g, 16 * g + 15], so a
+ * probe stops at the first group that has an EMPTY byte. That is also why an
+ * erase may turn a slot straight back into EMPTY when its group still has one.
+ *
+ * All memory comes from the MemPoolContext given at creation. Pointers to keys
+ * and values stay valid until the next insertion or until the table is
+ * destroyed.
+ */
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ZT_HASHTABLE_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define ZT_HASHTABLE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define GROUP_WIDTH			16
+#define CTRL_EMPTY			((U8)0x80)
+#define CTRL_DELETED		((U8)0xFE)
+#define CTRL_IS_FULL(c)		(((c) & 0x80) == 0)
+
+#define HASHTABLE_MIN_CAPACITY	GROUP_WIDTH
+
+/* the table is kept at most 7/8 full, tombstones included */
+#define MaxLoad(capacity)	((capacity) - ((capacity) >> 3))
+
+#define SLOT_ALIGN(LEN)		(((LEN) + 7) & ~((size_t)7))
+
+typedef struct
+{
+	MemPoolContext		cxt;
+	HashTableHashFunc	hash;
+	HashTableEqualFunc	equal;
+	U8					seed[16];
+	size_t				keysize;
+	size_t				valuesize;
+	size_t				valueoffset;	/* value offset within a slot */
+	size_t				slotsize;
+	size_t				capacity;		/* number of slots, a multiple of GROUP_WIDTH */
+	size_t				groupmask;		/* number of groups - 1 */
+	size_t				count;			/* live entries */
+	size_t				growthleft;		/* insertions into EMPTY slots before a rehash */
+	U8*					ctrl;
+	U8*					slots;
+} HashTableData;
+
+static U32 LowestBit(U32 mask)
+{
+#if defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return (U32)idx;
+#else
+	return (U32)__builtin_ctz(mask);
+#endif
+}
+
+/* Bit i of the result is set when ctrl[i] == c */
+static U32 GroupMatch(const U8* ctrl, U8 c)
+{
+#if defined(ZT_HASHTABLE_SSE2)
+	__m128i g = _mm_loadu_si128((const __m128i*)ctrl);
+	return (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+#elif defined(ZT_HASHTABLE_NEON)
+	static const U8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(c));
+	uint8x16_t m = vandq_u8(eq, vld1q_u8(bits));
+	return (U32)vaddv_u8(vget_low_u8(m)) | ((U32)vaddv_u8(vget_high_u8(m)) << 8);
+#else
+	U32 mask = 0;
+	int i;
+	for (i = 0; i < GROUP_WIDTH; i++)
+	{
+		if (ctrl[i] == c)
+			mask |= (1u << i);
+	}
+	return mask;
+#endif
+}
+
+/* Bit i of the result is set when ctrl[i] is EMPTY or DELETED */
+static U32 GroupMatchFree(const U8* ctrl)
+{
+#if defined(ZT_HASHTABLE_SSE2)
+	return (U32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#elif defined(ZT_HASHTABLE_NEON)
+	static const U8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	uint8x16_t hi = vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl)), vdupq_n_s8(0));
+	uint8x16_t m = vandq_u8(hi, vld1q_u8(bits));
+	return (U32)vaddv_u8(vget_low_u8(m)) | ((U32)vaddv_u8(vget_high_u8(m)) << 8);
+#else
+	U32 mask = 0;
+	int i;
+	for (i = 0; i < GROUP_WIDTH; i++)
+	{
+		if (!CTRL_IS_FULL(ctrl[i]))
+			mask |= (1u << i);
+	}
+	return mask;
+#endif
+}
+
+static U64 DefaultHash(const void* key, size_t keysize, const U8* seed)
+{
+	return zt_siphash13(key, keysize, seed);
+}
+
+static bool DefaultEqual(const void* a, const void* b, size_t keysize)
+{
+	return memcmp(a, b, keysize) == 0;
+}
+
+#define SLOT(ht, i)			((ht)->slots + (i) * (ht)->slotsize)
+#define H1(h)				((size_t)((h) >> 7))
+#define H2(h)				((U8)((h) & 0x7F))
+
+static bool AllocArrays(HashTableData* ht, size_t capacity)
+{
+	U8* ctrl = (U8*)zt_palloc(ht->cxt, capacity);
+	U8* slots = (U8*)zt_palloc(ht->cxt, capacity * ht->slotsize);
+
+	if (ctrl == NULL || slots == NULL)
+	{
+		zt_pfree(ctrl);
+		zt_pfree(slots);
+		return false;
+	}
+
+	memset(ctrl, CTRL_EMPTY, capacity);
+	ht->ctrl = ctrl;
+	ht->slots = slots;
+	ht->capacity = capacity;
+	ht->groupmask = capacity / GROUP_WIDTH - 1;
+	ht->growthleft = MaxLoad(capacity) - ht->count;
+
+	return true;
+}
+
+/* First EMPTY or DELETED slot on the probe sequence of hash h */
+static size_t FindFreeSlot(const HashTableData* ht, U64 h)
+{
+	size_t g = H1(h) & ht->groupmask;
+	size_t step = 0;
+
+	for (;;)
+	{
+		const U8* ctrl = ht->ctrl + g * GROUP_WIDTH;
+		U32 mask = GroupMatchFree(ctrl);
+		if (mask)
+			return g * GROUP_WIDTH + LowestBit(mask);
+		step++;
+		g = (g + step) & ht->groupmask;
+	}
+}
+
+static bool Resize(HashTableData* ht, size_t capacity)
+{
+	U8* oldctrl = ht->ctrl;
+	U8* oldslots = ht->slots;
+	size_t oldcapacity = ht->capacity;
+	size_t i;
+
+	if (!AllocArrays(ht, capacity))
+		return false;
+
+	for (i = 0; i < oldcapacity; i++)
+	{
+		if (CTRL_IS_FULL(oldctrl[i]))
+		{
+			const U8* slot = oldslots + i * ht->slotsize;
+			U64 h = ht->hash(slot, ht->keysize, ht->seed);
+			size_t pos = FindFreeSlot(ht, h);
+			ht->ctrl[pos] = H2(h);
+			memcpy(SLOT(ht, pos), slot, ht->slotsize);
+		}
+	}
+
+	zt_pfree(oldctrl);
+	zt_pfree(oldslots);
+
+	return true;
+}
+
+static size_t FindSlot(const HashTableData* ht, const void* key, U64 h)
+{
+	size_t g = H1(h) & ht->groupmask;
+	size_t step = 0;
+	U8 h2 = H2(h);
+
+	for (;;)
+	{
+		const U8* ctrl = ht->ctrl + g * GROUP_WIDTH;
+		U32 mask = GroupMatch(ctrl, h2);
+		while (mask)
+		{
+			size_t pos = g * GROUP_WIDTH + LowestBit(mask);
+			if (ht->equal(SLOT(ht, pos), key, ht->keysize))
+				return pos;
+			mask &= mask - 1;
+		}
+		if (GroupMatch(ctrl, CTRL_EMPTY))
+			return (size_t)-1;
+		step++;
+		if (step > ht->groupmask)
+			return (size_t)-1;
+		g = (g + step) & ht->groupmask;
+	}
+}
+
+HashTable zt_hashtable_create(MemPoolContext cxt, size_t keysize, size_t valuesize, size_t initsize,
+	HashTableHashFunc hash, HashTableEqualFunc equal, const U8* seed)
+{
+	HashTableData* ht;
+	size_t capacity = HASHTABLE_MIN_CAPACITY;
+
+	if (cxt == NULL || keysize == 0)
+		return NULL;
+
+	/* smallest power of two that holds initsize entries below the load limit */
+	while (MaxLoad(capacity) < initsize)
+		capacity <<= 1;
+
+	ht = (HashTableData*)zt_palloc0(cxt, sizeof(HashTableData));
+	if (ht == NULL)
+		return NULL;
+
+	ht->cxt = cxt;
+	ht->hash = hash ? hash : DefaultHash;
+	ht->equal = equal ? equal : DefaultEqual;
+	if (seed)
+		memcpy(ht->seed, seed, sizeof(ht->seed));
+	else
+		zt_siphash(&ht, sizeof(ht), ht->seed, sizeof(ht->seed)); /* per-table key from its address */
+	ht->keysize = keysize;
+	ht->valuesize = valuesize;
+	ht->valueoffset = SLOT_ALIGN(keysize);
+	ht->slotsize = SLOT_ALIGN(ht->valueoffset + valuesize);
+
+	if (!AllocArrays(ht, capacity))
+	{
+		zt_pfree(ht);
+		return NULL;
+	}
+
+	return (HashTable)ht;
+}
+
+void zt_hashtable_destroy(HashTable table)
+{
+	HashTableData* ht = (HashTableData*)table;
+
+	if (ht)
+	{
+		zt_pfree(ht->ctrl);
+		zt_pfree(ht->slots);
+		zt_pfree(ht);
+	}
+}
+
+void* zt_hashtable_find(HashTable table, const void* key)
+{
+	HashTableData* ht = (HashTableData*)table;
+	size_t pos;
+
+	if (ht == NULL || key == NULL)
+		return NULL;
+
+	pos = FindSlot(ht, key, ht->hash(key, ht->keysize, ht->seed));
+	if (pos == (size_t)-1)
+		return NULL;
+
+	return SLOT(ht, pos) + ht->valueoffset;
+}
+
+void* zt_hashtable_insert(HashTable table, const void* key, bool* found)
+{
+	HashTableData* ht = (HashTableData*)table;
+	U64 h;
+	size_t pos;
+	U8* slot;
+
+	if (ht == NULL || key == NULL)
+		return NULL;
+
+	h = ht->hash(key, ht->keysize, ht->seed);
+	pos = FindSlot(ht, key, h);
+	if (pos != (size_t)-1)
+	{
+		if (found)
+			*found = true;
+		return SLOT(ht, pos) + ht->valueoffset;
+	}
+
+	pos = FindFreeSlot(ht, h);
+	if (ht->ctrl[pos] == CTRL_EMPTY && ht->growthleft == 0)
+	{
+		/* mostly tombstones: rehash in place, otherwise double */
+		size_t capacity = ht->capacity;
+		if (ht->count >= MaxLoad(capacity) / 2)
+			capacity <<= 1;
+		if (!Resize(ht, capacity))
+			return NULL;
+		pos = FindFreeSlot(ht, h);
+	}
+
+	if (ht->ctrl[pos] == CTRL_EMPTY)
+		ht->growthleft--;
+	ht->ctrl[pos] = H2(h);
+	ht->count++;
+
+	slot = SLOT(ht, pos);
+	memcpy(slot, key, ht->keysize);
+	memset(slot + ht->valueoffset, 0, ht->valuesize);
+
+	if (found)
+		*found = false;
+
+	return slot + ht->valueoffset;
+}
+
+bool zt_hashtable_erase(HashTable table, const void* key)
+{
+	HashTableData* ht = (HashTableData*)table;
+	size_t pos;
+
+	if (ht == NULL || key == NULL)
+		return false;
+
+	pos = FindSlot(ht, key, ht->hash(key, ht->keysize, ht->seed));
+	if (pos == (size_t)-1)
+		return false;
+
+	/* a probe never passes a group with an EMPTY byte, so no tombstone is needed there */
+	if (GroupMatch(ht->ctrl + (pos & ~(size_t)(GROUP_WIDTH - 1)), CTRL_EMPTY))
+	{
+		ht->ctrl[pos] = CTRL_EMPTY;
+		ht->growthleft++;
+	}
+	else
+	{
+		ht->ctrl[pos] = CTRL_DELETED;
+	}
+	ht->count--;
+
+	return true;
+}
+
+void zt_hashtable_clear(HashTable table)
+{
+	HashTableData* ht = (HashTableData*)table;
+
+	if (ht)
+	{
+		memset(ht->ctrl, CTRL_EMPTY, ht->capacity);
+		ht->count = 0;
+		ht->growthleft = MaxLoad(ht->capacity);
+	}
+}
+
+size_t zt_hashtable_count(HashTable table)
+{
+	HashTableData* ht = (HashTableData*)table;
+
+	return ht ? ht->count : 0;
+}
+
+bool zt_hashtable_next(HashTable table, size_t* iter, void** key, void** value)
+{
+	HashTableData* ht = (HashTableData*)table;
+	size_t i;
+
+	if (ht == NULL || iter == NULL)
+		return false;
+
+	for (i = *iter; i < ht->capacity; i++)
+	{
+		if (CTRL_IS_FULL(ht->ctrl[i]))
+		{
+			if (key)
+				*key = SLOT(ht, i);
+			if (value)
+				*value = SLOT(ht, i) + ht->valueoffset;
+			*iter = i + 1;
+			return true;
+		}
+	}
+
+	*iter = ht->capacity;
+	return false;
+}
@@ -1,5 +1,15 @@
 #include "ztlib.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
 #define INT64CONST(x)  (x##LL)
 #define UINT64CONST(x) (x##ULL)
 
@@ -1128,6 +1138,8 @@ typedef struct AllocSetContext
 	uint32		allocChunkLimit;	/* effective chunk size limit */
 	/* freelist this context could be put in, or -1 if not a candidate: */
 	int			freeListIndex;	/* index in context_freelists[], or -1 */
+	/* where blocks come from; malloc() if source.alloc_block is NULL */
+	MemPoolBlockSource source;
 } AllocSetContext;
 
 typedef AllocSetContext *AllocSet;
@@ -1206,6 +1218,28 @@ typedef struct AllocBlockData
  */
 #define MAX_FREE_CONTEXTS 100	/* arbitrary limit on freelist length */
 
+/*
+ * Every block of an allocation set, the keeper block included, is obtained
+ * from and returned to the set's block source.  Sets created without one go
+ * straight to malloc() and free().
+ */
+static inline void *
+BlockSourceAlloc(const MemPoolBlockSource *source, Size size)
+{
+	if (source->alloc_block == NULL)
+		return malloc(size);
+	return source->alloc_block(source->arg, size);
+}
+
+static inline void
+BlockSourceFree(const MemPoolBlockSource *source, void *block, Size size)
+{
+	if (source->free_block == NULL)
+		free(block);
+	else
+		source->free_block(source->arg, block, size);
+}
+
 /* Obtain the keeper block for an allocation set */
 #define KeeperBlock(set) \
 	((AllocBlock) (((char *) set) + MAXALIGN(sizeof(AllocSetContext))))
@@ -1390,6 +1424,7 @@ MemoryContextCreate(MemoryContext node,
  * minContextSize: minimum context size
  * initBlockSize: initial allocation block size
  * maxBlockSize: maximum allocation block size
+ * source: where the blocks come from (copied into the context)
  *
  * Most callers should abstract the context size parameters using a macro
  * such as ALLOCSET_DEFAULT_SIZES.
@@ -1402,7 +1437,8 @@ AllocSetContextCreateInternal(MemoryContext parent,
 							  const char *name,
 							  Size minContextSize,
 							  Size initBlockSize,
-							  Size maxBlockSize)
+							  Size maxBlockSize,
+							  const MemPoolBlockSource *source)
 {
 	int			freeListIndex;
 	Size		firstBlockSize;
@@ -1498,7 +1534,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 	 * Allocate the initial block.  Unlike other aset.c blocks, it starts with
 	 * the context header and its block header follows that.
 	 */
-	set = (AllocSet) malloc(firstBlockSize);
+	set = (AllocSet) BlockSourceAlloc(source, firstBlockSize);
 	if (set == NULL)
 	{
 #if 0
@@ -1539,6 +1575,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 	set->maxBlockSize = (uint32) maxBlockSize;
 	set->nextBlockSize = (uint32) initBlockSize;
 	set->freeListIndex = freeListIndex;
+	set->source = *source;
 
 	/*
 	 * Compute the allocation chunk size limit for this context.  It can't be
@@ -1650,7 +1687,7 @@ AllocSetReset(MemoryContext context)
 			wipe_mem(block, block->freeptr - ((char *) block));
 #endif
 #endif 
-			free(block);
+			BlockSourceFree(&set->source, block, block->endptr - ((char *) block));
 		}
 		block = next;
 	}
@@ -1707,7 +1744,8 @@ AllocSetDelete(MemoryContext context)
 {
 	AllocSet	set = (AllocSet) context;
 	AllocBlock	block = set->blocks;
-	Size		keepersize PG_USED_FOR_ASSERTS_ONLY;
+	MemPoolBlockSource source;
+	Size		keepersize;
 #if 0
 	Assert(AllocSetIsValid(set));
 #endif
@@ -1777,15 +1815,21 @@ AllocSetDelete(MemoryContext context)
 #endif
 
 		if (!IsKeeperBlock(set, block))
-			free(block);
+			BlockSourceFree(&set->source, block, block->endptr - ((char *) block));
 
 		block = next;
 	}
 #if 0
 	Assert(context->mem_allocated == keepersize);
 #endif 
-	/* Finally, free the context header, including the keeper block */
-	free(set);
+	/*
+	 * Finally, free the context header, including the keeper block.  The
+	 * source lives in the header, so take a copy before giving it back.
+	 */
+	source = set->source;
+	BlockSourceFree(&source, set, keepersize);
+	if (source.destroy)
+		source.destroy(source.arg);
 }
 
 /*
@@ -1817,7 +1861,7 @@ AllocSetAllocLarge(MemoryContext context, Size size, int flags)
 #endif
 
 	blksize = chunk_size + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
-	block = (AllocBlock) malloc(blksize);
+	block = (AllocBlock) BlockSourceAlloc(&set->source, blksize);
 	if (block == NULL)
 		return MemoryContextAllocationFailure(context, size, flags);
 
@@ -2020,7 +2064,7 @@ AllocSetAllocFromNewBlock(MemoryContext context, Size size, int flags,
 		blksize <<= 1;
 
 	/* Try to allocate it */
-	block = (AllocBlock) malloc(blksize);
+	block = (AllocBlock) BlockSourceAlloc(&set->source, blksize);
 
 	/*
 	 * We could be asking for pretty big blocks here, so cope if malloc fails.
@@ -2031,7 +2075,7 @@ AllocSetAllocFromNewBlock(MemoryContext context, Size size, int flags,
 		blksize >>= 1;
 		if (blksize < required_size)
 			break;
-		block = (AllocBlock) malloc(blksize);
+		block = (AllocBlock) BlockSourceAlloc(&set->source, blksize);
 	}
 
 	if (block == NULL)
@@ -2222,7 +2266,7 @@ AllocSetFree(void *pointer)
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
 #endif
-		free(block);
+		BlockSourceFree(&set->source, block, block->endptr - ((char *) block));
 	}
 	else
 	{
@@ -2858,20 +2902,332 @@ AllocSetCheck(MemoryContext context)
 #endif							/* MEMORY_CONTEXT_CHECKING */
 
 
+/*
+ * Virtual-memory block source
+ *
+ * Blocks of VMSOURCE_MIN_SIZE and up are mapped directly from the OS instead
+ * of going through malloc(), which lets us ask for huge pages and NUMA
+ * placement per block.  Smaller blocks still come from malloc(); they are
+ * too small for a huge page and are mostly the first few blocks of a pool.
+ *
+ * Freed mappings are kept in a small per-source cache with their physical
+ * pages handed back to the OS (MADV_FREE/MADV_DONTNEED, MEM_RESET), so a pool
+ * that is reset and refilled reuses its address space, huge-page alignment
+ * and NUMA policy without another round of mmap/munmap.
+ */
+#define VMSOURCE_MIN_SIZE		(256 * 1024)
+#define VMSOURCE_HUGE_SIZE		(2 * 1024 * 1024)
+#define VMSOURCE_CACHE_SIZE		8
+
+typedef struct VMBlockSource
+{
+	U32			flags;
+	int			node;			/* NUMA node, or -1 */
+	Size		pagesize;		/* mapping granularity */
+	Size		hugesize;		/* huge page size, 0 if not used */
+	int			ncached;
+	struct
+	{
+		void	   *ptr;
+		Size		size;
+	}			cache[VMSOURCE_CACHE_SIZE];
+} VMBlockSource;
+
+static Size
+VMSourceMapSize(VMBlockSource *vm, Size size)
+{
+	if (vm->hugesize && size >= vm->hugesize)
+		return TYPEALIGN(vm->hugesize, size);
+	return TYPEALIGN(vm->pagesize, size);
+}
+
+#ifdef _WIN32
+
+static void *
+VMSourceMap(VMBlockSource *vm, Size mapsize)
+{
+	void	   *p = NULL;
+	DWORD		type = MEM_RESERVE | MEM_COMMIT;
+
+	if ((vm->flags & ZT_MEMPOOL_HUGETLB) && vm->hugesize && mapsize % vm->hugesize == 0)
+	{
+		/* needs SeLockMemoryPrivilege, so this quietly fails for most users */
+		if (vm->node >= 0)
+			p = VirtualAllocExNuma(GetCurrentProcess(), NULL, mapsize, type | MEM_LARGE_PAGES, PAGE_READWRITE, (DWORD) vm->node);
+		else
+			p = VirtualAlloc(NULL, mapsize, type | MEM_LARGE_PAGES, PAGE_READWRITE);
+	}
+	if (p == NULL)
+	{
+		if (vm->node >= 0)
+			p = VirtualAllocExNuma(GetCurrentProcess(), NULL, mapsize, type, PAGE_READWRITE, (DWORD) vm->node);
+		else
+			p = VirtualAlloc(NULL, mapsize, type, PAGE_READWRITE);
+	}
+	return p;
+}
+
+static void
+VMSourceUnmap(void *block, Size mapsize)
+{
+	VirtualFree(block, 0, MEM_RELEASE);
+}
+
+static void
+VMSourceRelease(void *block, Size mapsize)
+{
+	/* fails harmlessly on large pages, which cannot be reset */
+	VirtualAlloc(block, mapsize, MEM_RESET, PAGE_READWRITE);
+}
+
+static int
+VMSourceLocalNode(void)
+{
+	PROCESSOR_NUMBER pn;
+	USHORT		node;
+
+	GetCurrentProcessorNumberEx(&pn);
+	if (!GetNumaProcessorNodeEx(&pn, &node))
+		return -1;
+	return (int) node;
+}
+
+#else							/* !_WIN32 */
+
+static void
+VMSourceBind(VMBlockSource *vm, void *p, Size mapsize)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	unsigned long nodemask[16];
+
+	if (vm->node < 0 || vm->node >= (int) (sizeof(nodemask) * 8))
+		return;
+
+	/* MPOL_PREFERRED, so a full node falls back instead of failing */
+	memset(nodemask, 0, sizeof(nodemask));
+	nodemask[vm->node / (sizeof(unsigned long) * 8)] |= 1UL << (vm->node % (sizeof(unsigned long) * 8));
+	syscall(SYS_mbind, p, mapsize, 1 /* MPOL_PREFERRED */ , nodemask, sizeof(nodemask) * 8, 0);
+#endif
+}
+
+static void *
+VMSourceMap(VMBlockSource *vm, Size mapsize)
+{
+	char	   *p;
+	Size		align = 0;
+
+#ifdef MAP_HUGETLB
+	if ((vm->flags & ZT_MEMPOOL_HUGETLB) && vm->hugesize && mapsize % vm->hugesize == 0)
+	{
+		p = mmap(NULL, mapsize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+		{
+			VMSourceBind(vm, p, mapsize);
+			return p;
+		}
+	}
+#endif
+
+	/* over-map so the block can start on a huge page boundary */
+	if (vm->hugesize && mapsize % vm->hugesize == 0)
+		align = vm->hugesize;
+
+	p = mmap(NULL, mapsize + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	if (align)
+	{
+		char	   *start = (char *) TYPEALIGN(align, p);
+
+		if (start > p)
+			munmap(p, start - p);
+		if (start + mapsize < p + mapsize + align)
+			munmap(start + mapsize, (p + mapsize + align) - (start + mapsize));
+		p = start;
+#ifdef MADV_HUGEPAGE
+		madvise(p, mapsize, MADV_HUGEPAGE);
+#endif
+	}
+
+	VMSourceBind(vm, p, mapsize);
+	return p;
+}
+
+static void
+VMSourceUnmap(void *block, Size mapsize)
+{
+	munmap(block, mapsize);
+}
+
+static void
+VMSourceRelease(void *block, Size mapsize)
+{
+#ifdef MADV_FREE
+	/* hugetlb mappings do not support MADV_FREE */
+	if (madvise(block, mapsize, MADV_FREE) == 0)
+		return;
+#endif
+	madvise(block, mapsize, MADV_DONTNEED);
+}
+
+static int
+VMSourceLocalNode(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+	unsigned	cpu,
+				node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return (int) node;
+#endif
+	return -1;
+}
+
+#endif							/* _WIN32 */
+
+static void *
+VMSourceAlloc(void *arg, size_t size)
+{
+	VMBlockSource *vm = (VMBlockSource *) arg;
+	Size		mapsize;
+	int			i;
+
+	if (size < VMSOURCE_MIN_SIZE)
+		return malloc(size);
+
+	mapsize = VMSourceMapSize(vm, size);
+
+	/* newest cached mapping of the right size first */
+	for (i = vm->ncached - 1; i >= 0; i--)
+	{
+		if (vm->cache[i].size == mapsize)
+		{
+			void	   *p = vm->cache[i].ptr;
+
+			vm->cache[i] = vm->cache[--vm->ncached];
+			return p;
+		}
+	}
+
+	return VMSourceMap(vm, mapsize);
+}
+
+static void
+VMSourceFree(void *arg, void *block, size_t size)
+{
+	VMBlockSource *vm = (VMBlockSource *) arg;
+	Size		mapsize;
+
+	if (size < VMSOURCE_MIN_SIZE)
+	{
+		free(block);
+		return;
+	}
+
+	mapsize = VMSourceMapSize(vm, size);
+	if (vm->ncached < VMSOURCE_CACHE_SIZE)
+	{
+		VMSourceRelease(block, mapsize);
+		vm->cache[vm->ncached].ptr = block;
+		vm->cache[vm->ncached].size = mapsize;
+		vm->ncached++;
+	}
+	else
+		VMSourceUnmap(block, mapsize);
+}
+
+static void
+VMSourceDestroy(void *arg)
+{
+	VMBlockSource *vm = (VMBlockSource *) arg;
+	int			i;
+
+	for (i = 0; i < vm->ncached; i++)
+		VMSourceUnmap(vm->cache[i].ptr, vm->cache[i].size);
+	free(vm);
+}
+
+/*
+ * The source is meant for one pool: like the pool itself it is not
+ * thread-safe.  ZT_MEMPOOL_NUMA_LOCAL picks the node of the calling thread,
+ * so create per-thread pools on the thread that will use them.
+ */
+int zt_mempool_vmsource(MemPoolBlockSource* source, U32 flags, int numa_node)
+{
+	VMBlockSource* vm;
+
+	if (source == NULL)
+		return ZT_FAIL;
+
+	vm = (VMBlockSource*)malloc(sizeof(VMBlockSource));
+	if (vm == NULL)
+		return ZT_FAIL;
+
+	vm->flags = flags;
+	vm->node = (flags & ZT_MEMPOOL_NUMA_LOCAL) ? VMSourceLocalNode() : numa_node;
+	vm->ncached = 0;
+#ifdef _WIN32
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		vm->pagesize = si.dwAllocationGranularity;
+		vm->hugesize = (flags & ZT_MEMPOOL_HUGETLB) ? GetLargePageMinimum() : 0;
+	}
+#else
+	vm->pagesize = (Size)sysconf(_SC_PAGESIZE);
+	vm->hugesize = (flags & (ZT_MEMPOOL_HUGEPAGE | ZT_MEMPOOL_HUGETLB)) ? VMSOURCE_HUGE_SIZE : 0;
+#endif
+
+	source->alloc_block = VMSourceAlloc;
+	source->free_block = VMSourceFree;
+	source->destroy = VMSourceDestroy;
+	source->arg = vm;
+
+	return ZT_OK;
+}
+
 MemPoolContext zt_mempool_create(const char* mempool_name, U32 minContextSize, U32 initBlockSize, U32 maxBlockSize)
+{
+	return zt_mempool_create_ex(mempool_name, minContextSize, initBlockSize, maxBlockSize, NULL);
+}
+
+MemPoolContext zt_mempool_create_ex(const char* mempool_name, U32 minContextSize, U32 initBlockSize, U32 maxBlockSize, const MemPoolBlockSource* source)
 {
 	MemoryContext cxt;
+	MemPoolBlockSource malloc_source = { NULL, NULL, NULL, NULL };
 
 	if (0 == initBlockSize)
 		initBlockSize = ALLOCSET_DEFAULT_INITSIZE;
 	if (0 == maxBlockSize)
 		maxBlockSize = ALLOCSET_DEFAULT_MAXSIZE;
 
-	cxt = AllocSetContextCreateInternal(NULL, mempool_name, minContextSize, initBlockSize, maxBlockSize);
+	if (source == NULL)
+		source = &malloc_source;
+
+	cxt = AllocSetContextCreateInternal(NULL, mempool_name, minContextSize, initBlockSize, maxBlockSize, source);
+
+	if (cxt == NULL && source->destroy)
+		source->destroy(source->arg);
 
 	return (MemPoolContext)cxt;
 }
 
+/* Frees everything allocated in the pool but keeps the pool itself */
+void zt_mempool_reset(MemPoolContext cxt)
+{
+	if (cxt)
+	{
+		MemoryContext context = (MemoryContext)cxt;
+
+		if (!context->isReset)
+		{
+			context->methods->reset(context);
+			context->isReset = true;
+		}
+	}
+}
+
 void zt_mempool_destroy(MemPoolContext cxt)
 {
 	if (cxt)
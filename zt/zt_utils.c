@@ -1,120 +1,346 @@
 #include "ztlib.h"
 
-bool zt_IsAlphabetString(U8* str, U8 len)
+/*
+ * Hex and character class helpers
+ *
+ * The size_t based ...Ex() functions do the work, 16 or 32 input bytes at a
+ * time with SSE2 on x86/x64 and NEON on ARM64 (both are part of the baseline of
+ * those targets, so no runtime dispatch is needed), and a scalar loop for the
+ * tail. The older U8-length functions are kept as thin wrappers.
+ */
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define ZT_HEX_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define ZT_HEX_NEON
+#include <arm_neon.h>
+#endif
+
+static const U8 hex_chars[] = "0123456789abcdef";
+
+/* 0x00..0x0F for hex digits of either case, 0xFF otherwise */
+static const U8 hex_values[256] =
 {
-	bool bRet = false;
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0x0A,0x0B,0x0C,0x0D,0x0E,0x0F,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF
+};
+
+#define IS_DIGIT(c)			((U8)((c) - '0') <= 9)
+#define IS_UPPER_HEX(c)		((U8)((c) - 'A') <= 5)
+#define IS_ALPHA(c)			((U8)(((c) | 0x20) - 'a') <= 25)
+
+#if defined(ZT_HEX_SSE2)
+/* lanes of x that are in [lo, lo + span] */
+static __m128i InRangeSSE2(__m128i x, char lo, char span)
+{
+	__m128i d = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+}
+
+static __m128i HexDigitsSSE2(__m128i n)
+{
+	/* '0' + n, plus ('a' - '0' - 10) for n > 9 */
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+	return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), alpha);
+}
+
+/* decode 16 hex characters of either case into 16 nibbles, false if any is not hex */
+static bool HexNibblesSSE2(__m128i c, __m128i* n)
+{
+	__m128i isDigit = InRangeSSE2(c, '0', 9);
+	__m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+	__m128i isAlpha = InRangeSSE2(lower, 'a', 5);
+	__m128i digit = _mm_and_si128(isDigit, _mm_sub_epi8(c, _mm_set1_epi8('0')));
+	__m128i alpha = _mm_and_si128(isAlpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)));
+
+	*n = _mm_or_si128(digit, alpha);
+	return _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) == 0xFFFF;
+}
+
+/* 16 nibbles (high, low, high, low, ...) to 8 bytes in the low half of each 16-bit lane */
+static __m128i PackNibblesSSE2(__m128i n)
+{
+	__m128i hi = _mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00FF)), 4);
+	return _mm_or_si128(hi, _mm_srli_epi16(n, 8));
+}
+#endif
+
+#if defined(ZT_HEX_NEON)
+static uint8x16_t HexDigitsNEON(uint8x16_t n)
+{
+	uint8x16_t alpha = vandq_u8(vcgtq_u8(n, vdupq_n_u8(9)), vdupq_n_u8('a' - '0' - 10));
+	return vaddq_u8(vaddq_u8(n, vdupq_n_u8('0')), alpha);
+}
+
+static bool HexNibblesNEON(uint8x16_t c, uint8x16_t* n)
+{
+	uint8x16_t digit = vsubq_u8(c, vdupq_n_u8('0'));
+	uint8x16_t alpha = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+	uint8x16_t isDigit = vcleq_u8(digit, vdupq_n_u8(9));
+	uint8x16_t isAlpha = vcleq_u8(alpha, vdupq_n_u8(5));
+
+	*n = vorrq_u8(vandq_u8(isDigit, digit), vandq_u8(isAlpha, vaddq_u8(alpha, vdupq_n_u8(10))));
+	return vminvq_u8(vorrq_u8(isDigit, isAlpha)) == 0xFF;
+}
+#endif
+
+size_t zt_Raw2HexStringEx(const U8* input, size_t len, U8* output)
+{
+	size_t i = 0;
 
-	if (str && len)
+#if defined(ZT_HEX_SSE2)
+	for (; i + 16 <= len; i += 16)
 	{
-		U8 i, oneChar;
-		for (i = 0; i < len; i++)
-		{
-			oneChar = str[i];
-			if (oneChar >= '0' && oneChar <= '9')
-				continue;
-			if (oneChar >= 'A' && oneChar <= 'Z')
-				continue;
-			if (oneChar >= 'a' && oneChar <= 'z')
-				continue;
-			break;
-		}
-		if (i == len)
-			bRet = true;
+		__m128i v = _mm_loadu_si128((const __m128i*)(input + i));
+		__m128i hi = HexDigitsSSE2(_mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)));
+		__m128i lo = HexDigitsSSE2(_mm_and_si128(v, _mm_set1_epi8(0x0F)));
+		_mm_storeu_si128((__m128i*)(output + (i << 1)), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i*)(output + (i << 1) + 16), _mm_unpackhi_epi8(hi, lo));
 	}
-	return bRet;
+#elif defined(ZT_HEX_NEON)
+	for (; i + 16 <= len; i += 16)
+	{
+		uint8x16_t v = vld1q_u8(input + i);
+		uint8x16x2_t hex;
+		hex.val[0] = HexDigitsNEON(vshrq_n_u8(v, 4));
+		hex.val[1] = HexDigitsNEON(vandq_u8(v, vdupq_n_u8(0x0F)));
+		vst2q_u8(output + (i << 1), hex);
+	}
+#endif
+	for (; i < len; i++)
+	{
+		output[(i << 1)] = hex_chars[input[i] >> 4];
+		output[(i << 1) + 1] = hex_chars[input[i] & 0x0F];
+	}
+
+	return len << 1;
 }
 
-bool zt_IsAlphabetStringW(wchar_t* str, U8 len)
+int zt_HexString2RawEx(const U8* input, size_t len, U8* output, size_t* outlen)
 {
-	bool bRet = false;
+	size_t i = 0;
+
+	if (len & 1)
+		return ZT_FAIL;
 
-	if (str && len)
+#if defined(ZT_HEX_SSE2)
+	for (; i + 32 <= len; i += 32)
 	{
-		U8 i, oneChar;
-		for (i = 0; i < len; i++)
+		__m128i a, b;
+		if (!HexNibblesSSE2(_mm_loadu_si128((const __m128i*)(input + i)), &a))
+			return ZT_FAIL;
+		if (!HexNibblesSSE2(_mm_loadu_si128((const __m128i*)(input + i + 16)), &b))
+			return ZT_FAIL;
+		_mm_storeu_si128((__m128i*)(output + (i >> 1)), _mm_packus_epi16(PackNibblesSSE2(a), PackNibblesSSE2(b)));
+	}
+#elif defined(ZT_HEX_NEON)
+	for (; i + 32 <= len; i += 32)
+	{
+		uint8x16x2_t c = vld2q_u8(input + i); /* even (high) and odd (low) characters */
+		uint8x16_t hi, lo;
+		if (!HexNibblesNEON(c.val[0], &hi) || !HexNibblesNEON(c.val[1], &lo))
+			return ZT_FAIL;
+		vst1q_u8(output + (i >> 1), vorrq_u8(vshlq_n_u8(hi, 4), lo));
+	}
+#endif
+	for (; i < len; i += 2)
+	{
+		U8 hiValue = hex_values[input[i]];
+		U8 lowValue = hex_values[input[i + 1]];
+		if ((hiValue | lowValue) & 0xF0)
+			return ZT_FAIL;
+		output[(i >> 1)] = (U8)(hiValue << 4 | lowValue);
+	}
+
+	if (outlen)
+		*outlen = (len >> 1);
+
+	return ZT_OK;
+}
+
+int zt_HexString2RawWEx(const wchar_t* input, size_t len, U8* output, size_t* outlen)
+{
+	size_t i = 0;
+
+	if (len & 1)
+		return ZT_FAIL;
+
+	if (sizeof(wchar_t) == 2)
+	{
+		const U16* w = (const U16*)input;
+#if defined(ZT_HEX_SSE2)
+		for (; i + 32 <= len; i += 32)
+		{
+			/* characters outside 0..0xFF saturate to 0x00 or 0xFF, neither is a hex digit */
+			__m128i c0 = _mm_packus_epi16(_mm_loadu_si128((const __m128i*)(w + i)), _mm_loadu_si128((const __m128i*)(w + i + 8)));
+			__m128i c1 = _mm_packus_epi16(_mm_loadu_si128((const __m128i*)(w + i + 16)), _mm_loadu_si128((const __m128i*)(w + i + 24)));
+			__m128i a, b;
+			if (!HexNibblesSSE2(c0, &a) || !HexNibblesSSE2(c1, &b))
+				return ZT_FAIL;
+			_mm_storeu_si128((__m128i*)(output + (i >> 1)), _mm_packus_epi16(PackNibblesSSE2(a), PackNibblesSSE2(b)));
+		}
+#elif defined(ZT_HEX_NEON)
+		for (; i + 32 <= len; i += 32)
 		{
-			oneChar = str[i];
-			if (oneChar >= L'0' && oneChar <= L'9')
-				continue;
-			if (oneChar >= L'A' && oneChar <= L'Z')
-				continue;
-			if (oneChar >= L'a' && oneChar <= L'z')
-				continue;
-			break;
+			uint16x8x2_t w0 = vld2q_u16(w + i);
+			uint16x8x2_t w1 = vld2q_u16(w + i + 16);
+			uint8x16_t even = vcombine_u8(vqmovn_u16(w0.val[0]), vqmovn_u16(w1.val[0]));
+			uint8x16_t odd = vcombine_u8(vqmovn_u16(w0.val[1]), vqmovn_u16(w1.val[1]));
+			uint8x16_t hi, lo;
+			if (!HexNibblesNEON(even, &hi) || !HexNibblesNEON(odd, &lo))
+				return ZT_FAIL;
+			vst1q_u8(output + (i >> 1), vorrq_u8(vshlq_n_u8(hi, 4), lo));
 		}
-		if (i == len)
-			bRet = true;
+#endif
 	}
-	return bRet;
+
+	for (; i < len; i += 2)
+	{
+		wchar_t hiChar = input[i], lowChar = input[i + 1];
+		U8 hiValue = ((U32)hiChar < 0x80) ? hex_values[hiChar] : 0xFF;
+		U8 lowValue = ((U32)lowChar < 0x80) ? hex_values[lowChar] : 0xFF;
+		if ((hiValue | lowValue) & 0xF0)
+			return ZT_FAIL;
+		output[(i >> 1)] = (U8)(hiValue << 4 | lowValue);
+	}
+
+	if (outlen)
+		*outlen = (len >> 1);
+
+	return ZT_OK;
 }
 
+bool zt_IsHexStringEx(const U8* str, size_t len)
+{
+	size_t i = 0;
 
-bool zt_IsHexString(U8* str, U8 len)
+	if (str == NULL || len == 0)
+		return false;
+
+#if defined(ZT_HEX_SSE2)
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)(str + i));
+		if (_mm_movemask_epi8(_mm_or_si128(InRangeSSE2(c, '0', 9), InRangeSSE2(c, 'A', 5))) != 0xFFFF)
+			return false;
+	}
+#elif defined(ZT_HEX_NEON)
+	for (; i + 16 <= len; i += 16)
+	{
+		uint8x16_t c = vld1q_u8(str + i);
+		uint8x16_t ok = vorrq_u8(vcleq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(9)),
+			vcleq_u8(vsubq_u8(c, vdupq_n_u8('A')), vdupq_n_u8(5)));
+		if (vminvq_u8(ok) != 0xFF)
+			return false;
+	}
+#endif
+	for (; i < len; i++)
+	{
+		if (!IS_DIGIT(str[i]) && !IS_UPPER_HEX(str[i]))
+			return false;
+	}
+
+	return true;
+}
+
+bool zt_IsAlphabetStringEx(const U8* str, size_t len)
 {
-	bool bRet = false;
+	size_t i = 0;
 
-	if (str && len)
+	if (str == NULL || len == 0)
+		return false;
+
+#if defined(ZT_HEX_SSE2)
+	for (; i + 16 <= len; i += 16)
 	{
-		U8 i, oneChar;
-		for (i = 0; i < len; i++)
-		{
-			oneChar = str[i];
-			if (oneChar >= '0' && oneChar <= '9')
-				continue;
-			if (oneChar >= 'A' && oneChar <= 'F')
-				continue;
-			break;
-		}
-		if (i == len)
-			bRet = true;
+		__m128i c = _mm_loadu_si128((const __m128i*)(str + i));
+		__m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+		if (_mm_movemask_epi8(_mm_or_si128(InRangeSSE2(c, '0', 9), InRangeSSE2(lower, 'a', 25))) != 0xFFFF)
+			return false;
 	}
-	return bRet;
+#elif defined(ZT_HEX_NEON)
+	for (; i + 16 <= len; i += 16)
+	{
+		uint8x16_t c = vld1q_u8(str + i);
+		uint8x16_t ok = vorrq_u8(vcleq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(9)),
+			vcleq_u8(vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a')), vdupq_n_u8(25)));
+		if (vminvq_u8(ok) != 0xFF)
+			return false;
+	}
+#endif
+	for (; i < len; i++)
+	{
+		if (!IS_DIGIT(str[i]) && !IS_ALPHA(str[i]))
+			return false;
+	}
+
+	return true;
 }
 
-int zt_Raw2HexString(U8* input, U8 len, U8* output, U8* outlen)
+bool zt_IsAlphabetStringWEx(const wchar_t* str, size_t len)
 {
-	U8 idx, i;
-	const U8* hex_chars = (const U8*)"0123456789abcdef";
+	size_t i;
+
+	if (str == NULL || len == 0)
+		return false;
 
 	for (i = 0; i < len; i++)
 	{
-		idx = ((input[i] >> 4) & 0x0F);
-		output[(i << 1)] = hex_chars[idx];
-
-		idx = (input[i] & 0x0F);
-		output[(i << 1) + 1] = hex_chars[idx];
+		wchar_t oneChar = str[i];
+		if ((U32)oneChar >= 0x80 || (!IS_DIGIT(oneChar) && !IS_ALPHA(oneChar)))
+			return false;
 	}
-#if 0
-	output[(i << 1)] = 0;
-#endif 
+
+	return true;
+}
+
+bool zt_IsAlphabetString(U8* str, U8 len)
+{
+	return zt_IsAlphabetStringEx(str, len);
+}
+
+bool zt_IsAlphabetStringW(wchar_t* str, U8 len)
+{
+	return zt_IsAlphabetStringWEx(str, len);
+}
+
+bool zt_IsHexString(U8* str, U8 len)
+{
+	return zt_IsHexStringEx(str, len);
+}
+
+int zt_Raw2HexString(U8* input, U8 len, U8* output, U8* outlen)
+{
+	size_t n = zt_Raw2HexStringEx(input, len, output);
+
 	if (outlen)
-		*outlen = (i << 1);
+		*outlen = (U8)n;
 
 	return 0;
 }
 
 U32 zt_HexString2Raw(U8* input, U8 len, U8* output, U8* outlen)
 {
-	U8 oneChar, hiValue, lowValue, i;
-
-	for (i = 0; i < len; i += 2)
-	{
-		oneChar = input[i];
-		if (oneChar >= '0' && oneChar <= '9')
-			hiValue = oneChar - '0';
-		else if (oneChar >= 'A' && oneChar <= 'F')
-			hiValue = (oneChar - 'A') + 0x0A;
-		else return ZT_FAIL;
+	/* this one has always accepted upper case digits only */
+	if (len && !zt_IsHexStringEx(input, len))
+		return ZT_FAIL;
 
-		oneChar = input[i + 1];
-		if (oneChar >= '0' && oneChar <= '9')
-			lowValue = oneChar - '0';
-		else if (oneChar >= 'A' && oneChar <= 'F')
-			lowValue = (oneChar - 'A') + 0x0A;
-		else return ZT_FAIL;
-
-		output[(i >> 1)] = (hiValue << 4 | lowValue);
-	}
+	if (zt_HexString2RawEx(input, len, output, NULL) != ZT_OK)
+		return ZT_FAIL;
 
 	if (outlen)
 		*outlen = (len >> 1);
@@ -124,30 +350,8 @@ U32 zt_HexString2Raw(U8* input, U8 len, U8* output, U8* outlen)
 
 bool zt_HexString2RawW(wchar_t* input, U8 len, U8* output, U8* outlen)
 {
-	wchar_t oneChar, hiValue, lowValue;
-
-	for (U8 i = 0; i < len; i += 2)
-	{
-		oneChar = input[i];
-		if (oneChar >= L'0' && oneChar <= L'9')
-			hiValue = oneChar - L'0';
-		else if (oneChar >= L'a' && oneChar <= L'f')
-			hiValue = (oneChar - L'a') + 0x0A;
-		else if (oneChar >= L'A' && oneChar <= L'F')
-			hiValue = (oneChar - L'A') + 0x0A;
-		else return false;
-
-		oneChar = input[i + 1];
-		if (oneChar >= L'0' && oneChar <= L'9')
-			lowValue = oneChar - L'0';
-		else if (oneChar >= L'a' && oneChar <= L'f')
-			lowValue = (oneChar - L'a') + 0x0A;
-		else if (oneChar >= L'A' && oneChar <= L'F')
-			lowValue = (oneChar - L'A') + 0x0A;
-		else return false;
-
-		output[(i >> 1)] = (hiValue << 4 | lowValue);
-	}
+	if (zt_HexString2RawWEx(input, len, output, NULL) != ZT_OK)
+		return false;
 
 	if (outlen)
 		*outlen = (len >> 1);
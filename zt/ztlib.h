@@ -106,8 +106,12 @@ extern "C" {
 
 	int zt_siphash(const void*, const size_t, uint8_t*, const size_t);
 
+	uint64_t zt_siphash13(const void*, const size_t, const uint8_t*);
+
 	unsigned int zt_crc32(const unsigned char*, const unsigned int);
 
+	int zt_pbkdf2_sha256(const U8* pass, size_t passlen, const U8* salt, size_t saltlen, U32 iterations, U8* out, size_t outlen);
+
 	U32	zt_UTF8ToUTF16(U8* input, U32 input_len, U16* output, U32* output_len);
 	U32	zt_UTF16ToUTF8(U16* input, U32 input_len, U8* output, U32* output_len);
 
@@ -123,11 +127,99 @@ extern "C" {
 
 	void zt_pfree(void* pointer);
 
+	/*
+	 * Where a memory pool gets its blocks from. alloc_block() is asked for every
+	 * block the pool needs and free_block() gets it back with the same size;
+	 * destroy() is called once when the pool goes away. The pool owns the source
+	 * once it is passed to zt_mempool_create_ex(), even if creation fails.
+	 */
+	typedef struct MemPoolBlockSource
+	{
+		void* (*alloc_block)(void* arg, size_t size);
+		void  (*free_block)(void* arg, void* block, size_t size);
+		void  (*destroy)(void* arg);
+		void* arg;
+	} MemPoolBlockSource;
+
+#define ZT_MEMPOOL_HUGEPAGE		0x01	/* transparent huge pages for blocks of 2 MB and up */
+#define ZT_MEMPOOL_HUGETLB		0x02	/* explicit huge/large pages, falls back to ZT_MEMPOOL_HUGEPAGE */
+#define ZT_MEMPOOL_NUMA_LOCAL	0x04	/* place blocks on the NUMA node of the creating thread */
+
+	MemPoolContext zt_mempool_create_ex(const char*, U32, U32, U32, const MemPoolBlockSource* source);
+
+	/* fills in the virtual-memory block source; numa_node < 0 means no placement */
+	int zt_mempool_vmsource(MemPoolBlockSource* source, U32 flags, int numa_node);
+
+	void zt_mempool_reset(MemPoolContext cxt);
+
+	/*
+	 * Open-addressing hash table with fixed-size keys and values stored inline.
+	 * Keys are hashed with zt_siphash13 under a 16-byte seed unless a hash
+	 * function is given, and compared with memcmp unless an equal function is
+	 * given. Pointers returned by find/insert/next stay valid until the next
+	 * insert. Values of new entries are zero-filled.
+	 */
+	typedef void* HashTable;
+	typedef U64(*HashTableHashFunc)(const void* key, size_t keysize, const U8* seed);
+	typedef bool(*HashTableEqualFunc)(const void* a, const void* b, size_t keysize);
+
+	HashTable zt_hashtable_create(MemPoolContext cxt, size_t keysize, size_t valuesize, size_t initsize,
+		HashTableHashFunc hash, HashTableEqualFunc equal, const U8* seed);
+
+	void zt_hashtable_destroy(HashTable ht);
+
+	void* zt_hashtable_find(HashTable ht, const void* key);
+
+	void* zt_hashtable_insert(HashTable ht, const void* key, bool* found);
+
+	bool zt_hashtable_erase(HashTable ht, const void* key);
+
+	void zt_hashtable_clear(HashTable ht);
+
+	size_t zt_hashtable_count(HashTable ht);
+
+	bool zt_hashtable_next(HashTable ht, size_t* iter, void** key, void** value);
+
+	/*
+	 * AES-256-GCM, streaming interface. A context holds one key and can be
+	 * reused for many messages: call zt_aes256_gcm_start() with a fresh IV,
+	 * feed the AAD, then the text, then zt_aes256_gcm_finish() to produce the
+	 * tag (encryption) or zt_aes256_gcm_verify() to check it (decryption).
+	 * All functions return ZT_OK or ZT_FAIL.
+	 */
+	typedef void* AES256GCMContext;
+
+	int zt_aes256_hwaccel(void);
+
+	AES256GCMContext zt_aes256_gcm_create(const U8* key32);
+
+	void zt_aes256_gcm_destroy(AES256GCMContext cxt);
+
+	int zt_aes256_gcm_start(AES256GCMContext cxt, const U8* iv, size_t ivlen);
+
+	int zt_aes256_gcm_aad(AES256GCMContext cxt, const U8* aad, size_t len);
+
+	int zt_aes256_gcm_encrypt(AES256GCMContext cxt, const U8* input, U8* output, size_t len);
+
+	int zt_aes256_gcm_decrypt(AES256GCMContext cxt, const U8* input, U8* output, size_t len);
+
+	int zt_aes256_gcm_finish(AES256GCMContext cxt, U8* tag, size_t taglen);
+
+	int zt_aes256_gcm_verify(AES256GCMContext cxt, const U8* tag, size_t taglen);
+
 	int zt_Raw2HexString(U8* input, U8 len, U8* output, U8* outlen);
 
 	bool zt_IsAlphabetStringW(wchar_t*, U8);
 	bool zt_HexString2RawW(wchar_t*, U8, U8*, U8*);
 
+	/* size_t-length versions of the above, the output of zt_Raw2HexStringEx is lower case */
+	size_t zt_Raw2HexStringEx(const U8* input, size_t len, U8* output);
+	int zt_HexString2RawEx(const U8* input, size_t len, U8* output, size_t* outlen);
+	int zt_HexString2RawWEx(const wchar_t* input, size_t len, U8* output, size_t* outlen);
+	bool zt_IsHexStringEx(const U8* str, size_t len);
+	bool zt_IsAlphabetStringEx(const U8* str, size_t len);
+	bool zt_IsAlphabetStringWEx(const wchar_t* str, size_t len);
+
 #ifdef __cplusplus
 }
 #endif